@@ -27,6 +27,7 @@
 # include  "verinum.h"
 # include  "LineInfo.h"
 # include  "pform_types.h"
+# include  "size_pool.h"
 
 class Design;
 class Module;
@@ -60,6 +61,10 @@ class PExpr : public LineInfo {
       PExpr();
       virtual ~PExpr();
 
+	// Expressions are allocated from the pform pool.
+      static void* operator new(size_t size) { return pform_pool.alloc(size); }
+      static void operator delete(void*ptr, size_t size) { pform_pool.free(ptr, size); }
+
       virtual void dump(ostream&) const;
 
         // This method tests whether the expression contains any identifiers
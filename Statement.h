@@ -30,6 +30,7 @@
 # include  "PScope.h"
 # include  "HName.h"
 # include  "LineInfo.h"
+# include  "size_pool.h"
 class PExpr;
 class PChainConstructor;
 class PPackage;
@@ -81,6 +82,10 @@ class Statement : public LineInfo {
       Statement() { }
       virtual ~Statement() =0;
 
+	// Statements are allocated from the pform pool.
+      static void* operator new(size_t size) { return pform_pool.alloc(size); }
+      static void operator delete(void*ptr, size_t size) { pform_pool.free(ptr, size); }
+
       virtual void dump(ostream&out, unsigned ind) const;
       virtual NetProc* elaborate(Design*des, NetScope*scope) const;
       virtual void elaborate_scope(Design*des, NetScope*scope) const;
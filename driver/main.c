@@ -397,6 +397,94 @@ static int t_preprocess_only(void)
       return 0;
 }
 
+#ifndef __MINGW32__
+/*
+ * Make a single argument word from a flag and a value. This is the
+ * exec() equivalent of the -X"value" strings that the shell commands
+ * use, so no quoting is needed.
+ */
+static char* make_arg(const char*flag, const char*val)
+{
+      char*arg = malloc(strlen(flag) + strlen(val) + 1);
+      strcpy(arg, flag);
+      strcat(arg, val);
+      return arg;
+}
+
+/*
+ * Start the program in argv with the given stdin/stdout descriptors.
+ * A descriptor of -1 means inherit ours. All the pipe ends that the
+ * child does not use must be listed in close_fds so that the reader
+ * sees EOF when the writer exits.
+ */
+static pid_t spawn_program(char*const argv[], int in_fd, int out_fd,
+			   const int close_fds[], unsigned nclose)
+{
+      pid_t pid = fork();
+      if (pid != 0)
+	    return pid;
+
+      if (in_fd >= 0) {
+	    dup2(in_fd, 0);
+	    close(in_fd);
+      }
+      if (out_fd >= 0) {
+	    dup2(out_fd, 1);
+	    close(out_fd);
+      }
+      for (unsigned idx = 0 ; idx < nclose ; idx += 1)
+	    close(close_fds[idx]);
+
+      execv(argv[0], argv);
+      fprintf(stderr, "%s: %s\n", argv[0], strerror(errno));
+      _exit(127);
+}
+
+/*
+ * Run ivlpp and ivl as two processes connected directly by a pipe,
+ * with no shell in between. The compiler parses the preprocessed text
+ * as it is produced, so the two phases overlap. The result is a wait
+ * status in the same form system() returns: the status of ivl unless
+ * ivl succeeded and the preprocessor did not.
+ */
+static int run_compile_pipeline(char*const pp_argv[], char*const ivl_argv[])
+{
+      int fds[2];
+      int pp_status = 0, ivl_status = 0;
+
+      fflush(0);
+      if (pipe(fds) < 0) {
+	    perror("pipe");
+	    return -1;
+      }
+
+      pid_t pp_pid = spawn_program(pp_argv, -1, fds[1], fds, 2);
+      if (pp_pid < 0) {
+	    perror("fork");
+	    close(fds[0]);
+	    close(fds[1]);
+	    return -1;
+      }
+
+      pid_t ivl_pid = spawn_program(ivl_argv, fds[0], -1, fds, 2);
+      close(fds[0]);
+      close(fds[1]);
+      if (ivl_pid < 0) {
+	    perror("fork");
+	    waitpid(pp_pid, &pp_status, 0);
+	    return -1;
+      }
+
+      waitpid(ivl_pid, &ivl_status, 0);
+      waitpid(pp_pid, &pp_status, 0);
+
+      if (ivl_status != 0)
+	    return ivl_status;
+
+      return pp_status;
+}
+#endif
+
 /*
  * This is the default target type. It looks up the bits that are
  * needed to run the command from the configuration file (which is
@@ -456,8 +544,38 @@ static int t_compile(void)
       if (verbose_flag)
 	    printf("translate: %s\n", cmd);
 
-
+#ifdef __MINGW32__
       rc = system(cmd);
+#else
+      { char*pp_argv[8];
+	char*ivl_argv[10];
+	unsigned npp = 0, nivl = 0;
+
+	snprintf(tmp, sizeof tmp, "%s%civlpp", ivlpp_dir, sep);
+	pp_argv[npp++] = strdup(tmp);
+	if (verbose_flag) pp_argv[npp++] = strdup("-v");
+	pp_argv[npp++] = strdup("-L");
+	pp_argv[npp++] = make_arg("-F", defines_path);
+	pp_argv[npp++] = make_arg("-f", source_path);
+	pp_argv[npp++] = make_arg("-p", compiled_defines_path);
+	pp_argv[npp] = 0;
+
+	snprintf(tmp, sizeof tmp, "%s%civl", base, sep);
+	ivl_argv[nivl++] = strdup(tmp);
+	if (verbose_flag) ivl_argv[nivl++] = strdup("-v");
+	if (npath != 0) ivl_argv[nivl++] = make_arg("-N", npath);
+	ivl_argv[nivl++] = make_arg("-C", iconfig_path);
+	ivl_argv[nivl++] = make_arg("-C", iconfig_common_path);
+	ivl_argv[nivl++] = strdup("--");
+	ivl_argv[nivl++] = strdup("-");
+	ivl_argv[nivl] = 0;
+
+	rc = run_compile_pipeline(pp_argv, ivl_argv);
+
+	for (unsigned idx = 0 ; idx < npp ; idx += 1) free(pp_argv[idx]);
+	for (unsigned idx = 0 ; idx < nivl ; idx += 1) free(ivl_argv[idx]);
+      }
+#endif
       if ( ! getenv("IVERILOG_ICONFIG")) {
 	    remove(source_path);
 	    free(source_path);
@@ -474,7 +592,8 @@ static int t_compile(void)
 #else
       rtn = 0;
       if (rc != 0) {
-	    if (rc == 127) {
+	    if (rc == 127 || (int)rc == -1
+		|| (WIFEXITED(rc) && WEXITSTATUS(rc) == 127)) {
 		  fprintf(stderr, "Failed to execute: %s\n", cmd);
 		  rtn = 1;
 	    } else if (WIFEXITED(rc)) {
@@ -939,9 +939,27 @@ bool Module::elaborate_scope(Design*des, NetScope*scope,
       }
 
 	// Gates include modules, which might introduce new scopes, so
-	// scan all of them to create those scopes.
+	// scan all of them to create those scopes. Start with a quick
+	// pass that gets any library modules we will need preprocessing
+	// in parallel while the scopes are elaborated.
 
       typedef list<PGate*>::const_iterator gates_it_t;
+      for (gates_it_t cur = gates_.begin()
+		 ; cur != gates_.end() ; ++ cur ) {
+
+	    const PGModule*mod = dynamic_cast<const PGModule*>(*cur);
+	    if (mod == 0)
+		  continue;
+
+	    perm_string type = mod->get_type();
+	    if (pform_modules.find(type) != pform_modules.end())
+		  continue;
+	    if (pform_primitives.find(type) != pform_primitives.end())
+		  continue;
+
+	    prefetch_module(type);
+      }
+
       for (gates_it_t cur = gates_.begin()
 		 ; cur != gates_.end() ; ++ cur ) {
 
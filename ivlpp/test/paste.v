@@ -0,0 +1,5 @@
+/*
+ * Check that `` in an included file gets the Icarus stringify
+ * handling, while `` in the text of a macro still pastes tokens.
+ */
+`include "paste.vh"
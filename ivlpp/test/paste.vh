@@ -0,0 +1,4 @@
+`define MSG hello
+`define CAT(a,b) a``b
+initial $display(``MSG);
+wire `CAT(fo,o);
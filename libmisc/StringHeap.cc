@@ -29,6 +29,71 @@ static char **string_pool = NULL;
 static unsigned string_pool_count = 0;
 #endif
 
+/*
+ * This is the table of interned strings, shared by all the string
+ * heaps. It is an open-addressed hash table of pointers to permanent
+ * copies of the strings. Strings are never removed, since they are
+ * permanent, so the table only ever grows.
+ */
+static const char**intern_table = 0;
+static size_t intern_mask = 0;
+static size_t intern_count = 0;
+
+static unsigned hash_string(const char*text)
+{
+      unsigned h = 0;
+
+      while (*text) {
+	    h = (h << 4) ^ (h >> 28) ^ *text;
+	    text += 1;
+      }
+      return h;
+}
+
+static void intern_grow(void)
+{
+      const char**old = intern_table;
+      size_t old_size = old? intern_mask+1 : 0;
+
+      intern_mask = old_size? 2*old_size-1 : 4095;
+      intern_table = new const char*[intern_mask+1];
+      for (size_t idx = 0 ; idx <= intern_mask ; idx += 1)
+	    intern_table[idx] = 0;
+
+      for (size_t idx = 0 ; idx < old_size ; idx += 1) {
+	    if (old[idx] == 0)
+		  continue;
+	    size_t cur = hash_string(old[idx]) & intern_mask;
+	    while (intern_table[cur])
+		  cur = (cur+1) & intern_mask;
+	    intern_table[cur] = old[idx];
+      }
+
+      delete[]old;
+}
+
+/*
+ * Return the slot for this text in the intern table. If the slot is
+ * empty, the string is not interned yet and the caller is expected to
+ * fill the slot with a permanent copy and call intern_added().
+ */
+static const char** intern_slot(const char*text)
+{
+      if (2*(intern_count+1) > intern_mask)
+	    intern_grow();
+
+      size_t idx = hash_string(text) & intern_mask;
+      while (intern_table[idx] && strcmp(intern_table[idx], text) != 0)
+	    idx = (idx+1) & intern_mask;
+
+      return intern_table + idx;
+}
+
+static void intern_added(void)
+{
+      intern_count += 1;
+}
+
 StringHeap::StringHeap()
 {
       cell_base_ = 0;
@@ -73,7 +138,24 @@ const char* StringHeap::add(const char*text)
 
 perm_string StringHeap::make(const char*text)
 {
-      return perm_string(add(text));
+      const char**slot = intern_slot(text);
+      if (*slot == 0) {
+	    *slot = add(text);
+	    intern_added();
+      }
+      return perm_string(*slot);
+}
+
+perm_string perm_string::literal(const char*text)
+{
+	// Literals are already permanent, so the literal itself can
+	// become the interned copy.
+      const char**slot = intern_slot(text);
+      if (*slot == 0) {
+	    *slot = text;
+	    intern_added();
+      }
+      return perm_string(*slot);
 }
 
 
@@ -81,9 +163,6 @@ StringHeapLex::StringHeapLex()
 {
       hit_count_ = 0;
       add_count_ = 0;
-
-      for (unsigned idx = 0 ;  idx < HASH_SIZE ;  idx += 1)
-	    hash_table_[idx] = 0;
 }
 
 StringHeapLex::~StringHeapLex()
@@ -100,9 +179,10 @@ void StringHeapLex::cleanup()
       string_pool = NULL;
       string_pool_count = 0;
 
-      for (unsigned idx = 0 ;  idx < HASH_SIZE ;  idx += 1) {
-	    hash_table_[idx] = 0;
-      }
+      delete[]intern_table;
+      intern_table = 0;
+      intern_mask = 0;
+      intern_count = 0;
 #endif
 }
 
@@ -116,37 +196,24 @@ unsigned StringHeapLex::add_count() const
       return add_count_;
 }
 
-static unsigned hash_string(const char*text)
-{
-      unsigned h = 0;
-
-      while (*text) {
-	    h = (h << 4) ^ (h >> 28) ^ *text;
-	    text += 1;
-      }
-      return h;
-}
-
 const char* StringHeapLex::add(const char*text)
 {
-      unsigned hash_value = hash_string(text) % HASH_SIZE;
+      const char**slot = intern_slot(text);
 
-	/* If we easily find the string in the hash table, then return
-	   that and be done. */
-      if (hash_table_[hash_value]
-	  && (strcmp(hash_table_[hash_value], text) == 0)) {
+	/* If the string is already interned, then return that and be
+	   done. */
+      if (*slot) {
 	    hit_count_ += 1;
-	    return hash_table_[hash_value];
+	    return *slot;
       }
 
-	/* The existing hash entry is not a match. Replace it with the
-	   newly allocated value, and return the new pointer as the
-	   result to the add. */
-      const char*res = StringHeap::add(text);
-      hash_table_[hash_value] = res;
+	/* This is a new string. Make a permanent copy in this heap and
+	   make that the interned copy. */
+      *slot = StringHeap::add(text);
+      intern_added();
       add_count_ += 1;
 
-      return res;
+      return *slot;
 }
 
 perm_string StringHeapLex::make(const char*text)
@@ -173,21 +240,11 @@ bool operator == (perm_string a, const char*b)
       return false;
 }
 
-bool operator == (perm_string a, perm_string b)
-{
-      return a == b.str();
-}
-
 bool operator != (perm_string a, const char*b)
 {
       return ! (a == b);
 }
 
-bool operator != (perm_string a, perm_string b)
-{
-      return ! (a == b);
-}
-
 bool operator < (perm_string a, perm_string b)
 {
       if (b.str() && !a.str())
@@ -20,6 +20,8 @@
  */
 
 # include  <string>
+# include  <cstddef>
+# include  <stdint.h>
 
 using namespace std;
 
@@ -40,8 +42,10 @@ class perm_string {
 
 	// This is an escape for making perm_string objects out of
 	// literals. For example, perm_string::literal("Label"); Please
-	// do *not* cheat and pass arbitrary const char* items here.
-      static perm_string literal(const char*t) { return perm_string(t); }
+	// do *not* cheat and pass arbitrary const char* items here. The
+	// literal is interned, so the result is pointer-equal to any
+	// other perm_string with the same text.
+      static perm_string literal(const char*t);
 
     private:
       friend class StringHeap;
@@ -52,10 +56,17 @@ class perm_string {
       const char*text_;
 };
 
+/*
+ * All perm_string objects are interned (see StringHeapLex) so two
+ * perm_strings are equal exactly when they point to the same text.
+ */
+inline bool operator == (perm_string a, perm_string b)
+{ return a.str() == b.str(); }
+inline bool operator != (perm_string a, perm_string b)
+{ return a.str() != b.str(); }
+
 extern const perm_string empty_perm_string;
-extern bool operator == (perm_string a, perm_string b);
 extern bool operator == (perm_string a, const char* b);
-extern bool operator != (perm_string a, perm_string b);
 extern bool operator != (perm_string a, const char* b);
 extern bool operator >  (perm_string a, perm_string b);
 extern bool operator <  (perm_string a, perm_string b);
@@ -63,6 +74,111 @@ extern bool operator >= (perm_string a, perm_string b);
 extern bool operator <= (perm_string a, perm_string b);
 extern ostream& operator << (ostream&out, perm_string that);
 
+/*
+ * Since perm_string objects are interned, a hash on the pointer is
+ * as good as a hash on the text, and much cheaper. This is a small
+ * open-addressed table from perm_string to a value that makes use of
+ * that. It keeps no order, so it is meant to be a lookup index kept
+ * alongside an ordered container that is used for iteration. Missing
+ * keys find the default value of T.
+ */
+template <class T> class perm_string_index {
+
+    public:
+      perm_string_index() : table_(0), mask_(0), count_(0), shift_(63) { }
+      ~perm_string_index() { delete[]table_; }
+
+      T find(perm_string key) const
+      {
+	    if (count_ == 0) return T();
+	    for (size_t idx = hash_(key) ; ; idx = (idx+1) & mask_) {
+		  if (table_[idx].key == key.str()) return table_[idx].val;
+		  if (table_[idx].key == 0) return T();
+	    }
+      }
+
+      void insert(perm_string key, const T&val)
+      {
+	    if (2*(count_+1) > mask_) grow_();
+	    insert_(key.str(), val);
+      }
+
+      void erase(perm_string key)
+      {
+	    if (count_ == 0) return;
+	    size_t idx = hash_(key);
+	    while (table_[idx].key != key.str()) {
+		  if (table_[idx].key == 0) return;
+		  idx = (idx+1) & mask_;
+	    }
+	    table_[idx].key = 0;
+	    count_ -= 1;
+
+	      // Move back any following entries of the probe run that
+	      // can no longer be reached past the hole.
+	    for (size_t nxt = (idx+1) & mask_ ; table_[nxt].key
+		       ; nxt = (nxt+1) & mask_) {
+		  size_t home = hash_ptr_(table_[nxt].key);
+		  if (((nxt - home) & mask_) >= ((nxt - idx) & mask_)) {
+			table_[idx] = table_[nxt];
+			table_[nxt].key = 0;
+			idx = nxt;
+		  }
+	    }
+      }
+
+    private:
+      struct cell_t {
+	    cell_t() : key(0), val() { }
+	    const char*key;
+	    T val;
+      };
+
+      void insert_(const char*key, const T&val)
+      {
+	    size_t idx = hash_ptr_(key);
+	    while (table_[idx].key && table_[idx].key != key)
+		  idx = (idx+1) & mask_;
+	    if (table_[idx].key == 0) count_ += 1;
+	    table_[idx].key = key;
+	    table_[idx].val = val;
+      }
+
+	// Strings are packed at byte granularity, so the low bits of the
+	// pointers are not much use by themselves. Fibonacci hashing
+	// mixes every bit of the pointer into the top of the product,
+	// and the top bits are the ones that index the table.
+      size_t hash_ptr_(const char*ptr) const
+      { return (size_t)(((uint64_t)(size_t)ptr * 0x9e3779b97f4a7c15ULL) >> shift_); }
+      size_t hash_(perm_string key) const
+      { return hash_ptr_(key.str()); }
+
+      void grow_()
+      {
+	    cell_t*old = table_;
+	    size_t old_size = table_? mask_+1 : 0;
+	    mask_ = old_size? 2*old_size-1 : 15;
+	    shift_ = old_size? shift_-1 : 60;
+	    table_ = new cell_t[mask_+1];
+	    count_ = 0;
+	    for (size_t idx = 0 ; idx < old_size ; idx += 1) {
+		  if (old[idx].key == 0) continue;
+		  insert_(old[idx].key, old[idx].val);
+	    }
+	    delete[]old;
+      }
+
+      cell_t*table_;
+      size_t mask_;
+      size_t count_;
+	// 64 less the log2 of the table size.
+      unsigned shift_;
+
+    private: // not implemented
+      perm_string_index(const perm_string_index&);
+      perm_string_index& operator= (const perm_string_index&);
+};
+
 /*
  * The string heap is a way to permanently allocate strings
  * efficiently. They only take up the space of the string characters
@@ -90,10 +206,12 @@ class StringHeap {
 };
 
 /*
- * A lexical string heap is a string heap that makes an effort to
- * return the same pointer for identical strings. This saves further
- * space by not allocating duplicate strings, so in a system with lots
- * of identifiers, this can theoretically save more space.
+ * A lexical string heap is a string heap that returns the same
+ * pointer for identical strings. The table of known strings is shared
+ * by all the lexical heaps (and by perm_string::literal) so that any
+ * two perm_string objects with the same text have the same pointer,
+ * no matter which heap made them. This saves space, and makes
+ * perm_string equality a pointer compare.
  */
 class StringHeapLex  : private StringHeap {
 
@@ -110,9 +228,6 @@ class StringHeapLex  : private StringHeap {
       void cleanup();
 
     private:
-      enum { HASH_SIZE = 4096 };
-      const char*hash_table_[HASH_SIZE];
-
       unsigned add_count_;
       unsigned hit_count_;
 
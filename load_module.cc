@@ -51,12 +51,22 @@ extern char depfile_mode;
 extern FILE *depend_file;
 
 /*
- * Use the type name as a key, and search the module library for a
- * file name that has that key.
+ * Library files that have a preprocessor already running on them. Each
+ * library file is preprocessed from the same compiled defines, so no
+ * `define state is shared between them, and several can safely be
+ * preprocessed at once. The parser then reads the stream when the
+ * module is actually needed.
  */
-bool load_module(const char*type)
+static map<string,FILE*> prefetch_map;
+static const unsigned prefetch_max = 16;
+
+/*
+ * Find the library file that holds the module type. Return false if
+ * there is none, otherwise write the full file name into path.
+ */
+static bool find_module_file(const char*type, char*path, size_t npath)
 {
-      char path[4096];
+      bool rc = false;
       char*ltype = strdup(type);
 
       for (char*tmp = ltype ; *tmp ;  tmp += 1)
@@ -71,7 +81,78 @@ bool load_module(const char*type)
 	    if (cur == lcur->name_map.end())
 		  continue;
 
-	    sprintf(path, "%s%c%s", lcur->dir, dir_character, (*cur).second);
+	    snprintf(path, npath, "%s%c%s", lcur->dir, dir_character,
+		     (*cur).second);
+	    rc = true;
+	    break;
+      }
+
+      free(ltype);
+      return rc;
+}
+
+static FILE* open_preprocessed(const char*path)
+{
+      char*cmdline = (char*)malloc(strlen(ivlpp_string) +
+				   strlen(path) + 4);
+      strcpy(cmdline, ivlpp_string);
+      strcat(cmdline, " \"");
+      strcat(cmdline, path);
+      strcat(cmdline, "\"");
+
+      if (verbose_flag)
+	    cerr << "Executing: " << cmdline << endl<< flush;
+
+      FILE*file = popen(cmdline, "r");
+      free(cmdline);
+      return file;
+}
+
+/*
+ * Start the preprocessor on the library file for this module type, if
+ * there is one, but do not parse it yet. This lets the caller get all
+ * the library files it is about to need preprocessing in parallel.
+ */
+void prefetch_module(const char*type)
+{
+      char path[4096];
+
+      if (ivlpp_string == 0)
+	    return;
+      if (prefetch_map.size() >= prefetch_max)
+	    return;
+      if (! find_module_file(type, path, sizeof path))
+	    return;
+      if (prefetch_map.find(path) != prefetch_map.end())
+	    return;
+
+      FILE*file = open_preprocessed(path);
+      if (file)
+	    prefetch_map[path] = file;
+}
+
+/*
+ * Close any prefetched streams that were never needed. This will
+ * terminate the preprocessors that are still writing to them.
+ */
+void prefetch_module_cleanup(void)
+{
+      for (map<string,FILE*>::iterator cur = prefetch_map.begin()
+		 ; cur != prefetch_map.end() ; ++ cur) {
+	    pclose(cur->second);
+      }
+      prefetch_map.clear();
+}
+
+/*
+ * Use the type name as a key, and search the module library for a
+ * file name that has that key.
+ */
+bool load_module(const char*type)
+{
+      char path[4096];
+
+      if (find_module_file(type, path, sizeof path)) {
 
 	    if(depend_file) {
                   if (depfile_mode == 'p') {
@@ -83,24 +164,20 @@ bool load_module(const char*type)
 	    }
 
 	    if (ivlpp_string) {
-		  char*cmdline = (char*)malloc(strlen(ivlpp_string) +
-					       strlen(path) + 4);
-		  strcpy(cmdline, ivlpp_string);
-		  strcat(cmdline, " \"");
-		  strcat(cmdline, path);
-		  strcat(cmdline, "\"");
-
-		  if (verbose_flag)
-			cerr << "Executing: " << cmdline << endl<< flush;
-
-		  FILE*file = popen(cmdline, "r");
+		  FILE*file;
+		  map<string,FILE*>::iterator pre = prefetch_map.find(path);
+		  if (pre != prefetch_map.end()) {
+			file = pre->second;
+			prefetch_map.erase(pre);
+		  } else {
+			file = open_preprocessed(path);
+		  }
 
 		  if (verbose_flag)
 			cerr << "...parsing output from preprocessor..." << endl << flush;
 
 		  pform_parse(path, file);
 		  pclose(file);
-		  free(cmdline);
 
 	    } else {
 		  if (verbose_flag)
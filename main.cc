@@ -753,6 +753,7 @@ static void read_iconfig_file(const char*ipath)
 }
 
 extern Design* elaborate(list <perm_string> root);
+extern void prefetch_module_cleanup(void);
 
 #if defined(HAVE_TIMES)
 static double cycles_diff(struct tms *a, struct tms *b)
@@ -1118,6 +1119,7 @@ int main(int argc, char*argv[])
 
 	/* On with the process of elaborating the module. */
       Design*des = elaborate(roots);
+      prefetch_module_cleanup();
 
       if ((des == 0) || (des->errors > 0)) {
 	    if (des != 0) {
@@ -326,17 +326,16 @@ bool NetScope::make_parameter_unannotatable(perm_string key)
 
 /*
  * NOTE: This method takes a const char* as a key to lookup a
- * parameter, because we don't save that pointer. However, due to the
- * way the map<> template works, we need to *cheat* and use the
- * perm_string::literal method to fake the compiler into doing the
- * compare without actually creating a perm_string.
+ * parameter, because we don't save that pointer. The key must be
+ * interned before it can be compared with the parameter names, and
+ * perm_string::literal would keep the pointer, so intern a copy.
  */
 const NetExpr* NetScope::get_parameter(Design*des,
 				       const char* key,
 				       const NetExpr*&msb,
 				       const NetExpr*&lsb)
 {
-      return get_parameter(des, perm_string::literal(key), msb, lsb);
+      return get_parameter(des, lex_strings.make(key), msb, lsb);
 }
 
 const NetExpr* NetScope::get_parameter(Design*des,
@@ -613,8 +612,9 @@ void NetScope::add_genvar(perm_string name, LineInfo *li)
 
 LineInfo* NetScope::find_genvar(perm_string name)
 {
-      if (genvars_.find(name) != genvars_.end())
-	    return genvars_[name];
+      map<perm_string,LineInfo*>::const_iterator cur = genvars_.find(name);
+      if (cur != genvars_.end())
+	    return cur->second;
       else
             return 0;
 }
@@ -622,12 +622,14 @@ LineInfo* NetScope::find_genvar(perm_string name)
 void NetScope::add_signal(NetNet*net)
 {
       signals_map_[net->name()]=net;
+      signals_index_.insert(net->name(), net);
 }
 
 void NetScope::rem_signal(NetNet*net)
 {
       assert(net->scope() == this);
       signals_map_.erase(net->name());
+      signals_index_.erase(net->name());
 }
 
 /*
@@ -637,10 +639,7 @@ void NetScope::rem_signal(NetNet*net)
  */
 NetNet* NetScope::find_signal(perm_string key)
 {
-      if (signals_map_.find(key)!=signals_map_.end())
-	    return signals_map_[key];
-      else
-	    return 0;
+      return signals_index_.find(key);
 }
 
 netclass_t*NetScope::find_class(perm_string name)
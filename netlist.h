@@ -45,6 +45,7 @@
 # include  "LineInfo.h"
 # include  "Attrib.h"
 # include  "PUdp.h"
+# include  "size_pool.h"
 
 #ifdef HAVE_IOSFWD
 # include  <iosfwd>
@@ -206,6 +207,10 @@ class NetPins : public LineInfo {
       explicit NetPins(unsigned npins);
       virtual ~NetPins();
 
+	// Netlist nodes are allocated from the netlist pool.
+      static void* operator new(size_t size) { return netlist_pool.alloc(size); }
+      static void operator delete(void*ptr, size_t size) { netlist_pool.free(ptr, size); }
+
       unsigned pin_count() const { return npins_; }
 
       Link&pin(unsigned idx);
@@ -1243,8 +1248,12 @@ class NetScope : public Definitions, public Attrib {
 
       map<perm_string,LineInfo*> genvars_;
 
+	// The signals are kept in name order so that everything that
+	// iterates over them is deterministic. Lookups by name go
+	// through the hashed index instead.
       typedef std::map<perm_string,NetNet*>::const_iterator signals_map_iter_t;
       std::map <perm_string,NetNet*> signals_map_;
+      perm_string_index<NetNet*> signals_index_;
       perm_string module_name_;
       vector<NetNet*> port_nets;
 
@@ -1927,6 +1936,10 @@ class NetExpr  : public LineInfo {
       explicit NetExpr(ivl_type_t t);
       virtual ~NetExpr() =0;
 
+	// Expressions are allocated from the netlist pool.
+      static void* operator new(size_t size) { return netlist_pool.alloc(size); }
+      static void operator delete(void*ptr, size_t size) { netlist_pool.free(ptr, size); }
+
       virtual void expr_scan(struct expr_scan_t*) const =0;
       virtual void dump(ostream&) const;
 
@@ -2569,6 +2582,10 @@ class NetProc : public virtual LineInfo {
       explicit NetProc();
       virtual ~NetProc();
 
+	// Statements are allocated from the netlist pool.
+      static void* operator new(size_t size) { return netlist_pool.alloc(size); }
+      static void operator delete(void*ptr, size_t size) { netlist_pool.free(ptr, size); }
+
 	// Find the nexa that are input by the statement. This is used
 	// for example by @* to find the inputs to the process for the
 	// sensitivity list.
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2015 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  "config.h"
+# include  "size_pool.h"
+# include  <new>
+# include  <cassert>
+
+size_pool_t pform_pool;
+size_pool_t netlist_pool;
+
+/*
+ * The free list for this size is empty, so take a new block from the
+ * current chunk, getting a new chunk if needed. The size is already
+ * rounded up to a multiple of GRAIN, so blocks stay aligned.
+ */
+void* size_pool_t::alloc_slow_(size_t size)
+{
+      assert(size <= MAX_SIZE && size % GRAIN == 0);
+
+      if (chunk_remaining_ < size) {
+	      // Put what is left of the old chunk on the free lists
+	      // so that it is not wasted.
+	    while (chunk_remaining_ >= GRAIN) {
+		  size_t use = chunk_remaining_;
+		  if (use > MAX_SIZE) use = MAX_SIZE - MAX_SIZE % GRAIN;
+		  use -= use % GRAIN;
+		  free(chunk_ptr_, use);
+		  chunk_ptr_ += use;
+		  chunk_remaining_ -= use;
+	    }
+
+	    chunk_ptr_ = static_cast<char*>(::operator new(CHUNK_SIZE));
+	    chunk_remaining_ = CHUNK_SIZE;
+	    chunk_count_ += 1;
+      }
+
+      void*res = chunk_ptr_;
+      chunk_ptr_ += size;
+      chunk_remaining_ -= size;
+      return res;
+}
@@ -0,0 +1,96 @@
+#ifndef IVL_size_pool_H
+#define IVL_size_pool_H
+/*
+ * Copyright (c) 2015 Stephen Williams (steve@icarus.com)
+ *
+ *    This source code is free software; you can redistribute it
+ *    and/or modify it in source code form under the terms of the GNU
+ *    General Public License as published by the Free Software
+ *    Foundation; either version 2 of the License, or (at your option)
+ *    any later version.
+ *
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *    GNU General Public License for more details.
+ *
+ *    You should have received a copy of the GNU General Public License
+ *    along with this program; if not, write to the Free Software
+ *    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+# include  <cstddef>
+
+/*
+ * The size_pool_t is an allocator for the many small objects that the
+ * compiler creates. Memory is carved out of large chunks, and freed
+ * blocks go onto a free list for their size, where the next
+ * allocation of that size finds them. Blocks larger than MAX_SIZE are
+ * passed to the global allocator.
+ *
+ * Each phase of the compiler has its own pool (pform_pool for the
+ * parse tree and netlist_pool for the elaborated design) so that the
+ * objects of a phase are packed together in memory. The chunks are
+ * never returned: like the string heap, this is a planned leak, and
+ * the compiler exits without visiting every object to delete it.
+ *
+ * The pools are static objects with no constructor, so they are
+ * zero-initialized and ready before any other static constructors
+ * run.
+ */
+class size_pool_t {
+
+    public:
+      inline void* alloc(size_t size);
+      inline void  free(void*ptr, size_t size);
+
+	// Number of chunks allocated so far.
+      unsigned chunk_count() const { return chunk_count_; }
+
+    public:
+      enum { GRAIN = 16, MAX_SIZE = 512, CHUNK_SIZE = 0x10000 };
+
+      struct cell_t { cell_t*next; };
+
+      void* alloc_slow_(size_t size);
+
+      cell_t*free_[MAX_SIZE/GRAIN + 1];
+      char*chunk_ptr_;
+      size_t chunk_remaining_;
+      unsigned chunk_count_;
+};
+
+inline void* size_pool_t::alloc(size_t size)
+{
+      if (size > MAX_SIZE)
+	    return ::operator new(size);
+
+      unsigned idx = (size + GRAIN - 1) / GRAIN;
+      if (cell_t*cur = free_[idx]) {
+	    free_[idx] = cur->next;
+	    return cur;
+      }
+
+      return alloc_slow_(idx * GRAIN);
+}
+
+inline void size_pool_t::free(void*ptr, size_t size)
+{
+      if (ptr == 0)
+	    return;
+
+      if (size > MAX_SIZE) {
+	    ::operator delete(ptr);
+	    return;
+      }
+
+      unsigned idx = (size + GRAIN - 1) / GRAIN;
+      cell_t*cur = static_cast<cell_t*>(ptr);
+      cur->next = free_[idx];
+      free_[idx] = cur;
+}
+
+extern size_pool_t pform_pool;
+extern size_pool_t netlist_pool;
+
+#endif /* IVL_size_pool_H */
@@ -107,7 +107,8 @@ inline const char*dlerror(void)
  * The custom new operator for the ivl_nexus_s type allows us to
  * allocate nexus objects in blocks. There are generally lots of them
  * permanently allocated, and allocating them in blocks reduces the
- * allocation overhead.
+ * allocation overhead. The pool is raw memory: the objects are
+ * constructed by the new expression that allocates them.
  */
 
 template <class TYPE> void* pool_permalloc(size_t s)
@@ -118,7 +119,7 @@ template <class TYPE> void* pool_permalloc(size_t s)
 
       assert(s == sizeof(TYPE));
       if (pool_remaining <= 0) {
-	    pool_ptr = new TYPE[POOL_SIZE];
+	    pool_ptr = static_cast<TYPE*>(::operator new(POOL_SIZE*sizeof(TYPE)));
 	    pool_remaining = POOL_SIZE;
       }
 
@@ -309,10 +310,86 @@ ivl_signal_t dll_target::find_signal(ivl_design_s &des, const NetNet*net)
       return 0;
 }
 
-static ivl_nexus_t nexus_sig_make(ivl_signal_t net, unsigned pin)
+/*
+ * The ivl_nexus_ptr_s arrays of all the nexus objects are carved out
+ * of large permanently allocated blocks. Very large arrays (the
+ * fan-out of clocks and resets) get their own allocation.
+ */
+static ivl_nexus_ptr_s* nexus_ptrs_alloc(unsigned count)
+{
+      static ivl_nexus_ptr_s*block_ptr = 0;
+      static unsigned block_remaining = 0;
+      static const unsigned BLOCK_SIZE = 0x10000;
+
+      if (count > BLOCK_SIZE/16)
+	    return new ivl_nexus_ptr_s[count];
+
+      if (count > block_remaining) {
+	    block_ptr = new ivl_nexus_ptr_s[BLOCK_SIZE];
+	    block_remaining = BLOCK_SIZE;
+      }
+
+      ivl_nexus_ptr_s*tmp = block_ptr;
+      block_ptr += count;
+      block_remaining -= count;
+      return tmp;
+}
+
+/*
+ * Make room in the nexus for at least count items.
+ */
+static void nexus_reserve(ivl_nexus_t nex, unsigned count)
+{
+      if (count <= nex->cap_)
+	    return;
+
+      ivl_nexus_ptr_s*tmp = nexus_ptrs_alloc(count);
+      for (unsigned idx = 0 ; idx < nex->nptrs_ ; idx += 1)
+	    tmp[idx] = nex->ptrs_[idx];
+
+	// The old array is part of the permanent pool, so it is
+	// simply abandoned.
+      nex->ptrs_ = tmp;
+      nex->cap_ = count;
+}
+
+/*
+ * Append an item to the nexus and return a pointer to it. The array
+ * is normally sized from the link count of the Nexus before it is
+ * filled, so this rarely has to grow it.
+ */
+static ivl_nexus_ptr_s* nexus_ptr_append(ivl_nexus_t nex)
+{
+      if (nex->nptrs_ == nex->cap_)
+	    nexus_reserve(nex, nex->cap_? 2*nex->cap_ : 2);
+
+      nex->nptrs_ += 1;
+      return nex->ptrs_ + nex->nptrs_ - 1;
+}
+
+/*
+ * Count the links in the Nexus. Every object that will be attached
+ * to the ivl_nexus_t has a link here, so this is the most items that
+ * the ivl_nexus_t can collect.
+ */
+static unsigned nexus_link_count(const Nexus*nex)
+{
+      unsigned count = 0;
+      if (nex == 0)
+	    return 1;
+
+      for (const Link*cur = nex->first_nlink() ; cur ; cur = cur->next_nlink())
+	    count += 1;
+
+      return count? count : 1;
+}
+
+static ivl_nexus_t nexus_sig_make(ivl_signal_t net, unsigned pin,
+				  const Nexus*nex =0)
 {
       ivl_nexus_t tmp = new struct ivl_nexus_s;
-      tmp->ptrs_.resize(1);
+      nexus_reserve(tmp, nexus_link_count(nex));
+      nexus_ptr_append(tmp);
       tmp->ptrs_[0].pin_   = pin;
       tmp->ptrs_[0].type_  = __NEXUS_PTR_SIG;
       tmp->ptrs_[0].l.sig  = net;
@@ -333,8 +410,7 @@ static ivl_nexus_t nexus_sig_make(ivl_signal_t net, unsigned pin)
 
 static void nexus_sig_add(ivl_nexus_t nex, ivl_signal_t net, unsigned pin)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
       ivl_drive_t drive = IVL_DR_HiZ;
       switch (ivl_signal_type(net)) {
 	  case IVL_SIT_REG:
@@ -344,22 +420,21 @@ static void nexus_sig_add(ivl_nexus_t nex, ivl_signal_t net, unsigned pin)
 	    break;
       }
 
-      nex->ptrs_[top].type_= __NEXUS_PTR_SIG;
-      nex->ptrs_[top].drive0 = drive;
-      nex->ptrs_[top].drive1 = drive;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.sig= net;
+      ptr->type_= __NEXUS_PTR_SIG;
+      ptr->drive0 = drive;
+      ptr->drive1 = drive;
+      ptr->pin_ = pin;
+      ptr->l.sig= net;
 }
 
 static void nexus_bra_add(ivl_nexus_t nex, ivl_branch_t net, unsigned pin)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
-      nex->ptrs_[top].type_= __NEXUS_PTR_BRA;
-      nex->ptrs_[top].drive0 = 0;
-      nex->ptrs_[top].drive1 = 0;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.bra= net;
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
+      ptr->type_= __NEXUS_PTR_BRA;
+      ptr->drive0 = 0;
+      ptr->drive1 = 0;
+      ptr->pin_ = pin;
+      ptr->l.bra= net;
 }
 
 /*
@@ -373,54 +448,50 @@ static ivl_nexus_ptr_t nexus_log_add(ivl_nexus_t nex,
 				     ivl_net_logic_t net,
 				     unsigned pin)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
 
-      nex->ptrs_[top].type_= __NEXUS_PTR_LOG;
-      nex->ptrs_[top].drive0 = (pin == 0)? IVL_DR_STRONG : IVL_DR_HiZ;
-      nex->ptrs_[top].drive1 = (pin == 0)? IVL_DR_STRONG : IVL_DR_HiZ;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.log= net;
+      ptr->type_= __NEXUS_PTR_LOG;
+      ptr->drive0 = (pin == 0)? IVL_DR_STRONG : IVL_DR_HiZ;
+      ptr->drive1 = (pin == 0)? IVL_DR_STRONG : IVL_DR_HiZ;
+      ptr->pin_ = pin;
+      ptr->l.log= net;
 
-      return & (nex->ptrs_[top]);
+      return ptr;
 }
 
 static void nexus_con_add(ivl_nexus_t nex, ivl_net_const_t net, unsigned pin,
 			  ivl_drive_t drive0, ivl_drive_t drive1)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
 
-      nex->ptrs_[top].type_= __NEXUS_PTR_CON;
-      nex->ptrs_[top].drive0 = drive0;
-      nex->ptrs_[top].drive1 = drive1;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.con= net;
+      ptr->type_= __NEXUS_PTR_CON;
+      ptr->drive0 = drive0;
+      ptr->drive1 = drive1;
+      ptr->pin_ = pin;
+      ptr->l.con= net;
 }
 
 static void nexus_lpm_add(ivl_nexus_t nex, ivl_lpm_t net, unsigned pin,
 			  ivl_drive_t drive0, ivl_drive_t drive1)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
 
-      nex->ptrs_[top].type_= __NEXUS_PTR_LPM;
-      nex->ptrs_[top].drive0 = drive0;
-      nex->ptrs_[top].drive1 = drive1;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.lpm= net;
+      ptr->type_= __NEXUS_PTR_LPM;
+      ptr->drive0 = drive0;
+      ptr->drive1 = drive1;
+      ptr->pin_ = pin;
+      ptr->l.lpm= net;
 }
 
 static void nexus_switch_add(ivl_nexus_t nex, ivl_switch_t net, unsigned pin)
 {
-      unsigned top = nex->ptrs_.size();
-      nex->ptrs_.resize(top+1);
+      ivl_nexus_ptr_s*ptr = nexus_ptr_append(nex);
 
-      nex->ptrs_[top].type_= __NEXUS_PTR_SWI;
-      nex->ptrs_[top].drive0 = IVL_DR_HiZ;
-      nex->ptrs_[top].drive1 = IVL_DR_HiZ;
-      nex->ptrs_[top].pin_ = pin;
-      nex->ptrs_[top].l.swi= net;
+      ptr->type_= __NEXUS_PTR_SWI;
+      ptr->drive0 = IVL_DR_HiZ;
+      ptr->drive1 = IVL_DR_HiZ;
+      ptr->pin_ = pin;
+      ptr->l.swi= net;
 }
 
 void scope_add_logic(ivl_scope_t scope, ivl_net_logic_t net)
@@ -2723,7 +2794,7 @@ void dll_target::signal(const NetNet*net)
 			nexus_sig_add(obj->pin, obj, idx);
 		  }
 	    } else {
-		  ivl_nexus_t tmp = nexus_sig_make(obj, idx);
+		  ivl_nexus_t tmp = nexus_sig_make(obj, idx, nex);
 		  tmp->nexus_ = nex;
 		  tmp->name_ = 0;
 		  nex->t_cookie(tmp);
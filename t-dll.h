@@ -600,10 +600,17 @@ struct ivl_nexus_ptr_s {
 
 /*
  * NOTE: ONLY allocate ivl_nexus_s objects with the included "new" operator.
+ *
+ * The ptrs_ array is allocated from a permanent pool (see t-dll.cc)
+ * with room for cap_ items, of which nptrs_ are used. The capacity is
+ * normally set from the number of links in the Nexus, before any
+ * items are added.
  */
 struct ivl_nexus_s {
-      ivl_nexus_s() : ptrs_(1), nexus_(0), name_(0), private_data(0) { }
-      vector<ivl_nexus_ptr_s>ptrs_;
+      ivl_nexus_s() : ptrs_(0), nptrs_(0), cap_(0), nexus_(0), name_(0), private_data(0) { }
+      ivl_nexus_ptr_s*ptrs_;
+      unsigned nptrs_;
+      unsigned cap_;
       const Nexus*nexus_;
       const char*name_;
       void*private_data;
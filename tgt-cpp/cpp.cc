@@ -23,6 +23,7 @@
 #include "cpp_target.h"
 #include "cpp_syntax.hh"
 #include "state.hh"
+#include "partition.hh"
 
 #include <iostream>
 #include <fstream>
@@ -84,6 +85,15 @@ void debug_msg(const char *fmt, ...)
    va_end(args);
 }
 
+/*
+ * Return the value of a -p<key>=<value> flag passed to the code
+ * generator, or an empty string if the flag was not given.
+ */
+const char* get_design_flag(const char *key)
+{
+   return ivl_design_flag(g_design, key);
+}
+
 extern "C" int target_design(ivl_design_t des)
 {
    ivl_scope_t *roots;
@@ -106,12 +116,21 @@ extern "C" int target_design(ivl_design_t des)
    // only if there were no errors generating entities or processes
    if (0 == g_errors) {
       const char *ofname = ivl_design_flag(des, "-o");
-      ofstream outfile(ofname);
-      outfile << "// This C++11 compliant code was converted using the" << endl
-              << "// Icarus Verilog C++ Code Generator " VERSION
-                 " (" VERSION_TAG ")" << endl;
-
-      emit_everything(outfile);
+      std::string banner = "// This C++11 compliant code was converted using the\n"
+                           "// Icarus Verilog C++ Code Generator " VERSION
+                           " (" VERSION_TAG ")\n";
+
+      if (split_output_size() > 0)
+         emit_split(ofname, banner);
+      else {
+         ofstream outfile(ofname);
+         outfile << banner;
+         emit_everything(outfile);
+      }
+
+      if (sim_partitions() > 1)
+         write_partition_file(std::string(ofname) + ".partition");
+      write_lookahead_file(std::string(ofname) + ".lookahead");
    }
 
    // Clean up
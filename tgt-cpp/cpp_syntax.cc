@@ -39,12 +39,28 @@ using namespace std;
 #define WARPED_TIMESTAMP_FUN_NAME "timestamp"
 #define SIGNAL_NAME_GETTER_FUN_NAME "signalName"
 #define NEW_VALUE_GETTER_FUN_NAME "newValue"
+#define EVALUATE_FUN_NAME "evaluate"
+#define OUTPUT_DELAY_FUN_NAME "outputDelay"
+#define PROCESS_FUN_PREFIX "always"
+#define WAKE_PROCESSES_FUN_NAME "wakeProcesses"
+#define CHANGE_SIGNAL_FUN_NAME "changeSignal"
+#define WAKE_PENDING_FUN_NAME "wakePending"
+// the signal holding the step of a process with delays
+#define PROCESS_STEP_SUFFIX ".step"
 // var names inside classes
 #define INPUT_VAR_NAME "signals_"
+#define RUNNING_VAR_NAME "running_"
+#define PENDING_VAR_NAME "pending_"
 #define HIERARCHY_VAR_NAME "hierarchy_"
+#define STATE_VAR_NAME "state_"
+// array of the state holding the signal bits
+#define STATE_BITS_NAME "bits_"
 // var names inside function
 #define RETURN_EVENT_LIST_VAR_NAME "response_event"
 #define CASTED_EVENT_VAR_NAME "my_event"
+#define TIMESTAMP_VAR_NAME "ts"
+#define OLD_VALUE_VAR_NAME "old_value"
+#define WRITER_VAR_NAME "writer"
 
 void cpp_scope::add_decl(cpp_decl *decl)
 {
@@ -137,6 +153,15 @@ void cpp_binop_expr::emit(std::ostream &of, int level) const
          case CPP_BINOP_SQUARE_BRACKETS:
             of << "[";
             break;
+         case CPP_BINOP_BIT_AND:
+            of << " & ";
+            break;
+         case CPP_BINOP_BIT_OR:
+            of << " | ";
+            break;
+         case CPP_BINOP_XOR:
+            of << " ^ ";
+            break;
          default:
             error("This binary operation is not supported");
       }
@@ -214,7 +239,8 @@ void cpp_expr_list::emit(std::ostream &of, int level) const
 }
 
    cppClass::cppClass(const string& name, const cpp_inherit_class in)
-: name_(name), scope_(), inherit_(in) , type_(CPP_CLASS_MODULE)
+: name_(name), scope_(), inherit_(in) , type_(CPP_CLASS_MODULE), state_words_(0),
+   signal_update_(NULL), handler_return_(NULL), wake_tests_(NULL), init_wake_(NULL), processes_(0)
 {
    cpp_function* constr = new cpp_function(name_.c_str(), new cpp_type(CPP_TYPE_NOTYPE));
    constr->set_constructor();
@@ -248,28 +274,21 @@ void cpp_expr_list::emit(std::ostream &of, int level) const
  * This constructor is basically created to build logic gates.
  */
    cppClass::cppClass(const cpp_class_type type)
-: scope_(), inherit_(CPP_INHERIT_BASE_CLASS), type_(type)
+: scope_(), inherit_(CPP_INHERIT_BASE_CLASS), type_(type), state_words_(0),
+   signal_update_(NULL), handler_return_(NULL), wake_tests_(NULL), init_wake_(NULL), processes_(0)
 {
    scope_.set_parent(find_class(BASE_CLASS_NAME)->get_scope());
    switch(type_)
    {
-      case CPP_CLASS_OR:
-         {
-            name_ = "Or";
-            cpp_function* constr = new cpp_function(name_.c_str(), new cpp_type(CPP_TYPE_NOTYPE));
-            constr->set_constructor();
-            constr->set_comment(name_ + " constructor");
-            add_function(constr);
-            implement_simulation_functions();
-         }
-         break;
-      case CPP_CLASS_AND:
+      case CPP_CLASS_CLUSTER:
          {
-            name_ = "And";
+            name_ = CLUSTER_CLASS_NAME;
             cpp_function* constr = new cpp_function(name_.c_str(), new cpp_type(CPP_TYPE_NOTYPE));
             constr->set_constructor();
             constr->set_comment(name_ + " constructor");
             add_function(constr);
+            set_comment("Group of logic gates evaluated by a single simulation object.\n"
+                  "Only the signals leaving the cluster generate events.");
             implement_simulation_functions();
          }
          break;
@@ -305,8 +324,11 @@ void cppClass::add_event_functions()
    signal_name_getter->set_comment("Get the name of the changed signal");
    signal_name_getter->set_const();
    // Create function to retrieve the new value of the signal
-   cpp_type* tribool_type = new cpp_type(CPP_TYPE_BOOST_TRIBOOL);
-   cpp_function *new_value_getter = new cpp_function(NEW_VALUE_GETTER_FUN_NAME, tribool_type);
+   cpp_type* logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   cpp_type* const_ref_logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   const_ref_logic_type->set_const();
+   const_ref_logic_type->set_reference();
+   cpp_function *new_value_getter = new cpp_function(NEW_VALUE_GETTER_FUN_NAME, const_ref_logic_type);
    new_value_getter->set_comment("Get the name of the new value of the signal");
    new_value_getter->set_const();
    // Create values to return
@@ -318,7 +340,7 @@ void cppClass::add_event_functions()
    cpp_var *receiver_var = new cpp_var("receiver_name", const_ref_string_type);
    cpp_var *timestamp_var = new cpp_var("ts_", timestamp_type);
    timestamp_var->set_comment("Timestamp");
-   cpp_var * signal_value = new cpp_var("new_value_", tribool_type);
+   cpp_var * signal_value = new cpp_var("new_value_", logic_type);
    signal_value->set_comment("The new value");
    cpp_var * signal_name = new cpp_var("changed_signal_name", const_ref_string_type);
    signal_name->set_comment("The changed signal name");
@@ -348,7 +370,7 @@ void cppClass::add_event_functions()
    init_timestamp->add_param(new_timestamp->get_ref());
    constr->add_init(init_timestamp);
    // Add the new_signal_value var
-   cpp_var *new_signal_value = new cpp_var("new_signal_value", tribool_type);
+   cpp_var *new_signal_value = new cpp_var("new_signal_value", const_ref_logic_type);
    constr->add_param(new_signal_value);
    cpp_fcall_stmt* init_signal_value = new cpp_fcall_stmt(const_ref_string_type, signal_value->get_ref(), "");
    init_signal_value->add_param(new_signal_value->get_ref());
@@ -368,11 +390,8 @@ void cppClass::add_simulation_functions()
     * Signal var.
     */
    cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
-   cpp_type* boost_type = new cpp_type(CPP_TYPE_BOOST_TRIBOOL);
-   cpp_type* inside_input_map = new cpp_type(CPP_TYPE_NOTYPE, boost_type);
-   inside_input_map->add_type(string_type);
-   cpp_var *inputvar = new cpp_var(INPUT_VAR_NAME, new cpp_type(CPP_TYPE_STD_MAP, inside_input_map));
-   inputvar->set_comment("map< signal_name, value >");
+   cpp_var *inputvar = new cpp_var(INPUT_VAR_NAME, new cpp_type(CPP_TYPE_IVL_SIGNAL_TABLE));
+   inputvar->set_comment("signal_name -> value, the bits are in the state");
    // The Output var
    cpp_type* output_pair = new cpp_type(CPP_TYPE_STD_PAIR, string_type);
    output_pair->add_type(string_type);
@@ -381,9 +400,6 @@ void cppClass::add_simulation_functions()
    output_map_type->add_type(string_type);
    cpp_var *output_var = new cpp_var(HIERARCHY_VAR_NAME, output_map_type);
    output_var->set_comment("map< mysignal, vector< pair< submodule, signals_in_submodule > > >");
-   // The State var
-   cpp_var *state_var = new cpp_var("state_", new cpp_type(CPP_TYPE_ELEMENT_STATE));
-   state_var->set_comment("The State variable");
    /*
     * End vars creation.
     * Start creating functions.
@@ -395,13 +411,17 @@ void cppClass::add_simulation_functions()
    const_ref_string_type->set_const();
    const_ref_string_type->set_reference();
    cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
-   cpp_const_expr* indeterminate_value = new cpp_const_expr("boost::indeterminate", no_type);
+   cpp_type* const_ref_logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   const_ref_logic_type->set_const();
+   const_ref_logic_type->set_reference();
+   cpp_const_expr* unknown_value = new cpp_const_expr("ivl::logic_vector()", no_type);
    cpp_var *input_name_var = new cpp_var("signal", const_ref_string_type);
-   cpp_var *signal_value_var = new cpp_var("value", boost_type, indeterminate_value);
+   cpp_var *signal_value_var = new cpp_var("value", const_ref_logic_type, unknown_value);
    add_input_fun->add_param(input_name_var);
    add_input_fun->add_param(signal_value_var);
-   cpp_binop_expr* square = new cpp_binop_expr(inputvar->get_ref(), CPP_BINOP_SQUARE_BRACKETS, input_name_var->get_ref(), boost_type);
-   cpp_assign_stmt* new_val = new cpp_assign_stmt(square, signal_value_var->get_ref());
+   cpp_fcall_stmt* new_val = new cpp_fcall_stmt(void_type, inputvar->get_ref(), "add");
+   new_val->add_param(input_name_var->get_ref());
+   new_val->add_param(signal_value_var->get_ref());
    add_input_fun->add_stmt(new_val);
    add_input_fun->get_scope()->get_parent()->set_parent(&scope_);
    // Create the function to add an output
@@ -421,14 +441,6 @@ void cppClass::add_simulation_functions()
    push_back_fcall->add_param(make_pair);
    add_output_fun->add_stmt(push_back_fcall);
    add_output_fun->get_scope()->get_parent()->set_parent(&scope_);
-   // Create the getState function
-   cpp_type *get_state_ret_type = new cpp_type(CPP_TYPE_WARPED_OBJECT_STATE);
-   get_state_ret_type->set_reference();
-   cpp_function *get_state_fun = new cpp_function("getState", get_state_ret_type);
-   get_state_fun->add_stmt(new cpp_unaryop_expr(CPP_UNARYOP_RETURN, state_var->get_ref(), state_var->get_type()));
-   get_state_fun->set_override();
-   get_state_fun->set_virtual();
-   get_state_fun->get_scope()->get_parent()->set_parent(&scope_);
    /*
     * End functions creation
     * Add the init list to the constructor
@@ -446,8 +458,6 @@ void cppClass::add_simulation_functions()
     */
    add_var(inputvar);
    add_var(output_var);
-   add_var(state_var);
-   add_function(get_state_fun);
    add_function(add_input_fun);
    add_function(add_output_fun);
 }
@@ -472,6 +482,25 @@ void cppClass::implement_simulation_functions()
    cpp_fcall_stmt* init_name = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_CUSTOM_BASE_CLASS), sim_obj, "");
    init_name->add_param(name->get_ref());
    constr->add_init(init_name);
+   /*
+    * Every class has its own state, declared by emit() once the
+    * size is known. The signals keep their bits in it, so they are
+    * bound to it before any signal is added.
+    */
+   cpp_var *state_var = new cpp_var(STATE_VAR_NAME, new cpp_type(CPP_TYPE_ELEMENT_STATE));
+   state_var->set_comment("The State variable");
+   add_var(state_var);
+   cpp_type *get_state_ret_type = new cpp_type(CPP_TYPE_WARPED_OBJECT_STATE);
+   get_state_ret_type->set_reference();
+   cpp_function *get_state_fun = new cpp_function("getState", get_state_ret_type);
+   get_state_fun->add_stmt(new cpp_unaryop_expr(CPP_UNARYOP_RETURN, state_var->get_ref(), state_var->get_type()));
+   get_state_fun->set_override();
+   get_state_fun->set_virtual();
+   get_state_fun->get_scope()->get_parent()->set_parent(&scope_);
+   add_function(get_state_fun);
+   cpp_fcall_stmt* bind_signals = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_VOID), new cpp_var_ref(INPUT_VAR_NAME, new cpp_type(CPP_TYPE_IVL_SIGNAL_TABLE)), "bind");
+   bind_signals->add_param(new cpp_const_expr(STATE_VAR_NAME "." STATE_BITS_NAME, new cpp_type(CPP_TYPE_NOTYPE)));
+   constr->add_stmt(bind_signals);
    // Create the initial event function
    cpp_type *returnType = new cpp_type(CPP_TYPE_STD_VECTOR,
          new cpp_type(CPP_TYPE_SHARED_PTR,
@@ -523,12 +552,12 @@ void cppClass::implement_simulation_functions()
    signal_known->add_expr(new cpp_fcall_stmt(inputvar->get_type(), inputvar->get_ref(), "end"));
    event_handler->add_stmt(new cpp_assert(signal_known));
    // Store the new signal value
-   cpp_fcall_stmt* change_in_stmt = new cpp_fcall_stmt(inputvar->get_type(), inputvar->get_ref(), "at");
-   change_in_stmt->add_param(new_signal);
-   cpp_fcall_stmt* new_value_fcall = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_BOOST_TRIBOOL), local_event->get_ref(), NEW_VALUE_GETTER_FUN_NAME);
-   cpp_assign_stmt* update_signal = new cpp_assign_stmt(change_in_stmt, new_value_fcall);
-   update_signal->set_comment("Store the new value");
+   cpp_fcall_stmt* new_value_fcall = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_IVL_LOGIC), local_event->get_ref(), NEW_VALUE_GETTER_FUN_NAME);
+   cpp_fcall_stmt* update_signal = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_VOID), inputvar->get_ref(), "set");
+   update_signal->add_param(new_signal);
+   update_signal->add_param(new_value_fcall);
    event_handler->add_stmt(update_signal);
+   signal_update_ = update_signal;
    // Create type that will be shared later on
    cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
    cpp_type* output_pair = new cpp_type(CPP_TYPE_STD_PAIR, string_type);
@@ -538,9 +567,8 @@ void cppClass::implement_simulation_functions()
    // Here there are the implementation specific instructions
    switch(type_)
    {
-      case CPP_CLASS_AND:
-      case CPP_CLASS_OR:
-         implement_gate();
+      case CPP_CLASS_CLUSTER:
+         implement_cluster();
          return;
       case CPP_CLASS_MODULE:
          {
@@ -555,8 +583,12 @@ void cppClass::implement_simulation_functions()
             cpp_for * ext_for = new cpp_for(cond);
             ext_for->add_precycle(precycle);
             ext_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, ext_iterator->get_ref(), ext_iterator->get_type()));
-            // Create the if to determine if the current signal has an indeterminate value
-            cpp_fcall_stmt* indeter_expr = new cpp_fcall_stmt(no_type, new cpp_const_expr("boost::indeterminate", no_type), "");
+            // Create the if to determine if the current signal has an unknown value
+            cpp_fcall_stmt* ext_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, ext_iterator->get_ref(), ext_iterator->get_type()), "first");
+            ext_name->set_member_access();
+            cpp_fcall_stmt* signal_value = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_IVL_LOGIC), inputvar->get_ref(), "at");
+            signal_value->add_param(ext_name);
+            cpp_fcall_stmt* indeter_expr = new cpp_fcall_stmt(boolean_type, signal_value, "is_unknown");
             cpp_binop_expr * cond_indeter = new cpp_binop_expr(CPP_BINOP_AND, boolean_type);
             cpp_unaryop_expr * first_cond = new cpp_unaryop_expr(CPP_UNARYOP_NOT, indeter_expr, local_event->get_type());
             cpp_binop_expr * second_cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
@@ -568,9 +600,6 @@ void cppClass::implement_simulation_functions()
             second_cond->add_expr(new cpp_fcall_stmt(output_var->get_type(), output_var->get_ref(), "end"));
             cond_indeter->add_expr(first_cond);
             cond_indeter->add_expr(second_cond);
-            cpp_fcall_stmt* signal_value = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, ext_iterator->get_ref(), ext_iterator->get_type()), "second");
-            signal_value->set_member_access();
-            indeter_expr->add_param(signal_value);
             cpp_if * defined_signal_if = new cpp_if(cond_indeter);
             // Create the internal for to alert averyone interested in that signal
             cpp_type* int_iterator_type = new cpp_type(*(output_var->get_type()));
@@ -649,166 +678,798 @@ void cppClass::implement_simulation_functions()
    cpp_unaryop_expr* return_stmt = new cpp_unaryop_expr(CPP_UNARYOP_RETURN, response_event->get_ref(), response_event->get_type());
    init_fun->add_stmt(return_stmt);
    event_handler->add_stmt(return_stmt);
+   handler_return_ = return_stmt;
 }
 
-void cppClass::implement_gate()
+/*
+ * Build the cycles that send the value of every signal listed in
+ * the hierarchy to all the objects interested in it.
+ * Signals with an unknown value are not sent. With delayed, the
+ * delay of every signal is added to the timestamp.
+ */
+static cpp_for* send_outputs(cpp_var* inputvar, cpp_var* output_var,
+      cpp_var* response_event, cpp_expr* timestamp, bool delayed = false)
+{
+   cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   cpp_type* boolean_type = new cpp_type(CPP_TYPE_BOOL);
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_type *local_event_type = new cpp_type(CPP_TYPE_CUSTOM_EVENT);
+   cpp_type* output_pair = new cpp_type(CPP_TYPE_STD_PAIR, string_type);
+   output_pair->add_type(string_type);
+   cpp_type* list_iterator_type = new cpp_type(CPP_TYPE_STD_VECTOR, output_pair);
+   list_iterator_type->set_iterator();
+   // The external for scans the signals
+   cpp_type* out_iterator_type = new cpp_type(*(output_var->get_type()));
+   out_iterator_type->set_iterator();
+   cpp_var* out_iterator = new cpp_var("out", out_iterator_type);
+   cpp_binop_expr * out_cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   out_cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, out_iterator->get_ref(), out_iterator->get_type()));
+   out_cond->add_expr(new cpp_fcall_stmt(out_iterator->get_type(), output_var->get_ref(), "end"));
+   cpp_for * out_for = new cpp_for(out_cond);
+   out_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, out_iterator->get_ref(), out_iterator->get_type()), new cpp_fcall_stmt(out_iterator->get_type(), output_var->get_ref(), "begin")));
+   out_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, out_iterator->get_ref(), out_iterator->get_type()));
+   cpp_fcall_stmt* out_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, out_iterator->get_ref(), out_iterator->get_type()), "first");
+   out_name->set_member_access();
+   cpp_fcall_stmt* out_value = new cpp_fcall_stmt(inputvar->get_type(), inputvar->get_ref(), "at");
+   out_value->add_param(out_name);
+   if(delayed) {
+      cpp_fcall_stmt* out_delay = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_UNSIGNED_INT), new cpp_const_expr(OUTPUT_DELAY_FUN_NAME, no_type), "");
+      out_delay->add_param(out_name);
+      cpp_binop_expr* delayed_timestamp = new cpp_binop_expr(CPP_BINOP_ADD, no_type);
+      delayed_timestamp->add_expr(timestamp);
+      delayed_timestamp->add_expr(out_delay);
+      timestamp = delayed_timestamp;
+   }
+   cpp_fcall_stmt* is_indeter = new cpp_fcall_stmt(boolean_type, out_value, "is_unknown");
+   cpp_if* determinate_if = new cpp_if(new cpp_unaryop_expr(CPP_UNARYOP_NOT, is_indeter, boolean_type));
+   // The internal for scans the receivers of a signal
+   cpp_var* iterator = new cpp_var("it", list_iterator_type);
+   cpp_fcall_stmt* receivers = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, out_iterator->get_ref(), out_iterator->get_type()), "second");
+   receivers->set_member_access();
+   cpp_binop_expr * cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, iterator->get_ref(), iterator->get_type()));
+   cond->add_expr(new cpp_fcall_stmt(iterator->get_type(), receivers, "end"));
+   cpp_for * push_event_for = new cpp_for(cond);
+   push_event_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, iterator->get_ref(), iterator->get_type()), new cpp_fcall_stmt(iterator->get_type(), receivers, "begin")));
+   push_event_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, iterator->get_ref(), iterator->get_type()));
+   cpp_fcall_stmt* receiver_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "first");
+   receiver_name->set_member_access();
+   cpp_fcall_stmt* signal_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "second");
+   signal_name->set_member_access();
+   cpp_const_expr* event_name = new cpp_const_expr(cpp_type::tostring(CPP_TYPE_CUSTOM_EVENT).c_str(), no_type);
+   cpp_fcall_stmt* new_event_fcall = new cpp_fcall_stmt(no_type, event_name, "");
+   new_event_fcall->add_param(receiver_name);
+   new_event_fcall->add_param(timestamp);
+   new_event_fcall->add_param(out_value);
+   new_event_fcall->add_param(signal_name);
+   cpp_fcall_stmt* add_event = new cpp_fcall_stmt(response_event->get_type(), response_event->get_ref(), "emplace_back");
+   add_event->add_param(new cpp_unaryop_expr(CPP_UNARYOP_NEW, new_event_fcall, local_event_type));
+   push_event_for->add_to_body(add_event);
+   determinate_if->add_to_body(push_event_for);
+   out_for->add_to_body(determinate_if);
+   return out_for;
+}
+
+/*
+ * A cluster keeps the list of its gates in a vector. Every element
+ * holds the gate type and the names of its pins: the first one is the
+ * output, the others are the inputs. The gates are sorted so that a
+ * gate comes after the gates that drive it, so a single evaluation
+ * pass is enough unless the cluster contains a combinational loop.
+ * The number of passes is given to the constructor.
+ */
+void cppClass::implement_cluster()
 {
    // Retrieve all the vars and funs I need
    cpp_var* inputvar = get_var(INPUT_VAR_NAME);
    assert(inputvar);
    cpp_var* output_var = get_var(HIERARCHY_VAR_NAME);
    assert(output_var);
-   cpp_type *local_event_type = new cpp_type(CPP_TYPE_CUSTOM_EVENT);
-   cpp_var *local_event = new cpp_var(CASTED_EVENT_VAR_NAME, local_event_type);
+   cpp_function *event_handler = get_function(WARPED_HANDLE_EVENT_FUN_NAME);
+   assert(event_handler);
+   cpp_function *init_fun = get_function(WARPED_INIT_EVENT_FUN_NAME);
+   assert(init_fun);
+   cpp_var *response_event = event_handler->get_var(RETURN_EVENT_LIST_VAR_NAME);
+   assert(response_event);
+   cpp_function* constr = get_costructor();
+   assert(constr);
    cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
    cpp_type* boolean_type = new cpp_type(CPP_TYPE_BOOL);
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_type* int_type = new cpp_type(CPP_TYPE_INT);
+   cpp_type* unsigned_type = new cpp_type(CPP_TYPE_UNSIGNED_INT);
+   cpp_type* void_type = new cpp_type(CPP_TYPE_VOID);
+   cpp_type* logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
    cpp_type* const_ref_string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   const_ref_string_type->set_const();
+   const_ref_string_type->set_reference();
+   /*
+    * Start creating vars.
+    */
+   cpp_type* pins_type = new cpp_type(CPP_TYPE_STD_VECTOR, string_type);
+   cpp_type* gate_type = new cpp_type(CPP_TYPE_STD_PAIR, pins_type);
+   gate_type->add_type(int_type);
+   cpp_var* gates_var = new cpp_var("gates_", new cpp_type(CPP_TYPE_STD_VECTOR, gate_type));
+   gates_var->set_comment("vector< pair< gate_type, pins > >");
+   cpp_type* delays_type = new cpp_type(CPP_TYPE_STD_MAP, unsigned_type);
+   delays_type->add_type(string_type);
+   cpp_var* delays_var = new cpp_var("delays_", delays_type);
+   delays_var->set_comment("The outputs slower than one time unit");
+   cpp_var* passes_var = new cpp_var("passes_", unsigned_type);
+   passes_var->set_comment("Evaluation passes needed to reach a stable value");
+   // The constructor receives the number of passes
+   cpp_var* passes_param = new cpp_var("passes", unsigned_type);
+   constr->add_param(passes_param);
+   cpp_fcall_stmt* init_passes = new cpp_fcall_stmt(unsigned_type, passes_var->get_ref(), "");
+   init_passes->add_param(passes_param->get_ref());
+   constr->add_init(init_passes);
+   /*
+    * Create the function to add a gate.
+    */
+   cpp_function* add_gate_fun = new cpp_function(ADD_GATE_FUN_NAME, void_type);
+   add_gate_fun->set_comment("Add a gate driving the output signal");
+   cpp_var* type_param = new cpp_var("type", int_type);
+   cpp_var* output_param = new cpp_var("output", const_ref_string_type);
+   add_gate_fun->add_param(type_param);
+   add_gate_fun->add_param(output_param);
+   cpp_fcall_stmt* new_pins = new cpp_fcall_stmt(pins_type, new cpp_var_ref("", pins_type), "");
+   new_pins->add_param(new cpp_const_expr("1", unsigned_type));
+   new_pins->add_param(output_param->get_ref());
+   cpp_fcall_stmt* push_gate = new cpp_fcall_stmt(no_type, gates_var->get_ref(), "emplace_back");
+   push_gate->add_param(type_param->get_ref());
+   push_gate->add_param(new_pins);
+   add_gate_fun->add_stmt(push_gate);
+   add_gate_fun->get_scope()->get_parent()->set_parent(&scope_);
+   /*
+    * Create the function to add an input to the last gate.
+    */
+   cpp_function* add_gate_input_fun = new cpp_function(ADD_GATE_INPUT_FUN_NAME, void_type);
+   add_gate_input_fun->set_comment("Add an input to the last gate added");
+   cpp_var* input_param = new cpp_var("input", const_ref_string_type);
+   add_gate_input_fun->add_param(input_param);
+   cpp_fcall_stmt* last_gate = new cpp_fcall_stmt(gate_type, gates_var->get_ref(), "back");
+   cpp_fcall_stmt* last_pins = new cpp_fcall_stmt(pins_type, last_gate, "second");
+   last_pins->set_member_access();
+   cpp_fcall_stmt* push_input = new cpp_fcall_stmt(no_type, last_pins, "push_back");
+   push_input->add_param(input_param->get_ref());
+   add_gate_input_fun->add_stmt(push_input);
+   add_gate_input_fun->get_scope()->get_parent()->set_parent(&scope_);
+   /*
+    * Create the functions to set and read the delay of an output.
+    */
+   cpp_function* set_delay_fun = new cpp_function(SET_DELAY_FUN_NAME, void_type);
+   set_delay_fun->set_comment("Delay the events of an output");
+   cpp_var* delay_signal_param = new cpp_var("output", const_ref_string_type);
+   cpp_var* delay_param = new cpp_var("delay", unsigned_type);
+   set_delay_fun->add_param(delay_signal_param);
+   set_delay_fun->add_param(delay_param);
+   cpp_fcall_stmt* add_delay = new cpp_fcall_stmt(no_type, delays_var->get_ref(), "emplace");
+   add_delay->add_param(delay_signal_param->get_ref());
+   add_delay->add_param(delay_param->get_ref());
+   set_delay_fun->add_stmt(add_delay);
+   set_delay_fun->get_scope()->get_parent()->set_parent(&scope_);
+   cpp_function* output_delay_fun = new cpp_function(OUTPUT_DELAY_FUN_NAME, unsigned_type);
+   output_delay_fun->set_comment("The delay of an output, one time unit by default");
+   output_delay_fun->set_const();
+   cpp_var* output_delay_param = new cpp_var("output", const_ref_string_type);
+   output_delay_fun->add_param(output_delay_param);
+   cpp_fcall_stmt* count_delay = new cpp_fcall_stmt(boolean_type, delays_var->get_ref(), "count");
+   count_delay->add_param(output_delay_param->get_ref());
+   cpp_if* has_delay = new cpp_if(count_delay);
+   cpp_fcall_stmt* read_delay = new cpp_fcall_stmt(unsigned_type, delays_var->get_ref(), "at");
+   read_delay->add_param(output_delay_param->get_ref());
+   has_delay->add_to_body(new cpp_unaryop_expr(CPP_UNARYOP_RETURN, read_delay, unsigned_type));
+   output_delay_fun->add_stmt(has_delay);
+   output_delay_fun->add_stmt(new cpp_unaryop_expr(CPP_UNARYOP_RETURN, new cpp_const_expr("1", unsigned_type), unsigned_type));
+   output_delay_fun->get_scope()->get_parent()->set_parent(&scope_);
+   /*
+    * Create the function that evaluates all the gates.
+    */
+   cpp_function* evaluate_fun = new cpp_function(EVALUATE_FUN_NAME, void_type);
+   evaluate_fun->set_comment("Compute the value of all the gates");
+   evaluate_fun->get_scope()->get_parent()->set_parent(&scope_);
+   // The cycle on the passes
+   cpp_var* pass = new cpp_var("pass", unsigned_type);
+   cpp_binop_expr* pass_cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   pass_cond->add_expr(pass->get_ref());
+   pass_cond->add_expr(passes_var->get_ref());
+   cpp_for* pass_for = new cpp_for(pass_cond);
+   pass_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, pass->get_ref(), pass->get_type()), new cpp_const_expr("0", unsigned_type)));
+   pass_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, pass->get_ref(), pass->get_type()));
+   // The cycle on the gates
+   cpp_type* gate_iterator_type = new cpp_type(*(gates_var->get_type()));
+   gate_iterator_type->set_iterator();
+   cpp_var* gate = new cpp_var("gate", gate_iterator_type);
+   cpp_binop_expr* gate_cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   gate_cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, gate->get_ref(), gate->get_type()));
+   gate_cond->add_expr(new cpp_fcall_stmt(gate->get_type(), gates_var->get_ref(), "end"));
+   cpp_for* gate_for = new cpp_for(gate_cond);
+   gate_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, gate->get_ref(), gate->get_type()), new cpp_fcall_stmt(gate->get_type(), gates_var->get_ref(), "begin")));
+   gate_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, gate->get_ref(), gate->get_type()));
+   cpp_fcall_stmt* this_type = new cpp_fcall_stmt(int_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, gate->get_ref(), gate->get_type()), "first");
+   this_type->set_member_access();
+   cpp_fcall_stmt* these_pins = new cpp_fcall_stmt(pins_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, gate->get_ref(), gate->get_type()), "second");
+   these_pins->set_member_access();
+   // The gates are evaluated by the runtime of ivl_logic.hpp
+   cpp_fcall_stmt* gate_value = new cpp_fcall_stmt(logic_type, new cpp_const_expr("ivl::evaluate_gate", no_type), "");
+   gate_value->add_param(this_type);
+   gate_value->add_param(these_pins);
+   gate_value->add_param(inputvar->get_ref());
+   // Store the value of the output
+   cpp_fcall_stmt* output_name = new cpp_fcall_stmt(string_type, these_pins, "front");
+   cpp_fcall_stmt* output_value = new cpp_fcall_stmt(void_type, inputvar->get_ref(), "set");
+   output_value->add_param(output_name);
+   output_value->add_param(gate_value);
+   gate_for->add_to_body(output_value);
+   pass_for->add_to_body(gate_for);
+   evaluate_fun->add_stmt(pass_for);
+   /*
+    * Both the initial events and the event handler evaluate the
+    * cluster and send the value of the outputs.
+    */
+   cpp_fcall_stmt* evaluate_call = new cpp_fcall_stmt(void_type, new cpp_const_expr(EVALUATE_FUN_NAME, no_type), "");
+   init_fun->add_stmt(evaluate_call);
+   init_fun->add_stmt(send_outputs(inputvar, output_var, response_event,
+            new cpp_const_expr("0", unsigned_type)));
+   event_handler->add_stmt(evaluate_call);
+   cpp_var *local_event = event_handler->get_var(CASTED_EVENT_VAR_NAME);
+   // The outputs change after the delay of the gates driving them
+   cpp_fcall_stmt* event_timestamp = new cpp_fcall_stmt(unsigned_type, local_event->get_ref(), WARPED_TIMESTAMP_FUN_NAME);
+   event_handler->add_stmt(send_outputs(inputvar, output_var, response_event, event_timestamp, true));
+   // Add the return statements
+   cpp_unaryop_expr* return_stmt = new cpp_unaryop_expr(CPP_UNARYOP_RETURN, response_event->get_ref(), response_event->get_type());
+   init_fun->add_stmt(return_stmt);
+   event_handler->add_stmt(return_stmt);
+   /*
+    * Add all functions and vars created
+    */
+   add_var(gates_var);
+   add_var(passes_var);
+   add_var(delays_var);
+   add_function(add_gate_fun);
+   add_function(add_gate_input_fun);
+   add_function(set_delay_fun);
+   add_function(output_delay_fun);
+   add_function(evaluate_fun);
+}
+
+
+/*
+ * Send the value of a signal to all the objects interested in it.
+ */
+static cpp_if* notify_receivers(cpp_var* output_var, cpp_expr* response_event,
+      cpp_expr* signal, cpp_expr* value, cpp_expr* timestamp)
+{
+   cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   cpp_type* boolean_type = new cpp_type(CPP_TYPE_BOOL);
    cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
-   cpp_function *event_handler = get_function(WARPED_HANDLE_EVENT_FUN_NAME);
-   assert(event_handler);
-   cpp_function *init_fun = get_function(WARPED_INIT_EVENT_FUN_NAME);
+   cpp_type* local_event_type = new cpp_type(CPP_TYPE_CUSTOM_EVENT);
    cpp_type* output_pair = new cpp_type(CPP_TYPE_STD_PAIR, string_type);
    output_pair->add_type(string_type);
    cpp_type* list_iterator_type = new cpp_type(CPP_TYPE_STD_VECTOR, output_pair);
    list_iterator_type->set_iterator();
-   cpp_var *response_event = event_handler->get_var(RETURN_EVENT_LIST_VAR_NAME);
-   assert(response_event);
-   cpp_fcall_stmt* new_value_fcall = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_BOOST_TRIBOOL), local_event->get_ref(), NEW_VALUE_GETTER_FUN_NAME);
-   // Add an assert(only one output)
-   cpp_binop_expr * eq_to_one = new cpp_binop_expr(CPP_BINOP_EQ, boolean_type);
-   cpp_fcall_stmt* size_call = new cpp_fcall_stmt(output_var->get_type(), output_var->get_ref(), "size");
-   eq_to_one->add_expr(size_call);
-   eq_to_one->add_expr(new cpp_const_expr("1", new cpp_type(CPP_TYPE_UNSIGNED_INT)));
-   init_fun->add_stmt(new cpp_assert(eq_to_one));
-   // Create the cycle to scan the inputs in order to determine the output
+   cpp_binop_expr* interest = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   cpp_fcall_stmt* find_el = new cpp_fcall_stmt(output_var->get_type(), output_var->get_ref(), "find");
+   find_el->add_param(signal);
+   interest->add_expr(find_el);
+   interest->add_expr(new cpp_fcall_stmt(output_var->get_type(), output_var->get_ref(), "end"));
+   cpp_if* check_interest = new cpp_if(interest);
+   cpp_var* iterator = new cpp_var("it", list_iterator_type);
+   cpp_fcall_stmt* at_fun = new cpp_fcall_stmt(iterator->get_type(), output_var->get_ref(), "at");
+   at_fun->add_param(signal);
+   cpp_binop_expr* cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, iterator->get_ref(), iterator->get_type()));
+   cond->add_expr(new cpp_fcall_stmt(at_fun->get_type(), at_fun, "end"));
+   cpp_for* push_event_for = new cpp_for(cond);
+   push_event_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, iterator->get_ref(), iterator->get_type()), new cpp_fcall_stmt(at_fun->get_type(), at_fun, "begin")));
+   push_event_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, iterator->get_ref(), iterator->get_type()));
+   cpp_fcall_stmt* receiver_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "first");
+   receiver_name->set_member_access();
+   cpp_fcall_stmt* signal_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "second");
+   signal_name->set_member_access();
+   cpp_const_expr* event_name = new cpp_const_expr(cpp_type::tostring(CPP_TYPE_CUSTOM_EVENT).c_str(), no_type);
+   cpp_fcall_stmt* new_event_fcall = new cpp_fcall_stmt(no_type, event_name, "");
+   new_event_fcall->add_param(receiver_name);
+   new_event_fcall->add_param(timestamp);
+   new_event_fcall->add_param(value);
+   new_event_fcall->add_param(signal_name);
+   cpp_fcall_stmt* add_event = new cpp_fcall_stmt(no_type, response_event, "emplace_back");
+   add_event->add_param(new cpp_unaryop_expr(CPP_UNARYOP_NEW, new_event_fcall, local_event_type));
+   push_event_for->add_to_body(add_event);
+   check_interest->add_to_body(push_event_for);
+   return check_interest;
+}
+
+/*
+ * The first process of a module adds three functions:
+ * - changeSignal stores a value written by a process. If the value
+ *   is different it is sent to the objects interested in it, like
+ *   the event handler does, and the processes waiting for it run.
+ * - wakeProcesses runs the processes waiting for an event of a
+ *   signal.
+ * - wakePending runs the processes waiting for the pending changes,
+ *   each one once however many of the changes it waits for. Every
+ *   process adds its own test.
+ * A process runs to its end before any other one: the changes it
+ * makes are kept in pending_ and the processes waiting for them run
+ * after it returns. The writer of the changes is not woken by them,
+ * it was not waiting while it made them.
+ * The event handler keeps the previous value of the changed signal
+ * and calls wakeProcesses too.
+ */
+void cppClass::implement_processes()
+{
+   assert(type_ == CPP_CLASS_MODULE && inherit_ == CPP_INHERIT_BASE_CLASS);
+   assert(signal_update_ && handler_return_);
+   cpp_var* inputvar = get_var(INPUT_VAR_NAME);
+   cpp_var* output_var = get_var(HIERARCHY_VAR_NAME);
+   cpp_function* event_handler = get_function(WARPED_HANDLE_EVENT_FUN_NAME);
+   cpp_var* local_event = event_handler->get_var(CASTED_EVENT_VAR_NAME);
+   cpp_var* response_event = event_handler->get_var(RETURN_EVENT_LIST_VAR_NAME);
+   cpp_function* constr = get_costructor();
+   cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   cpp_type* boolean_type = new cpp_type(CPP_TYPE_BOOL);
+   cpp_type* void_type = new cpp_type(CPP_TYPE_VOID);
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_type* int_type = new cpp_type(CPP_TYPE_INT);
+   cpp_type* unsigned_type = new cpp_type(CPP_TYPE_UNSIGNED_INT);
+   cpp_type* logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   cpp_type* const_logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   const_logic_type->set_const();
+   cpp_type* const_ref_logic_type = new cpp_type(CPP_TYPE_IVL_LOGIC);
+   const_ref_logic_type->set_const();
+   const_ref_logic_type->set_reference();
+   cpp_type* const_ref_string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   const_ref_string_type->set_const();
+   const_ref_string_type->set_reference();
+   cpp_type* ref_event_list_type = new cpp_type(*(response_event->get_type()));
+   ref_event_list_type->set_reference();
+   cpp_const_expr* no_writer = new cpp_const_expr("-1", int_type);
+   /*
+    * The running process and the changes it made.
+    */
+   cpp_var* running_var = new cpp_var(RUNNING_VAR_NAME, int_type);
+   running_var->set_comment("The running process, -1 if none");
+   cpp_fcall_stmt* init_running = new cpp_fcall_stmt(int_type, running_var->get_ref(), "");
+   init_running->add_param(no_writer);
+   constr->add_init(init_running);
+   cpp_type* change_type = new cpp_type(CPP_TYPE_STD_PAIR, logic_type);
+   change_type->add_type(string_type);
+   cpp_var* pending_var = new cpp_var(PENDING_VAR_NAME, new cpp_type(CPP_TYPE_STD_VECTOR, change_type));
+   pending_var->set_comment("vector< pair< signal, old_value > > changed by the running process");
+   /*
+    * Create the function that wakes the processes: the change is
+    * pending until no process runs.
+    */
+   cpp_function* wake_fun = new cpp_function(WAKE_PROCESSES_FUN_NAME, void_type);
+   wake_fun->set_comment("Run the processes waiting for an event of the signal");
+   cpp_var* wake_signal_param = new cpp_var("signal", const_ref_string_type);
+   cpp_var* wake_old_param = new cpp_var(OLD_VALUE_VAR_NAME, const_ref_logic_type);
+   cpp_var* wake_ts_param = new cpp_var(TIMESTAMP_VAR_NAME, unsigned_type);
+   cpp_var* wake_events_param = new cpp_var(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type);
+   cpp_var* wake_writer_param = new cpp_var(WRITER_VAR_NAME, int_type);
+   wake_fun->add_param(wake_signal_param);
+   wake_fun->add_param(wake_old_param);
+   wake_fun->add_param(wake_ts_param);
+   wake_fun->add_param(wake_events_param);
+   wake_fun->add_param(wake_writer_param);
+   wake_fun->get_scope()->get_parent()->set_parent(&scope_);
+   cpp_fcall_stmt* queue_change = new cpp_fcall_stmt(no_type, pending_var->get_ref(), "emplace_back");
+   queue_change->add_param(wake_signal_param->get_ref());
+   queue_change->add_param(wake_old_param->get_ref());
+   wake_fun->add_stmt(queue_change);
+   cpp_binop_expr* idle = new cpp_binop_expr(CPP_BINOP_EQ, boolean_type);
+   idle->add_expr(running_var->get_ref());
+   idle->add_expr(no_writer);
+   cpp_if* idle_if = new cpp_if(idle);
+   cpp_fcall_stmt* run_pending = new cpp_fcall_stmt(void_type, new cpp_const_expr(WAKE_PENDING_FUN_NAME, no_type), "");
+   run_pending->add_param(wake_writer_param->get_ref());
+   run_pending->add_param(wake_ts_param->get_ref());
+   run_pending->add_param(wake_events_param->get_ref());
+   idle_if->add_to_body(run_pending);
+   wake_fun->add_stmt(idle_if);
+   /*
+    * Create the function that wakes the processes for the pending
+    * changes. Every process adds a flag, set by its test on any of
+    * the changes, and runs once after the tests. A process woken
+    * here can make new changes.
+    */
+   cpp_function* pending_fun = new cpp_function(WAKE_PENDING_FUN_NAME, void_type);
+   pending_fun->set_comment("Run once the processes waiting for the pending changes");
+   cpp_var* writer_param = new cpp_var(WRITER_VAR_NAME, int_type);
+   cpp_var* pending_ts_param = new cpp_var(TIMESTAMP_VAR_NAME, unsigned_type);
+   cpp_var* pending_events_param = new cpp_var(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type);
+   pending_fun->add_param(writer_param);
+   pending_fun->add_param(pending_ts_param);
+   pending_fun->add_param(pending_events_param);
+   pending_fun->get_scope()->get_parent()->set_parent(&scope_);
+   pending_fun->add_stmt(new cpp_assign_stmt(running_var->get_ref(), no_writer));
+   cpp_var* changes = new cpp_var("changes", pending_var->get_type());
+   pending_fun->add_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, changes->get_ref(), changes->get_type()));
+   cpp_fcall_stmt* take_changes = new cpp_fcall_stmt(void_type, changes->get_ref(), "swap");
+   take_changes->add_param(pending_var->get_ref());
+   pending_fun->add_stmt(take_changes);
+   cpp_type* change_iterator_type = new cpp_type(*(pending_var->get_type()));
+   change_iterator_type->set_iterator();
+   cpp_var* change = new cpp_var("change", change_iterator_type);
+   cpp_binop_expr* change_cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   change_cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, change->get_ref(), change->get_type()));
+   change_cond->add_expr(new cpp_fcall_stmt(change->get_type(), changes->get_ref(), "end"));
+   wake_tests_ = new cpp_for(change_cond);
+   wake_tests_->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, change->get_ref(), change->get_type()), new cpp_fcall_stmt(change->get_type(), changes->get_ref(), "begin")));
+   wake_tests_->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, change->get_ref(), change->get_type()));
+   // The tests read the change like the parameters of wakeProcesses
+   cpp_fcall_stmt* changed_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, change->get_ref(), change->get_type()), "first");
+   changed_name->set_member_access();
+   cpp_fcall_stmt* changed_old = new cpp_fcall_stmt(logic_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, change->get_ref(), change->get_type()), "second");
+   changed_old->set_member_access();
+   cpp_var* changed_signal_var = new cpp_var("signal", const_ref_string_type);
+   cpp_var* changed_old_var = new cpp_var(OLD_VALUE_VAR_NAME, const_ref_logic_type);
+   wake_tests_->add_to_body(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, changed_signal_var->get_ref(), changed_signal_var->get_type()), changed_name));
+   wake_tests_->add_to_body(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, changed_old_var->get_ref(), changed_old_var->get_type()), changed_old));
+   pending_fun->add_stmt(wake_tests_);
+   /*
+    * Create the function that changes a signal.
+    */
+   cpp_function* change_fun = new cpp_function(CHANGE_SIGNAL_FUN_NAME, void_type);
+   change_fun->set_comment("Store a value written by a process");
+   cpp_var* signal_param = new cpp_var("signal", const_ref_string_type);
+   cpp_var* value_param = new cpp_var("value", const_ref_logic_type);
+   cpp_var* ts_param = new cpp_var(TIMESTAMP_VAR_NAME, unsigned_type);
+   cpp_var* events_param = new cpp_var(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type);
+   change_fun->add_param(signal_param);
+   change_fun->add_param(value_param);
+   change_fun->add_param(ts_param);
+   change_fun->add_param(events_param);
+   change_fun->get_scope()->get_parent()->set_parent(&scope_);
+   cpp_var* old_value = new cpp_var(OLD_VALUE_VAR_NAME, const_logic_type);
+   cpp_fcall_stmt* read_old = new cpp_fcall_stmt(logic_type, inputvar->get_ref(), "at");
+   read_old->add_param(signal_param->get_ref());
+   change_fun->add_stmt(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, old_value->get_ref(), old_value->get_type()), read_old));
+   cpp_fcall_stmt* store = new cpp_fcall_stmt(void_type, inputvar->get_ref(), "set");
+   store->add_param(signal_param->get_ref());
+   store->add_param(value_param->get_ref());
+   change_fun->add_stmt(store);
+   cpp_fcall_stmt* new_value = new cpp_fcall_stmt(logic_type, inputvar->get_ref(), "at");
+   new_value->add_param(signal_param->get_ref());
+   cpp_fcall_stmt* same_value = new cpp_fcall_stmt(boolean_type, old_value->get_ref(), "eeq");
+   same_value->add_param(new_value);
+   cpp_if* changed_if = new cpp_if(new cpp_unaryop_expr(CPP_UNARYOP_NOT, same_value, boolean_type));
+   cpp_binop_expr* next_timestamp = new cpp_binop_expr(CPP_BINOP_ADD, no_type);
+   next_timestamp->add_expr(ts_param->get_ref());
+   next_timestamp->add_expr(new cpp_const_expr("1", unsigned_type));
+   changed_if->add_to_body(notify_receivers(output_var, events_param->get_ref(),
+            signal_param->get_ref(), new_value, next_timestamp));
+   cpp_fcall_stmt* wake_call = new cpp_fcall_stmt(void_type, new cpp_const_expr(WAKE_PROCESSES_FUN_NAME, no_type), "");
+   wake_call->add_param(signal_param->get_ref());
+   wake_call->add_param(old_value->get_ref());
+   wake_call->add_param(ts_param->get_ref());
+   wake_call->add_param(events_param->get_ref());
+   wake_call->add_param(no_writer);
+   changed_if->add_to_body(wake_call);
+   change_fun->add_stmt(changed_if);
+   /*
+    * Hook into the event handler.
+    */
+   cpp_fcall_stmt* changed_signal = new cpp_fcall_stmt(string_type, local_event->get_ref(), SIGNAL_NAME_GETTER_FUN_NAME);
+   cpp_fcall_stmt* handler_old = new cpp_fcall_stmt(logic_type, inputvar->get_ref(), "at");
+   handler_old->add_param(changed_signal);
+   event_handler->insert_stmt(signal_update_, new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, old_value->get_ref(), old_value->get_type()), handler_old));
+   cpp_fcall_stmt* handler_wake = new cpp_fcall_stmt(void_type, new cpp_const_expr(WAKE_PROCESSES_FUN_NAME, no_type), "");
+   handler_wake->add_param(changed_signal);
+   handler_wake->add_param(old_value->get_ref());
+   handler_wake->add_param(new cpp_fcall_stmt(unsigned_type, local_event->get_ref(), WARPED_TIMESTAMP_FUN_NAME));
+   handler_wake->add_param(response_event->get_ref());
+   handler_wake->add_param(no_writer);
+   event_handler->insert_stmt(handler_return_, handler_wake);
+   /*
+    * The initial value of a signal is a change from x: the initial
+    * events run the processes waiting for the initial values.
+    */
+   cpp_function* init_fun = get_function(WARPED_INIT_EVENT_FUN_NAME);
    cpp_type* iterator_type = new cpp_type(*(inputvar->get_type()));
    iterator_type->set_iterator();
-   cpp_var* iterator = new cpp_var ("it", iterator_type);
-   cpp_assign_stmt* precycle = new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, iterator->get_ref(), iterator->get_type()), new cpp_fcall_stmt(iterator->get_type(), inputvar->get_ref(), "begin"));
-   cpp_binop_expr * cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   cpp_var* iterator = new cpp_var("sig", iterator_type);
+   cpp_binop_expr* cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
    cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, iterator->get_ref(), iterator->get_type()));
    cond->add_expr(new cpp_fcall_stmt(iterator->get_type(), inputvar->get_ref(), "end"));
-   cpp_for * output_for = new cpp_for(cond);
-   output_for->add_precycle(precycle);
-   output_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, iterator->get_ref(), iterator->get_type()));
-   // Create the if to handle a false value on an input
-   cpp_binop_expr * cond_gate_dep = new cpp_binop_expr(CPP_BINOP_EQ, boolean_type);
-   cpp_unaryop_expr* it_deref = new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), inputvar->get_type());
-   cpp_fcall_stmt * thesignal = new cpp_fcall_stmt(string_type, it_deref, "second");
-   thesignal->set_member_access();
-   cond_gate_dep->add_expr_front(thesignal);
-   cpp_const_expr* gate_dep_expr = new cpp_const_expr("false", CPP_TYPE_NOTYPE);
-   // Create/Add the output default value before
-   switch(type_)
+   cpp_for* init_for = new cpp_for(cond);
+   init_for->add_precycle(new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, iterator->get_ref(), iterator->get_type()), new cpp_fcall_stmt(iterator->get_type(), inputvar->get_ref(), "begin")));
+   init_for->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, iterator->get_ref(), iterator->get_type()));
+   cpp_fcall_stmt* sig_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "first");
+   sig_name->set_member_access();
+   cpp_fcall_stmt* sig_value = new cpp_fcall_stmt(logic_type, inputvar->get_ref(), "at");
+   sig_value->add_param(sig_name);
+   cpp_if* known_if = new cpp_if(new cpp_unaryop_expr(CPP_UNARYOP_NOT, new cpp_fcall_stmt(boolean_type, sig_value, "is_unknown"), boolean_type));
+   cpp_fcall_stmt* unknown_value = new cpp_fcall_stmt(logic_type, new cpp_const_expr("ivl::logic_vector", no_type), "");
+   unknown_value->add_param(new cpp_fcall_stmt(unsigned_type, sig_value, "size"));
+   cpp_fcall_stmt* init_change = new cpp_fcall_stmt(no_type, pending_var->get_ref(), "emplace_back");
+   init_change->add_param(sig_name);
+   init_change->add_param(unknown_value);
+   known_if->add_to_body(init_change);
+   init_for->add_to_body(known_if);
+   init_fun->insert_stmt(handler_return_, init_for);
+   cpp_fcall_stmt* init_wake = new cpp_fcall_stmt(void_type, new cpp_const_expr(WAKE_PENDING_FUN_NAME, no_type), "");
+   init_wake->add_param(no_writer);
+   init_wake->add_param(new cpp_const_expr("0", unsigned_type));
+   init_wake->add_param(response_event->get_ref());
+   init_fun->insert_stmt(handler_return_, init_wake);
+   init_wake_ = init_wake;
+   add_var(running_var);
+   add_var(pending_var);
+   add_function(change_fun);
+   add_function(wake_fun);
+   add_function(pending_fun);
+}
+
+/*
+ * A process with delays keeps its step in a signal of its own, so
+ * that the step is saved with the state: x while the process waits
+ * for its events, or the number of the step the next event resumes
+ * while it is suspended at a delay.
+ * The step of a process without events is x when the process starts
+ * again from its first step. The initial events start it.
+ */
+cpp_function* cppClass::add_process(const sensitivity_list_t& events,
+      const process_steps_t& steps)
+{
+   assert(!steps.empty() && (!events.empty() || steps.size() > 1));
+   if(wake_tests_ == NULL)
+      implement_processes();
+   cpp_function* event_handler = get_function(WARPED_HANDLE_EVENT_FUN_NAME);
+   cpp_var* response_event = event_handler->get_var(RETURN_EVENT_LIST_VAR_NAME);
+   cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
+   cpp_type* boolean_type = new cpp_type(CPP_TYPE_BOOL);
+   cpp_type* void_type = new cpp_type(CPP_TYPE_VOID);
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_type* int_type = new cpp_type(CPP_TYPE_INT);
+   cpp_type* unsigned_type = new cpp_type(CPP_TYPE_UNSIGNED_INT);
+   cpp_type* ref_event_list_type = new cpp_type(*(response_event->get_type()));
+   ref_event_list_type->set_reference();
+   // Create the function holding the statements
+   std::ostringstream name, number;
+   number << processes_++;
+   name << PROCESS_FUN_PREFIX << number.str();
+   cpp_function* process = new cpp_function(name.str().c_str(), void_type);
+   process->add_param(new cpp_var(TIMESTAMP_VAR_NAME, unsigned_type));
+   process->add_param(new cpp_var(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type));
+   process->get_scope()->get_parent()->set_parent(&scope_);
+   // The signal holding the step, wide enough for the last one
+   const unsigned last = steps.size() - 1;
+   std::string step_signal;
+   unsigned step_width = 1;
+   if(last > 0)
    {
-      case CPP_CLASS_AND:
-         gate_dep_expr = new cpp_const_expr("false", CPP_TYPE_NOTYPE);
-         break;
-      case CPP_CLASS_OR:
-         gate_dep_expr = new cpp_const_expr("true", CPP_TYPE_NOTYPE);
-         break;
-      default:
-         assert(false);
+      step_signal = name.str() + PROCESS_STEP_SUFFIX;
+      while((last >> step_width) != 0)
+         step_width++;
+      add_signal(step_signal, step_width);
    }
-   cond_gate_dep->add_expr(gate_dep_expr);
-   cpp_fcall_stmt* begin_fun = new cpp_fcall_stmt(iterator->get_type(), output_var->get_ref(), "begin");
-   cpp_fcall_stmt* deref = new cpp_fcall_stmt(const_ref_string_type, begin_fun, "first");
-   deref->set_pointer_call();
-   deref->set_member_access();
-   cpp_fcall_stmt* get_el = new cpp_fcall_stmt(inputvar->get_type(), inputvar->get_ref(), "at");
-   get_el->add_param(deref);
-   cpp_assign_stmt* false_assign = new cpp_assign_stmt(get_el, gate_dep_expr);
-   cpp_if * false_if = new cpp_if(cond_gate_dep);
-   false_if->add_to_body(false_assign);
-   false_if->add_to_body(new cpp_break());
-   output_for->add_to_body(false_if);
-   // Create the if to handle an indeterminate value on an input
-   cpp_const_expr * boost_const = new cpp_const_expr("boost::indeterminate", no_type);
-   cpp_fcall_stmt* indeter_expr = new cpp_fcall_stmt(boolean_type, boost_const, "");
-   indeter_expr->add_param(thesignal);
-   cpp_if *indeter_if = new cpp_if(indeter_expr);
-   cpp_assign_stmt* indeter_assign = new cpp_assign_stmt(get_el, boost_const);
-   indeter_if->add_to_body(indeter_assign);
-   output_for->add_to_body(indeter_if);
-   cpp_assign_stmt* assign_default;
-   // Create/Add the output default value before
-   switch(type_)
+   // Run it when one of the events happens
+   std::string comment("always");
+   cpp_binop_expr* wake_cond = new cpp_binop_expr(CPP_BINOP_OR, boolean_type);
+   if(!events.empty())
    {
-      case CPP_CLASS_AND:
-         assign_default = new cpp_assign_stmt(get_el, new cpp_const_expr("true", CPP_TYPE_NOTYPE));
-         break;
-      case CPP_CLASS_OR:
-         assign_default = new cpp_assign_stmt(get_el, new cpp_const_expr("false", CPP_TYPE_NOTYPE));
-         break;
-      default:
-         assert(false);
+      cpp_binop_expr* event_cond = new cpp_binop_expr(CPP_BINOP_OR, boolean_type);
+      comment += " @(";
+      for(sensitivity_list_t::const_iterator it = events.begin(); it != events.end(); ++it)
+      {
+         cpp_binop_expr* this_signal = new cpp_binop_expr(CPP_BINOP_EQ, boolean_type);
+         this_signal->add_expr(new cpp_var_ref("signal", string_type));
+         this_signal->add_expr(new cpp_const_expr(it->first.c_str(), string_type));
+         cpp_fcall_stmt* new_value = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_IVL_LOGIC), new cpp_var_ref(INPUT_VAR_NAME, no_type), "at");
+         new_value->add_param(new cpp_const_expr(it->first.c_str(), string_type));
+         cpp_expr* edge;
+         if(it != events.begin())
+            comment += " or ";
+         switch(it->second)
+         {
+            case CPP_EDGE_POS:
+            case CPP_EDGE_NEG:
+               {
+                  const char* fun = it->second == CPP_EDGE_POS ? "ivl::posedge" : "ivl::negedge";
+                  cpp_fcall_stmt* edge_call = new cpp_fcall_stmt(boolean_type, new cpp_const_expr(fun, no_type), "");
+                  edge_call->add_param(new cpp_var_ref(OLD_VALUE_VAR_NAME, no_type));
+                  edge_call->add_param(new_value);
+                  edge = edge_call;
+                  comment += it->second == CPP_EDGE_POS ? "posedge " : "negedge ";
+               }
+               break;
+            case CPP_EDGE_ANY:
+               {
+                  cpp_fcall_stmt* same_value = new cpp_fcall_stmt(boolean_type, new cpp_var_ref(OLD_VALUE_VAR_NAME, no_type), "eeq");
+                  same_value->add_param(new_value);
+                  edge = new cpp_unaryop_expr(CPP_UNARYOP_NOT, same_value, boolean_type);
+               }
+               break;
+            default:
+               assert(false);
+         }
+         comment += it->first;
+         event_cond->add_expr(new cpp_binop_expr(this_signal, CPP_BINOP_AND, edge, boolean_type));
+      }
+      comment += ")";
+      // A process resumed later is not waiting for its events
+      if(last > 0)
+      {
+         cpp_fcall_stmt* waiting = new cpp_fcall_stmt(boolean_type, make_signal_read(step_signal), "has_xz");
+         wake_cond->add_expr(new cpp_binop_expr(waiting, CPP_BINOP_AND, event_cond, boolean_type));
+      }
+      else
+         wake_cond->add_expr(event_cond);
+   }
+   if(last > 0)
+   {
+      cpp_binop_expr* resumed = new cpp_binop_expr(CPP_BINOP_EQ, boolean_type);
+      resumed->add_expr(new cpp_var_ref("signal", string_type));
+      resumed->add_expr(new cpp_const_expr(step_signal.c_str(), string_type));
+      wake_cond->add_expr(resumed);
+      comment += ", resumed by " + step_signal;
+   }
+   process->set_comment(comment);
+   cpp_binop_expr* not_writer = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
+   not_writer->add_expr(new cpp_var_ref(WRITER_VAR_NAME, int_type));
+   not_writer->add_expr(new cpp_const_expr(number.str().c_str(), int_type));
+   // The flag of the process, set by the test of any change
+   cpp_function* pending_fun = get_function(WAKE_PENDING_FUN_NAME);
+   cpp_var* woken = new cpp_var("woken" + number.str(), boolean_type);
+   pending_fun->insert_stmt(wake_tests_, new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, woken->get_ref(), woken->get_type()), new cpp_const_expr("false", no_type)));
+   cpp_if* wake_if = new cpp_if(new cpp_binop_expr(not_writer, CPP_BINOP_AND, wake_cond, boolean_type));
+   wake_if->add_to_body(new cpp_assign_stmt(woken->get_ref(), new cpp_const_expr("true", no_type)));
+   wake_tests_->add_to_body(wake_if);
+   cpp_if* run_if = new cpp_if(woken->get_ref());
+   run_if->add_to_body(new cpp_assign_stmt(new cpp_var_ref(RUNNING_VAR_NAME, int_type), new cpp_const_expr(number.str().c_str(), int_type)));
+   cpp_fcall_stmt* run_process = new cpp_fcall_stmt(void_type, new cpp_const_expr(name.str().c_str(), no_type), "");
+   run_process->add_param(new cpp_var_ref(TIMESTAMP_VAR_NAME, unsigned_type));
+   run_process->add_param(new cpp_var_ref(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type));
+   run_if->add_to_body(run_process);
+   cpp_fcall_stmt* wake_pending = new cpp_fcall_stmt(void_type, new cpp_const_expr(WAKE_PENDING_FUN_NAME, no_type), "");
+   wake_pending->add_param(new cpp_const_expr(number.str().c_str(), int_type));
+   wake_pending->add_param(new cpp_var_ref(TIMESTAMP_VAR_NAME, unsigned_type));
+   wake_pending->add_param(new cpp_var_ref(RETURN_EVENT_LIST_VAR_NAME, ref_event_list_type));
+   run_if->add_to_body(wake_pending);
+   pending_fun->add_stmt(run_if);
+   add_function(process);
+   if(last == 0)
+   {
+      const std::list<cpp_stmt*>& body = steps.front().second;
+      for(std::list<cpp_stmt*>::const_iterator it = body.begin(); it != body.end(); ++it)
+         process->add_stmt(*it);
+      return process;
    }
-   event_handler->add_stmt(assign_default);
-   init_fun->add_stmt(assign_default);
-   // Add the for to the functions
-   event_handler->add_stmt(output_for);
-   init_fun->add_stmt(output_for);
    /*
-    * Add the cycle that will create the events
+    * Every step but the last sets the next one at once, so that the
+    * process ignores its events, and sends the event that resumes it.
+    * The last one sets the step back to x. The steps are a chain of
+    * if/else, so that the step just set does not run at once, but
+    * without events the step x follows the last one: the last step
+    * comes first, out of the chain.
     */
-   // Create the for.
-   iterator = new cpp_var ("it", list_iterator_type);
-   cpp_fcall_stmt* at_fun = new cpp_fcall_stmt(iterator->get_type(), output_var->get_ref(), "begin");
-   cpp_fcall_stmt* to_vector = new cpp_fcall_stmt(string_type, at_fun, "second");
-   to_vector->set_pointer_call();
-   to_vector->set_member_access();
-   precycle = new cpp_assign_stmt(new cpp_unaryop_expr(CPP_UNARYOP_DECL, iterator->get_ref(), iterator->get_type()), new cpp_fcall_stmt(at_fun->get_type(), to_vector, "begin"));
-   cond = new cpp_binop_expr(CPP_BINOP_NEQ, boolean_type);
-   cond->add_expr(new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, iterator->get_ref(), iterator->get_type()));
-   cond->add_expr(new cpp_fcall_stmt(at_fun->get_type(), to_vector, "end"));
-   cpp_for * push_event_for_handler = new cpp_for(cond);
-   push_event_for_handler->add_precycle(precycle);
-   push_event_for_handler->add_postcycle(new cpp_unaryop_expr(CPP_UNARYOP_ADD, iterator->get_ref(), iterator->get_type()));
-   cpp_for * push_event_for_init = new cpp_for(*push_event_for_handler);
-   // Start creating stuff to instantiate the new event
-   cpp_fcall_stmt* receiver_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "first");
-   receiver_name->set_member_access();
-   cpp_fcall_stmt* signal_name = new cpp_fcall_stmt(string_type, new cpp_unaryop_expr(CPP_UNARYOP_DEREF, iterator->get_ref(), iterator->get_type()), "second");
-   signal_name->set_member_access();
-   cpp_const_expr* event_name = new cpp_const_expr(cpp_type::tostring(CPP_TYPE_CUSTOM_EVENT).c_str(), no_type);
-   cpp_fcall_stmt* new_event_fcall_handler = new cpp_fcall_stmt(no_type, event_name, "");
-   cpp_fcall_stmt* new_event_fcall_init = new cpp_fcall_stmt(no_type, event_name, "");
-   cpp_unaryop_expr* new_event_handler = new cpp_unaryop_expr(CPP_UNARYOP_NEW, new_event_fcall_handler, local_event_type);
-   cpp_unaryop_expr* new_event_init = new cpp_unaryop_expr(CPP_UNARYOP_NEW, new_event_fcall_init, local_event_type);
-   cpp_fcall_stmt* is_indeter = new cpp_fcall_stmt(boolean_type, boost_const, "");
-   is_indeter->add_param(get_el);
-   cpp_unaryop_expr * not_is_indeter = new cpp_unaryop_expr(CPP_UNARYOP_NOT, is_indeter, is_indeter->get_type());
-   // Create the instruction that push back the new events
-   cpp_fcall_stmt* add_event_handler = new cpp_fcall_stmt(response_event->get_type(), response_event->get_ref(), "emplace_back");
-   cpp_fcall_stmt* add_event_init = new cpp_fcall_stmt(response_event->get_type(), response_event->get_ref(), "emplace_back");
-   // Create the if that will contain the for
-   cpp_if *if_not_indeter_handler = new cpp_if(not_is_indeter);
-   cpp_if *if_not_indeter_init = new cpp_if(*if_not_indeter_handler);
-   if_not_indeter_init->add_to_body(push_event_for_init);
-   if_not_indeter_handler->add_to_body(push_event_for_handler);
-   new_event_fcall_handler->add_param(receiver_name);
-   cpp_binop_expr * sum_timestamp = new cpp_binop_expr(CPP_BINOP_ADD, no_type);
-   sum_timestamp->add_expr(new cpp_fcall_stmt(new cpp_type(CPP_TYPE_UNSIGNED_INT), local_event->get_ref(), WARPED_TIMESTAMP_FUN_NAME));
-   sum_timestamp->add_expr(new cpp_const_expr("3", new cpp_type(CPP_TYPE_UNSIGNED_INT)));
-   new_event_fcall_handler->add_param(sum_timestamp);
-   new_event_fcall_handler->add_param(new_value_fcall);
-   new_event_fcall_handler->add_param(signal_name);
-   new_event_fcall_init->add_param(receiver_name);
-   new_event_fcall_init->add_param(new cpp_const_expr("0", new cpp_type(CPP_TYPE_UNSIGNED_INT)));
-   new_event_fcall_init->add_param(get_el);
-   new_event_fcall_init->add_param(signal_name);
-   add_event_handler->add_param(new_event_handler);
-   add_event_init->add_param(new_event_init);
-   push_event_for_handler->add_to_body(add_event_handler);
-   push_event_for_init->add_to_body(add_event_init);
-   event_handler->add_stmt(if_not_indeter_handler);
-   init_fun->add_stmt(if_not_indeter_init);
-   // Add the return statements
-   cpp_unaryop_expr* return_stmt = new cpp_unaryop_expr(CPP_UNARYOP_RETURN, response_event->get_ref(), response_event->get_type());
-   init_fun->add_stmt(return_stmt);
-   event_handler->add_stmt(return_stmt);
+   std::ostringstream unknown_step;
+   unknown_step << "ivl::logic_vector(" << step_width << ")";
+   cpp_if *first = NULL, *chain = NULL, *restart = NULL;
+   for(unsigned step = 0; step <= last; step++)
+   {
+      cpp_expr* this_step;
+      if(step == 0)
+         this_step = new cpp_fcall_stmt(boolean_type, make_signal_read(step_signal), "has_xz");
+      else
+      {
+         std::ostringstream value;
+         value << "ivl::logic_vector(\"";
+         for(unsigned bit = step_width; bit > 0; bit--)
+            value << ((step >> (bit - 1)) & 1);
+         value << "\")";
+         cpp_fcall_stmt* same_step = new cpp_fcall_stmt(boolean_type, make_signal_read(step_signal), "eeq");
+         same_step->add_param(new cpp_const_expr(value.str().c_str(), no_type));
+         this_step = same_step;
+      }
+      cpp_if* step_if = new cpp_if(this_step);
+      const std::list<cpp_stmt*>& body = steps[step].second;
+      for(std::list<cpp_stmt*>::const_iterator it = body.begin(); it != body.end(); ++it)
+         step_if->add_to_body(*it);
+      cpp_fcall_stmt* set_step = new cpp_fcall_stmt(void_type, get_var(INPUT_VAR_NAME)->get_ref(), "set");
+      set_step->add_param(new cpp_const_expr(step_signal.c_str(), string_type));
+      if(step < last)
+      {
+         std::ostringstream next;
+         next << "ivl::logic_vector(\"";
+         for(unsigned bit = step_width; bit > 0; bit--)
+            next << (((step + 1) >> (bit - 1)) & 1);
+         next << "\")";
+         set_step->add_param(new cpp_const_expr(next.str().c_str(), no_type));
+         step_if->add_to_body(set_step);
+         step_if->add_to_body(make_scheduled_assign(step_signal,
+                  new cpp_const_expr(next.str().c_str(), no_type), steps[step + 1].first));
+      }
+      else
+      {
+         set_step->add_param(new cpp_const_expr(unknown_step.str().c_str(), no_type));
+         step_if->add_to_body(set_step);
+      }
+      if(step == last && events.empty())
+         restart = step_if;
+      else
+      {
+         if(chain == NULL)
+            first = step_if;
+         else
+            chain->add_to_else_body(step_if);
+         chain = step_if;
+      }
+   }
+   if(restart != NULL)
+      process->add_stmt(restart);
+   process->add_stmt(first);
+   // Start a process without events with the initial events
+   if(events.empty())
+   {
+      cpp_fcall_stmt* start = new cpp_fcall_stmt(no_type, get_var(PENDING_VAR_NAME)->get_ref(), "emplace_back");
+      start->add_param(new cpp_const_expr(step_signal.c_str(), string_type));
+      start->add_param(new cpp_const_expr(unknown_step.str().c_str(), no_type));
+      get_function(WARPED_INIT_EVENT_FUN_NAME)->insert_stmt(init_wake_, start);
+   }
+   return process;
 }
 
+cpp_expr* cppClass::make_signal_read(const std::string& signal)
+{
+   assert(signal_widths_.find(signal) != signal_widths_.end());
+   cpp_fcall_stmt* read = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_IVL_LOGIC), get_var(INPUT_VAR_NAME)->get_ref(), "at");
+   read->add_param(new cpp_const_expr(signal.c_str(), new cpp_type(CPP_TYPE_STD_STRING)));
+   return read;
+}
+
+/*
+ * A blocking assignment changes the signal at once: the statements
+ * that follow read the new value.
+ */
+cpp_stmt* cppClass::make_blocking_assign(const std::string& signal, cpp_expr* value)
+{
+   if(wake_tests_ == NULL)
+      implement_processes();
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_fcall_stmt* change = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_VOID), new cpp_const_expr(CHANGE_SIGNAL_FUN_NAME, no_type), "");
+   change->add_param(new cpp_const_expr(signal.c_str(), new cpp_type(CPP_TYPE_STD_STRING)));
+   change->add_param(value);
+   change->add_param(new cpp_var_ref(TIMESTAMP_VAR_NAME, no_type));
+   change->add_param(new cpp_var_ref(RETURN_EVENT_LIST_VAR_NAME, no_type));
+   return change;
+}
+
+/*
+ * Any other assignment computes the value now and sends it to this
+ * same object, which stores it when the event arrives.
+ */
+cpp_stmt* cppClass::make_scheduled_assign(const std::string& signal, cpp_expr* value,
+      unsigned delay)
+{
+   assert(delay > 0);
+   if(wake_tests_ == NULL)
+      implement_processes();
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   cpp_type* unsigned_type = new cpp_type(CPP_TYPE_UNSIGNED_INT);
+   std::ostringstream delay_str;
+   delay_str << delay;
+   cpp_binop_expr* timestamp = new cpp_binop_expr(CPP_BINOP_ADD, no_type);
+   timestamp->add_expr(new cpp_var_ref(TIMESTAMP_VAR_NAME, unsigned_type));
+   timestamp->add_expr(new cpp_const_expr(delay_str.str().c_str(), unsigned_type));
+   cpp_const_expr* event_name = new cpp_const_expr(cpp_type::tostring(CPP_TYPE_CUSTOM_EVENT).c_str(), no_type);
+   cpp_fcall_stmt* new_event_fcall = new cpp_fcall_stmt(no_type, event_name, "");
+   new_event_fcall->add_param(new cpp_var_ref("name_", no_type));
+   new_event_fcall->add_param(timestamp);
+   new_event_fcall->add_param(value);
+   // The event keeps a reference to the name: use the one in the table
+   cpp_fcall_stmt* find_signal = new cpp_fcall_stmt(no_type, get_var(INPUT_VAR_NAME)->get_ref(), "find");
+   find_signal->add_param(new cpp_const_expr(signal.c_str(), new cpp_type(CPP_TYPE_STD_STRING)));
+   cpp_fcall_stmt* signal_name = new cpp_fcall_stmt(new cpp_type(CPP_TYPE_STD_STRING), find_signal, "first");
+   signal_name->set_pointer_call();
+   signal_name->set_member_access();
+   new_event_fcall->add_param(signal_name);
+   cpp_fcall_stmt* add_event = new cpp_fcall_stmt(no_type, new cpp_var_ref(RETURN_EVENT_LIST_VAR_NAME, no_type), "emplace_back");
+   add_event->add_param(new cpp_unaryop_expr(CPP_UNARYOP_NEW, new_event_fcall, new cpp_type(CPP_TYPE_CUSTOM_EVENT)));
+   return add_event;
+}
 
 cpp_var* cppClass::get_var(const std::string &name) const
 {
@@ -831,14 +1492,97 @@ cpp_function* cppClass::get_function(const std::string &name) const
 
 void cpp_context::emit_after_classes(std::ostream &of, int level) const
 {
+   std::list<cpp_stmt*> main_stmts(setup_);
+   main_stmts.insert(main_stmts.end(), statements_.begin(), statements_.end());
+   main_stmts.insert(main_stmts.end(), start_.begin(), start_.end());
    newline(of, level);
    of << "int main(int argc, const char** argv) {";
    newline(of, indent(level));
-   emit_children<cpp_stmt>(of, statements_, level, ";");
+   emit_children<cpp_stmt>(of, main_stmts, level, ";");
    newline(of, level);
    of << "}; ";
 }
 
+unsigned cpp_context::build_parts(unsigned part_size) const
+{
+   assert(part_size > 0);
+   return (statements_.size() + part_size - 1) / part_size;
+}
+
+static void emit_build_part_signature(std::ostream &of, unsigned part)
+{
+   of << "void " << BUILD_DESIGN_FUN_NAME << part
+      << "(std::vector<warped::SimulationObject*>& " << OBJECT_POINTERS_VAR_NAME << ")";
+}
+
+/*
+ * The statements from part * part_size on, in a function of their
+ * own: a file holding it is compiled as fast as its size allows.
+ */
+void cpp_context::emit_build_part(std::ostream &of, unsigned part, unsigned part_size) const
+{
+   std::list<cpp_stmt*>::const_iterator first = statements_.begin();
+   for(unsigned skip = part * part_size; skip > 0 && first != statements_.end(); skip--)
+      first++;
+   std::list<cpp_stmt*>::const_iterator last = first;
+   for(unsigned count = 0; count < part_size && last != statements_.end(); count++)
+      last++;
+   std::list<cpp_stmt*> chunk(first, last);
+   newline(of, 0);
+   emit_build_part_signature(of, part);
+   of << " {";
+   newline(of, indent(0));
+   emit_children<cpp_stmt>(of, chunk, 0, ";");
+   newline(of, 0);
+   of << "}";
+   newline(of, 0);
+}
+
+void cpp_context::emit_globals_declaration(std::ostream &of) const
+{
+   for(std::list<cpp_var*>::const_iterator it = globals_.begin();
+         it != globals_.end(); it++) {
+      of << "extern ";
+      (*it)->get_type()->emit(of);
+      of << " " << (*it)->get_name() << ";";
+      newline(of, 0);
+   }
+}
+
+void cpp_context::emit_split_main(std::ostream &of, unsigned part_size) const
+{
+   newline(of, 0);
+   for(std::list<cpp_var*>::const_iterator it = globals_.begin();
+         it != globals_.end(); it++) {
+      (*it)->emit(of, 0);
+      of << ";";
+   }
+   newline(of, 0);
+   unsigned parts = build_parts(part_size);
+   for(unsigned part = 0; part < parts; part++) {
+      newline(of, 0);
+      emit_build_part_signature(of, part);
+      of << ";";
+   }
+   std::list<cpp_stmt*> main_stmts(setup_);
+   cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   for(unsigned part = 0; part < parts; part++) {
+      std::ostringstream name;
+      name << BUILD_DESIGN_FUN_NAME << part;
+      cpp_fcall_stmt* build = new cpp_fcall_stmt(no_type, new cpp_const_expr(name.str().c_str(), no_type), "");
+      build->add_param(new cpp_var_ref(OBJECT_POINTERS_VAR_NAME, no_type));
+      main_stmts.push_back(build);
+   }
+   main_stmts.insert(main_stmts.end(), start_.begin(), start_.end());
+   newline(of, 0);
+   newline(of, 0);
+   of << "int main(int argc, const char** argv) {";
+   newline(of, indent(0));
+   emit_children<cpp_stmt>(of, main_stmts, 0, ";");
+   newline(of, 0);
+   of << "}; ";
+}
+
 void cpp_if::emit(std::ostream &of, int level) const
 {
    assert(condition_);
@@ -901,27 +1645,42 @@ void cpp_context::emit_before_classes(std::ostream &of, int level) const
       of << "#include <" + *it + ">";
       newline(of, level);
    }
-   newline(of, level);
-   of << "WARPED_DEFINE_OBJECT_STATE_STRUCT(" << cpp_type::tostring(CPP_TYPE_ELEMENT_STATE) << "){";
-   if(!elem_parts_.empty())
-      emit_children<cpp_var>(of, elem_parts_, indent(level), ";");
-   of << "};";
+}
 
-   newline(of, level);
+void cppClass::add_to_inputs(cpp_var* item, unsigned width)
+{
+   add_signal(item->get_name(), width);
+   // The following instruction is to avoid problems handling nexus
+   get_scope()->add_visible(item);
 }
 
-void cppClass::add_to_inputs(cpp_var* item)
+void cppClass::add_signal(const std::string& name, unsigned width)
 {
    cpp_function* constr = get_costructor();
    assert(constr);
    cpp_decl* input_var = get_scope()->get_decl(INPUT_VAR_NAME);
    assert(input_var);
-   cpp_fcall_stmt* add_event = new cpp_fcall_stmt(input_var->get_type(), new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, new cpp_var_ref(input_var->get_name(), input_var->get_type()), input_var->get_type()), "emplace");
-   add_event->add_param(new cpp_const_expr(item->get_name().c_str(), new cpp_type(CPP_TYPE_STD_STRING)));
-   add_event->add_param(new cpp_const_expr("boost::indeterminate", new cpp_type(CPP_TYPE_NOTYPE)));
+   cpp_fcall_stmt* add_event = new cpp_fcall_stmt(input_var->get_type(), new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, new cpp_var_ref(input_var->get_name(), input_var->get_type()), input_var->get_type()), "add");
+   add_event->add_param(new cpp_const_expr(name.c_str(), new cpp_type(CPP_TYPE_STD_STRING)));
+   // All the bits of the signal start as x
+   std::ostringstream unknown_value;
+   unknown_value << "ivl::logic_vector(" << width << ")";
+   add_event->add_param(new cpp_const_expr(unknown_value.str().c_str(), new cpp_type(CPP_TYPE_NOTYPE)));
    constr->add_stmt(add_event);
-   // The following instruction is to avoid problems handling nexus
-   get_scope()->add_visible(item);
+   signal_widths_[name] = width;
+   reserve_state(state_words_ + logic_words(width));
+}
+
+unsigned cppClass::get_signal_width(const std::string& name) const
+{
+   std::map<std::string, unsigned>::const_iterator it = signal_widths_.find(name);
+   return it == signal_widths_.end() ? 1 : it->second;
+}
+
+void cppClass::reserve_state(unsigned words)
+{
+   if(words > state_words_)
+      state_words_ = words;
 }
 
 void cppClass::add_to_hierarchy(cpp_var* item)
@@ -938,6 +1697,32 @@ void cppClass::add_to_hierarchy(cpp_var* item)
 }
 
 void cppClass::emit(std::ostream &of, int level) const
+{
+   emit_class(of, level, false);
+}
+
+void cppClass::emit_declaration(std::ostream &of, int level) const
+{
+   emit_class(of, level, true);
+}
+
+void cppClass::emit_definitions(std::ostream &of, int level) const
+{
+   const std::list<cpp_decl*>& members = scope_.get_printable();
+   for(std::list<cpp_decl*>::const_iterator it = members.begin(); it != members.end(); ++it) {
+      const cpp_function* fun = dynamic_cast<const cpp_function*>(*it);
+      if(fun != NULL) {
+         fun->emit_definition(of, name_, level);
+         newline(of, level);
+      }
+   }
+}
+
+/*
+ * With only_prototypes the member functions are declared and
+ * emit_definitions prints their bodies.
+ */
+void cppClass::emit_class(std::ostream &of, int level, bool only_prototypes) const
 {
    newline(of, level);
    emit_comment(of, level);
@@ -961,7 +1746,32 @@ void cppClass::emit(std::ostream &of, int level) const
    newline(of, level);
    of << "public:";
 
-   emit_children<cpp_decl>(of, scope_.get_printable(), indent(level), ";");
+   // The kernel copies the state to roll back: keep it a plain array
+   if(inherit_ == CPP_INHERIT_BASE_CLASS) {
+      int member_level = indent(indent(level));
+      newline(of, member_level);
+      of << "WARPED_DEFINE_OBJECT_STATE_STRUCT(" << cpp_type::tostring(CPP_TYPE_ELEMENT_STATE) << ") {";
+      newline(of, indent(member_level));
+      of << "ivl::logic_vector::word_t " << STATE_BITS_NAME << "[" << (state_words_ ? state_words_ : 1) << "];";
+      newline(of, member_level);
+      of << "};";
+      newline(of, member_level);
+   }
+
+   if(!only_prototypes)
+      emit_children<cpp_decl>(of, scope_.get_printable(), indent(level), ";");
+   else {
+      const std::list<cpp_decl*>& members = scope_.get_printable();
+      for(std::list<cpp_decl*>::const_iterator it = members.begin(); it != members.end(); ++it) {
+         const cpp_function* fun = dynamic_cast<const cpp_function*>(*it);
+         if(fun != NULL)
+            fun->emit_declaration(of, indent(level));
+         else
+            (*it)->emit(of, indent(level));
+         of << ";";
+         newline(of, indent(level));
+      }
+   }
 
    newline(of, level);
    of << "};";
@@ -982,6 +1792,9 @@ void cpp_unaryop_expr::emit(std::ostream &of, int level) const
       case CPP_UNARYOP_NOT:
          of << "!";
          break;
+      case CPP_UNARYOP_BIT_NOT:
+         of << "~";
+         break;
       case CPP_UNARYOP_NEW:
          of << "new ";
          break;
@@ -1048,6 +1861,13 @@ void cpp_fcall_stmt::emit(std::ostream &of, int level) const
    }
 }
 
+void cpp_procedural::insert_stmt(cpp_stmt* where, cpp_stmt* item)
+{
+   std::list<cpp_stmt*>::iterator it = std::find(statements_.begin(), statements_.end(), where);
+   assert(it != statements_.end());
+   statements_.insert(it, item);
+}
+
 cpp_var* cpp_function::get_var(const std::string &name) const
 {
    cpp_decl* temp = variables_.get_decl(name);
@@ -1057,20 +1877,34 @@ cpp_var* cpp_function::get_var(const std::string &name) const
    return retvalue;
 }
 
-void cpp_function::emit(std::ostream &of, int level) const
+void cpp_function::emit_signature(std::ostream &of, int level,
+      const std::string& qualifier) const
 {
-   newline(of, level);
-   emit_comment(of, level);
-   if(isvirtual)
-      of << "virtual ";
    type_->emit(of, level);
-   of << " " << name_ << " (";
-   emit_children<cpp_decl>(of, scope_.get_printable(), indent(level), ",", false);
+   of << " " << qualifier << name_ << " (";
+   if(qualifier.empty())
+      emit_children<cpp_decl>(of, scope_.get_printable(), indent(level), ",", false);
+   else {
+      // The default values stay in the declaration
+      const std::list<cpp_decl*>& params = scope_.get_printable();
+      int sz = params.size();
+      for(std::list<cpp_decl*>::const_iterator it = params.begin(); it != params.end(); ++it) {
+         const cpp_var* param = dynamic_cast<const cpp_var*>(*it);
+         assert(param);
+         param->emit_parameter(of, indent(level));
+         if(--sz > 0) {
+            of << ",";
+            newline(of, indent(level));
+         }
+      }
+   }
    of << ")";
    if(isconst)
       of << " const";
-   if(isoverride)
-      of << " override";
+}
+
+void cpp_function::emit_body(std::ostream &of, int level) const
+{
    if(isconstructor)
    {
       of << " : ";
@@ -1084,6 +1918,37 @@ void cpp_function::emit(std::ostream &of, int level) const
    of << "}";
 }
 
+void cpp_function::emit(std::ostream &of, int level) const
+{
+   newline(of, level);
+   emit_comment(of, level);
+   if(isvirtual)
+      of << "virtual ";
+   emit_signature(of, level, "");
+   if(isoverride)
+      of << " override";
+   emit_body(of, level);
+}
+
+void cpp_function::emit_declaration(std::ostream &of, int level) const
+{
+   newline(of, level);
+   emit_comment(of, level);
+   if(isvirtual)
+      of << "virtual ";
+   emit_signature(of, level, "");
+   if(isoverride)
+      of << " override";
+}
+
+void cpp_function::emit_definition(std::ostream &of, const std::string& class_name,
+      int level) const
+{
+   newline(of, level);
+   emit_signature(of, level, class_name + "::");
+   emit_body(of, level);
+}
+
 cpp_var_ref* cpp_var::get_ref()
 {
    if(ref_to_this_var == NULL)
@@ -1105,6 +1970,13 @@ void cpp_assert::emit(std::ostream &of, int level) const
    of << ")";
 }
 
+void cpp_var::emit_parameter(std::ostream &of, int level) const
+{
+   newline(of, level);
+   type_->emit(of, level);
+   of << " " << name_;
+}
+
 void cpp_var::emit(std::ostream &of, int level) const
 {
    newline(of, level);
@@ -24,6 +24,7 @@
 #include <inttypes.h>
 #include "cpp_element.hh"
 #include "cpp_type.hh"
+#include <map>
 #include <set>
 #include <cassert>
 
@@ -33,10 +34,21 @@ using namespace std;
 #define CUSTOM_EVENT_CLASS_NAME "EventClass"
 // Name of the class that every SimulationObject will inherit
 #define BASE_CLASS_NAME "Module"
+// Name of the class that evaluates a cluster of gates
+#define CLUSTER_CLASS_NAME "Cluster"
 // Name of the function to add a signal
 #define ADD_SIGNAL_FUN_NAME "addSignal"
 // Name of the function to add an output
 #define ADD_OUTPUT_FUN_NAME "addOutput"
+// Name of the functions to describe the gates of a cluster
+#define ADD_GATE_FUN_NAME "addGate"
+#define ADD_GATE_INPUT_FUN_NAME "addGateInput"
+// Name of the function to delay an output of a cluster
+#define SET_DELAY_FUN_NAME "setDelay"
+// Name of the functions that build the design with the split output
+#define BUILD_DESIGN_FUN_NAME "buildDesign"
+// Name of the vector of the objects handed to the kernel
+#define OBJECT_POINTERS_VAR_NAME "object_pointers"
 
 class cpp_scope;
 class cppClass;
@@ -103,6 +115,8 @@ enum cpp_binop_t {
    CPP_BINOP_XNOR,
    CPP_BINOP_DIV,
    CPP_BINOP_SQUARE_BRACKETS,
+   CPP_BINOP_BIT_AND,
+   CPP_BINOP_BIT_OR,
 };
 
 /*
@@ -133,6 +147,7 @@ private:
 
 enum cpp_unaryop_t {
    CPP_UNARYOP_ADD,
+   CPP_UNARYOP_BIT_NOT,
    CPP_UNARYOP_DECL,
    CPP_UNARYOP_DEREF,
    CPP_UNARYOP_LITERAL,
@@ -250,6 +265,8 @@ public:
       : cpp_decl(name, type), ref_to_this_var(NULL), default_value(def_val) {}
 
    virtual void emit(std::ostream &of, int level) const;
+   // Like emit, without the default value
+   void emit_parameter(std::ostream &of, int level) const;
    cpp_var_ref* get_ref();
 
 private:
@@ -390,6 +407,8 @@ public:
 
    virtual cpp_scope *get_scope() { return &scope_; }
    void add_stmt(cpp_stmt* item) { statements_.push_back(item); };
+   // Add item just before the statement where
+   void insert_stmt(cpp_stmt* where, cpp_stmt* item);
    void add_param(cpp_var *p) { scope_.add_decl(p); }
 
 protected:
@@ -409,14 +428,30 @@ public:
    void emit_before_classes(std::ostream &of, int level = 0) const;
    void add_stmt(cpp_stmt* el) { statements_.push_back(el); };
    void add_stmt(std::list<cpp_stmt*> el) { statements_.splice(statements_.end(), el); };
-   void add_var_to_state(cpp_var* el) { elem_parts_.push_back(el); };
    void add_include(std::string el ) { includes_.insert(el); };
+   /*
+    * The statements that create the simulation come first in the
+    * main, the one that starts it last. The others build the design.
+    */
+   void add_setup(std::list<cpp_stmt*> el) { setup_.splice(setup_.end(), el); };
+   void add_start(cpp_stmt* el) { start_.push_back(el); };
+   /*
+    * With the split output the statements that build the design are
+    * spread over functions of at most part_size statements, in files
+    * of their own, and the objects they create are globals.
+    */
+   void add_global(cpp_var* var) { globals_.push_back(var); };
+   unsigned build_parts(unsigned part_size) const;
+   void emit_build_part(std::ostream &of, unsigned part, unsigned part_size) const;
+   void emit_split_main(std::ostream &of, unsigned part_size) const;
+   void emit_globals_declaration(std::ostream &of) const;
 
 private:
-   // the macro that define the state
-   std::list<cpp_var*> elem_parts_;
    // statements inside the main
+   std::list<cpp_stmt*> setup_;
    std::list<cpp_stmt*> statements_;
+   std::list<cpp_stmt*> start_;
+   std::list<cpp_var*> globals_;
    std::set<std::string> includes_;
 };
 
@@ -444,6 +479,13 @@ public:
    }
 
    virtual void emit(std::ostream &of, int level = 0) const;
+   /*
+    * The split output: the prototype inside the class and the
+    * definition out of it.
+    */
+   void emit_declaration(std::ostream &of, int level = 0) const;
+   void emit_definition(std::ostream &of, const std::string& class_name,
+         int level = 0) const;
    cpp_scope *get_scope() { return &variables_; }
    void set_override() { isoverride = true; }
    void add_init(cpp_fcall_stmt* el) { init_list_.push_back(el); }
@@ -453,6 +495,9 @@ public:
    void set_constructor() { isconstructor = true; }
 
 private:
+   void emit_signature(std::ostream &of, int level, const std::string& qualifier) const;
+   void emit_body(std::ostream &of, int level) const;
+
    std::list<cpp_fcall_stmt*> init_list_;
    // Local vars
    cpp_scope variables_;
@@ -464,13 +509,36 @@ private:
  * CPP_CLASS_MODULE is a special value. It means that
  * the corrisponding class is not a logic gate but a
  * general module.
+ * CPP_CLASS_GATE is a logic gate, LPM device or UDP.
+ * CPP_CLASS_CLUSTER is a group of logic gates evaluated
+ * inside a single simulation object: every gate of the
+ * design ends up in a cluster, so CPP_CLASS_GATE never
+ * becomes a class. The generated code tells the gates apart
+ * with the ivl::gate_type of ivl_logic.hpp.
  */
 enum cpp_class_type {
    CPP_CLASS_MODULE,
-   CPP_CLASS_AND,
-   CPP_CLASS_OR
+   CPP_CLASS_GATE,
+   CPP_CLASS_CLUSTER
 };
 
+/*
+ * The edge of a signal an always block waits for.
+ */
+enum cpp_edge_t {
+   CPP_EDGE_ANY,
+   CPP_EDGE_POS,
+   CPP_EDGE_NEG
+};
+
+typedef std::list< std::pair<std::string, cpp_edge_t> > sensitivity_list_t;
+
+/*
+ * The statements of an always block between its delay controls,
+ * each one with the delay that precedes it (0 for the first).
+ */
+typedef std::vector< std::pair<unsigned, std::list<cpp_stmt*> > > process_steps_t;
+
 enum cpp_inherit_class {
    CPP_INHERIT_BASE_CLASS,
    CPP_INHERIT_EVENT,
@@ -487,11 +555,17 @@ public:
    virtual ~cppClass() {};
 
    void emit(std::ostream &of, int level = 0) const;
+   // The class with the prototypes only, and the member functions
+   void emit_declaration(std::ostream &of, int level = 0) const;
+   void emit_definitions(std::ostream &of, int level = 0) const;
    const std::string &get_name() const { return name_; }
    void add_var(cpp_var *item) { scope_.add_decl(item); }
    void add_visible(cpp_decl *item) { scope_.add_visible(item); }
-   void add_to_inputs(cpp_var *item);
+   void add_to_inputs(cpp_var *item, unsigned width = 1);
    void add_to_hierarchy(cpp_var *item);
+   unsigned get_signal_width(const std::string& name) const;
+   // Make room in the state for at least this many words
+   void reserve_state(unsigned words);
    void add_function(cpp_procedural* fun) { scope_.add_decl(fun); };
    cpp_class_type get_type() const { return type_; };
    cpp_inherit_class get_inherited() const { return inherit_; };
@@ -501,11 +575,28 @@ public:
    cpp_function* get_function(const std::string &name) const;
    cpp_var* get_var(const std::string &name) const;
 
+   /*
+    * The always blocks of a module. A process is a member function
+    * called by the event handler when one of the events it waits
+    * for happens. Its statements are built with the make_ functions.
+    * A process with delay controls returns at each delay and is
+    * resumed with the next step by an event it sends to itself.
+    */
+   cpp_function* add_process(const sensitivity_list_t& events,
+         const process_steps_t& steps);
+   cpp_expr* make_signal_read(const std::string& signal);
+   cpp_stmt* make_blocking_assign(const std::string& signal, cpp_expr* value);
+   cpp_stmt* make_scheduled_assign(const std::string& signal, cpp_expr* value,
+         unsigned delay);
+
 private:
+   void emit_class(std::ostream &of, int level, bool only_prototypes) const;
    inline void add_simulation_functions();
-   inline void implement_gate();
+   inline void implement_processes();
+   inline void implement_cluster();
    inline void implement_simulation_functions();
    inline void add_event_functions();
+   void add_signal(const std::string& name, unsigned width);
 
    // Class name
    std::string name_;
@@ -514,8 +605,27 @@ private:
    const cpp_inherit_class inherit_;
    // This variable contain the information about wich kind of SimulationObject you are.
    const cpp_class_type type_;
+   // Words of the state array and width of the signals added
+   unsigned state_words_;
+   std::map<std::string, unsigned> signal_widths_;
+   // The event handler statements the processes hook into
+   cpp_stmt *signal_update_, *handler_return_;
+   // The loop of wakePending testing the changes, NULL without processes
+   cpp_for* wake_tests_;
+   // The initial events wake the processes here
+   cpp_stmt* init_wake_;
+   unsigned processes_;
 };
 
+/*
+ * The number of words ivl::logic_vector stores for a signal
+ * of the given width: two bit planes of 64 bit words.
+ */
+inline unsigned logic_words(unsigned width)
+{
+   return 2 * ((width + 63) / 64);
+}
+
 typedef std::list<cppClass*> entity_list_t;
 
 #endif
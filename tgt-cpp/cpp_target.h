@@ -11,8 +11,18 @@
 
 using namespace std;
 
-void error(const char *fmt, ...);
-void debug_msg(const char *fmt, ...);
+// Let the compiler check the arguments of the messages.
+#if defined(__MINGW32__)
+# define CPP_PRINTF_FORMAT __attribute__((format (gnu_printf,1,2)))
+#elif defined(__GNUC__)
+# define CPP_PRINTF_FORMAT __attribute__((format (printf,1,2)))
+#else
+# define CPP_PRINTF_FORMAT
+#endif
+
+void error(const char *fmt, ...) CPP_PRINTF_FORMAT;
+void debug_msg(const char *fmt, ...) CPP_PRINTF_FORMAT;
+const char* get_design_flag(const char *key);
 
 int draw_scope(ivl_scope_t scope, void *_parent);
 extern "C" int draw_process(ivl_process_t net, void *cd);
@@ -22,6 +32,10 @@ cpp_var_ref *nexus_to_var_ref(cpp_scope *scope, ivl_nexus_t nexus);
 cpp_var_ref* readable_ref(cpp_scope* scope, ivl_nexus_t nex);
 string make_safe_name(ivl_signal_t sig);
 void draw_logic(cppClass *arch, ivl_net_logic_t log);
+void draw_lpm(cppClass *arch, ivl_lpm_t lpm);
+unsigned device_delay(ivl_expr_t rise, ivl_expr_t fall, ivl_expr_t decay);
 int draw_stmt(ivl_statement_t stmt);
+int draw_process_stmt(ivl_statement_t stmt, list<cpp_stmt*> &body);
+cpp_expr *translate_expr(ivl_expr_t e);
 
 #endif /* #ifndef INC_CPP_TARGET_H */
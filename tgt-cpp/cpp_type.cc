@@ -31,12 +31,16 @@ std::string cpp_type::tostring(const cpp_type_name_t type)
    {
       case CPP_TYPE_BOOL:
          return std::string("bool");
-      case CPP_TYPE_BOOST_TRIBOOL:
-         return std::string("boost::tribool");
+      case CPP_TYPE_IVL_LOGIC:
+         return std::string("ivl::logic_vector");
+      case CPP_TYPE_IVL_SIGNAL_TABLE:
+         return std::string("ivl::signal_table");
       case CPP_TYPE_CUSTOM_EVENT:
          return std::string(CUSTOM_EVENT_CLASS_NAME);
       case CPP_TYPE_CUSTOM_BASE_CLASS:
          return std::string(BASE_CLASS_NAME);
+      case CPP_TYPE_CUSTOM_CLUSTER:
+         return std::string(CLUSTER_CLASS_NAME);
       case CPP_TYPE_ELEMENT_STATE:
          return std::string("ElementState");
       case CPP_TYPE_INT:
@@ -74,12 +78,18 @@ std::string cpp_type::get_string() const
       case CPP_TYPE_BOOL:
          returnvalue += std::string("bool");
          break;
-      case CPP_TYPE_BOOST_TRIBOOL:
-         returnvalue += std::string("boost::tribool");
+      case CPP_TYPE_IVL_LOGIC:
+         returnvalue += std::string("ivl::logic_vector");
+         break;
+      case CPP_TYPE_IVL_SIGNAL_TABLE:
+         returnvalue += std::string("ivl::signal_table");
          break;
       case CPP_TYPE_CUSTOM_BASE_CLASS:
          returnvalue += BASE_CLASS_NAME;
          break;
+      case CPP_TYPE_CUSTOM_CLUSTER:
+         returnvalue += CLUSTER_CLASS_NAME;
+         break;
       case CPP_TYPE_CUSTOM_EVENT:
          returnvalue += CUSTOM_EVENT_CLASS_NAME;
          break;
@@ -113,6 +123,8 @@ std::string cpp_type::get_string() const
       default:
          error("cpp_type::get_string: Unhandled type");
    }
+   if(isiterator)
+      returnvalue += "::iterator";
    if(isreference)
       returnvalue += "&";
    if(ispointer)
@@ -174,6 +186,8 @@ void cpp_type::emit(std::ostream &of, int num) const
          of << ">";
       if(isiterator)
          of << "::iterator";
+      if(isreference)
+         of << "&";
    } else if(name_ != CPP_TYPE_NOTYPE)
       of << get_decl_string();
 }
@@ -26,9 +26,11 @@
 
 enum cpp_type_name_t {
    CPP_TYPE_BOOL,
-   CPP_TYPE_BOOST_TRIBOOL,
+   CPP_TYPE_IVL_LOGIC,
+   CPP_TYPE_IVL_SIGNAL_TABLE,
    CPP_TYPE_CUSTOM_EVENT,
    CPP_TYPE_CUSTOM_BASE_CLASS,
+   CPP_TYPE_CUSTOM_CLUSTER,
    CPP_TYPE_ELEMENT_STATE,
    CPP_TYPE_INT,
    CPP_TYPE_NOTYPE,
@@ -24,20 +24,237 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
-
+#include <sstream>
+#include <algorithm>
 
 /*
- * A numeric literal ends up as std_logic bit string.
+ * The expressions of the processes work on ivl::logic_vector values
+ * and use the operators and the functions of ivl_logic.hpp, so the x
+ * and z bits follow the Verilog rules.
  */
+
+static cpp_type *logic_type()
+{
+   return new cpp_type(CPP_TYPE_IVL_LOGIC);
+}
+
+static cpp_fcall_stmt *logic_call(const char *fun, cpp_expr *arg1,
+                                  cpp_expr *arg2 = NULL, cpp_expr *arg3 = NULL)
+{
+   cpp_fcall_stmt *call =
+      new cpp_fcall_stmt(logic_type(), new cpp_const_expr(fun, CPP_TYPE_NOTYPE), "");
+   call->add_param(arg1);
+   if (arg2)
+      call->add_param(arg2);
+   if (arg3)
+      call->add_param(arg3);
+   return call;
+}
+
+// A constant, the bits are MSB first like a Verilog literal
+static cpp_expr *make_constant(const std::string &bits)
+{
+   return logic_call("ivl::logic_vector",
+                     new cpp_const_expr(bits.c_str(), CPP_TYPE_STD_STRING));
+}
+
+static cpp_expr *invert(cpp_expr *e)
+{
+   return new cpp_unaryop_expr(CPP_UNARYOP_BIT_NOT, e, logic_type());
+}
+
 static cpp_expr *translate_number(ivl_expr_t e)
 {
-   assert(ivl_expr_width(e) == 1);
-   return new cpp_const_expr("", ivl_expr_bits(e)[0]);
+   // The bits of the number are LSB first
+   std::string bits(ivl_expr_bits(e), ivl_expr_width(e));
+   std::reverse(bits.begin(), bits.end());
+   return make_constant(bits);
+}
+
+static cpp_expr *translate_ulong(ivl_expr_t e)
+{
+   unsigned long value = ivl_expr_uvalue(e);
+   unsigned width = ivl_expr_width(e);
+   std::string bits;
+   for (unsigned i = 0; i < width; i++) {
+      bits.insert(bits.begin(), value & 1 ? '1' : '0');
+      value = value >> 1;
+   }
+   return make_constant(bits);
+}
+
+static cpp_expr *translate_signal(ivl_expr_t e)
+{
+   ivl_signal_t sig = ivl_expr_signal(e);
+   if (ivl_expr_oper1(e) != NULL || ivl_signal_dimensions(sig) > 0) {
+      error("Arrays are not supported (%s:%d)",
+            ivl_expr_file(e), ivl_expr_lineno(e));
+      return NULL;
+   }
+   cppClass *theclass = get_active_class();
+   assert(theclass);
+   return theclass->make_signal_read(get_renamed_signal(sig));
+}
+
+static cpp_expr *translate_unary(ivl_expr_t e)
+{
+   cpp_expr *operand = translate_expr(ivl_expr_oper1(e));
+   if (NULL == operand)
+      return NULL;
+
+   char op = ivl_expr_opcode(e);
+   switch (op) {
+   case '~':
+      return invert(operand);
+   case '!':
+      return logic_call("ivl::logical_not", operand);
+   case '-':
+      {
+         std::string zero(ivl_expr_width(e), '0');
+         return new cpp_binop_expr(make_constant(zero), CPP_BINOP_SUB,
+                                   operand, logic_type());
+      }
+   case '&':
+      return logic_call("ivl::reduce_and", operand);
+   case '|':
+      return logic_call("ivl::reduce_or", operand);
+   case '^':
+      return logic_call("ivl::reduce_xor", operand);
+   case 'A':
+      return invert(logic_call("ivl::reduce_and", operand));
+   case 'N':
+      return invert(logic_call("ivl::reduce_or", operand));
+   case 'X':
+      return invert(logic_call("ivl::reduce_xor", operand));
+   default:
+      error("No translation for unary operator '%c' at %s:%d", op,
+            ivl_expr_file(e), ivl_expr_lineno(e));
+      return NULL;
+   }
+}
+
+static cpp_expr *translate_binary(ivl_expr_t e)
+{
+   char op = ivl_expr_opcode(e);
+   switch (op) {
+   case '<':
+   case '>':
+   case 'L':
+   case 'G':
+      if (ivl_expr_signed(ivl_expr_oper1(e)) && ivl_expr_signed(ivl_expr_oper2(e))) {
+         error("Signed comparisons are not supported (%s:%d)",
+               ivl_expr_file(e), ivl_expr_lineno(e));
+         return NULL;
+      }
+      break;
+   default:
+      break;
+   }
+
+   cpp_expr *lhs = translate_expr(ivl_expr_oper1(e));
+   cpp_expr *rhs = translate_expr(ivl_expr_oper2(e));
+   if (NULL == lhs || NULL == rhs)
+      return NULL;
+
+   switch (op) {
+   case '&':
+      return new cpp_binop_expr(lhs, CPP_BINOP_BIT_AND, rhs, logic_type());
+   case '|':
+      return new cpp_binop_expr(lhs, CPP_BINOP_BIT_OR, rhs, logic_type());
+   case '^':
+      return new cpp_binop_expr(lhs, CPP_BINOP_XOR, rhs, logic_type());
+   case 'A':
+      return invert(new cpp_binop_expr(lhs, CPP_BINOP_BIT_AND, rhs, logic_type()));
+   case 'O':
+      return invert(new cpp_binop_expr(lhs, CPP_BINOP_BIT_OR, rhs, logic_type()));
+   case 'X':
+      return invert(new cpp_binop_expr(lhs, CPP_BINOP_XOR, rhs, logic_type()));
+   case '+':
+      return new cpp_binop_expr(lhs, CPP_BINOP_ADD, rhs, logic_type());
+   case '-':
+      return new cpp_binop_expr(lhs, CPP_BINOP_SUB, rhs, logic_type());
+   case 'e':
+      return logic_call("ivl::equal", lhs, rhs);
+   case 'n':
+      return logic_call("ivl::not_equal", lhs, rhs);
+   case 'E':
+      return logic_call("ivl::case_equal", lhs, rhs);
+   case 'N':
+      return invert(logic_call("ivl::case_equal", lhs, rhs));
+   case 'a':
+      return logic_call("ivl::logical_and", lhs, rhs);
+   case 'o':
+      return logic_call("ivl::logical_or", lhs, rhs);
+   case '<':
+      return logic_call("ivl::less", lhs, rhs);
+   case '>':
+      return logic_call("ivl::less", rhs, lhs);
+   case 'L':
+      return logic_call("ivl::less_equal", lhs, rhs);
+   case 'G':
+      return logic_call("ivl::less_equal", rhs, lhs);
+   default:
+      error("No translation for binary operator '%c' at %s:%d", op,
+            ivl_expr_file(e), ivl_expr_lineno(e));
+      return NULL;
+   }
+}
+
+static cpp_expr *translate_ternary(ivl_expr_t e)
+{
+   cpp_expr *cond = translate_expr(ivl_expr_oper1(e));
+   cpp_expr *true_part = translate_expr(ivl_expr_oper2(e));
+   cpp_expr *false_part = translate_expr(ivl_expr_oper3(e));
+   if (NULL == cond || NULL == true_part || NULL == false_part)
+      return NULL;
+
+   return logic_call("ivl::select", cond, true_part, false_part);
+}
+
+// The first parameter is the most significant one
+static cpp_expr *translate_concat(ivl_expr_t e)
+{
+   cpp_expr *once = NULL;
+   unsigned nparms = ivl_expr_parms(e);
+   for (unsigned i = 0; i < nparms; i++) {
+      cpp_expr *parm = translate_expr(ivl_expr_parm(e, i));
+      if (NULL == parm)
+         return NULL;
+      once = once ? logic_call("ivl::concat", once, parm) : parm;
+   }
+   assert(once);
+
+   cpp_expr *result = once;
+   for (unsigned i = 1; i < ivl_expr_repeat(e); i++)
+      result = logic_call("ivl::concat", result, once);
+   return result;
+}
+
+static cpp_expr *translate_select(ivl_expr_t e)
+{
+   cpp_expr *base = translate_expr(ivl_expr_oper1(e));
+   if (NULL == base)
+      return NULL;
+
+   std::ostringstream width;
+   width << ivl_expr_width(e);
+   cpp_const_expr *width_expr = new cpp_const_expr(width.str().c_str(), CPP_TYPE_UNSIGNED_INT);
+
+   // Without a shift this is a cut to the width of the expression
+   ivl_expr_t shift = ivl_expr_oper2(e);
+   if (NULL == shift) {
+      cpp_fcall_stmt *part = new cpp_fcall_stmt(logic_type(), base, "part");
+      part->add_param(new cpp_const_expr("0", CPP_TYPE_UNSIGNED_INT));
+      part->add_param(width_expr);
+      return part;
+   }
+
+   cpp_expr *shift_expr = translate_expr(shift);
+   if (NULL == shift_expr)
+      return NULL;
+   return logic_call("ivl::part_select", base, shift_expr, width_expr);
 }
 
-/*
- * Generate a C++ expression from a Verilog expression.
- */
 cpp_expr *translate_expr(ivl_expr_t e)
 {
    assert(e);
@@ -46,15 +263,22 @@ cpp_expr *translate_expr(ivl_expr_t e)
    switch (type) {
    case IVL_EX_NUMBER:
       return translate_number(e);
-   case IVL_EX_STRING:
-   case IVL_EX_SIGNAL:
    case IVL_EX_ULONG:
+      return translate_ulong(e);
+   case IVL_EX_SIGNAL:
+      return translate_signal(e);
    case IVL_EX_UNARY:
+      return translate_unary(e);
    case IVL_EX_BINARY:
+      return translate_binary(e);
    case IVL_EX_SELECT:
-   case IVL_EX_UFUNC:
+      return translate_select(e);
    case IVL_EX_TERNARY:
+      return translate_ternary(e);
    case IVL_EX_CONCAT:
+      return translate_concat(e);
+   case IVL_EX_STRING:
+   case IVL_EX_UFUNC:
    case IVL_EX_SFUNC:
    case IVL_EX_DELAY:
    case IVL_EX_REALNUM:
@@ -20,54 +20,69 @@
 
 #include "hierarchy.hh"
 #include "cpp_target.h"
+#include "state.hh"
+#include "partition.hh"
+#include <algorithm>
+#include <cstdlib>
 #include <map>
+#include <set>
 #include <sstream>
+#include <vector>
 
+/*
+ * The top modules, in the order they are built. A module leaves the
+ * list when it is instantiated by another one.
+ */
 static std::list<submodule*> modules;
-static std::list<submodule*> seen_modules;
 
-void remember_hierarchy(cppClass* theclass)
+/*
+ * Every class has a root submodule, created with the class, that
+ * collects what is added to the class before it is instantiated.
+ * The instances of the class copy the root and receive what is
+ * added later. Both are indexed by the class, so building the
+ * hierarchy is linear in the number of instances.
+ */
+struct class_nodes {
+   submodule* root;
+   std::list<submodule*>::iterator top;
+   bool is_top;
+   std::vector<submodule*> instances;
+};
+static std::map<const cppClass*, class_nodes> nodes_of_class;
+
+static class_nodes& nodes_of(const cppClass* theclass)
 {
-   submodule *temp = new submodule(theclass);
-   for(std::list<submodule*>::iterator it = modules.begin();
-         it != modules.end(); it++)
-      if((*it)->relate_class->get_name() == theclass->get_name())
-         assert(false);
-   modules.push_front(temp);
+   std::map<const cppClass*, class_nodes>::iterator it = nodes_of_class.find(theclass);
+   assert(it != nodes_of_class.end());
+   return it->second;
 }
 
-submodule* submodule::find(const cppClass* tofind)
+/*
+ * The submodules that stand for a class in the hierarchy: the
+ * instances, or the root until there is none.
+ */
+static std::vector<submodule*> class_targets(const cppClass* theclass)
 {
-   if(this->type != CPP_CLASS_MODULE)
-      return NULL;
-   if(tofind->get_name() == relate_class->get_name())
-      return this;
-   if(hierarchy.empty())
-      return NULL;
-   submodule* tmp = NULL;
-   for(std::list<submodule*>::iterator it = hierarchy.begin();
-         it != hierarchy.end(); it++)
-   {
-      tmp = (*it)->find(tofind);
-      if(tmp != NULL)
-         return tmp;
-   }
-   assert(tmp == NULL);
-   return tmp;
+   class_nodes& nodes = nodes_of(theclass);
+   if (nodes.instances.empty())
+      return std::vector<submodule*>(1, nodes.root);
+   return nodes.instances;
+}
+
+void remember_hierarchy(cppClass* theclass)
+{
+   submodule *temp = new submodule(theclass);
+   assert(nodes_of_class.find(theclass) == nodes_of_class.end());
+   modules.push_front(temp);
+   class_nodes& nodes = nodes_of_class[theclass];
+   nodes.root = temp;
+   nodes.top = modules.begin();
+   nodes.is_top = true;
 }
 
 submodule* find_submodule(cppClass* parent)
 {
-   submodule *found = NULL;
-   for(std::list<submodule*>::iterator it = modules.begin();
-         it != modules.end(); it++)
-   {
-      found = (*it)->find(parent);
-      if(found != NULL)
-         return found;
-   }
-   assert(found == NULL);
-   return found;
+   return class_targets(parent).front();
 }
 
 submodule* add_submodule_to(submodule* item, cppClass* parent)
@@ -75,43 +90,20 @@ submodule* add_submodule_to(submodule* item, cppClass* parent)
    if(item->type == CPP_CLASS_MODULE)
    {
       assert(item->relate_class != NULL);
-      bool flag = true;
-      for(std::list<submodule*>::iterator it = modules.begin();
-            it != modules.end() && flag; it++)
-      {
-         if((*it)->relate_class->get_name() == item->relate_class->get_name())
-         {
-            item->merge((*it));
-            seen_modules.push_front(*it);
-            modules.remove(*it);
-            flag = false;
-            break;
-         }
-      }
-      for(std::list<submodule*>::iterator it = seen_modules.begin();
-            it != seen_modules.end() && flag ; it++)
+      class_nodes& nodes = nodes_of(item->relate_class);
+      item->merge(nodes.root);
+      if(nodes.is_top)
       {
-         if((*it)->relate_class->get_name() == item->relate_class->get_name())
-         {
-            item->merge((*it));
-            flag = false;
-            break;
-         }
+         modules.erase(nodes.top);
+         nodes.is_top = false;
       }
-      assert(!flag);
+      nodes.instances.push_back(item);
    }
-   for(std::list<submodule* >::iterator it = modules.begin();
-         it != modules.end() ; it++)
-   {
-      submodule* found = (*it)->find(parent);
-      if(found != NULL)
-      {
-         found->add_submodule(item);
-         return found;
-      }
-   }
-   assert(false);
-   return NULL;
+   std::vector<submodule*> targets = class_targets(parent);
+   for(std::vector<submodule*>::iterator it = targets.begin();
+         it != targets.end(); it++)
+      (*it)->add_submodule(item);
+   return targets.front();
 }
 
 void submodule::merge(submodule* el)
@@ -121,24 +113,15 @@ void submodule::merge(submodule* el)
    hierarchy.insert(hierarchy.end(), el->hierarchy.begin(), el->hierarchy.end());
 }
 
-void define_value(cppClass* theclass, const std::string signal, const boost::tribool value)
+void define_value(cppClass* theclass, const std::string signal, const std::string& bits)
 {
    assert(theclass != NULL);
    assert(!signal.empty());
-   assert(!boost::indeterminate(value));
-   submodule* found = NULL;
-   for(std::list<submodule* >::iterator it = modules.begin();
-         it != modules.end() ; it++)
-   {
-      found = (*it)->find(theclass);
-      if(found != NULL)
-      {
-         break;
-      }
-   }
-   assert(found != NULL);
-   assert(found->relate_class == theclass);
-   found->value_map.push_front(std::pair<std::string, boost::tribool>(signal, value));
+   assert(!bits.empty());
+   std::vector<submodule*> targets = class_targets(theclass);
+   for(std::vector<submodule*>::iterator it = targets.begin();
+         it != targets.end(); it++)
+      (*it)->value_map.push_front(std::pair<std::string, std::string>(signal, bits));
 }
 
 void submodule::insert_output(const std::string& str1, const std::string& str2)
@@ -150,12 +133,19 @@ void submodule::insert_output(const std::string& str1, const std::string& str2)
 void submodule::insert_input(const std::string& str1, const std::string& str2)
 {
    assert(!str1.empty() || !str2.empty());
-   signal_mapping.push_front(std::pair<std::string, std::string>(str1, str2));
+   // The order of the inputs is the order of the pins of a gate
+   signal_mapping.push_back(std::pair<std::string, std::string>(str1, str2));
+}
+
+void submodule::insert_private(const std::string& name, const std::string& bits)
+{
+   assert(type == CPP_CLASS_GATE);
+   assert(!name.empty() && !bits.empty());
+   private_signals.push_back(std::pair<std::string, std::string>(name, bits));
 }
 
-static unsigned int andPort(0);
-static unsigned int orPort(0);
 static unsigned int modulenum(0);
+static unsigned int clusternum(0);
 
 static std::string get_unique_name(cpp_class_type type)
 {
@@ -163,37 +153,286 @@ static std::string get_unique_name(cpp_class_type type)
 
    switch(type)
    {
-      case CPP_CLASS_OR:
-         ss << "orPort" << orPort++;
-         break;
-      case CPP_CLASS_AND:
-         ss << "andPort" << andPort++;
-         break;
       case CPP_CLASS_MODULE:
          ss << "module" << modulenum++;
          break;
+      case CPP_CLASS_CLUSTER:
+         ss << "cluster" << clusternum++;
+         break;
       default:
          error("Cannot find a unique name for this logic port");
    }
    return ss.str();
 }
 
-static std::string get_class_name(cpp_class_type type)
+/*
+ * The name of the gate type in the generated code.
+ */
+static std::string get_gate_type_name(const submodule* gate)
 {
-   std::ostringstream ss;
+   if (gate->type != CPP_CLASS_GATE || gate->gate.empty())
+      error("Cannot find a unique name for this logic port");
+   return "ivl::" + gate->gate;
+}
 
-   switch(type)
-   {
-      case CPP_CLASS_OR:
-         ss << "Or";
-         break;
-      case CPP_CLASS_AND:
-         ss << "And";
-         break;
-      default:
-         error("Cannot find a unique name for this logic port");
+/*
+ * Gate clustering.
+ *
+ * Without clustering every gate is a simulation object of its own,
+ * so every wire between two gates turns into events routed through
+ * the parent module. Here the gates of a module that drive each other
+ * are merged into clusters: a cluster is evaluated by a single
+ * simulation object and only the signals that leave it generate
+ * events. The number of gates in a cluster is limited by the
+ * cluster_size flag (-pcluster_size=N), 1 disables the clustering:
+ * every gate is then a cluster of its own.
+ */
+#define DEFAULT_CLUSTER_SIZE 32
+
+static unsigned cluster_size_limit()
+{
+   const char* flag = get_design_flag("cluster_size");
+   if (flag == NULL || *flag == 0)
+      return DEFAULT_CLUSTER_SIZE;
+   unsigned long limit = strtoul(flag, NULL, 10);
+   return limit > 0 ? limit : 1;
+}
+
+static unsigned find_root(std::vector<unsigned>& parent, unsigned idx)
+{
+   while (parent[idx] != idx) {
+      parent[idx] = parent[parent[idx]];
+      idx = parent[idx];
    }
-   return ss.str();
+   return idx;
+}
+
+/*
+ * Sort the gates of a cluster so that every gate comes after the
+ * gates driving it. Gates in a combinational loop are left in their
+ * original order and the cluster will need more evaluation passes.
+ */
+static void sort_cluster(submodule* cluster, const std::vector<submodule*>& gates)
+{
+   std::map<std::string, std::list<unsigned> > drivers;
+   for (unsigned idx = 0; idx < gates.size(); idx++)
+      drivers[gates[idx]->outputs_map.front().first].push_back(idx);
+
+   std::vector<unsigned> pending(gates.size(), 0);
+   std::vector< std::list<unsigned> > fanout(gates.size());
+   for (unsigned idx = 0; idx < gates.size(); idx++) {
+      std::list< std::pair<std::string, std::string> >& in = gates[idx]->signal_mapping;
+      for (std::list< std::pair<std::string, std::string> >::iterator it = in.begin();
+            it != in.end(); ++it) {
+         std::map<std::string, std::list<unsigned> >::iterator drv = drivers.find(it->first);
+         if (drv == drivers.end())
+            continue;
+         for (std::list<unsigned>::iterator src = drv->second.begin();
+               src != drv->second.end(); ++src) {
+            fanout[*src].push_back(idx);
+            pending[idx] += 1;
+         }
+      }
+   }
+
+   std::list<unsigned> ready;
+   for (unsigned idx = 0; idx < gates.size(); idx++)
+      if (pending[idx] == 0)
+         ready.push_back(idx);
+
+   std::vector<bool> done(gates.size(), false);
+   while (!ready.empty()) {
+      unsigned idx = ready.front();
+      ready.pop_front();
+      done[idx] = true;
+      cluster->hierarchy.push_back(gates[idx]);
+      for (std::list<unsigned>::iterator it = fanout[idx].begin();
+            it != fanout[idx].end(); ++it)
+         if (--pending[*it] == 0)
+            ready.push_back(*it);
+   }
+
+   cluster->passes = 1;
+   for (unsigned idx = 0; idx < gates.size(); idx++) {
+      if (done[idx])
+         continue;
+      cluster->hierarchy.push_back(gates[idx]);
+      cluster->passes = gates.size();
+   }
+}
+
+/*
+ * Return the children of the module with the connected gates
+ * replaced by clusters. The module itself is not changed.
+ */
+static std::list<submodule*> cluster_gates(submodule* current)
+{
+   std::list<submodule*> result;
+   std::vector<submodule*> gates;
+   for (std::list<submodule*>::iterator it = current->hierarchy.begin();
+         it != current->hierarchy.end(); it++)
+      if ((*it)->type != CPP_CLASS_MODULE)
+         gates.push_back(*it);
+
+   unsigned limit = cluster_size_limit();
+   if (gates.empty())
+      return current->hierarchy;
+
+   // Who drives and who reads every signal of this module
+   std::map<submodule*, unsigned> gate_index;
+   std::map<std::string, std::list<unsigned> > drivers;
+   std::map<std::string, std::list<unsigned> > readers;
+   for (unsigned idx = 0; idx < gates.size(); idx++) {
+      assert(gates[idx]->outputs_map.size() == 1);
+      gate_index[gates[idx]] = idx;
+      drivers[gates[idx]->outputs_map.front().first].push_back(idx);
+      std::list< std::pair<std::string, std::string> >& in = gates[idx]->signal_mapping;
+      for (std::list< std::pair<std::string, std::string> >::iterator it = in.begin();
+            it != in.end(); ++it)
+         readers[it->first].push_back(idx);
+   }
+   // Signals that are seen outside the gates: submodule inputs and
+   // the outputs of this module.
+   std::set<std::string> external;
+   for (std::list<submodule*>::iterator it = current->hierarchy.begin();
+         it != current->hierarchy.end(); it++) {
+      if ((*it)->type != CPP_CLASS_MODULE)
+         continue;
+      for (std::list< std::pair<std::string, std::string> >::iterator sig = (*it)->signal_mapping.begin();
+            sig != (*it)->signal_mapping.end(); ++sig)
+         external.insert(sig->second);
+   }
+   for (std::list< std::pair<std::string, std::string> >::iterator sig = current->outputs_map.begin();
+         sig != current->outputs_map.end(); ++sig)
+      external.insert(sig->second);
+
+   std::vector<unsigned> parent(gates.size());
+   std::vector<unsigned> size(gates.size(), 1);
+   for (unsigned idx = 0; idx < gates.size(); idx++)
+      parent[idx] = idx;
+   // The gates driving the same signal, like the IVL_LPM_PART_PV
+   // devices driving the parts of a vector, work on the value the
+   // signal has in the cluster state, so they are all in the same
+   // cluster whatever its size.
+   for (std::map<std::string, std::list<unsigned> >::iterator drv = drivers.begin();
+         drv != drivers.end(); ++drv) {
+      for (std::list<unsigned>::iterator src = drv->second.begin();
+            src != drv->second.end(); ++src) {
+         unsigned root1 = find_root(parent, drv->second.front());
+         unsigned root2 = find_root(parent, *src);
+         if (root1 == root2)
+            continue;
+         if (size[root1] < size[root2])
+            std::swap(root1, root2);
+         parent[root2] = root1;
+         size[root1] += size[root2];
+      }
+   }
+   // In a module with timed gates the zero-delay gates join the
+   // cluster of the gates they drive, whatever its size: a signal
+   // leaving a cluster is then delayed and the channel it travels
+   // on has a lookahead to offer to a conservative kernel.
+   bool timed = false;
+   for (unsigned idx = 0; idx < gates.size() && !timed; idx++)
+      timed = gates[idx]->delay > 0;
+   for (unsigned idx = 0; idx < gates.size() && timed; idx++) {
+      std::list< std::pair<std::string, std::string> >& in = gates[idx]->signal_mapping;
+      for (std::list< std::pair<std::string, std::string> >::iterator it = in.begin();
+            it != in.end(); ++it) {
+         std::map<std::string, std::list<unsigned> >::iterator drv = drivers.find(it->first);
+         if (drv == drivers.end())
+            continue;
+         // A signal with one zero-delay driver changes at once
+         std::list<unsigned>::iterator src = drv->second.begin();
+         while (src != drv->second.end() && gates[*src]->delay > 0)
+            ++src;
+         if (src == drv->second.end())
+            continue;
+         unsigned root1 = find_root(parent, idx);
+         unsigned root2 = find_root(parent, *src);
+         if (root1 == root2)
+            continue;
+         if (size[root1] < size[root2])
+            std::swap(root1, root2);
+         parent[root2] = root1;
+         size[root1] += size[root2];
+      }
+   }
+   // Merge every gate with the gates driving its inputs
+   for (unsigned idx = 0; idx < gates.size(); idx++) {
+      std::list< std::pair<std::string, std::string> >& in = gates[idx]->signal_mapping;
+      for (std::list< std::pair<std::string, std::string> >::iterator it = in.begin();
+            it != in.end(); ++it) {
+         std::map<std::string, std::list<unsigned> >::iterator drv = drivers.find(it->first);
+         if (drv == drivers.end())
+            continue;
+         unsigned root1 = find_root(parent, idx);
+         unsigned root2 = find_root(parent, drv->second.front());
+         if (root1 == root2 || size[root1] + size[root2] > limit)
+            continue;
+         if (size[root1] < size[root2])
+            std::swap(root1, root2);
+         parent[root2] = root1;
+         size[root1] += size[root2];
+      }
+   }
+
+   // Build a cluster for each group of gates
+   std::map<unsigned, std::vector<submodule*> > groups;
+   for (unsigned idx = 0; idx < gates.size(); idx++)
+      groups[find_root(parent, idx)].push_back(gates[idx]);
+
+   std::map<unsigned, submodule*> clusters;
+   for (std::map<unsigned, std::vector<submodule*> >::iterator grp = groups.begin();
+         grp != groups.end(); ++grp) {
+      submodule* cluster = new submodule(CPP_CLASS_CLUSTER);
+      sort_cluster(cluster, grp->second);
+      std::set<std::string> inputs;
+      std::set<std::string> outputs;
+      for (std::vector<submodule*>::iterator gate = grp->second.begin();
+            gate != grp->second.end(); ++gate) {
+         // An input driven outside the cluster is an input of the cluster
+         std::list< std::pair<std::string, std::string> >& in = (*gate)->signal_mapping;
+         for (std::list< std::pair<std::string, std::string> >::iterator it = in.begin();
+               it != in.end(); ++it) {
+            std::map<std::string, std::list<unsigned> >::iterator drv = drivers.find(it->first);
+            if (drv != drivers.end() && find_root(parent, drv->second.front()) == grp->first)
+               continue;
+            if (inputs.insert(it->first).second)
+               cluster->insert_input(it->first, it->first);
+         }
+         // An output read outside the cluster is an output of the cluster
+         const std::string& out = (*gate)->outputs_map.front().first;
+         bool seen_outside = external.count(out) != 0;
+         std::list<unsigned>& rd = readers[out];
+         for (std::list<unsigned>::iterator it = rd.begin();
+               it != rd.end() && !seen_outside; ++it)
+            seen_outside = find_root(parent, *it) != grp->first;
+         if (seen_outside && outputs.insert(out).second)
+            cluster->insert_output(out, out);
+      }
+      clusters[grp->first] = cluster;
+      debug_msg("Clustered %u gates (%u passes)",
+                (unsigned)grp->second.size(), cluster->passes);
+   }
+
+   // Replace the gates with their clusters, keeping the original order
+   for (std::list<submodule*>::iterator it = current->hierarchy.begin();
+         it != current->hierarchy.end(); it++) {
+      if ((*it)->type == CPP_CLASS_MODULE) {
+         result.push_back(*it);
+         continue;
+      }
+      std::map<unsigned, submodule*>::iterator cl = clusters.find(find_root(parent, gate_index[*it]));
+      assert(cl != clusters.end());
+      if (cl->second != NULL) {
+         result.push_back(cl->second);
+         cl->second = NULL;
+      }
+   }
+   if (!clusters.empty())
+      remember_logic(CPP_CLASS_CLUSTER);
+   return result;
 }
 
 static cpp_type* port_pointer_type = new cpp_type(CPP_TYPE_CUSTOM_BASE_CLASS);
@@ -201,54 +440,215 @@ static const cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
 static cpp_type* sim_obj_pointer_type = new cpp_type(CPP_TYPE_WARPED_SIMULATION_OBJECT);
 static const cpp_type* string_type = new cpp_type(CPP_TYPE_STD_STRING);
 
+static cpp_type* cluster_pointer_type = new cpp_type(CPP_TYPE_CUSTOM_CLUSTER);
+
+/*
+ * The statements that add the simulation objects to the vector
+ * given to the kernel. They are emitted last, grouped by part.
+ */
+static std::list< std::pair<std::string, cpp_stmt*> > object_pushes;
+
+static void push_object(const std::string& name, cpp_stmt* push)
+{
+   object_pushes.push_back(std::make_pair(name, push));
+}
+
+/*
+ * The state of the Cluster class must hold the signals of the
+ * biggest cluster of the design.
+ */
+static unsigned cluster_words(0);
+
+unsigned cluster_state_words()
+{
+   return cluster_words;
+}
+
+// A module forwards the signals it receives one time unit later
+#define MODULE_DELAY 1
+
+/*
+ * The declaration of the pointer to a new simulation object. With
+ * the split output the design is built by several functions and the
+ * pointers are globals.
+ */
+static cpp_expr* declare_object(cpp_var_ref* ref, const cpp_type* type)
+{
+   if (split_output_size() == 0)
+      return new cpp_unaryop_expr(CPP_UNARYOP_DECL, ref, type);
+   declare_global(new cpp_var(ref->get_name(), type));
+   return ref;
+}
+
+/*
+ * Instantiate a cluster of gates inside the module my_name.
+ */
+static void build_cluster(submodule* cluster, const cppClass* module_class,
+      const std::string& my_name, cpp_var_ref* module_ref,
+      cpp_expr* obj_pointers, std::list<cpp_stmt*>* list)
+{
+   assert(cluster->type == CPP_CLASS_CLUSTER);
+   std::string cluster_name = get_unique_name(cluster->type);
+   cpp_const_expr* cluster_string_name = new cpp_const_expr(cluster_name.c_str(), string_type);
+   cpp_var_ref* cluster_ref = new cpp_var_ref(cluster_name, cluster_pointer_type);
+   add_sim_object(cluster_name, cluster->hierarchy.size());
+   // Create the cluster
+   cpp_expr* decl = declare_object(cluster_ref, cluster_pointer_type);
+   cpp_fcall_stmt* constr = new cpp_fcall_stmt(no_type, new cpp_const_expr(CLUSTER_CLASS_NAME, no_type), "");
+   constr->add_param(cluster_string_name);
+   std::ostringstream passes;
+   passes << cluster->passes;
+   constr->add_param(new cpp_const_expr(passes.str().c_str(), no_type));
+   list->push_back(new cpp_assign_stmt(decl, new cpp_unaryop_expr(CPP_UNARYOP_NEW, constr, cluster_pointer_type)));
+   // Add the gates and all the signals they use
+   std::set<std::string> signals;
+   std::map<std::string, std::string> private_values;
+   for (std::list<submodule*>::iterator gate = cluster->hierarchy.begin();
+         gate != cluster->hierarchy.end(); gate++) {
+      const std::string& out = (*gate)->outputs_map.front().first;
+      cpp_fcall_stmt* add_gate = new cpp_fcall_stmt(no_type, cluster_ref, ADD_GATE_FUN_NAME);
+      add_gate->set_pointer_call();
+      add_gate->add_param(new cpp_const_expr(get_gate_type_name(*gate).c_str(), no_type));
+      add_gate->add_param(new cpp_const_expr(out.c_str(), string_type));
+      list->push_back(add_gate);
+      signals.insert(out);
+      for (std::list<std::pair<std::string, std::string> >::iterator input_it = (*gate)->signal_mapping.begin();
+            input_it != (*gate)->signal_mapping.end(); input_it++) {
+         cpp_fcall_stmt* add_input = new cpp_fcall_stmt(no_type, cluster_ref, ADD_GATE_INPUT_FUN_NAME);
+         add_input->set_pointer_call();
+         add_input->add_param(new cpp_const_expr((*input_it).first.c_str(), string_type));
+         list->push_back(add_input);
+         signals.insert((*input_it).first);
+      }
+      for (std::list<std::pair<std::string, std::string> >::iterator priv = (*gate)->private_signals.begin();
+            priv != (*gate)->private_signals.end(); priv++) {
+         cpp_fcall_stmt* add_input = new cpp_fcall_stmt(no_type, cluster_ref, ADD_GATE_INPUT_FUN_NAME);
+         add_input->set_pointer_call();
+         add_input->add_param(new cpp_const_expr(priv->first.c_str(), string_type));
+         list->push_back(add_input);
+         private_values[priv->first] = priv->second;
+      }
+   }
+   unsigned words = 0;
+   for (std::set<std::string>::iterator sig = signals.begin(); sig != signals.end(); ++sig) {
+      cpp_fcall_stmt* add_signal = new cpp_fcall_stmt(no_type, cluster_ref, ADD_SIGNAL_FUN_NAME);
+      add_signal->set_pointer_call();
+      add_signal->add_param(new cpp_const_expr(sig->c_str(), string_type));
+      // The signal is as wide as in the module
+      unsigned width = module_class->get_signal_width(*sig);
+      if (width != 1) {
+         std::ostringstream value;
+         value << "ivl::logic_vector(" << width << ")";
+         add_signal->add_param(new cpp_const_expr(value.str().c_str(), no_type));
+      }
+      list->push_back(add_signal);
+      words += logic_words(width);
+   }
+   // The private signals start from their own value
+   for (std::map<std::string, std::string>::iterator priv = private_values.begin();
+         priv != private_values.end(); ++priv) {
+      cpp_fcall_stmt* add_signal = new cpp_fcall_stmt(no_type, cluster_ref, ADD_SIGNAL_FUN_NAME);
+      add_signal->set_pointer_call();
+      add_signal->add_param(new cpp_const_expr(priv->first.c_str(), string_type));
+      std::string value = "ivl::logic_vector(\"" + priv->second + "\")";
+      add_signal->add_param(new cpp_const_expr(value.c_str(), no_type));
+      list->push_back(add_signal);
+      words += logic_words(priv->second.size());
+   }
+   if (words > cluster_words)
+      cluster_words = words;
+   // The module sends the inputs to the cluster
+   for (std::list<std::pair<std::string, std::string> >::iterator input_it = cluster->signal_mapping.begin();
+         input_it != cluster->signal_mapping.end(); input_it++) {
+      cpp_const_expr* signal = new cpp_const_expr((*input_it).first.c_str(), string_type);
+      cpp_fcall_stmt* add_out_to_module = new cpp_fcall_stmt(no_type, module_ref, ADD_OUTPUT_FUN_NAME);
+      add_out_to_module->set_pointer_call();
+      add_out_to_module->add_param(signal);
+      add_out_to_module->add_param(cluster_string_name);
+      add_out_to_module->add_param(signal);
+      list->push_back(add_out_to_module);
+      add_sim_channel(my_name, cluster_name, MODULE_DELAY);
+   }
+   // The cluster sends the outputs to the module after the least
+   // delay of the gates driving them, one time unit at least
+   std::map<std::string, unsigned> output_delays;
+   for (std::list<submodule*>::iterator gate = cluster->hierarchy.begin();
+         gate != cluster->hierarchy.end(); gate++) {
+      unsigned delay = std::max(1U, (*gate)->delay);
+      std::map<std::string, unsigned>::iterator out =
+            output_delays.find((*gate)->outputs_map.front().first);
+      if (out == output_delays.end())
+         output_delays[(*gate)->outputs_map.front().first] = delay;
+      else
+         out->second = std::min(out->second, delay);
+   }
+   cpp_const_expr* my_string_name = new cpp_const_expr(my_name.c_str(), string_type);
+   for (std::list<std::pair<std::string, std::string> >::iterator output_it = cluster->outputs_map.begin();
+         output_it != cluster->outputs_map.end(); output_it++) {
+      cpp_const_expr* signal = new cpp_const_expr((*output_it).first.c_str(), string_type);
+      cpp_fcall_stmt* add_out_to_cluster = new cpp_fcall_stmt(no_type, cluster_ref, ADD_OUTPUT_FUN_NAME);
+      add_out_to_cluster->set_pointer_call();
+      add_out_to_cluster->add_param(signal);
+      add_out_to_cluster->add_param(my_string_name);
+      add_out_to_cluster->add_param(signal);
+      list->push_back(add_out_to_cluster);
+      unsigned delay = output_delays[(*output_it).first];
+      if (delay > 1) {
+         std::ostringstream delay_str;
+         delay_str << delay;
+         cpp_fcall_stmt* set_delay = new cpp_fcall_stmt(no_type, cluster_ref, SET_DELAY_FUN_NAME);
+         set_delay->set_pointer_call();
+         set_delay->add_param(signal);
+         set_delay->add_param(new cpp_const_expr(delay_str.str().c_str(), no_type));
+         list->push_back(set_delay);
+      }
+      add_sim_channel(cluster_name, my_name, delay);
+   }
+   cpp_fcall_stmt* push_cluster = new cpp_fcall_stmt(no_type, obj_pointers, "push_back");
+   push_cluster->add_param(cluster_ref);
+   push_object(cluster_name, push_cluster);
+}
+
 static std::string recursive_build(submodule* current, std::string father_name,
       std::list<cpp_stmt*>* list)
 {
    assert(current->type == CPP_CLASS_MODULE);
    assert(current->relate_class != NULL);
    const cpp_type* vector = new cpp_type(CPP_TYPE_STD_VECTOR, sim_obj_pointer_type);
-   cpp_var* vector_var = new cpp_var("object_pointers", vector);
+   cpp_var* vector_var = new cpp_var(OBJECT_POINTERS_VAR_NAME, vector);
    cpp_unaryop_expr* obj_pointers_literal = new cpp_unaryop_expr(CPP_UNARYOP_LITERAL, vector_var->get_ref(), vector_var->get_type());
    std::string my_name = get_unique_name(current->type);
+   add_sim_object(my_name, 1);
    cpp_var_ref* expr_name = new cpp_var_ref(my_name, port_pointer_type);
-   cpp_unaryop_expr* unary = new cpp_unaryop_expr(CPP_UNARYOP_DECL, expr_name, port_pointer_type);
+   cpp_expr* unary = declare_object(expr_name, port_pointer_type);
    cpp_const_expr* cur_class_name = new cpp_const_expr(current->relate_class->get_name().c_str(), no_type);
    cpp_fcall_stmt* module_constr = new cpp_fcall_stmt(no_type, cur_class_name, "");
    module_constr->add_param(new cpp_const_expr(my_name.c_str(), string_type));
    cpp_unaryop_expr* new_module = new cpp_unaryop_expr(CPP_UNARYOP_NEW, module_constr, port_pointer_type);
    list->push_back(new cpp_assign_stmt(unary, new_module));
    // Set signal values for the current module
-   for(std::list<std::pair<std::string, boost::tribool> >::iterator signal = current->value_map.begin();
+   for(std::list<std::pair<std::string, std::string> >::iterator signal = current->value_map.begin();
          signal != current->value_map.end(); ++signal )
    {
       cpp_const_expr* current_signal = new cpp_const_expr((*signal).first.c_str(), string_type);
       cpp_fcall_stmt* add_in_to_port = new cpp_fcall_stmt(no_type, expr_name, ADD_SIGNAL_FUN_NAME);
       add_in_to_port->set_pointer_call();
       add_in_to_port->add_param(current_signal);
-      cpp_const_expr* current_signal_value;
-      if((*signal).second)
-         current_signal_value = new cpp_const_expr("true", no_type);
-      else
-         current_signal_value = new cpp_const_expr("false", no_type);
-      add_in_to_port->add_param(current_signal_value);
+      // The bits are converted to a logic vector by the callee
+      add_in_to_port->add_param(new cpp_const_expr((*signal).second.c_str(), string_type));
       list->push_back(add_in_to_port);
    }
    // From now on, manage interconnections among my children.
-   for(std::list<submodule*>::iterator it = current->hierarchy.begin();
-         it != current->hierarchy.end(); it++)
+   std::list<submodule*> children = cluster_gates(current);
+   for(std::list<submodule*>::iterator it = children.begin();
+         it != children.end(); it++)
    {
-      std::string submodule_name;
-      cpp_const_expr* sub_string_name;
-      cpp_var_ref* sub_var_ref;
-      cpp_const_expr* class_name_lhs;
       if((*it)->type == CPP_CLASS_MODULE)
       {
          assert((*it)->relate_class != NULL);
          // This child is another module: I need to build it recursively
-         submodule_name = recursive_build(*it, my_name, list);
-         sub_string_name = new cpp_const_expr(submodule_name.c_str(), string_type);
-         sub_var_ref = new cpp_var_ref(submodule_name, port_pointer_type);
-         class_name_lhs = new cpp_const_expr((*it)->relate_class->get_name().c_str(), no_type);
+         std::string submodule_name = recursive_build(*it, my_name, list);
+         cpp_const_expr* sub_string_name = new cpp_const_expr(submodule_name.c_str(), string_type);
          for(std::list<std::pair<std::string, std::string> >::iterator input_it = (*it)->signal_mapping.begin();
                input_it != (*it)->signal_mapping.end(); input_it++)
          {
@@ -261,69 +661,15 @@ static std::string recursive_build(submodule* current, std::string father_name,
             add_out_to_module->add_param(sub_string_name);
             add_out_to_module->add_param(submod_signal);
             list->push_back(add_out_to_module);
+            add_sim_channel(my_name, submodule_name, MODULE_DELAY);
          }
-         continue;
       }
       else
       {
-         assert((*it)->relate_class == NULL && (*it)->outputs_map.size() == 1);
-         submodule_name = get_unique_name(current->type);
-         sub_string_name = new cpp_const_expr(submodule_name.c_str(), string_type);
-         sub_var_ref = new cpp_var_ref(submodule_name, port_pointer_type);
-         class_name_lhs = new cpp_const_expr(get_class_name((*it)->type).c_str(), no_type);
+         // Every gate belongs to a cluster
+         assert((*it)->type == CPP_CLASS_CLUSTER);
+         build_cluster(*it, current->relate_class, my_name, expr_name, obj_pointers_literal, list);
       }
-      // From now on, I'm sure that I'm dealing with a gate
-      // Create the gate
-      cpp_unaryop_expr* sub_unary = new cpp_unaryop_expr(CPP_UNARYOP_DECL, sub_var_ref, port_pointer_type);
-      cpp_fcall_stmt* port_constr = new cpp_fcall_stmt(no_type, class_name_lhs, "");
-      port_constr->add_param(sub_string_name);
-      cpp_unaryop_expr* new_port = new cpp_unaryop_expr(CPP_UNARYOP_NEW, port_constr, port_pointer_type);
-      list->push_back(new cpp_assign_stmt(sub_unary, new_port));
-      // Add all the inputs
-      for(std::list<std::pair<std::string, std::string> >::iterator input_it = (*it)->signal_mapping.begin();
-            input_it != (*it)->signal_mapping.end(); input_it++ )
-      {
-         assert((*input_it).second == (*input_it).first);
-         cpp_const_expr* supermod_signal = new cpp_const_expr((*input_it).second.c_str(), string_type);
-         cpp_const_expr* submod_signal = new cpp_const_expr((*input_it).first.c_str(), string_type);
-         // Add signal to gates.
-         cpp_fcall_stmt* add_in_to_port = new cpp_fcall_stmt(no_type, sub_var_ref, ADD_SIGNAL_FUN_NAME);
-         add_in_to_port->set_pointer_call();
-         add_in_to_port->add_param(supermod_signal);
-         list->push_back(add_in_to_port);
-         // Add the input of the logic port to the outputs of the father module
-         cpp_fcall_stmt* add_out_to_module = new cpp_fcall_stmt(no_type, expr_name, ADD_OUTPUT_FUN_NAME);
-         add_out_to_module->set_pointer_call();
-         add_out_to_module->add_param(supermod_signal);
-         add_out_to_module->add_param(sub_string_name);
-         add_out_to_module->add_param(submod_signal);
-         list->push_back(add_out_to_module);
-      }
-      for(std::list<std::pair<std::string, std::string> >::iterator output_it = (*it)->outputs_map.begin();
-            output_it != (*it)->outputs_map.end(); output_it++ )
-      {
-         assert((*output_it).second == (*output_it).first);
-         cpp_const_expr* supermod_signal = new cpp_const_expr((*output_it).second.c_str(), string_type);
-         cpp_const_expr* submod_signal = new cpp_const_expr((*output_it).first.c_str(), string_type);
-         // Add signal to gates.
-         cpp_fcall_stmt* add_in_to_port = new cpp_fcall_stmt(no_type, sub_var_ref, ADD_SIGNAL_FUN_NAME);
-         add_in_to_port->set_pointer_call();
-         add_in_to_port->add_param(supermod_signal);
-         list->push_back(add_in_to_port);
-         // Add all the outputs
-         cpp_fcall_stmt* add_out_to_port = new cpp_fcall_stmt(no_type, sub_var_ref, ADD_OUTPUT_FUN_NAME);
-         add_out_to_port->set_pointer_call();
-         add_out_to_port->add_param(submod_signal);
-         // The name of the current module
-         cpp_const_expr* my_string_name = new cpp_const_expr(my_name.c_str(), string_type);
-         add_out_to_port->add_param(my_string_name);
-         add_out_to_port->add_param(new cpp_const_expr((*output_it).second.c_str(), string_type));
-         list->push_back(add_out_to_port);
-      }
-      // We have added input/output. Now, add the gate itself
-      cpp_fcall_stmt* push_port = new cpp_fcall_stmt(no_type, obj_pointers_literal, "push_back");
-      push_port->add_param(sub_var_ref);
-      list->push_back(push_port);
    }
    // Unless I'm the top module, I need to inform my supermodule that my outputs are changed
    if(!father_name.empty())
@@ -340,18 +686,24 @@ static std::string recursive_build(submodule* current, std::string father_name,
          add_out_to_module->add_param(father_string_name);
          add_out_to_module->add_param(supermod_signal);
          list->push_back(add_out_to_module);
+         add_sim_channel(my_name, father_name, MODULE_DELAY);
       }
    // Push the current module
    cpp_fcall_stmt* push_module = new cpp_fcall_stmt(no_type, obj_pointers_literal, "push_back");
    push_module->add_param(expr_name);
-   list->push_back(push_module);
+   push_object(my_name, push_module);
    return my_name;
 }
 
-std::list<cpp_stmt*> build_hierarchy()
+/*
+ * The main creates the simulation in setup, builds the objects of the
+ * design and hands them to the kernel in objects, starts it in start.
+ */
+void build_hierarchy(std::list<cpp_stmt*>& setup, std::list<cpp_stmt*>& objects,
+      std::list<cpp_stmt*>& start)
 {
-   std::list<cpp_stmt*> return_value;
    port_pointer_type->set_pointer();
+   cluster_pointer_type->set_pointer();
    // Create the simulation variable
    cpp_var_ref* lhs = new cpp_var_ref("this_sim", new cpp_type(CPP_TYPE_WARPED_SIMULATION));
    cpp_unaryop_expr* sim_decl = new cpp_unaryop_expr(CPP_UNARYOP_DECL, lhs, lhs->get_type());
@@ -360,22 +712,31 @@ std::list<cpp_stmt*> build_hierarchy()
    rhs->add_expr(new cpp_var_ref("argc", no_type));
    rhs->add_expr(new cpp_var_ref("argv", no_type));
    cpp_assign_stmt* sim_init = new cpp_assign_stmt(sim_decl, rhs, true);
-   return_value.push_back(sim_init);
+   setup.push_back(sim_init);
    // Create the object vector
    sim_obj_pointer_type->set_pointer();
    const cpp_type* vector = new cpp_type(CPP_TYPE_STD_VECTOR, sim_obj_pointer_type);
-   cpp_var* vector_var = new cpp_var("object_pointers", vector);
+   cpp_var* vector_var = new cpp_var(OBJECT_POINTERS_VAR_NAME, vector);
    cpp_unaryop_expr *output_var = new cpp_unaryop_expr(CPP_UNARYOP_DECL, vector_var->get_ref(), vector_var->get_type());
    output_var->set_comment("Object list to pass to warped kernel");
-   return_value.push_back(output_var);
+   setup.push_back(output_var);
    // Analyze all the top modules
    for(std::list<submodule*>::iterator class_it = modules.begin();
          class_it != modules.end(); class_it++ )
-      recursive_build(*class_it, "", &return_value);
+      recursive_build(*class_it, "", &objects);
+   // Split the objects among the threads of the kernel (-ppartitions=N)
+   // and add them to the object vector one part after the other.
+   const char* nparts = get_design_flag("partitions");
+   partition_sim_objects(strtoul(nparts, NULL, 10));
+   std::vector< std::list<cpp_stmt*> > parts(sim_partitions());
+   for(std::list< std::pair<std::string, cpp_stmt*> >::iterator push_it = object_pushes.begin();
+         push_it != object_pushes.end(); push_it++ )
+      parts[sim_object_part(push_it->first)].push_back(push_it->second);
+   for(unsigned idx = 0; idx < parts.size(); idx++)
+      objects.splice(objects.end(), parts[idx]);
    // Add the final instruction to start the simulation
    cpp_fcall_stmt* start_sim = new cpp_fcall_stmt(no_type, lhs, "simulate");
    start_sim->set_comment("Start simulation");
    start_sim->add_param(vector_var->get_ref());
-   return_value.push_back(start_sim);
-   return return_value;
+   start.push_back(start_sim);
 }
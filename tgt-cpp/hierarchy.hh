@@ -26,15 +26,15 @@
 #include <utility>
 #include <iostream>
 #include <string>
-#include <boost/logic/tribool.hpp>
 
 struct submodule {
-   submodule(cpp_class_type thetype) : type(thetype), relate_class(NULL), hierarchy(), value_map() {};
-   submodule(const cppClass* theclass) : type(CPP_CLASS_MODULE), relate_class(theclass), value_map() {};
+   submodule(cpp_class_type thetype) : type(thetype), relate_class(NULL), hierarchy(), value_map(), passes(1), delay(0) {};
+   submodule(const cppClass* theclass) : type(CPP_CLASS_MODULE), relate_class(theclass), value_map(), passes(1), delay(0) {};
+   submodule(const std::string& gate_type) : type(CPP_CLASS_GATE), relate_class(NULL), hierarchy(), value_map(), passes(1), delay(0), gate(gate_type) {};
 
    void insert_output(const std::string& str1, const std::string& str2);
    void insert_input(const std::string& str1, const std::string& str2);
-   submodule* find(const cppClass* elem);
+   void insert_private(const std::string& name, const std::string& bits);
    void add_submodule(submodule* item) { hierarchy.push_front(item); };
    void merge(submodule* item);
 
@@ -54,15 +54,40 @@ struct submodule {
     */
    std::list< std::pair< std::string, std::string > > outputs_map;
    /*
-    *
+    * list<pair< signal_name, initial_value> >
+    * The value is a string of 0, 1, x and z bits, MSB first.
     */
-   std::list< std::pair<std::string, boost::tribool> > value_map;
+   std::list< std::pair<std::string, std::string> > value_map;
+   /*
+    * For clusters, the number of evaluation passes needed to reach a
+    * stable value. The gates of the cluster are in the hierarchy.
+    */
+   unsigned passes;
+   /*
+    * For logic gates, the least delay from an input to the output in
+    * simulation ticks, 0 if it has none.
+    */
+   unsigned delay;
+   /*
+    * For logic gates, the ivl::gate_type in the generated code,
+    * like "GATE_NAND" or "GATE_UDP + 2".
+    */
+   std::string gate;
+   /*
+    * list<pair< signal_name, initial_value> >
+    * The signals that belong to the gate alone: the constant pins
+    * and what a sequential gate remembers between two evaluations.
+    * They follow the inputs in the pins of the gate.
+    */
+   std::list< std::pair<std::string, std::string> > private_signals;
 };
 
-void define_value(cppClass* theclass, const std::string str1, const boost::tribool value);
+void define_value(cppClass* theclass, const std::string str1, const std::string& bits);
 void remember_hierarchy(cppClass* theclass);
 submodule* add_submodule_to(submodule* item, cppClass* parent);
 submodule* find_submodule(cppClass* parent);
-std::list<cpp_stmt*> build_hierarchy();
+void build_hierarchy(std::list<cpp_stmt*>& setup, std::list<cpp_stmt*>& objects,
+      std::list<cpp_stmt*>& start);
+unsigned cluster_state_words();
 
 #endif  // #ifndef INC_CPP_HIERARCHY_HH
@@ -0,0 +1,445 @@
+/*
+ *  Reference event kernel for the C++ code generated by tgt-cpp.
+ *
+ *  Copyright (c) 2015 Michele Castellana (michele.castellana@mail.polimi.it)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INC_IVL_KERNEL_HPP
+#define INC_IVL_KERNEL_HPP
+
+/*
+ * This header is included by the generated code in place of the
+ * Warped2 one when the design is generated with -pkernel=ivl. It
+ * implements the part of the Warped2 API the generated code uses,
+ * so a design can be built and timed without an external kernel:
+ *
+ *        g++ -std=c++11 -O2 -pthread design.cc -o design
+ *        ./design --threads 4 --stats
+ *
+ * The options of the simulation are:
+ *
+ *   --threads N       run on N threads (default 1, sequential)
+ *   --max-time T      stop after the events of timestamp T
+ *   --lookahead L     the least delay between an event and the events
+ *                     it causes (default 1, see below)
+ *   --partition FILE  the "object part" lines written by -ppartitions,
+ *                     the parts are spread over the threads
+ *   --channels FILE   the "from to lookahead" lines of the .lookahead
+ *                     file written with the design
+ *   --stats           print the events per second on stderr
+ *
+ * The sequential mode runs every event in timestamp order. The
+ * multithreaded mode is conservative: every thread has the event
+ * queue of its own objects and all of them advance in windows of
+ * lookahead time units. An event at time t only causes events at
+ * t + lookahead or later, so the events of the window starting at
+ * the least pending timestamp cannot be affected by the events of
+ * the other threads and run with no rollback. The generated modules
+ * delay their events by at least one time unit and the gates by
+ * their delay, hence the default lookahead. With --channels the
+ * window grows to the least lookahead of the channels between
+ * objects of different threads.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ivl {
+
+namespace kernel {
+
+struct ObjectState {
+   virtual ~ObjectState() { }
+};
+
+class Event {
+public:
+   virtual ~Event() { }
+   virtual const std::string& receiverName() const = 0;
+   virtual unsigned int timestamp() const = 0;
+};
+
+class SimulationObject {
+public:
+   explicit SimulationObject(const std::string& name) : name_(name) { }
+   virtual ~SimulationObject() { }
+
+   // The state is only needed by the optimistic kernels.
+   virtual ObjectState& getState() = 0;
+   virtual std::vector<std::shared_ptr<Event> > createInitialEvents()
+   {
+      return std::vector<std::shared_ptr<Event> >();
+   }
+   virtual std::vector<std::shared_ptr<Event> > receiveEvent(const Event& event) = 0;
+
+   const std::string name_;
+};
+
+/*
+ * The events of a thread, least timestamp first. The sequence
+ * number keeps the events of the same timestamp in the order they
+ * were sent, so a sequential run is repeatable.
+ */
+class event_queue {
+public:
+   event_queue() : sequence_(0) { }
+
+   void push(const std::shared_ptr<Event>& event)
+   {
+      queue_.push(entry(event, sequence_++));
+   }
+   bool empty() const { return queue_.empty(); }
+   const std::shared_ptr<Event>& top() const { return queue_.top().event; }
+   void pop() { queue_.pop(); }
+
+private:
+   struct entry {
+      entry(const std::shared_ptr<Event>& e, unsigned long s) : event(e), sequence(s) { }
+      bool operator<(const entry& other) const
+      {
+         // std::priority_queue puts the greatest entry on top
+         if (event->timestamp() != other.event->timestamp())
+            return event->timestamp() > other.event->timestamp();
+         return sequence > other.sequence;
+      }
+      std::shared_ptr<Event> event;
+      unsigned long sequence;
+   };
+
+   std::priority_queue<entry> queue_;
+   unsigned long sequence_;
+};
+
+// All the threads wait here between two windows.
+class barrier {
+public:
+   explicit barrier(unsigned count) : count_(count), waiting_(0), generation_(0) { }
+
+   void wait()
+   {
+      std::unique_lock<std::mutex> lock(mutex_);
+      unsigned generation = generation_;
+      if (++waiting_ == count_) {
+         waiting_ = 0;
+         generation_ += 1;
+         ready_.notify_all();
+         return;
+      }
+      ready_.wait(lock, [this, generation] { return generation != generation_; });
+   }
+
+private:
+   std::mutex mutex_;
+   std::condition_variable ready_;
+   unsigned count_, waiting_, generation_;
+};
+
+class Simulation {
+public:
+   Simulation(const std::string& model, int argc, const char** argv)
+      : model_(model), threads_(1), max_time_(~0U), lookahead_(1), stats_(false),
+        events_(0)
+   {
+      for (int idx = 1; idx < argc; idx++) {
+         const char* next = idx + 1 < argc ? argv[idx + 1] : NULL;
+         if (strcmp(argv[idx], "--stats") == 0) {
+            stats_ = true;
+         } else if (next == NULL) {
+            usage(argv[0]);
+         } else if (strcmp(argv[idx], "--threads") == 0) {
+            threads_ = std::max(1UL, strtoul(next, NULL, 10));
+            idx++;
+         } else if (strcmp(argv[idx], "--max-time") == 0) {
+            max_time_ = strtoul(next, NULL, 10);
+            idx++;
+         } else if (strcmp(argv[idx], "--lookahead") == 0) {
+            lookahead_ = std::max(1UL, strtoul(next, NULL, 10));
+            idx++;
+         } else if (strcmp(argv[idx], "--partition") == 0) {
+            partition_file_ = next;
+            idx++;
+         } else if (strcmp(argv[idx], "--channels") == 0) {
+            channels_file_ = next;
+            idx++;
+         } else {
+            usage(argv[0]);
+         }
+      }
+   }
+
+   void simulate(const std::vector<SimulationObject*>& objects)
+   {
+      objects_ = objects;
+      owner_.assign(objects.size(), 0);
+      for (unsigned idx = 0; idx < objects.size(); idx++)
+         index_[objects[idx]->name_] = idx;
+      assign_threads();
+      if (threads_ > 1)
+         channel_lookahead();
+
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      if (threads_ == 1)
+         run_sequential();
+      else
+         run_parallel();
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (stats_) {
+         std::cerr << model_ << ": " << events_ << " events in "
+                   << elapsed.count() << " s on " << threads_ << " thread(s), "
+                   << (elapsed.count() > 0 ? events_ / elapsed.count() : 0)
+                   << " events/s" << std::endl;
+      }
+   }
+
+private:
+   static void usage(const char* program)
+   {
+      std::cerr << "usage: " << program << " [--threads N] [--max-time T]"
+                << " [--lookahead L] [--partition FILE] [--channels FILE]"
+                << " [--stats]" << std::endl;
+      exit(1);
+   }
+
+   unsigned receiver(const Event& event) const
+   {
+      std::unordered_map<std::string, unsigned>::const_iterator it =
+            index_.find(event.receiverName());
+      if (it == index_.end()) {
+         std::cerr << "Event for unknown object " << event.receiverName() << std::endl;
+         abort();
+      }
+      return it->second;
+   }
+
+   /*
+    * The objects come part after part, so without a partition file
+    * every thread takes a contiguous block of them.
+    */
+   void assign_threads()
+   {
+      if (threads_ > objects_.size())
+         threads_ = std::max<size_t>(1, objects_.size());
+      for (unsigned idx = 0; idx < objects_.size(); idx++)
+         owner_[idx] = idx * threads_ / objects_.size();
+      if (partition_file_.empty())
+         return;
+      std::ifstream in;
+      open_file(in, partition_file_);
+      std::istringstream line;
+      while (next_line(in, line)) {
+         std::string name;
+         unsigned part;
+         if (!(line >> name >> part))
+            continue;
+         std::unordered_map<std::string, unsigned>::iterator it = index_.find(name);
+         if (it != index_.end())
+            owner_[it->second] = part % threads_;
+      }
+   }
+
+   /*
+    * Only the channels between two threads limit the window, and
+    * then by their least lookahead.
+    */
+   void channel_lookahead()
+   {
+      if (channels_file_.empty())
+         return;
+      std::ifstream in;
+      open_file(in, channels_file_);
+      std::istringstream line;
+      unsigned least = ~0U;
+      while (next_line(in, line)) {
+         std::string from, to;
+         unsigned lookahead;
+         if (!(line >> from >> to >> lookahead))
+            continue;
+         std::unordered_map<std::string, unsigned>::iterator src = index_.find(from);
+         std::unordered_map<std::string, unsigned>::iterator dst = index_.find(to);
+         if (src != index_.end() && dst != index_.end()
+             && owner_[src->second] != owner_[dst->second])
+            least = std::min(least, lookahead);
+      }
+      lookahead_ = std::max(lookahead_, least);
+   }
+
+   static void open_file(std::ifstream& in, const std::string& fname)
+   {
+      in.open(fname.c_str());
+      if (!in) {
+         std::cerr << "Cannot open " << fname << std::endl;
+         exit(1);
+      }
+   }
+
+   // The next line that is not empty or a comment
+   static bool next_line(std::istream& in, std::istringstream& line)
+   {
+      std::string text;
+      while (std::getline(in, text)) {
+         if (text.empty() || text[0] == '#')
+            continue;
+         line.clear();
+         line.str(text);
+         return true;
+      }
+      return false;
+   }
+
+   void run_sequential()
+   {
+      event_queue queue;
+      for (unsigned idx = 0; idx < objects_.size(); idx++) {
+         std::vector<std::shared_ptr<Event> > initial = objects_[idx]->createInitialEvents();
+         for (unsigned ev = 0; ev < initial.size(); ev++)
+            queue.push(initial[ev]);
+      }
+      while (!queue.empty() && queue.top()->timestamp() <= max_time_) {
+         std::shared_ptr<Event> event = queue.top();
+         queue.pop();
+         std::vector<std::shared_ptr<Event> > caused =
+               objects_[receiver(*event)]->receiveEvent(*event);
+         for (unsigned ev = 0; ev < caused.size(); ev++)
+            queue.push(caused[ev]);
+         events_ += 1;
+      }
+   }
+
+   /*
+    * What a thread owns: its event queue, the events the other
+    * threads sent to it during the window and its least timestamp.
+    */
+   struct thread_data {
+      thread_data() : next_time(~0U), events(0) { }
+      event_queue queue;
+      std::mutex inbox_mutex;
+      std::vector<std::shared_ptr<Event> > inbox;
+      unsigned next_time;
+      unsigned long events;
+   };
+
+   void send(std::vector<thread_data>& data, unsigned me,
+             const std::shared_ptr<Event>& event, unsigned window_end)
+   {
+      unsigned dest = owner_[receiver(*event)];
+      if (dest == me) {
+         data[me].queue.push(event);
+         return;
+      }
+      if (event->timestamp() < window_end) {
+         std::cerr << "The lookahead is " << lookahead_ << " but an event is sent "
+                   << "at time " << event->timestamp() << " before the end of the "
+                   << "window at " << window_end << std::endl;
+         abort();
+      }
+      std::lock_guard<std::mutex> lock(data[dest].inbox_mutex);
+      data[dest].inbox.push_back(event);
+   }
+
+   void run_thread(std::vector<thread_data>& data, barrier& sync, unsigned me)
+   {
+      thread_data& mine = data[me];
+      for (unsigned idx = 0; idx < objects_.size(); idx++) {
+         if (owner_[idx] != me)
+            continue;
+         std::vector<std::shared_ptr<Event> > initial = objects_[idx]->createInitialEvents();
+         for (unsigned ev = 0; ev < initial.size(); ev++)
+            send(data, me, initial[ev], 0);
+      }
+      for (;;) {
+         sync.wait();
+         // The events of the other threads are safe to queue now
+         for (unsigned ev = 0; ev < mine.inbox.size(); ev++)
+            mine.queue.push(mine.inbox[ev]);
+         mine.inbox.clear();
+         mine.next_time = mine.queue.empty() ? ~0U : mine.queue.top()->timestamp();
+         sync.wait();
+         unsigned start = ~0U;
+         for (unsigned idx = 0; idx < data.size(); idx++)
+            start = std::min(start, data[idx].next_time);
+         if (start == ~0U || start > max_time_)
+            return;
+         unsigned window_end = start + lookahead_;
+         if (window_end < start)
+            window_end = ~0U;
+         while (!mine.queue.empty() && mine.queue.top()->timestamp() < window_end
+                && mine.queue.top()->timestamp() <= max_time_) {
+            std::shared_ptr<Event> event = mine.queue.top();
+            mine.queue.pop();
+            std::vector<std::shared_ptr<Event> > caused =
+                  objects_[receiver(*event)]->receiveEvent(*event);
+            for (unsigned ev = 0; ev < caused.size(); ev++)
+               send(data, me, caused[ev], window_end);
+            mine.events += 1;
+         }
+      }
+   }
+
+   void run_parallel()
+   {
+      std::vector<thread_data> data(threads_);
+      barrier sync(threads_);
+      std::vector<std::thread> workers;
+      for (unsigned idx = 1; idx < threads_; idx++)
+         workers.push_back(std::thread(&Simulation::run_thread, this,
+                                       std::ref(data), std::ref(sync), idx));
+      run_thread(data, sync, 0);
+      for (unsigned idx = 0; idx < workers.size(); idx++)
+         workers[idx].join();
+      for (unsigned idx = 0; idx < data.size(); idx++)
+         events_ += data[idx].events;
+   }
+
+   std::string model_;
+   unsigned threads_;
+   unsigned max_time_;
+   unsigned lookahead_;
+   bool stats_;
+   std::string partition_file_;
+   std::string channels_file_;
+   unsigned long events_;
+   std::vector<SimulationObject*> objects_;
+   std::vector<unsigned> owner_;
+   std::unordered_map<std::string, unsigned> index_;
+};
+
+}  // namespace kernel
+
+}  // namespace ivl
+
+// The generated code is written for the Warped2 names
+namespace warped = ivl::kernel;
+
+#ifndef WARPED_DEFINE_OBJECT_STATE_STRUCT
+#define WARPED_DEFINE_OBJECT_STATE_STRUCT(name) struct name : warped::ObjectState
+#endif
+
+#endif  // #ifndef INC_IVL_KERNEL_HPP
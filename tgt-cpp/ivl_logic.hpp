@@ -0,0 +1,1202 @@
+/*
+ *  Four-state logic values for the C++ code generated by tgt-cpp.
+ *
+ *  Copyright (c) 2015 Michele Castellana (michele.castellana@mail.polimi.it)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INC_IVL_LOGIC_HPP
+#define INC_IVL_LOGIC_HPP
+
+/*
+ * This header is included by the generated code, not by the code
+ * generator. It only depends on the C++11 standard library.
+ */
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ivl {
+
+/*
+ * A vector of four-state bits, kept in two bit planes like the
+ * vvp_vector4_t of vvp:
+ *
+ *     a b
+ *     0 0  -> 0
+ *     1 0  -> 1
+ *     1 1  -> x
+ *     0 1  -> z
+ *
+ * Vectors up to 64 bits wide are stored inline, wider vectors use
+ * one heap array holding the a plane followed by the b plane. The
+ * bits above the width in the last word are always 0.
+ */
+class logic_vector {
+public:
+   typedef uint64_t word_t;
+   static const unsigned WORD_BITS = 64;
+
+   // A single x bit.
+   logic_vector() : width_(1), heap_(0)
+   {
+      inline_[0] = 1;
+      inline_[1] = 1;
+   }
+
+   explicit logic_vector(unsigned width, char fill = 'x') : width_(width), heap_(0)
+   {
+      allocate_();
+      word_t a = (fill == '1' || fill == 'x' || fill == 'X') ? ~(word_t)0 : 0;
+      word_t b = (fill == 'x' || fill == 'X' || fill == 'z' || fill == 'Z') ? ~(word_t)0 : 0;
+      for (unsigned idx = 0; idx < words_(); idx++) {
+         abits_()[idx] = a;
+         bbits_()[idx] = b;
+      }
+      clean_top_();
+   }
+
+   // Bits are given MSB first, as in a Verilog literal.
+   logic_vector(const char* bits) : width_(strlen(bits)), heap_(0)
+   {
+      assert(width_ > 0);
+      allocate_();
+      for (unsigned idx = 0; idx < width_; idx++)
+         set(idx, bits[width_ - 1 - idx]);
+   }
+
+   logic_vector(const std::string& bits) : width_(bits.size()), heap_(0)
+   {
+      assert(width_ > 0);
+      allocate_();
+      for (unsigned idx = 0; idx < width_; idx++)
+         set(idx, bits[width_ - 1 - idx]);
+   }
+
+   logic_vector(const logic_vector& that) : width_(that.width_), heap_(0)
+   {
+      allocate_();
+      copy_bits_(that);
+   }
+
+   logic_vector& operator= (const logic_vector& that)
+   {
+      if (this == &that)
+         return *this;
+      if (words_() != that.words_()) {
+         delete[] heap_;
+         heap_ = 0;
+         width_ = that.width_;
+         allocate_();
+      }
+      width_ = that.width_;
+      copy_bits_(that);
+      return *this;
+   }
+
+   ~logic_vector() { delete[] heap_; }
+
+   // Read a vector stored by store().
+   logic_vector(unsigned width, const word_t* planes) : width_(width), heap_(0)
+   {
+      allocate_();
+      for (unsigned idx = 0; idx < words_(); idx++) {
+         abits_()[idx] = planes[idx];
+         bbits_()[idx] = planes[words_() + idx];
+      }
+   }
+
+   // Write the a plane then the b plane, storage_words() words.
+   void store(word_t* planes) const
+   {
+      for (unsigned idx = 0; idx < words_(); idx++) {
+         planes[idx] = abits_()[idx];
+         planes[words_() + idx] = bbits_()[idx];
+      }
+   }
+
+   static unsigned storage_words(unsigned width)
+   {
+      return 2 * ((width + WORD_BITS - 1) / WORD_BITS);
+   }
+
+   unsigned size() const { return width_; }
+
+   // The same value truncated or extended with 0 to width bits.
+   logic_vector resize(unsigned width) const
+   {
+      logic_vector res(width, '0');
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         res.abits_()[idx] = aword_(idx);
+         res.bbits_()[idx] = bword_(idx);
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   // Get/set a single bit as one of the characters 0, 1, x or z.
+   char get(unsigned idx) const
+   {
+      assert(idx < width_);
+      word_t mask = (word_t)1 << (idx % WORD_BITS);
+      bool a = abits_()[idx / WORD_BITS] & mask;
+      bool b = bbits_()[idx / WORD_BITS] & mask;
+      return b ? (a ? 'x' : 'z') : (a ? '1' : '0');
+   }
+
+   void set(unsigned idx, char bit)
+   {
+      assert(idx < width_);
+      word_t mask = (word_t)1 << (idx % WORD_BITS);
+      word_t& a = abits_()[idx / WORD_BITS];
+      word_t& b = bbits_()[idx / WORD_BITS];
+      a &= ~mask;
+      b &= ~mask;
+      switch (bit) {
+         case '1':
+            a |= mask;
+            break;
+         case 'z':
+         case 'Z':
+            b |= mask;
+            break;
+         case '0':
+            break;
+         default:
+            a |= mask;
+            b |= mask;
+            break;
+      }
+   }
+
+   // True if the two vectors are identical, x and z included (===).
+   bool eeq(const logic_vector& that) const
+   {
+      if (width_ != that.width_)
+         return false;
+      for (unsigned idx = 0; idx < words_(); idx++)
+         if (abits_()[idx] != that.abits_()[idx]
+             || bbits_()[idx] != that.bbits_()[idx])
+            return false;
+      return true;
+   }
+
+   // True if any bit is x or z.
+   bool has_xz() const
+   {
+      for (unsigned idx = 0; idx < words_(); idx++)
+         if (bbits_()[idx])
+            return true;
+      return false;
+   }
+
+   // True if all the bits are x: nothing is known about the value.
+   bool is_unknown() const
+   {
+      for (unsigned idx = 0; idx < words_(); idx++)
+         if (abits_()[idx] != top_mask_(idx) || bbits_()[idx] != top_mask_(idx))
+            return false;
+      return true;
+   }
+
+   // True if some bit is 1: the test of an if statement.
+   bool is_true() const
+   {
+      for (unsigned idx = 0; idx < words_(); idx++)
+         if (abits_()[idx] & ~bbits_()[idx])
+            return true;
+      return false;
+   }
+
+   // True if all the bits are 0.
+   bool is_false() const
+   {
+      for (unsigned idx = 0; idx < words_(); idx++)
+         if (abits_()[idx] | bbits_()[idx])
+            return false;
+      return true;
+   }
+
+   /*
+    * Compare two vectors without x or z bits as unsigned numbers,
+    * the shorter one extended with 0. Returns -1, 0 or 1.
+    */
+   static int compare(const logic_vector& l, const logic_vector& r)
+   {
+      assert(!l.has_xz() && !r.has_xz());
+      unsigned words = l.words_() > r.words_() ? l.words_() : r.words_();
+      for (unsigned idx = words; idx > 0; idx--) {
+         word_t lw = l.aword_(idx - 1), rw = r.aword_(idx - 1);
+         if (lw != rw)
+            return lw < rw ? -1 : 1;
+      }
+      return 0;
+   }
+
+   // The width bits starting from lsb. Bits past the end read as x.
+   logic_vector part(unsigned lsb, unsigned width) const
+   {
+      logic_vector res(width, 'x');
+      for (unsigned idx = 0; idx < width && lsb + idx < width_; idx++)
+         res.set(idx, get(lsb + idx));
+      return res;
+   }
+
+   std::string str() const
+   {
+      std::string res(width_, '0');
+      for (unsigned idx = 0; idx < width_; idx++)
+         res[width_ - 1 - idx] = get(idx);
+      return res;
+   }
+
+   /*
+    * Bitwise operators. The result is as wide as the widest operand,
+    * the other one is extended with 0. A z input counts as x.
+    */
+   friend logic_vector operator& (const logic_vector& l, const logic_vector& r)
+   {
+      logic_vector res(l.width_ > r.width_ ? l.width_ : r.width_, '0');
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         word_t la = l.aword_(idx), lb = l.bword_(idx);
+         word_t ra = r.aword_(idx), rb = r.bword_(idx);
+         word_t zero = (~la & ~lb) | (~ra & ~rb);
+         word_t one = (la & ~lb) & (ra & ~rb);
+         word_t x = ~(zero | one);
+         res.abits_()[idx] = one | x;
+         res.bbits_()[idx] = x;
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   friend logic_vector operator| (const logic_vector& l, const logic_vector& r)
+   {
+      logic_vector res(l.width_ > r.width_ ? l.width_ : r.width_, '0');
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         word_t la = l.aword_(idx), lb = l.bword_(idx);
+         word_t ra = r.aword_(idx), rb = r.bword_(idx);
+         word_t one = (la & ~lb) | (ra & ~rb);
+         word_t zero = (~la & ~lb) & (~ra & ~rb);
+         word_t x = ~(zero | one);
+         res.abits_()[idx] = one | x;
+         res.bbits_()[idx] = x;
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   friend logic_vector operator^ (const logic_vector& l, const logic_vector& r)
+   {
+      logic_vector res(l.width_ > r.width_ ? l.width_ : r.width_, '0');
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         word_t x = l.bword_(idx) | r.bword_(idx);
+         res.abits_()[idx] = (l.aword_(idx) ^ r.aword_(idx)) | x;
+         res.bbits_()[idx] = x;
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   /*
+    * Arithmetic is modulo the width of the widest operand. Any x or
+    * z in the operands makes the whole result x.
+    */
+   friend logic_vector operator+ (const logic_vector& l, const logic_vector& r)
+   {
+      unsigned width = l.width_ > r.width_ ? l.width_ : r.width_;
+      if (l.has_xz() || r.has_xz())
+         return logic_vector(width, 'x');
+      logic_vector res(width, '0');
+      word_t carry = 0;
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         word_t sum = l.aword_(idx) + carry;
+         carry = sum < carry;
+         sum += r.aword_(idx);
+         carry += sum < r.aword_(idx);
+         res.abits_()[idx] = sum;
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   friend logic_vector operator- (const logic_vector& l, const logic_vector& r)
+   {
+      unsigned width = l.width_ > r.width_ ? l.width_ : r.width_;
+      if (l.has_xz() || r.has_xz())
+         return logic_vector(width, 'x');
+      // l + ~r + 1
+      logic_vector res(width, '0');
+      word_t carry = 1;
+      for (unsigned idx = 0; idx < res.words_(); idx++) {
+         word_t neg = ~r.aword_(idx);
+         word_t sum = l.aword_(idx) + carry;
+         carry = sum < carry;
+         sum += neg;
+         carry += sum < neg;
+         res.abits_()[idx] = sum;
+      }
+      res.clean_top_();
+      return res;
+   }
+
+   logic_vector operator~ () const
+   {
+      logic_vector res(width_, '0');
+      for (unsigned idx = 0; idx < words_(); idx++) {
+         res.abits_()[idx] = ~abits_()[idx] | bbits_()[idx];
+         res.bbits_()[idx] = bbits_()[idx];
+      }
+      res.clean_top_();
+      return res;
+   }
+
+private:
+   unsigned words_() const { return (width_ + WORD_BITS - 1) / WORD_BITS; }
+
+   word_t* abits_() { return heap_ ? heap_ : inline_; }
+   word_t* bbits_() { return heap_ ? heap_ + words_() : inline_ + 1; }
+   const word_t* abits_() const { return heap_ ? heap_ : inline_; }
+   const word_t* bbits_() const { return heap_ ? heap_ + words_() : inline_ + 1; }
+
+   // Words past the end read as 0, so short operands are 0 extended.
+   word_t aword_(unsigned idx) const { return idx < words_() ? abits_()[idx] : 0; }
+   word_t bword_(unsigned idx) const { return idx < words_() ? bbits_()[idx] : 0; }
+
+   // The valid bits of the word idx.
+   word_t top_mask_(unsigned idx) const
+   {
+      if (idx + 1 < words_() || width_ % WORD_BITS == 0)
+         return ~(word_t)0;
+      return ((word_t)1 << (width_ % WORD_BITS)) - 1;
+   }
+
+   void allocate_()
+   {
+      inline_[0] = 0;
+      inline_[1] = 0;
+      if (width_ > WORD_BITS)
+         heap_ = new word_t[2 * words_()]();
+   }
+
+   void copy_bits_(const logic_vector& that)
+   {
+      for (unsigned idx = 0; idx < words_(); idx++) {
+         abits_()[idx] = that.abits_()[idx];
+         bbits_()[idx] = that.bbits_()[idx];
+      }
+   }
+
+   void clean_top_()
+   {
+      unsigned last = words_() - 1;
+      abits_()[last] &= top_mask_(last);
+      bbits_()[last] &= top_mask_(last);
+   }
+
+   unsigned width_;
+   word_t* heap_;
+   word_t inline_[2];
+};
+
+inline std::ostream& operator<< (std::ostream& out, const logic_vector& value)
+{
+   return out << value.str();
+}
+
+/*
+ * The Verilog operators that give a single bit. A comparison with
+ * x or z in the operands gives x, except for === and !==.
+ */
+inline logic_vector logic_bit(bool value)
+{
+   return logic_vector(1, value ? '1' : '0');
+}
+
+inline bool is_true(const logic_vector& value)
+{
+   return value.is_true();
+}
+
+inline logic_vector logical_not(const logic_vector& value)
+{
+   if (value.is_true())
+      return logic_bit(false);
+   return value.has_xz() ? logic_vector() : logic_bit(true);
+}
+
+inline logic_vector logical_and(const logic_vector& l, const logic_vector& r)
+{
+   if (l.is_false() || r.is_false())
+      return logic_bit(false);
+   return l.is_true() && r.is_true() ? logic_bit(true) : logic_vector();
+}
+
+inline logic_vector logical_or(const logic_vector& l, const logic_vector& r)
+{
+   if (l.is_true() || r.is_true())
+      return logic_bit(true);
+   return l.is_false() && r.is_false() ? logic_bit(false) : logic_vector();
+}
+
+inline logic_vector equal(const logic_vector& l, const logic_vector& r)
+{
+   if (l.has_xz() || r.has_xz())
+      return logic_vector();
+   return logic_bit(logic_vector::compare(l, r) == 0);
+}
+
+inline logic_vector not_equal(const logic_vector& l, const logic_vector& r)
+{
+   return logical_not(equal(l, r));
+}
+
+inline logic_vector case_equal(const logic_vector& l, const logic_vector& r)
+{
+   unsigned width = l.size() > r.size() ? l.size() : r.size();
+   return logic_bit(l.resize(width).eeq(r.resize(width)));
+}
+
+/*
+ * The comparisons of casex and casez: the x and z bits (casex) or
+ * only the z bits (casez) of the right operand match any bit.
+ */
+inline logic_vector wildcard_equal(const logic_vector& l, const logic_vector& r,
+                                   bool x_matches)
+{
+   unsigned width = l.size() > r.size() ? l.size() : r.size();
+   logic_vector lw = l.resize(width);
+   logic_vector rw = r.resize(width);
+   for (unsigned idx = 0; idx < width; idx++) {
+      char bit = rw.get(idx);
+      if (bit == 'z' || (x_matches && bit == 'x'))
+         continue;
+      if (lw.get(idx) != bit)
+         return logic_bit(false);
+   }
+   return logic_bit(true);
+}
+
+inline logic_vector less(const logic_vector& l, const logic_vector& r)
+{
+   if (l.has_xz() || r.has_xz())
+      return logic_vector();
+   return logic_bit(logic_vector::compare(l, r) < 0);
+}
+
+inline logic_vector less_equal(const logic_vector& l, const logic_vector& r)
+{
+   if (l.has_xz() || r.has_xz())
+      return logic_vector();
+   return logic_bit(logic_vector::compare(l, r) <= 0);
+}
+
+inline logic_vector reduce_and(const logic_vector& value)
+{
+   logic_vector res = value.part(0, 1);
+   for (unsigned idx = 1; idx < value.size(); idx++)
+      res = res & value.part(idx, 1);
+   return res;
+}
+
+inline logic_vector reduce_or(const logic_vector& value)
+{
+   logic_vector res = value.part(0, 1);
+   for (unsigned idx = 1; idx < value.size(); idx++)
+      res = res | value.part(idx, 1);
+   return res;
+}
+
+inline logic_vector reduce_xor(const logic_vector& value)
+{
+   logic_vector res = value.part(0, 1);
+   for (unsigned idx = 1; idx < value.size(); idx++)
+      res = res ^ value.part(idx, 1);
+   return res;
+}
+
+// The ?: operator: an unknown condition merges the two values.
+inline logic_vector select(const logic_vector& cond, const logic_vector& t,
+                           const logic_vector& f)
+{
+   if (cond.is_true())
+      return t;
+   if (cond.is_false())
+      return f;
+   unsigned width = t.size() > f.size() ? t.size() : f.size();
+   logic_vector tw = t.resize(width), fw = f.resize(width);
+   logic_vector res(width, 'x');
+   for (unsigned idx = 0; idx < width; idx++)
+      if (tw.get(idx) == fw.get(idx) && tw.get(idx) != 'z')
+         res.set(idx, tw.get(idx));
+   return res;
+}
+
+// {hi, lo}
+inline logic_vector concat(const logic_vector& hi, const logic_vector& lo)
+{
+   logic_vector res(hi.size() + lo.size(), '0');
+   for (unsigned idx = 0; idx < lo.size(); idx++)
+      res.set(idx, lo.get(idx));
+   for (unsigned idx = 0; idx < hi.size(); idx++)
+      res.set(lo.size() + idx, hi.get(idx));
+   return res;
+}
+
+// value[shift +: width], an unknown shift gives x.
+inline logic_vector part_select(const logic_vector& value,
+                                const logic_vector& shift, unsigned width)
+{
+   if (shift.has_xz())
+      return logic_vector(width, 'x');
+   unsigned lsb = 0;
+   for (unsigned idx = shift.size(); idx > 0; idx--) {
+      if (lsb >= value.size())
+         return logic_vector(width, 'x');
+      lsb = (lsb << 1) | (shift.get(idx - 1) == '1');
+   }
+   return value.part(lsb, width);
+}
+
+// vector with the bits from base on replaced by part.
+inline logic_vector part_insert(const logic_vector& vector,
+                                const logic_vector& part, unsigned base)
+{
+   logic_vector res = vector;
+   for (unsigned idx = 0; idx < part.size() && base + idx < res.size(); idx++)
+      res.set(base + idx, part.get(idx));
+   return res;
+}
+
+/*
+ * Edges of the least significant bit, as seen by @(posedge ...)
+ * and @(negedge ...): 0 -> 1, 0 -> x/z and x/z -> 1 are positive.
+ */
+inline bool posedge(const logic_vector& old_value, const logic_vector& new_value)
+{
+   char from = old_value.get(0), to = new_value.get(0);
+   return from != to && (from == '0' || to == '1');
+}
+
+inline bool negedge(const logic_vector& old_value, const logic_vector& new_value)
+{
+   char from = old_value.get(0), to = new_value.get(0);
+   return from != to && (from == '1' || to == '0');
+}
+
+/*
+ * The values of the signals of a simulation object. The bits are not
+ * kept here but in an array of words owned by the object, usually its
+ * state: the kernel can then save and restore the signals by copying
+ * a plain array. The table only maps every name to its place in the
+ * array, and it does not change once the object is built.
+ */
+class signal_table {
+public:
+   struct slot {
+      unsigned offset;
+      unsigned width;
+   };
+   typedef std::map<std::string, slot>::const_iterator iterator;
+
+   signal_table() : words_(0), capacity_(0), used_(0) { }
+
+   template <unsigned N> void bind(logic_vector::word_t (&words)[N])
+   {
+      words_ = words;
+      capacity_ = N;
+   }
+
+   // Add a signal as wide as value, or set it if it is already there.
+   void add(const std::string& name, const logic_vector& value)
+   {
+      if (slots_.find(name) == slots_.end()) {
+         slot& cur = slots_[name];
+         cur.offset = used_;
+         cur.width = value.size();
+         used_ += logic_vector::storage_words(cur.width);
+         assert(used_ <= capacity_);
+      }
+      set(name, value);
+   }
+
+   // Values are truncated or extended with 0 to the signal width.
+   void set(const std::string& name, const logic_vector& value)
+   {
+      const slot& cur = slots_.at(name);
+      if (value.size() == cur.width)
+         value.store(words_ + cur.offset);
+      else
+         value.resize(cur.width).store(words_ + cur.offset);
+   }
+
+   logic_vector at(const std::string& name) const
+   {
+      const slot& cur = slots_.at(name);
+      return logic_vector(cur.width, words_ + cur.offset);
+   }
+
+   iterator find(const std::string& name) const { return slots_.find(name); }
+   iterator begin() const { return slots_.begin(); }
+   iterator end() const { return slots_.end(); }
+   size_t size() const { return slots_.size(); }
+
+private:
+   signal_table(const signal_table&);
+   signal_table& operator= (const signal_table&);
+
+   std::map<std::string, slot> slots_;
+   logic_vector::word_t* words_;
+   unsigned capacity_, used_;
+};
+
+/*
+ * The value of a vector as an index, false if it has x or z bits or
+ * does not fit.
+ */
+inline bool to_index(const logic_vector& value, unsigned& index)
+{
+   if (value.has_xz())
+      return false;
+   index = 0;
+   for (unsigned idx = value.size(); idx > 0; idx--) {
+      if (index >> (sizeof(unsigned) * 8 - 1))
+         return false;
+      index = (index << 1) | (value.get(idx - 1) == '1');
+   }
+   return true;
+}
+
+// value << amount, value >> amount with 0 or the sign bit shifted in.
+inline logic_vector shift_left(const logic_vector& value, const logic_vector& amount)
+{
+   unsigned shift;
+   if (!to_index(amount, shift))
+      return logic_vector(value.size(), 'x');
+   logic_vector res(value.size(), '0');
+   for (unsigned idx = 0; shift < value.size() && idx < value.size() - shift; idx++)
+      res.set(idx + shift, value.get(idx));
+   return res;
+}
+
+inline logic_vector shift_right(const logic_vector& value, const logic_vector& amount,
+                                bool arithmetic = false)
+{
+   unsigned shift;
+   if (!to_index(amount, shift))
+      return logic_vector(value.size(), 'x');
+   char fill = arithmetic ? value.get(value.size() - 1) : '0';
+   logic_vector res(value.size(), fill);
+   for (unsigned idx = 0; shift < value.size() && idx < value.size() - shift; idx++)
+      res.set(idx, value.get(idx + shift));
+   return res;
+}
+
+// The product, as wide as the result.
+inline logic_vector multiply(const logic_vector& l, const logic_vector& r, unsigned width)
+{
+   if (l.has_xz() || r.has_xz())
+      return logic_vector(width, 'x');
+   logic_vector res(width, '0');
+   logic_vector addend = l.resize(width);
+   logic_vector one(1, '1');
+   for (unsigned idx = 0; idx < r.size() && idx < width; idx++) {
+      if (r.get(idx) == '1')
+         res = res + addend;
+      addend = shift_left(addend, one);
+   }
+   return res;
+}
+
+// Invert the sign bits: a signed compare becomes an unsigned one.
+inline logic_vector flip_sign(const logic_vector& value)
+{
+   logic_vector res = value;
+   char msb = value.get(value.size() - 1);
+   if (msb == '0' || msb == '1')
+      res.set(value.size() - 1, msb == '0' ? '1' : '0');
+   return res;
+}
+
+inline unsigned bit_code(char bit)
+{
+   switch (bit) {
+      case '0': return 0;
+      case '1': return 1;
+      case 'z': return 3;
+      default: return 2;
+   }
+}
+
+/*
+ * Tri-state buffers, shared by all the instances: the output bit for
+ * a data bit and an enable bit, both in the order 0, 1, x, z. A
+ * disabled buffer drives z, an unknown enable drives x.
+ */
+static const char bufif_table[4][4] = {
+   // enable:  0    1    x    z
+   /* 0 */  { 'z', '0', 'x', 'x' },
+   /* 1 */  { 'z', '1', 'x', 'x' },
+   /* x */  { 'z', 'x', 'x', 'x' },
+   /* z */  { 'z', 'x', 'x', 'x' }
+};
+
+inline logic_vector tristate(const logic_vector& data, const logic_vector& enable,
+                             bool active_low, bool invert)
+{
+   logic_vector res(data.size(), 'z');
+   for (unsigned idx = 0; idx < data.size(); idx++) {
+      char en = enable.get(idx < enable.size() ? idx : 0);
+      if (active_low && (en == '0' || en == '1'))
+         en = en == '0' ? '1' : '0';
+      char bit = data.get(idx);
+      if (invert && (bit == '0' || bit == '1'))
+         bit = bit == '0' ? '1' : '0';
+      res.set(idx, bufif_table[bit_code(bit)][bit_code(en)]);
+   }
+   return res;
+}
+
+/*
+ * The table of a user defined primitive, built once by the generated
+ * main and shared by all the instances. The rows are the ones of
+ * ivl_udp_row: the inputs then the output for a combinational
+ * primitive, the current output, the inputs and the next output (or
+ * '-' for no change) for a sequential one.
+ */
+class udp_table {
+public:
+   udp_table() : sequential_(false), init_('x'), inputs_(0) { }
+
+   void define(bool sequential, char init, unsigned inputs)
+   {
+      sequential_ = sequential;
+      init_ = init;
+      inputs_ = inputs;
+      rows_.clear();
+   }
+
+   void add_row(const char* row)
+   {
+      assert(strlen(row) == inputs_ + (sequential_ ? 2 : 1));
+      rows_.push_back(row);
+   }
+
+   bool sequential() const { return sequential_; }
+   char init() const { return init_; }
+   unsigned inputs() const { return inputs_; }
+
+   // The output of a combinational primitive for the input bits.
+   char evaluate(const std::string& in) const
+   {
+      for (unsigned row = 0; row < rows_.size(); row++) {
+         const std::string& r = rows_[row];
+         unsigned idx = 0;
+         while (idx < inputs_ && level_match(r[idx], in[idx]))
+            idx++;
+         if (idx == inputs_)
+            return r[inputs_];
+      }
+      return 'x';
+   }
+
+   /*
+    * The next output of a sequential primitive when the input pos
+    * changes from the value from to in[pos]. The level entries come
+    * before the edge entries.
+    */
+   char evaluate(char state, const std::string& in, unsigned pos, char from) const
+   {
+      for (int pass = 0; pass < 2; pass++) {
+         for (unsigned row = 0; row < rows_.size(); row++) {
+            const std::string& r = rows_[row];
+            if (!level_match(r[0], state))
+               continue;
+            bool edge_row = false;
+            unsigned idx = 0;
+            for (; idx < inputs_; idx++) {
+               if (is_edge(r[idx + 1])) {
+                  edge_row = true;
+                  if (idx != pos || !edge_match(r[idx + 1], from, in[idx]))
+                     break;
+               } else if (!level_match(r[idx + 1], in[idx])) {
+                  break;
+               }
+            }
+            if (idx == inputs_ && edge_row == (pass == 1))
+               return r[inputs_ + 1] == '-' ? state : r[inputs_ + 1];
+         }
+      }
+      return 'x';
+   }
+
+private:
+   static bool is_edge(char sym)
+   {
+      return strchr("rfpn*BFMNPqQR%+_", sym) != 0;
+   }
+
+   static bool level_match(char sym, char bit)
+   {
+      if (bit == 'z')
+         bit = 'x';
+      switch (sym) {
+         case '?': return true;
+         case 'b': return bit != 'x';
+         case 'l': return bit != '1';
+         case 'h': return bit != '0';
+         default: return sym == bit;
+      }
+   }
+
+   // The sets of the old and the new values of every edge symbol.
+   static bool edge_match(char sym, char from, char to)
+   {
+      if (from == 'z')
+         from = 'x';
+      if (to == 'z')
+         to = 'x';
+      if (from == to)
+         return false;
+      const char *from_set, *to_set;
+      switch (sym) {
+         case 'r': from_set = "0"; to_set = "1"; break;
+         case 'f': from_set = "1"; to_set = "0"; break;
+         case 'p': return (from == '0') || (to == '1');
+         case 'n': return (from == '1') || (to == '0');
+         case '*': return true;
+         case 'B': from_set = "x"; to_set = "01"; break;
+         case 'F': from_set = "x"; to_set = "0"; break;
+         case 'M': from_set = "1"; to_set = "x"; break;
+         case 'N': from_set = "1"; to_set = "x0"; break;
+         case 'P': from_set = "0"; to_set = "x1"; break;
+         case 'q':
+         case '%': from_set = "01"; to_set = "x"; break;
+         case 'Q': from_set = "0"; to_set = "x"; break;
+         case 'R': from_set = "x"; to_set = "1"; break;
+         case '+': from_set = "0x"; to_set = "1"; break;
+         case '_': from_set = "x1"; to_set = "0"; break;
+         default: return false;
+      }
+      return strchr(from_set, from) != 0 && strchr(to_set, to) != 0;
+   }
+
+   bool sequential_;
+   char init_;
+   unsigned inputs_;
+   std::vector<std::string> rows_;
+};
+
+// The user defined primitives of the design.
+inline udp_table& udp(unsigned idx)
+{
+   static std::vector<udp_table> tables;
+   if (idx >= tables.size())
+      tables.resize(idx + 1);
+   return tables[idx];
+}
+
+/*
+ * The logic gates and the LPM devices. Every gate of the design is
+ * evaluated by the same function, given the names of its pins and
+ * the container that holds the signal values. The first pin is the
+ * output, the others are the inputs:
+ *
+ *   GATE_AND ... GATE_XNOR         any number of inputs
+ *   GATE_BUF, GATE_BUFZ, GATE_NOT  the input
+ *   GATE_BUFIF0 ... GATE_NOTIF1    the data and the enable
+ *   GATE_PULLUP, GATE_PULLDOWN     no inputs
+ *   GATE_ADD ... GATE_EQZ          the two operands
+ *   GATE_MUX                       the select and the data inputs
+ *   GATE_CONCAT                    the parts, least significant first
+ *   GATE_PART                      the vector and the first bit
+ *   GATE_PART_PV                   the part and the first bit it drives,
+ *                                  the other bits keep the output value
+ *   GATE_REPEAT, GATE_SIGN_EXT     the input, the width is the output one
+ *   GATE_SHIFTL ... GATE_SHIFTR_SIGNED  the vector and the distance
+ *   GATE_RE_AND ... GATE_RE_XNOR   the vector
+ *   GATE_FF, GATE_FF_NEG           D, clock, enable, asynchronous clear
+ *                                  and set, synchronous clear and set,
+ *                                  the asynchronous and the synchronous
+ *                                  set values, then the previous clock
+ *   GATE_UDP + n                   the inputs of the primitive udp(n),
+ *                                  then the previous inputs if it is
+ *                                  sequential
+ *
+ * The last pins of the flip-flops and of the sequential primitives
+ * are private signals of the gate: it keeps there what it needs to
+ * see an edge, so the rollback of the kernel restores them too.
+ */
+enum gate_type {
+   GATE_AND,
+   GATE_OR,
+   GATE_NAND,
+   GATE_NOR,
+   GATE_XOR,
+   GATE_XNOR,
+   GATE_BUF,
+   GATE_BUFZ,
+   GATE_NOT,
+   GATE_BUFIF0,
+   GATE_BUFIF1,
+   GATE_NOTIF0,
+   GATE_NOTIF1,
+   GATE_PULLUP,
+   GATE_PULLDOWN,
+   GATE_ADD,
+   GATE_SUB,
+   GATE_MULT,
+   GATE_EQ,
+   GATE_NE,
+   GATE_EEQ,
+   GATE_NEE,
+   GATE_GE,
+   GATE_GT,
+   GATE_GE_SIGNED,
+   GATE_GT_SIGNED,
+   GATE_EQX,
+   GATE_EQZ,
+   GATE_MUX,
+   GATE_CONCAT,
+   GATE_PART,
+   GATE_PART_PV,
+   GATE_REPEAT,
+   GATE_SIGN_EXT,
+   GATE_SHIFTL,
+   GATE_SHIFTR,
+   GATE_SHIFTR_SIGNED,
+   GATE_RE_AND,
+   GATE_RE_OR,
+   GATE_RE_XOR,
+   GATE_RE_NAND,
+   GATE_RE_NOR,
+   GATE_RE_XNOR,
+   GATE_FF,
+   GATE_FF_NEG,
+   GATE_UDP
+};
+
+template <class SIGNALS>
+logic_vector evaluate_flip_flop(bool negedge_clock, const std::vector<std::string>& pins,
+                                SIGNALS& signals)
+{
+   assert(pins.size() == 11);
+   logic_vector clock = signals.at(pins[2]);
+   logic_vector previous = signals.at(pins[10]);
+   signals.set(pins[10], clock);
+   if (signals.at(pins[4]).is_true())
+      return logic_vector(signals.at(pins[0]).size(), '0');
+   if (signals.at(pins[5]).is_true())
+      return signals.at(pins[8]);
+   bool edge = negedge_clock ? negedge(previous, clock) : posedge(previous, clock);
+   if (!edge || !signals.at(pins[3]).is_true())
+      return signals.at(pins[0]);
+   if (signals.at(pins[6]).is_true())
+      return logic_vector(signals.at(pins[0]).size(), '0');
+   if (signals.at(pins[7]).is_true())
+      return signals.at(pins[9]);
+   return signals.at(pins[1]);
+}
+
+/*
+ * A sequential primitive keeps the inputs it saw last and, in the
+ * top bit, whether it has already started from its initial value.
+ * The inputs that changed are applied one at a time.
+ */
+template <class SIGNALS>
+logic_vector evaluate_udp(const udp_table& table, const std::vector<std::string>& pins,
+                          SIGNALS& signals)
+{
+   unsigned inputs = table.inputs();
+   std::string in(inputs, 'x');
+   for (unsigned idx = 0; idx < inputs; idx++)
+      in[idx] = signals.at(pins[idx + 1]).get(0);
+   if (!table.sequential())
+      return logic_vector(1, table.evaluate(in));
+
+   assert(pins.size() == inputs + 2);
+   logic_vector previous = signals.at(pins[inputs + 1]);
+   char state = signals.at(pins[0]).get(0);
+   if (previous.get(inputs) != '1')
+      state = table.init();
+   std::string seen(inputs, 'x');
+   for (unsigned idx = 0; idx < inputs; idx++)
+      seen[idx] = previous.get(idx);
+   for (unsigned idx = 0; idx < inputs; idx++) {
+      if (seen[idx] == in[idx])
+         continue;
+      char from = seen[idx];
+      seen[idx] = in[idx];
+      state = table.evaluate(state, seen, idx, from);
+   }
+   for (unsigned idx = 0; idx < inputs; idx++)
+      previous.set(idx, in[idx]);
+   previous.set(inputs, '1');
+   signals.set(pins[inputs + 1], previous);
+   return logic_vector(1, state);
+}
+
+template <class SIGNALS>
+logic_vector evaluate_gate(int type, const std::vector<std::string>& pins,
+                           SIGNALS& signals)
+{
+   unsigned width = signals.at(pins[0]).size();
+   if (type >= GATE_UDP)
+      return evaluate_udp(udp(type - GATE_UDP), pins, signals);
+
+   switch (type) {
+      case GATE_PULLUP:
+         return logic_vector(width, '1');
+      case GATE_PULLDOWN:
+         return logic_vector(width, '0');
+      case GATE_FF:
+      case GATE_FF_NEG:
+         return evaluate_flip_flop(type == GATE_FF_NEG, pins, signals);
+      default:
+         break;
+   }
+
+   assert(pins.size() >= 2);
+   logic_vector value = signals.at(pins[1]);
+   switch (type) {
+      case GATE_AND:
+      case GATE_NAND:
+         for (unsigned idx = 2; idx < pins.size(); idx++)
+            value = value & signals.at(pins[idx]);
+         return type == GATE_AND ? value : ~value;
+      case GATE_OR:
+      case GATE_NOR:
+         for (unsigned idx = 2; idx < pins.size(); idx++)
+            value = value | signals.at(pins[idx]);
+         return type == GATE_OR ? value : ~value;
+      case GATE_XOR:
+      case GATE_XNOR:
+         for (unsigned idx = 2; idx < pins.size(); idx++)
+            value = value ^ signals.at(pins[idx]);
+         return type == GATE_XOR ? value : ~value;
+      case GATE_BUF:
+         // A buffer turns z into x
+         return value & value;
+      case GATE_BUFZ:
+         return value;
+      case GATE_NOT:
+         return ~value;
+      case GATE_BUFIF0:
+      case GATE_BUFIF1:
+      case GATE_NOTIF0:
+      case GATE_NOTIF1:
+         return tristate(value, signals.at(pins[2]),
+                         type == GATE_BUFIF0 || type == GATE_NOTIF0,
+                         type == GATE_NOTIF0 || type == GATE_NOTIF1);
+      case GATE_RE_AND:
+         return reduce_and(value);
+      case GATE_RE_OR:
+         return reduce_or(value);
+      case GATE_RE_XOR:
+         return reduce_xor(value);
+      case GATE_RE_NAND:
+         return ~reduce_and(value);
+      case GATE_RE_NOR:
+         return ~reduce_or(value);
+      case GATE_RE_XNOR:
+         return ~reduce_xor(value);
+      case GATE_REPEAT:
+         {
+            logic_vector res = value;
+            while (res.size() < width)
+               res = concat(res, value);
+            return res;
+         }
+      case GATE_SIGN_EXT:
+         {
+            logic_vector res(width, value.get(value.size() - 1));
+            for (unsigned idx = 0; idx < value.size() && idx < width; idx++)
+               res.set(idx, value.get(idx));
+            return res;
+         }
+      case GATE_CONCAT:
+         for (unsigned idx = 2; idx < pins.size(); idx++)
+            value = concat(signals.at(pins[idx]), value);
+         return value;
+      case GATE_MUX:
+         {
+            unsigned sel;
+            if (!to_index(value, sel) || sel + 2 >= pins.size())
+               return logic_vector(width, 'x');
+            return signals.at(pins[sel + 2]);
+         }
+      default:
+         break;
+   }
+
+   assert(pins.size() == 3);
+   logic_vector other = signals.at(pins[2]);
+   switch (type) {
+      case GATE_ADD:
+         return value.resize(width) + other.resize(width);
+      case GATE_SUB:
+         return value.resize(width) - other.resize(width);
+      case GATE_MULT:
+         return multiply(value, other, width);
+      case GATE_EQ:
+         return equal(value, other);
+      case GATE_NE:
+         return not_equal(value, other);
+      case GATE_EEQ:
+         return case_equal(value, other);
+      case GATE_NEE:
+         return ~case_equal(value, other);
+      case GATE_GE:
+         return less_equal(other, value);
+      case GATE_GT:
+         return less(other, value);
+      case GATE_GE_SIGNED:
+         return less_equal(flip_sign(other), flip_sign(value));
+      case GATE_GT_SIGNED:
+         return less(flip_sign(other), flip_sign(value));
+      case GATE_EQX:
+         return wildcard_equal(value, other, true);
+      case GATE_EQZ:
+         return wildcard_equal(value, other, false);
+      case GATE_PART:
+         return part_select(value, other, width);
+      case GATE_PART_PV:
+         {
+            unsigned base;
+            if (!to_index(other, base))
+               return signals.at(pins[0]);
+            return part_insert(signals.at(pins[0]), value, base);
+         }
+      case GATE_SHIFTL:
+         return shift_left(value, other);
+      case GATE_SHIFTR:
+         return shift_right(value, other);
+      case GATE_SHIFTR_SIGNED:
+         return shift_right(value, other, true);
+      default:
+         assert(false);
+         return logic_vector(width, 'x');
+   }
+}
+
+}  // namespace ivl
+
+#endif  // #ifndef INC_IVL_LOGIC_HPP
@@ -24,22 +24,56 @@
 #include "hierarchy.hh"
 #include "cpp_type.hh"
 
+#include <algorithm>
 #include <cassert>
 #include <sstream>
 #include <iostream>
 
-static void inputs_to_expr(cppClass *theclass, cpp_class_type type,
+static unsigned constant_delay(ivl_expr_t delay)
+{
+   if (delay == NULL)
+      return 0;
+   switch (ivl_expr_type(delay)) {
+   case IVL_EX_DELAY:
+      return ivl_expr_delay_val(delay);
+   case IVL_EX_NUMBER:
+   case IVL_EX_ULONG:
+      return ivl_expr_uvalue(delay);
+   default:
+      // A delay given by a signal may be as short as zero
+      return 0;
+   }
+}
+
+/*
+ * The least of the rise, fall and decay delays of a device, in
+ * simulation ticks: no change of its output can come earlier.
+ */
+unsigned device_delay(ivl_expr_t rise, ivl_expr_t fall, ivl_expr_t decay)
+{
+   unsigned delay = constant_delay(rise);
+   delay = std::min(delay, constant_delay(fall));
+   delay = std::min(delay, constant_delay(decay));
+   return delay;
+}
+
+/*
+ * The gates are instantiated inside clusters, see cluster_gates().
+ * The first pin is the output, the others are the inputs in order.
+ */
+static submodule* inputs_to_expr(cppClass *theclass, const std::string& gate,
                                  ivl_net_logic_t log)
 {
-   remember_logic(type);
-   submodule *temp = new submodule(type);
+   submodule *temp = new submodule(gate);
+   temp->delay = device_delay(ivl_logic_delay(log, 0), ivl_logic_delay(log, 1),
+                              ivl_logic_delay(log, 2));
    // The single output
    ivl_nexus_t output = ivl_logic_pin(log, 0);
    assert(output);
    cpp_var_ref* tmp = readable_ref(theclass->get_scope(), output);
    assert(tmp);
    temp->insert_output(tmp->get_name(), tmp->get_name());
-   
+
    // All the inputs
    int npins = ivl_logic_pins(log);
    for (int i = 1; i < npins; i++) {
@@ -52,28 +86,81 @@ static void inputs_to_expr(cppClass *theclass, cpp_class_type type,
    }
 
    add_submodule_to(temp, theclass);
+   return temp;
+}
+
+/*
+ * A user defined primitive evaluates the table of its definition,
+ * shared by all the instances. A sequential one also remembers
+ * the inputs it saw last and whether it has started.
+ */
+static void translate_udp(cppClass *theclass, ivl_net_logic_t log)
+{
+   ivl_udp_t udp = ivl_logic_udp(log);
+   assert(udp);
+   std::ostringstream ss;
+   ss << "GATE_UDP + " << remember_udp(udp);
+   submodule* gate = inputs_to_expr(theclass, ss.str(), log);
+   if (ivl_udp_sequ(udp)) {
+      std::string output = gate->outputs_map.front().first;
+      gate->insert_private(output + ":prev", std::string(ivl_udp_nin(udp) + 1, 'x'));
+   }
 }
 
 void translate_logic(cppClass *theclass, ivl_net_logic_t log)
 {
    switch (ivl_logic_type(log)) {
-   case IVL_LO_OR:
-      inputs_to_expr(theclass, CPP_CLASS_OR, log);
-      return;
    case IVL_LO_AND:
-      inputs_to_expr(theclass, CPP_CLASS_AND, log);
+      inputs_to_expr(theclass, "GATE_AND", log);
+      return;
+   case IVL_LO_OR:
+      inputs_to_expr(theclass, "GATE_OR", log);
       return;
    case IVL_LO_NAND:
+      inputs_to_expr(theclass, "GATE_NAND", log);
+      return;
    case IVL_LO_NOR:
+      inputs_to_expr(theclass, "GATE_NOR", log);
+      return;
    case IVL_LO_XOR:
+      inputs_to_expr(theclass, "GATE_XOR", log);
+      return;
    case IVL_LO_XNOR:
+      inputs_to_expr(theclass, "GATE_XNOR", log);
+      return;
    case IVL_LO_NOT:
-   case IVL_LO_PULLUP:
-   case IVL_LO_PULLDOWN:
+      inputs_to_expr(theclass, "GATE_NOT", log);
+      return;
    case IVL_LO_BUF:
+      inputs_to_expr(theclass, "GATE_BUF", log);
+      return;
    case IVL_LO_BUFT:
    case IVL_LO_BUFZ:
+      inputs_to_expr(theclass, "GATE_BUFZ", log);
+      return;
+   case IVL_LO_PULLUP:
+      inputs_to_expr(theclass, "GATE_PULLUP", log);
+      return;
+   case IVL_LO_PULLDOWN:
+      inputs_to_expr(theclass, "GATE_PULLDOWN", log);
+      return;
+   case IVL_LO_BUFIF0:
+      inputs_to_expr(theclass, "GATE_BUFIF0", log);
+      return;
+   case IVL_LO_BUFIF1:
+      inputs_to_expr(theclass, "GATE_BUFIF1", log);
+      return;
+   case IVL_LO_NOTIF0:
+      inputs_to_expr(theclass, "GATE_NOTIF0", log);
+      return;
+   case IVL_LO_NOTIF1:
+      inputs_to_expr(theclass, "GATE_NOTIF1", log);
+      return;
+   case IVL_LO_UDP:
+      translate_udp(theclass, log);
+      return;
    default:
+      // The switch level primitives need the strengths
       error("The expression %d is not supported yet",
             ivl_logic_type(log));
       return;
@@ -82,19 +169,5 @@ void translate_logic(cppClass *theclass, ivl_net_logic_t log)
 
 void draw_logic(cppClass *theclass, ivl_net_logic_t log)
 {
-   switch (ivl_logic_type(log)) {
-   case IVL_LO_BUFIF0:
-   case IVL_LO_BUFIF1:
-   case IVL_LO_NOTIF0:
-   case IVL_LO_NOTIF1:
-   case IVL_LO_UDP:
-      {
-         error("The expression %d is not supported yet",
-               ivl_logic_type(log));
-      }
-   default:
-      {
-         translate_logic(theclass, log);
-      }
-   }
+   translate_logic(theclass, log);
 }
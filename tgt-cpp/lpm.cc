@@ -0,0 +1,246 @@
+/*
+ *  C++ code generation for LPM devices.
+ *
+ *  Copyright (C) 2015  Michele Castellana (michele.castellana@mail.polimi.it)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "cpp_target.h"
+#include "state.hh"
+#include "hierarchy.hh"
+
+#include <cassert>
+#include <sstream>
+#include <iostream>
+
+/*
+ * The LPM devices become gates of the clusters, like the logic
+ * gates: the output is the q pin and the inputs follow the order
+ * described in ivl_logic.hpp for every ivl::gate_type.
+ */
+static std::string lpm_signal(cppClass *theclass, ivl_nexus_t nex)
+{
+   cpp_var_ref* ref = readable_ref(theclass->get_scope(), nex);
+   assert(ref);
+   return ref->get_name();
+}
+
+static void lpm_input(cppClass *theclass, submodule *gate, ivl_nexus_t nex)
+{
+   assert(nex);
+   std::string name = lpm_signal(theclass, nex);
+   gate->insert_input(name, name);
+}
+
+// The bits of a constant, MSB first, as wide as width.
+static std::string constant_bits(unsigned long value, unsigned width)
+{
+   std::string bits(width, '0');
+   for (unsigned idx = 0; idx < width && idx < sizeof(value) * 8; idx++)
+      if ((value >> idx) & 1)
+         bits[width - idx - 1] = '1';
+   return bits;
+}
+
+static std::string constant_bits(ivl_expr_t value, unsigned width)
+{
+   if (value == NULL)
+      return std::string(width, 'x');
+   assert(ivl_expr_type(value) == IVL_EX_NUMBER);
+   const char* lsb_first = ivl_expr_bits(value);
+   unsigned nbits = ivl_expr_width(value);
+   std::string bits(width, '0');
+   for (unsigned idx = 0; idx < width && idx < nbits; idx++)
+      bits[width - idx - 1] = lsb_first[idx];
+   return bits;
+}
+
+/*
+ * A pin left unconnected is a constant of the gate: the name has
+ * a ':' so that it cannot clash with a Verilog signal.
+ */
+static void lpm_input(cppClass *theclass, submodule *gate, ivl_nexus_t nex,
+                      const char* what, const std::string& bits)
+{
+   if (nex != NULL)
+      lpm_input(theclass, gate, nex);
+   else
+      gate->insert_private(gate->outputs_map.front().first + ":" + what, bits);
+}
+
+static submodule* new_lpm_gate(cppClass *theclass, ivl_lpm_t lpm, const std::string& type)
+{
+   submodule *gate = new submodule(type);
+   gate->delay = device_delay(ivl_lpm_delay(lpm, 0), ivl_lpm_delay(lpm, 1),
+                              ivl_lpm_delay(lpm, 2));
+   std::string output = lpm_signal(theclass, ivl_lpm_q(lpm));
+   gate->insert_output(output, output);
+   return gate;
+}
+
+// The devices with all the inputs in the data pins.
+static void draw_data_lpm(cppClass *theclass, ivl_lpm_t lpm, const std::string& type,
+                          unsigned ninputs)
+{
+   submodule *gate = new_lpm_gate(theclass, lpm, type);
+   for (unsigned idx = 0; idx < ninputs; idx++)
+      lpm_input(theclass, gate, ivl_lpm_data(lpm, idx));
+   add_submodule_to(gate, theclass);
+}
+
+static void draw_mux_lpm(cppClass *theclass, ivl_lpm_t lpm)
+{
+   submodule *gate = new_lpm_gate(theclass, lpm, "GATE_MUX");
+   lpm_input(theclass, gate, ivl_lpm_select(lpm));
+   for (unsigned idx = 0; idx < ivl_lpm_size(lpm); idx++)
+      lpm_input(theclass, gate, ivl_lpm_data(lpm, idx));
+   add_submodule_to(gate, theclass);
+}
+
+// A constant base is a private signal of the gate.
+static void draw_part_lpm(cppClass *theclass, ivl_lpm_t lpm)
+{
+   submodule *gate = new_lpm_gate(theclass, lpm, "GATE_PART");
+   lpm_input(theclass, gate, ivl_lpm_data(lpm, 0));
+   lpm_input(theclass, gate, ivl_lpm_data(lpm, 1), "base",
+             constant_bits(ivl_lpm_base(lpm), 32));
+   add_submodule_to(gate, theclass);
+}
+
+/*
+ * The part drives the bits from base on of the output vector, the
+ * other bits of the vector come from the other devices driving it.
+ * All of them are in the same cluster (see cluster_gates).
+ */
+static void draw_part_pv_lpm(cppClass *theclass, ivl_lpm_t lpm)
+{
+   submodule *gate = new_lpm_gate(theclass, lpm, "GATE_PART_PV");
+   lpm_input(theclass, gate, ivl_lpm_data(lpm, 0));
+   lpm_input(theclass, gate, NULL, "base", constant_bits(ivl_lpm_base(lpm), 32));
+   add_submodule_to(gate, theclass);
+}
+
+/*
+ * The flip-flop remembers the clock it saw last, the missing
+ * controls are constants that never fire.
+ */
+static void draw_ff_lpm(cppClass *theclass, ivl_lpm_t lpm)
+{
+   submodule *gate = new_lpm_gate(theclass, lpm, ivl_lpm_negedge(lpm) ? "GATE_FF_NEG" : "GATE_FF");
+   unsigned width = ivl_lpm_width(lpm);
+   lpm_input(theclass, gate, ivl_lpm_data(lpm, 0));
+   lpm_input(theclass, gate, ivl_lpm_clk(lpm));
+   lpm_input(theclass, gate, ivl_lpm_enable(lpm), "enable", "1");
+   lpm_input(theclass, gate, ivl_lpm_async_clr(lpm), "aclr", "0");
+   lpm_input(theclass, gate, ivl_lpm_async_set(lpm), "aset", "0");
+   lpm_input(theclass, gate, ivl_lpm_sync_clr(lpm), "sclr", "0");
+   lpm_input(theclass, gate, ivl_lpm_sync_set(lpm), "sset", "0");
+   lpm_input(theclass, gate, NULL, "aset_value", constant_bits(ivl_lpm_aset_value(lpm), width));
+   lpm_input(theclass, gate, NULL, "sset_value", constant_bits(ivl_lpm_sset_value(lpm), width));
+   lpm_input(theclass, gate, NULL, "prev", "x");
+   add_submodule_to(gate, theclass);
+}
+
+void draw_lpm(cppClass *theclass, ivl_lpm_t lpm)
+{
+   bool is_signed = ivl_lpm_signed(lpm) != 0;
+   switch (ivl_lpm_type(lpm)) {
+   case IVL_LPM_ADD:
+      draw_data_lpm(theclass, lpm, "GATE_ADD", 2);
+      return;
+   case IVL_LPM_SUB:
+      draw_data_lpm(theclass, lpm, "GATE_SUB", 2);
+      return;
+   case IVL_LPM_MULT:
+      draw_data_lpm(theclass, lpm, "GATE_MULT", 2);
+      return;
+   case IVL_LPM_CMP_EQ:
+      draw_data_lpm(theclass, lpm, "GATE_EQ", 2);
+      return;
+   case IVL_LPM_CMP_NE:
+      draw_data_lpm(theclass, lpm, "GATE_NE", 2);
+      return;
+   case IVL_LPM_CMP_EEQ:
+      draw_data_lpm(theclass, lpm, "GATE_EEQ", 2);
+      return;
+   case IVL_LPM_CMP_NEE:
+      draw_data_lpm(theclass, lpm, "GATE_NEE", 2);
+      return;
+   case IVL_LPM_CMP_EQX:
+      draw_data_lpm(theclass, lpm, "GATE_EQX", 2);
+      return;
+   case IVL_LPM_CMP_EQZ:
+      draw_data_lpm(theclass, lpm, "GATE_EQZ", 2);
+      return;
+   case IVL_LPM_CMP_GE:
+      draw_data_lpm(theclass, lpm, is_signed ? "GATE_GE_SIGNED" : "GATE_GE", 2);
+      return;
+   case IVL_LPM_CMP_GT:
+      draw_data_lpm(theclass, lpm, is_signed ? "GATE_GT_SIGNED" : "GATE_GT", 2);
+      return;
+   case IVL_LPM_SHIFTL:
+      draw_data_lpm(theclass, lpm, "GATE_SHIFTL", 2);
+      return;
+   case IVL_LPM_SHIFTR:
+      draw_data_lpm(theclass, lpm, is_signed ? "GATE_SHIFTR_SIGNED" : "GATE_SHIFTR", 2);
+      return;
+   case IVL_LPM_CONCAT:
+   case IVL_LPM_CONCATZ:
+      draw_data_lpm(theclass, lpm, "GATE_CONCAT", ivl_lpm_size(lpm));
+      return;
+   case IVL_LPM_REPEAT:
+      draw_data_lpm(theclass, lpm, "GATE_REPEAT", 1);
+      return;
+   case IVL_LPM_SIGN_EXT:
+      draw_data_lpm(theclass, lpm, "GATE_SIGN_EXT", 1);
+      return;
+   case IVL_LPM_RE_AND:
+      draw_data_lpm(theclass, lpm, "GATE_RE_AND", 1);
+      return;
+   case IVL_LPM_RE_OR:
+      draw_data_lpm(theclass, lpm, "GATE_RE_OR", 1);
+      return;
+   case IVL_LPM_RE_XOR:
+      draw_data_lpm(theclass, lpm, "GATE_RE_XOR", 1);
+      return;
+   case IVL_LPM_RE_NAND:
+      draw_data_lpm(theclass, lpm, "GATE_RE_NAND", 1);
+      return;
+   case IVL_LPM_RE_NOR:
+      draw_data_lpm(theclass, lpm, "GATE_RE_NOR", 1);
+      return;
+   case IVL_LPM_RE_XNOR:
+      draw_data_lpm(theclass, lpm, "GATE_RE_XNOR", 1);
+      return;
+   case IVL_LPM_MUX:
+      draw_mux_lpm(theclass, lpm);
+      return;
+   case IVL_LPM_PART_VP:
+      draw_part_lpm(theclass, lpm);
+      return;
+   case IVL_LPM_PART_PV:
+      draw_part_pv_lpm(theclass, lpm);
+      return;
+   case IVL_LPM_FF:
+      draw_ff_lpm(theclass, lpm);
+      return;
+   default:
+      // Real values, functions and memories are not translated yet
+      error("The LPM device %d (%s:%d) is not supported yet",
+            ivl_lpm_type(lpm), ivl_lpm_file(lpm), ivl_lpm_lineno(lpm));
+      return;
+   }
+}
@@ -0,0 +1,297 @@
+/*
+ *  Partitioning of the generated simulation objects.
+ *
+ *  Copyright (c) 2015 Michele Castellana (michele.castellana@mail.polimi.it)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "partition.hh"
+#include "cpp_target.h"
+
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+/*
+ * The partitioning works in two steps. First the parts are grown one
+ * at a time from a seed object, always adding the object with the
+ * most channels towards the part being built, until the part reaches
+ * its share of the total load. Then the objects on the border of
+ * the parts are moved to the part they talk most with, as long as
+ * this reduces the number of channels cut and keeps the parts
+ * balanced.
+ *
+ * The load of an object is its own cost plus the number of channels
+ * it receives from: every incoming signal is an event to handle.
+ */
+struct sim_object_t {
+   std::string name;
+   unsigned cost;
+   unsigned weight;
+   unsigned part;
+   // neighbour -> number of channels in both directions
+   std::map<unsigned, unsigned> adj;
+};
+
+static std::vector<sim_object_t> objects;
+static std::map<std::string, unsigned> object_index;
+struct sim_channel_t {
+   std::string from, to;
+   unsigned lookahead;
+};
+
+static std::vector<sim_channel_t> channels;
+static unsigned nparts_ = 1;
+
+// Allow the parts to be this much (in percent) above the average load
+#define PARTITION_IMBALANCE 5
+// Maximum number of refinement passes
+#define PARTITION_PASSES 8
+
+void add_sim_object(const std::string& name, unsigned cost)
+{
+   assert(object_index.find(name) == object_index.end());
+   sim_object_t obj;
+   obj.name = name;
+   obj.cost = cost;
+   obj.weight = cost;
+   obj.part = 0;
+   object_index[name] = objects.size();
+   objects.push_back(obj);
+}
+
+void add_sim_channel(const std::string& from, const std::string& to,
+                     unsigned lookahead)
+{
+   sim_channel_t channel;
+   channel.from = from;
+   channel.to = to;
+   channel.lookahead = lookahead;
+   channels.push_back(channel);
+}
+
+/*
+ * Resolve the channels into the adjacency of the objects.
+ */
+static void build_graph()
+{
+   for (std::vector<sim_channel_t>::iterator it = channels.begin();
+         it != channels.end(); ++it) {
+      std::map<std::string, unsigned>::iterator from = object_index.find(it->from);
+      std::map<std::string, unsigned>::iterator to = object_index.find(it->to);
+      if (from == object_index.end() || to == object_index.end()) {
+         error("Channel between unknown simulation objects %s and %s",
+               it->from.c_str(), it->to.c_str());
+         continue;
+      }
+      objects[to->second].weight += 1;
+      if (from->second == to->second)
+         continue;
+      objects[from->second].adj[to->second] += 1;
+      objects[to->second].adj[from->second] += 1;
+   }
+}
+
+/*
+ * Grow the parts one after the other.
+ */
+static void grow_parts(std::vector<unsigned long>& load, unsigned long target)
+{
+   const unsigned unassigned = nparts_;
+   for (unsigned idx = 0; idx < objects.size(); idx++)
+      objects[idx].part = unassigned;
+
+   // Objects are seeded in creation order, which follows the design
+   // hierarchy, so a new part starts close to where the last ended.
+   unsigned next_seed = 0;
+   for (unsigned part = 0; part < nparts_; part++) {
+      // The frontier, ordered by the channels towards this part
+      std::set< std::pair<unsigned, unsigned> > frontier;
+      std::map<unsigned, unsigned> gain;
+      bool last = part + 1 == nparts_;
+      while (last || load[part] < target) {
+         unsigned pick;
+         if (frontier.empty()) {
+            while (next_seed < objects.size() && objects[next_seed].part != unassigned)
+               next_seed += 1;
+            if (next_seed == objects.size())
+               break;
+            pick = next_seed;
+         } else {
+            std::set< std::pair<unsigned, unsigned> >::iterator best = frontier.end();
+            --best;
+            pick = best->second;
+            frontier.erase(best);
+            gain.erase(pick);
+         }
+         objects[pick].part = part;
+         load[part] += objects[pick].weight;
+         for (std::map<unsigned, unsigned>::iterator nb = objects[pick].adj.begin();
+               nb != objects[pick].adj.end(); ++nb) {
+            if (objects[nb->first].part != unassigned)
+               continue;
+            std::map<unsigned, unsigned>::iterator cur = gain.find(nb->first);
+            unsigned old_gain = cur == gain.end() ? 0 : cur->second;
+            if (cur != gain.end())
+               frontier.erase(std::make_pair(old_gain, nb->first));
+            gain[nb->first] = old_gain + nb->second;
+            frontier.insert(std::make_pair(old_gain + nb->second, nb->first));
+         }
+      }
+   }
+}
+
+/*
+ * Move the objects to the part they have most channels with.
+ */
+static void refine_parts(std::vector<unsigned long>& load, unsigned long target)
+{
+   unsigned long limit = target + target * PARTITION_IMBALANCE / 100;
+   for (unsigned pass = 0; pass < PARTITION_PASSES; pass++) {
+      unsigned moved = 0;
+      for (unsigned idx = 0; idx < objects.size(); idx++) {
+         sim_object_t& obj = objects[idx];
+         std::map<unsigned, unsigned> conn;
+         for (std::map<unsigned, unsigned>::iterator nb = obj.adj.begin();
+               nb != obj.adj.end(); ++nb)
+            conn[objects[nb->first].part] += nb->second;
+         unsigned here = conn[obj.part];
+         unsigned best = obj.part;
+         unsigned best_conn = here;
+         for (std::map<unsigned, unsigned>::iterator it = conn.begin();
+               it != conn.end(); ++it) {
+            if (it->second <= best_conn)
+               continue;
+            if (load[it->first] + obj.weight > limit)
+               continue;
+            best = it->first;
+            best_conn = it->second;
+         }
+         if (best == obj.part)
+            continue;
+         load[obj.part] -= obj.weight;
+         load[best] += obj.weight;
+         obj.part = best;
+         moved += 1;
+      }
+      if (moved == 0)
+         break;
+   }
+}
+
+void partition_sim_objects(unsigned nparts)
+{
+   nparts_ = nparts > 0 ? nparts : 1;
+   if (nparts_ == 1 || objects.empty())
+      return;
+
+   build_graph();
+
+   unsigned long total = 0;
+   for (unsigned idx = 0; idx < objects.size(); idx++)
+      total += objects[idx].weight;
+   unsigned long target = (total + nparts_ - 1) / nparts_;
+
+   std::vector<unsigned long> load(nparts_, 0);
+   grow_parts(load, target);
+   refine_parts(load, target);
+
+   unsigned long cut = 0;
+   for (unsigned idx = 0; idx < objects.size(); idx++)
+      for (std::map<unsigned, unsigned>::iterator nb = objects[idx].adj.begin();
+            nb != objects[idx].adj.end(); ++nb)
+         if (nb->first > idx && objects[nb->first].part != objects[idx].part)
+            cut += nb->second;
+
+   debug_msg("Partitioned %u simulation objects in %u parts, %lu channels cut",
+             (unsigned)objects.size(), nparts_, cut);
+   for (unsigned part = 0; part < nparts_; part++)
+      debug_msg("  part %u: load %lu", part, load[part]);
+}
+
+unsigned sim_object_part(const std::string& name)
+{
+   std::map<std::string, unsigned>::iterator it = object_index.find(name);
+   if (it == object_index.end() || nparts_ == 1)
+      return 0;
+   return objects[it->second].part;
+}
+
+unsigned sim_partitions()
+{
+   return nparts_;
+}
+
+/*
+ * The partition file lists every simulation object with the
+ * number of its part, one per line.
+ */
+bool write_partition_file(const std::string& fname)
+{
+   std::ofstream out(fname.c_str());
+   if (!out) {
+      error("Unable to open %s for writing", fname.c_str());
+      return false;
+   }
+   out << "# " << objects.size() << " simulation objects in "
+       << nparts_ << " parts" << std::endl;
+   out << "# object part" << std::endl;
+   for (unsigned idx = 0; idx < objects.size(); idx++)
+      out << objects[idx].name << " " << objects[idx].part << std::endl;
+   return true;
+}
+
+/*
+ * The lookahead file lists every pair of objects with a channel
+ * and the least delay of the signals sent on it, one per line. A
+ * conservative kernel can advance the threads by the least lookahead
+ * of the channels between them.
+ */
+bool write_lookahead_file(const std::string& fname)
+{
+   std::map< std::pair<std::string, std::string>, unsigned> lookahead;
+   unsigned least = 0;
+   for (std::vector<sim_channel_t>::iterator it = channels.begin();
+         it != channels.end(); ++it) {
+      std::pair<std::string, std::string> key(it->from, it->to);
+      std::map< std::pair<std::string, std::string>, unsigned>::iterator cur = lookahead.find(key);
+      if (cur == lookahead.end())
+         lookahead[key] = it->lookahead;
+      else
+         cur->second = std::min(cur->second, it->lookahead);
+      if (least == 0 || it->lookahead < least)
+         least = it->lookahead;
+   }
+
+   std::ofstream out(fname.c_str());
+   if (!out) {
+      error("Unable to open %s for writing", fname.c_str());
+      return false;
+   }
+   out << "# " << lookahead.size() << " channels, least lookahead "
+       << least << std::endl;
+   out << "# from to lookahead" << std::endl;
+   for (std::map< std::pair<std::string, std::string>, unsigned>::iterator it = lookahead.begin();
+         it != lookahead.end(); ++it)
+      out << it->first.first << " " << it->first.second << " " << it->second << std::endl;
+   debug_msg("%u channels, least lookahead %u",
+             (unsigned)lookahead.size(), least);
+   return true;
+}
@@ -0,0 +1,48 @@
+/*
+ *  Partitioning of the generated simulation objects.
+ *
+ *  Copyright (c) 2015 Michele Castellana (michele.castellana@mail.polimi.it)
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INC_CPP_PARTITION_HH
+#define INC_CPP_PARTITION_HH
+
+#include <string>
+
+/*
+ * The simulation objects and the channels among them form a graph.
+ * The cost of an object is the work it does on its own (e.g. the
+ * number of gates of a cluster), each channel is a signal sent from
+ * an object to another one, at least lookahead time units after the
+ * event that caused it.
+ */
+void add_sim_object(const std::string& name, unsigned cost);
+void add_sim_channel(const std::string& from, const std::string& to,
+                     unsigned lookahead);
+
+/*
+ * Split the objects into nparts parts of similar load, keeping the
+ * number of channels between different parts low.
+ */
+void partition_sim_objects(unsigned nparts);
+unsigned sim_object_part(const std::string& name);
+unsigned sim_partitions();
+
+bool write_partition_file(const std::string& fname);
+bool write_lookahead_file(const std::string& fname);
+
+#endif  // #ifndef INC_CPP_PARTITION_HH
@@ -27,23 +27,117 @@
 #include <iostream>
 #include <cassert>
 #include <sstream>
+#include <climits>
 
 /*
  * TODO: always.
  * WARNING: Right now it only supports "initial".
  * Convert a Verilog process.
  */
+/*
+ * The delay controls of an always block split its statements in
+ * steps, see cppClass::add_process. Delays are translated at the top
+ * level of the body only, not inside if or case statements. A zero
+ * delay does not split the body: the statements after it run at once.
+ */
+static int draw_always_steps(ivl_statement_t stmt, process_steps_t &steps)
+{
+   switch (ivl_statement_type(stmt)) {
+      case IVL_ST_BLOCK:
+         {
+            ivl_scope_t block_scope = ivl_stmt_block_scope(stmt);
+            if (block_scope && ivl_scope_sigs(block_scope) > 0) {
+               error("Signals declared in named blocks are not supported (%s:%d)",
+                     ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+               return 1;
+            }
+            for (unsigned i = 0; i < ivl_stmt_block_count(stmt); i++) {
+               if (draw_always_steps(ivl_stmt_block_stmt(stmt, i), steps) != 0)
+                  return 1;
+            }
+            return 0;
+         }
+      case IVL_ST_DELAY:
+         {
+            uint64_t delay = ivl_stmt_delay_val(stmt);
+            if (delay > UINT_MAX) {
+               error("Delay too large (%s:%d)", ivl_stmt_file(stmt),
+                     ivl_stmt_lineno(stmt));
+               return 1;
+            }
+            if (delay > 0)
+               steps.push_back(std::make_pair((unsigned)delay, list<cpp_stmt*>()));
+            ivl_statement_t sub_stmt = ivl_stmt_sub_stmt(stmt);
+            return sub_stmt ? draw_always_steps(sub_stmt, steps) : 0;
+         }
+      case IVL_ST_DELAYX:
+         error("Only constant delays are supported (%s:%d)",
+               ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+         return 1;
+      default:
+         return draw_process_stmt(stmt, steps.back().second);
+   }
+}
+
+/*
+ * An always block starts with an event control, whose events become
+ * the sensitivity list of the process, or with a delay: then it needs
+ * no event and runs again when its last step ends.
+ */
+static int generate_always(cppClass *theclass, ivl_process_t proc)
+{
+   ivl_statement_t stmt = ivl_process_stmt(proc);
+   sensitivity_list_t events;
+   if (ivl_statement_type(stmt) == IVL_ST_WAIT) {
+      for (unsigned i = 0; i < ivl_stmt_nevent(stmt); i++) {
+         ivl_event_t event = ivl_stmt_events(stmt, i);
+         for (unsigned j = 0; j < ivl_event_nany(event); j++) {
+            cpp_var_ref *ref = readable_ref(theclass->get_scope(), ivl_event_any(event, j));
+            events.push_back(std::make_pair(ref->get_name(), CPP_EDGE_ANY));
+         }
+         for (unsigned j = 0; j < ivl_event_npos(event); j++) {
+            cpp_var_ref *ref = readable_ref(theclass->get_scope(), ivl_event_pos(event, j));
+            events.push_back(std::make_pair(ref->get_name(), CPP_EDGE_POS));
+         }
+         for (unsigned j = 0; j < ivl_event_nneg(event); j++) {
+            cpp_var_ref *ref = readable_ref(theclass->get_scope(), ivl_event_neg(event, j));
+            events.push_back(std::make_pair(ref->get_name(), CPP_EDGE_NEG));
+         }
+      }
+      if (events.empty()) {
+         error("Named events are not supported (%s:%d)",
+               ivl_process_file(proc), ivl_process_lineno(proc));
+         return 1;
+      }
+      stmt = ivl_stmt_sub_stmt(stmt);
+   }
+
+   process_steps_t steps(1, std::make_pair(0U, list<cpp_stmt*>()));
+   if (stmt && draw_always_steps(stmt, steps) != 0)
+      return 1;
+   if (events.empty() && steps.size() == 1) {
+      error("Only always blocks starting with an event control or "
+            "with a delay are supported (%s:%d)",
+            ivl_process_file(proc), ivl_process_lineno(proc));
+      return 1;
+   }
+
+   theclass->add_process(events, steps);
+   return 0;
+}
+
 static int generate_process(cppClass *theclass, ivl_process_t proc)
 {
    set_active_class(theclass);
 
-   ivl_statement_t stmt = ivl_process_stmt(proc);
-   int rc = draw_stmt(stmt);
-   if (rc != 0)
-      return rc;
+   int rc;
+   if (ivl_process_type(proc) == IVL_PR_ALWAYS)
+      rc = generate_always(theclass, proc);
+   else
+      rc = draw_stmt(ivl_process_stmt(proc));
 
    set_active_class(NULL);
-   return 0;
+   return rc;
 }
 
 extern "C" int draw_process(ivl_process_t proc, void *)
@@ -58,8 +58,8 @@ struct nexus_private_t {
 };
 
 /*
- * Translate all the primitive logic gates into concurrent
- * signal assignments.
+ * Translate all the primitive logic gates and the LPM devices
+ * into the gates of the clusters.
  */
 static void declare_logic(cppClass *arch, ivl_scope_t scope)
 {
@@ -68,6 +68,10 @@ static void declare_logic(cppClass *arch, ivl_scope_t scope)
    int nlogs = ivl_scope_logs(scope);
    for (int i = 0; i < nlogs; i++)
       draw_logic(arch, ivl_scope_log(scope, i));
+
+   int nlpms = ivl_scope_lpms(scope);
+   for (int i = 0; i < nlpms; i++)
+      draw_lpm(arch, ivl_scope_lpm(scope, i));
 }
 
 // Replace consecutive underscores with a single underscore
@@ -344,7 +348,7 @@ static void declare_one_signal(cppClass *theclass, ivl_signal_t sig,
    case IVL_SIP_INPUT:
       {
          cpp_var *var = new cpp_var(name, sig_type);
-         theclass->add_to_inputs(var);
+         theclass->add_to_inputs(var, ivl_signal_width(sig));
       }
          break;
    case IVL_SIP_INOUT:
@@ -26,10 +26,15 @@
 #include <algorithm>
 #include <string>
 #include <map>
+#include <set>
 #include <vector>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 
 using namespace std;
 
@@ -51,6 +56,9 @@ struct signal_defn_t {
 // encountered and hence it will appear first in the output file.
 static std::list<cppClass*> g_classes;
 
+// The same classes by name
+static std::map<std::string, cppClass*> g_class_names;
+
 // Store the mapping of ivl scope names to class names
 static map<ivl_scope_t, string> g_scope_names;
 
@@ -61,9 +69,14 @@ static cppClass *g_active_class = NULL;
 
 // Set of scopes that are treated as the default examples of
 // that type. Any other scopes of the same type are ignored.
-typedef vector<ivl_scope_t> default_scopes_t;
+typedef set<ivl_scope_t> default_scopes_t;
 static default_scopes_t g_default_scopes;
 
+// The default example of every type, by type signature, and the
+// default example of every scope seen.
+static map<string, ivl_scope_t> g_scope_types;
+static map<ivl_scope_t, ivl_scope_t> g_default_of_scope;
+
 // There is one and only one context
 static cpp_context *context = new cpp_context();
 
@@ -76,6 +89,44 @@ void remember_logic(cpp_class_type type)
    design_logic.insert(type);
 }
 
+// The user defined primitives, numbered in the order they are seen
+static std::map<ivl_udp_t, unsigned> design_udps;
+
+/*
+ * The table of a primitive is filled once by the main, whatever
+ * the number of its instances.
+ */
+unsigned remember_udp(ivl_udp_t udp)
+{
+   std::map<ivl_udp_t, unsigned>::iterator it = design_udps.find(udp);
+   if (it != design_udps.end())
+      return it->second;
+   unsigned idx = design_udps.size();
+   design_udps[udp] = idx;
+
+   const cpp_type* no_type = new cpp_type(CPP_TYPE_NOTYPE);
+   ostringstream ss;
+   ss << "ivl::udp(" << idx << ")";
+   cpp_const_expr* table = new cpp_const_expr(ss.str().c_str(), no_type);
+   bool sequential = ivl_udp_sequ(udp) != 0;
+   cpp_fcall_stmt* define = new cpp_fcall_stmt(no_type, table, "define");
+   define->add_param(new cpp_const_expr(sequential ? "true" : "false", no_type));
+   ss.str("");
+   ss << "'" << (sequential ? ivl_udp_init(udp) : 'x') << "'";
+   define->add_param(new cpp_const_expr(ss.str().c_str(), no_type));
+   ss.str("");
+   ss << ivl_udp_nin(udp);
+   define->add_param(new cpp_const_expr(ss.str().c_str(), no_type));
+   context->add_stmt(define);
+   for (unsigned row = 0; row < ivl_udp_rows(udp); row++) {
+      cpp_fcall_stmt* add_row = new cpp_fcall_stmt(no_type, table, "add_row");
+      add_row->add_param(new cpp_const_expr(ivl_udp_row(udp, row), new cpp_type(CPP_TYPE_STD_STRING)));
+      context->add_stmt(add_row);
+   }
+   debug_msg("Primitive %s is table %d", ivl_udp_name(udp), idx);
+   return idx;
+}
+
 // True if signal `sig' has already been encountered by the code
 // generator. This means we have already assigned it to a C++
 // object and possibly renamed it.
@@ -126,6 +177,7 @@ static void only_remember_class(cppClass* theclass, bool a = true)
     * The first 2 classes added are the event class and
     * the base class. They NEED to stay on top on the others.
     */
+   g_class_names[theclass->get_name()] = theclass;
    if(g_classes.size() <= 1)
    {
       g_classes.push_front(theclass);
@@ -151,23 +203,53 @@ void build_basic_classes()
    cppClass *theeventclass = new cppClass(CUSTOM_EVENT_CLASS_NAME, CPP_INHERIT_EVENT);
    theeventclass->set_comment("Created to store information about the triggered event");
    only_remember_class(theeventclass, false);
-   context->add_include("boost/logic/tribool.hpp");
-   context->add_include("boost/logic/tribool_io.hpp");
+   context->add_include("ivl_logic.hpp");
    context->add_include("cassert");
    context->add_include("map");
    context->add_include("vector");
-   context->add_include("warped.hpp");
+   // The bundled reference kernel or Warped2
+   const char* kernel = get_design_flag("kernel");
+   if (kernel != NULL && strcmp(kernel, "ivl") == 0)
+      context->add_include("ivl_kernel.hpp");
+   else
+      context->add_include("warped.hpp");
 }
 
 void build_net()
 {
+   // Build the hierarchy first: the clustering of the gates
+   // adds the Cluster class to the design logic and tells how
+   // big its state must be.
+   std::list<cpp_stmt*> setup, objects, start;
+   build_hierarchy(setup, objects, start);
    // Create all the logic gate classes
    for(std::set<cpp_class_type>::iterator it = design_logic.begin();
          it != design_logic.end(); it++)
    {
-      only_remember_class(new cppClass(*it), false);
+      cppClass* logic_class = new cppClass(*it);
+      if(*it == CPP_CLASS_CLUSTER)
+         logic_class->reserve_state(cluster_state_words());
+      only_remember_class(logic_class, false);
    }
-   context->add_stmt(build_hierarchy());
+   context->add_setup(setup);
+   context->add_stmt(objects);
+   for(std::list<cpp_stmt*>::iterator it = start.begin(); it != start.end(); it++)
+      context->add_start(*it);
+}
+
+/*
+ * The statements of every file building the design with -psplit=N,
+ * 0 when the design goes to a single file.
+ */
+unsigned split_output_size()
+{
+   const char* size = get_design_flag("split");
+   return strtoul(size, NULL, 10);
+}
+
+void declare_global(cpp_var* var)
+{
+   context->add_global(var);
 }
 
 // TODO: Can we dispose of this???
@@ -186,29 +268,11 @@ ivl_signal_t find_signal_named(const std::string &name, const cpp_scope *scope)
    return NULL;
 }
 
-// Compare the name of a class against a string
-struct cmp_ent_name {
-   cmp_ent_name(const string& n) : name_(n) {}
-
-   bool operator()(const cppClass* ent) const
-   {
-      return ent->get_name() == name_;
-   }
-
-   const string& name_;
-};
-
 // Find a class given its name.
 cppClass* find_class(const string& name)
 {
-   std::list<cppClass*>::const_iterator it
-      = find_if(g_classes.begin(), g_classes.end(),
-                cmp_ent_name(name));
-
-   if (it != g_classes.end())
-      return *it;
-   else
-      return NULL;
+   std::map<std::string, cppClass*>::const_iterator it = g_class_names.find(name);
+   return it == g_class_names.end() ? NULL : it->second;
 }
 
 // Find a C++ class given a Verilog module scope. The C++ class
@@ -231,14 +295,13 @@ cppClass* find_class(ivl_scope_t scope)
          return NULL;
    }
    else {
-      const char *tname = ivl_scope_tname(scope);
-
-      for (map<ivl_scope_t, string>::iterator it = g_scope_names.begin();
-           it != g_scope_names.end(); ++it) {
-         if (strcmp(tname, ivl_scope_tname((*it).first)) == 0)
-            return find_class((*it).second);
-      }
-
+      // The class of the default instance with the same parameters
+      map<ivl_scope_t, ivl_scope_t>::iterator def = g_default_of_scope.find(scope);
+      if (def == g_default_of_scope.end())
+         return NULL;
+      map<ivl_scope_t, string>::iterator it = g_scope_names.find(def->second);
+      if (it != g_scope_names.end())
+         return find_class((*it).second);
       return NULL;
    }
 }
@@ -247,6 +310,7 @@ cppClass* find_class(ivl_scope_t scope)
 void remember_class(cppClass* theclass, ivl_scope_t scope)
 {
    g_classes.push_back(theclass);
+   g_class_names[theclass->get_name()] = theclass;
    g_scope_names[scope] = theclass->get_name();
    remember_hierarchy(theclass);
 }
@@ -267,6 +331,169 @@ void emit_everything(std::ostream& os)
    context->emit_after_classes(os);
 }
 
+/*
+ * The split output is made of files named after the output one: the
+ * common part of their names is the output name without extension.
+ */
+static std::string split_base_name(const std::string& ofname)
+{
+   std::string::size_type dot = ofname.rfind('.');
+   std::string::size_type slash = ofname.rfind('/');
+   if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+      return ofname;
+   return ofname.substr(0, dot);
+}
+
+static std::string file_name_only(const std::string& path)
+{
+   std::string::size_type slash = path.rfind('/');
+   return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+// A name made of letters, digits and underscores only.
+static std::string identifier_of(const std::string& name)
+{
+   std::string ident(name);
+   for (std::string::iterator it = ident.begin(); it != ident.end(); it++)
+      if (!isalnum((unsigned char)*it))
+         *it = '_';
+   return ident;
+}
+
+/*
+ * A file is rewritten only if its contents changed, so that make
+ * rebuilds the parts of the design that really changed.
+ */
+static void write_if_changed(const std::string& path, const std::string& contents)
+{
+   ifstream old_file(path.c_str(), ios::in | ios::binary);
+   if (old_file) {
+      ostringstream old_contents;
+      old_contents << old_file.rdbuf();
+      if (old_contents.str() == contents)
+         return;
+   }
+   ofstream new_file(path.c_str(), ios::out | ios::binary);
+   new_file << contents;
+   if (!new_file)
+      error("Cannot write the file %s", path.c_str());
+}
+
+static void open_header(std::ostream& os, const std::string& name)
+{
+   std::string guard = "INC_" + identifier_of(name);
+   for (std::string::iterator it = guard.begin(); it != guard.end(); it++)
+      *it = toupper((unsigned char)*it);
+   os << "#ifndef " << guard << endl
+      << "#define " << guard << endl;
+}
+
+/*
+ * Print the classes to a header and a source file each and the
+ * statements building the design to files of at most split_size
+ * statements: every file is compiled on its own, in parallel with
+ * the others. <base>.mk is a Makefile fragment to build them all.
+ */
+void emit_split(const std::string& ofname, const std::string& banner)
+{
+   unsigned part_size = split_output_size();
+   assert(part_size > 0);
+   std::string base = split_base_name(ofname);
+   std::string base_name = file_name_only(base);
+   std::list<std::string> sources, headers;
+   std::map<std::string, std::string> dependencies;
+
+   // The basic classes are included by all the others
+   std::string basic_headers, basic_deps;
+   for (entity_list_t::iterator it = g_classes.begin();
+        it != g_classes.end();
+        ++it) {
+      std::string name = base_name + "_" + (*it)->get_name();
+      ostringstream header;
+      header << banner;
+      open_header(header, name + ".hh");
+      context->emit_before_classes(header);
+      header << basic_headers;
+      (*it)->emit_declaration(header);
+      header << "#endif" << endl;
+      write_if_changed(base + "_" + (*it)->get_name() + ".hh", header.str());
+
+      ostringstream source;
+      source << banner << "#include \"" << name << ".hh\"" << endl;
+      (*it)->emit_definitions(source);
+      write_if_changed(base + "_" + (*it)->get_name() + ".cc", source.str());
+
+      sources.push_back(name + ".cc");
+      dependencies[name + ".cc"] = name + ".hh" + basic_deps;
+      headers.push_back(name + ".hh");
+      if ((*it)->get_inherited() != CPP_INHERIT_BASE_CLASS) {
+         basic_headers += "#include \"" + name + ".hh\"\n";
+         basic_deps += " " + name + ".hh";
+      }
+   }
+
+   // The objects of the design and the functions that build them
+   std::string objects_name = base_name + "_objects.hh";
+   ostringstream objects;
+   objects << banner;
+   open_header(objects, objects_name);
+   for (std::list<std::string>::iterator it = headers.begin(); it != headers.end(); ++it)
+      objects << "#include \"" << *it << "\"" << endl;
+   context->emit_globals_declaration(objects);
+   objects << "#endif" << endl;
+   write_if_changed(base + "_objects.hh", objects.str());
+   headers.push_back(objects_name);
+
+   std::string all_headers;
+   for (std::list<std::string>::iterator it = headers.begin(); it != headers.end(); ++it)
+      all_headers += " " + *it;
+
+   unsigned parts = context->build_parts(part_size);
+   for (unsigned part = 0; part < parts; part++) {
+      ostringstream name;
+      name << base_name << "_build_" << part << ".cc";
+      ostringstream source;
+      source << banner << "#include \"" << objects_name << "\"" << endl;
+      context->emit_build_part(source, part, part_size);
+      ostringstream path;
+      path << base << "_build_" << part << ".cc";
+      write_if_changed(path.str(), source.str());
+      sources.push_back(name.str());
+   }
+
+   ostringstream main_file;
+   main_file << banner << "#include \"" << objects_name << "\"" << endl;
+   context->emit_split_main(main_file, part_size);
+   main_file << endl;
+   write_if_changed(ofname, main_file.str());
+   sources.push_back(file_name_only(ofname));
+
+   // The Makefile fragment: the classes depend on their own headers,
+   // the rest of the files on all of them.
+   std::string var = identifier_of(base_name);
+   ostringstream mk;
+   mk << "# Makefile fragment to build " << base_name << ": include it in a" << endl
+      << "# Makefile that sets CXX, CXXFLAGS and LDFLAGS and run make -j." << endl
+      << var << "_SRCS =";
+   for (std::list<std::string>::iterator it = sources.begin(); it != sources.end(); ++it)
+      mk << " \\" << endl << "\t" << *it;
+   mk << endl
+      << var << "_OBJS = $(" << var << "_SRCS:.cc=.o)" << endl << endl
+      << base_name << ": $(" << var << "_OBJS)" << endl
+      << "\t$(CXX) $(CXXFLAGS) -o $@ $(" << var << "_OBJS) $(LDFLAGS)" << endl << endl;
+   for (std::list<std::string>::iterator it = sources.begin(); it != sources.end(); ++it) {
+      std::string object = it->substr(0, it->rfind('.')) + ".o";
+      std::map<std::string, std::string>::iterator dep = dependencies.find(*it);
+      mk << object << ": " << *it;
+      if (dep != dependencies.end())
+         mk << " " << dep->second;
+      else
+         mk << all_headers;
+      mk << endl;
+   }
+   write_if_changed(base + ".mk", mk.str());
+}
+
 // Release all memory for the C++ objects.
 void free_all_cpp_objects()
 {
@@ -274,9 +501,11 @@ void free_all_cpp_objects()
    debug_msg("Deallocated %d C++ syntax objects", freed);
 
    size_t total = cpp_element::total_allocated();
-   debug_msg("%d total bytes used for C++ syntax objects", total);
+   debug_msg("%lu total bytes used for C++ syntax objects",
+             (unsigned long)total);
 
    g_classes.clear();
+   g_class_names.clear();
 }
 
 // Return the currently active entity
@@ -292,42 +521,34 @@ void set_active_class(cppClass *ent)
 }
 
 /*
- * True if two scopes have the same type name.
+ * The type name of a scope and the names and values of its
+ * parameters: two scopes of the same type have the same signature.
+ * A length prefix keeps apart strings that would concatenate the
+ * same way.
  */
-static bool same_scope_type_name(ivl_scope_t a, ivl_scope_t b)
+static string scope_type_signature(ivl_scope_t s)
 {
-   if (strcmp(ivl_scope_tname(a), ivl_scope_tname(b)) != 0)
-      return false;
-
-   unsigned nparams_a = ivl_scope_params(a);
-   unsigned nparams_b = ivl_scope_params(b);
-
-   if (nparams_a != nparams_b)
-      return false;
-
-   for (unsigned i = 0; i < nparams_a; i++) {
-      ivl_parameter_t param_a = ivl_scope_param(a, i);
-      ivl_parameter_t param_b = ivl_scope_param(b, i);
-
-      if (strcmp(ivl_parameter_basename(param_a),
-                 ivl_parameter_basename(param_b)) != 0)
-         return false;
-
-      ivl_expr_t value_a = ivl_parameter_expr(param_a);
-      ivl_expr_t value_b = ivl_parameter_expr(param_b);
-
-      if (ivl_expr_type(value_a) != ivl_expr_type(value_b))
-         return false;
-
-      switch (ivl_expr_type(value_a)) {
+   ostringstream ss;
+   const char *tname = ivl_scope_tname(s);
+   ss << strlen(tname) << ":" << tname;
+
+   unsigned nparams = ivl_scope_params(s);
+   for (unsigned i = 0; i < nparams; i++) {
+      ivl_parameter_t param = ivl_scope_param(s, i);
+      const char *name = ivl_parameter_basename(param);
+      ss << "," << strlen(name) << ":" << name;
+
+      ivl_expr_t value = ivl_parameter_expr(param);
+      switch (ivl_expr_type(value)) {
          case IVL_EX_STRING:
-            if (strcmp(ivl_expr_string(value_a), ivl_expr_string(value_b)) != 0)
-               return false;
+            {
+               const char *str = ivl_expr_string(value);
+               ss << "=s" << strlen(str) << ":" << str;
+            }
             break;
 
          case IVL_EX_NUMBER:
-            if (ivl_expr_uvalue(value_a) != ivl_expr_uvalue(value_b))
-               return false;
+            ss << "=n" << ivl_expr_uvalue(value);
             break;
 
       default:
@@ -335,7 +556,7 @@ static bool same_scope_type_name(ivl_scope_t a, ivl_scope_t b)
       }
    }
 
-   return true;
+   return ss.str();
 }
 
 /*
@@ -345,10 +566,11 @@ static bool same_scope_type_name(ivl_scope_t a, ivl_scope_t b)
  */
 bool seen_this_scope_type(ivl_scope_t s)
 {
-   if (find_if(g_default_scopes.begin(), g_default_scopes.end(),
-               bind1st(ptr_fun(same_scope_type_name), s))
-       == g_default_scopes.end()) {
-      g_default_scopes.push_back(s);
+   pair<map<string, ivl_scope_t>::iterator, bool> type =
+      g_scope_types.insert(make_pair(scope_type_signature(s), s));
+   g_default_of_scope[s] = type.first->second;
+   if (type.second) {
+      g_default_scopes.insert(s);
       return false;
    }
    else
@@ -361,6 +583,5 @@ bool seen_this_scope_type(ivl_scope_t s)
  */
 bool is_default_scope_instance(ivl_scope_t s)
 {
-   return find(g_default_scopes.begin(), g_default_scopes.end(), s)
-      != g_default_scopes.end();
+   return g_default_scopes.find(s) != g_default_scopes.end();
 }
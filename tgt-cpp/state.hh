@@ -37,6 +37,7 @@ const std::string &get_renamed_signal(ivl_signal_t sig);
 ivl_signal_t find_signal_named(const std::string &name, const cpp_scope *scope);
 
 void remember_logic(cpp_class_type type);
+unsigned remember_udp(ivl_udp_t udp);
 void remember_class(cppClass *ent, ivl_scope_t scope);
 cppClass* find_class(ivl_scope_t scope);
 cppClass* find_class(const std::string& name);
@@ -44,6 +45,9 @@ cppClass* find_class(const std::string& name);
 void build_basic_classes();
 void build_net();
 void emit_everything(std::ostream& os);
+unsigned split_output_size();
+void declare_global(cpp_var* var);
+void emit_split(const std::string& ofname, const std::string& banner);
 void free_all_cpp_objects();
 
 cppClass *get_active_class();
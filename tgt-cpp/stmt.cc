@@ -76,9 +76,12 @@ void make_assignment(ivl_statement_t stmt)
    ivl_expr_type_t type = ivl_expr_type(rval);
    // FIXME: strong assumption here
    assert(type == IVL_EX_NUMBER);
-   assert(ivl_expr_width(rval) == 1);
-   assert(ivl_expr_bits(rval)[0] == '1' || ivl_expr_bits(rval)[0] == '0');
-   boost::tribool value = (ivl_expr_bits(rval)[0] == '1') ? true : false;
+   // The bits of the number are LSB first, the generated code
+   // wants them MSB first like a Verilog literal.
+   unsigned width = ivl_expr_width(rval);
+   const char* bits = ivl_expr_bits(rval);
+   std::string value(bits, width);
+   std::reverse(value.begin(), value.end());
 
    cpp_var_ref *lhs = lvals.front();
    cppClass *thisclass = get_active_class();
@@ -165,3 +168,227 @@ int draw_stmt(ivl_statement_t stmt)
          return 1;
    }
 }
+
+/*
+ * The statements of an always block become statements of the member
+ * function of the process, see cppClass::add_process.
+ */
+
+// The value of a constant expression, false if it is not constant
+static bool constant_value(ivl_expr_t e, unsigned long *value)
+{
+   switch (ivl_expr_type(e)) {
+      case IVL_EX_ULONG:
+         *value = ivl_expr_uvalue(e);
+         return true;
+      case IVL_EX_NUMBER:
+         {
+            const char *bits = ivl_expr_bits(e);
+            *value = 0;
+            for (unsigned i = ivl_expr_width(e); i > 0; i--) {
+               if (bits[i - 1] != '0' && bits[i - 1] != '1')
+                  return false;
+               *value = (*value << 1) | (bits[i - 1] == '1');
+            }
+            return true;
+         }
+      default:
+         return false;
+   }
+}
+
+/*
+ * The l-values are whole signals. With several l-values, as in
+ * {a, b} = c, the first one takes the least significant bits.
+ */
+static int draw_process_assign(ivl_statement_t stmt, list<cpp_stmt*> &body,
+                               bool blocking)
+{
+   unsigned long delay = 1;
+   ivl_expr_t delay_expr = ivl_stmt_delay_expr(stmt);
+   if (delay_expr) {
+      if (blocking || !constant_value(delay_expr, &delay)) {
+         error("Only constant delays of nonblocking assignments are "
+               "supported (%s:%d)", ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+         return 1;
+      }
+      if (delay == 0)
+         delay = 1;
+   }
+
+   cpp_expr *rhs = translate_expr(ivl_stmt_rval(stmt));
+   if (NULL == rhs)
+      return 1;
+
+   cppClass *thisclass = get_active_class();
+   unsigned nlvals = ivl_stmt_lvals(stmt);
+   unsigned offset = 0;
+   for (unsigned i = 0; i < nlvals; i++) {
+      ivl_lval_t lval = ivl_stmt_lval(stmt, i);
+      ivl_signal_t sig = ivl_lval_sig(lval);
+      if (!sig || ivl_lval_idx(lval) || ivl_lval_part_off(lval)
+          || ivl_lval_width(lval) != ivl_signal_width(sig)) {
+         error("Only whole signals are supported as l-values (%s:%d)",
+               ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+         return 1;
+      }
+
+      cpp_expr *value = rhs;
+      if (nlvals > 1) {
+         std::ostringstream lsb, width;
+         lsb << offset;
+         width << ivl_lval_width(lval);
+         cpp_fcall_stmt *part = new cpp_fcall_stmt(rhs->get_type(), rhs, "part");
+         part->add_param(new cpp_const_expr(lsb.str().c_str(), CPP_TYPE_UNSIGNED_INT));
+         part->add_param(new cpp_const_expr(width.str().c_str(), CPP_TYPE_UNSIGNED_INT));
+         value = part;
+      }
+      offset += ivl_lval_width(lval);
+
+      const std::string &signame = get_renamed_signal(sig);
+      if (blocking)
+         body.push_back(thisclass->make_blocking_assign(signame, value));
+      else
+         body.push_back(thisclass->make_scheduled_assign(signame, value, delay));
+   }
+   return 0;
+}
+
+static int draw_process_block(ivl_statement_t stmt, list<cpp_stmt*> &body)
+{
+   ivl_scope_t block_scope = ivl_stmt_block_scope(stmt);
+   if (block_scope && ivl_scope_sigs(block_scope) > 0) {
+      error("Signals declared in named blocks are not supported (%s:%d)",
+            ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+      return 1;
+   }
+
+   int count = ivl_stmt_block_count(stmt);
+   for (int i = 0; i < count; i++) {
+      if (draw_process_stmt(ivl_stmt_block_stmt(stmt, i), body) != 0)
+         return 1;
+   }
+   return 0;
+}
+
+// The condition of an if is true if some bit is 1
+static cpp_expr *make_condition(cpp_expr *value)
+{
+   cpp_fcall_stmt *test =
+      new cpp_fcall_stmt(new cpp_type(CPP_TYPE_BOOL),
+                         new cpp_const_expr("ivl::is_true", CPP_TYPE_NOTYPE), "");
+   test->add_param(value);
+   return test;
+}
+
+static int draw_process_condit(ivl_statement_t stmt, list<cpp_stmt*> &body)
+{
+   cpp_expr *cond = translate_expr(ivl_stmt_cond_expr(stmt));
+   if (NULL == cond)
+      return 1;
+
+   cpp_if *if_stmt = new cpp_if(make_condition(cond));
+   list<cpp_stmt*> then_part, else_part;
+   ivl_statement_t true_stmt = ivl_stmt_cond_true(stmt);
+   ivl_statement_t false_stmt = ivl_stmt_cond_false(stmt);
+   if (true_stmt && draw_process_stmt(true_stmt, then_part) != 0)
+      return 1;
+   if (false_stmt && draw_process_stmt(false_stmt, else_part) != 0)
+      return 1;
+
+   for (list<cpp_stmt*>::iterator it = then_part.begin(); it != then_part.end(); ++it)
+      if_stmt->add_to_body(*it);
+   for (list<cpp_stmt*>::iterator it = else_part.begin(); it != else_part.end(); ++it)
+      if_stmt->add_to_else_body(*it);
+   body.push_back(if_stmt);
+   return 0;
+}
+
+/*
+ * A case statement becomes a chain of if statements comparing the
+ * value with ===, in the order of the items. The default item, if
+ * any, is the last else.
+ */
+static int draw_process_case(ivl_statement_t stmt, list<cpp_stmt*> &body)
+{
+   ivl_expr_t test = ivl_stmt_cond_expr(stmt);
+   ivl_statement_t default_stmt = NULL;
+   cpp_if *first = NULL, *last = NULL;
+
+   unsigned count = ivl_stmt_case_count(stmt);
+   for (unsigned i = 0; i < count; i++) {
+      ivl_expr_t item = ivl_stmt_case_expr(stmt, i);
+      ivl_statement_t item_stmt = ivl_stmt_case_stmt(stmt, i);
+      if (NULL == item) {
+         default_stmt = item_stmt;
+         continue;
+      }
+
+      cpp_expr *value = translate_expr(test);
+      cpp_expr *item_value = translate_expr(item);
+      if (NULL == value || NULL == item_value)
+         return 1;
+      cpp_fcall_stmt *match =
+         new cpp_fcall_stmt(new cpp_type(CPP_TYPE_IVL_LOGIC),
+                            new cpp_const_expr("ivl::case_equal", CPP_TYPE_NOTYPE), "");
+      match->add_param(value);
+      match->add_param(item_value);
+
+      cpp_if *if_stmt = new cpp_if(make_condition(match));
+      list<cpp_stmt*> item_body;
+      if (draw_process_stmt(item_stmt, item_body) != 0)
+         return 1;
+      for (list<cpp_stmt*>::iterator it = item_body.begin(); it != item_body.end(); ++it)
+         if_stmt->add_to_body(*it);
+
+      if (last)
+         last->add_to_else_body(if_stmt);
+      else
+         first = if_stmt;
+      last = if_stmt;
+   }
+
+   list<cpp_stmt*> default_body;
+   if (default_stmt && draw_process_stmt(default_stmt, default_body) != 0)
+      return 1;
+   for (list<cpp_stmt*>::iterator it = default_body.begin(); it != default_body.end(); ++it) {
+      if (last)
+         last->add_to_else_body(*it);
+      else
+         body.push_back(*it);
+   }
+
+   if (first)
+      body.push_back(first);
+   return 0;
+}
+
+int draw_process_stmt(ivl_statement_t stmt, list<cpp_stmt*> &body)
+{
+   assert(stmt);
+
+   switch (ivl_statement_type(stmt)) {
+      case IVL_ST_BLOCK:
+         return draw_process_block(stmt, body);
+      case IVL_ST_ASSIGN:
+         return draw_process_assign(stmt, body, true);
+      case IVL_ST_ASSIGN_NB:
+         return draw_process_assign(stmt, body, false);
+      case IVL_ST_CONDIT:
+         return draw_process_condit(stmt, body);
+      case IVL_ST_CASE:
+         return draw_process_case(stmt, body);
+      case IVL_ST_NOOP:
+         return 0;
+      case IVL_ST_DELAY:
+      case IVL_ST_DELAYX:
+         error("Delays inside if and case statements are not supported (%s:%d)",
+               ivl_stmt_file(stmt), ivl_stmt_lineno(stmt));
+         return 1;
+      default:
+         error("No translation for statement in always block at %s:%d (type = %d)",
+               ivl_stmt_file(stmt), ivl_stmt_lineno(stmt),
+               ivl_statement_type(stmt));
+         return 1;
+   }
+}
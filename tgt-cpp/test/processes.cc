@@ -0,0 +1,129 @@
+/*
+ * Check the code generated for always blocks. The processes are
+ * built with the same calls process.cc and stmt.cc make, the code is
+ * written to the standard output with a main that runs it on the
+ * bundled kernel and prints the signals at the end:
+ *
+ *    always #5 clk = ~clk;
+ *    always @(posedge clk) begin cnt = cnt + 1; #15 q = cnt; end
+ *    always @(posedge clk) begin a = ~a; b = ~b; end
+ *    always @(a or b) n = n + 1;
+ *    always @(a or y) begin y = 0; y = y | a; end
+ *
+ * The delay of 15 is longer than the clock period: the posedges at
+ * 15 and 35 find the process suspended. The last two blocks run once
+ * for the changes of a and b, and do not wake themselves.
+ */
+#include "cpp_target.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <map>
+
+static std::map<std::string, cppClass*> classes;
+
+void error(const char *fmt, ...)
+{
+   va_list args;
+   va_start(args, fmt);
+   vfprintf(stderr, fmt, args);
+   va_end(args);
+   fputc('\n', stderr);
+}
+
+cppClass* find_class(const std::string& name)
+{
+   std::map<std::string, cppClass*>::const_iterator it = classes.find(name);
+   return it == classes.end() ? NULL : it->second;
+}
+
+static cppClass* remember(cppClass* theclass)
+{
+   classes[theclass->get_name()] = theclass;
+   return theclass;
+}
+
+static cpp_expr* constant(const char* bits)
+{
+   std::string value("ivl::logic_vector(\"");
+   value += bits;
+   value += "\")";
+   return new cpp_const_expr(value.c_str(), CPP_TYPE_NOTYPE);
+}
+
+static cpp_expr* binop(cpp_binop_t op, cpp_expr* l, cpp_expr* r)
+{
+   cpp_binop_expr* expr = new cpp_binop_expr(op, new cpp_type(CPP_TYPE_IVL_LOGIC));
+   expr->add_expr(l);
+   expr->add_expr(r);
+   return expr;
+}
+
+static cpp_expr* invert(cpp_expr* value)
+{
+   return new cpp_unaryop_expr(CPP_UNARYOP_BIT_NOT, value, new cpp_type(CPP_TYPE_IVL_LOGIC));
+}
+
+int main()
+{
+   std::cout << "#include <cassert>\n#include <iostream>\n#include <map>\n"
+                "#include <vector>\n#include <ivl_kernel.hpp>\n#include <ivl_logic.hpp>\n";
+   remember(new cppClass(BASE_CLASS_NAME, CPP_INHERIT_SIM_OBJ))->emit(std::cout);
+   remember(new cppClass(CUSTOM_EVENT_CLASS_NAME, CPP_INHERIT_EVENT))->emit(std::cout);
+   cppClass* top = remember(new cppClass("top"));
+   const char* names[] = { "clk", "a", "b", "y", "cnt", "q", "n" };
+   for (unsigned i = 0; i < sizeof names / sizeof names[0]; i++)
+      top->add_to_inputs(new cpp_var(names[i], CPP_TYPE_IVL_LOGIC), i < 4 ? 1 : 4);
+
+   sensitivity_list_t no_events, posedge_clk, a_or_b, a_or_y;
+   posedge_clk.push_back(std::make_pair(std::string("clk"), CPP_EDGE_POS));
+   a_or_b.push_back(std::make_pair(std::string("a"), CPP_EDGE_ANY));
+   a_or_b.push_back(std::make_pair(std::string("b"), CPP_EDGE_ANY));
+   a_or_y.push_back(std::make_pair(std::string("a"), CPP_EDGE_ANY));
+   a_or_y.push_back(std::make_pair(std::string("y"), CPP_EDGE_ANY));
+
+   process_steps_t steps(2);
+   steps[1].first = 5;
+   steps[1].second.push_back(top->make_blocking_assign("clk", invert(top->make_signal_read("clk"))));
+   top->add_process(no_events, steps);
+
+   steps.assign(2, process_steps_t::value_type());
+   steps[0].second.push_back(top->make_blocking_assign("cnt",
+            binop(CPP_BINOP_ADD, top->make_signal_read("cnt"), constant("0001"))));
+   steps[1].first = 15;
+   steps[1].second.push_back(top->make_blocking_assign("q", top->make_signal_read("cnt")));
+   top->add_process(posedge_clk, steps);
+
+   steps.assign(1, process_steps_t::value_type());
+   steps[0].second.push_back(top->make_blocking_assign("a", invert(top->make_signal_read("a"))));
+   steps[0].second.push_back(top->make_blocking_assign("b", invert(top->make_signal_read("b"))));
+   top->add_process(posedge_clk, steps);
+
+   steps.assign(1, process_steps_t::value_type());
+   steps[0].second.push_back(top->make_blocking_assign("n",
+            binop(CPP_BINOP_ADD, top->make_signal_read("n"), constant("0001"))));
+   top->add_process(a_or_b, steps);
+
+   steps.assign(1, process_steps_t::value_type());
+   steps[0].second.push_back(top->make_blocking_assign("y", constant("0")));
+   steps[0].second.push_back(top->make_blocking_assign("y",
+            binop(CPP_BINOP_BIT_OR, top->make_signal_read("y"), top->make_signal_read("a"))));
+   top->add_process(a_or_y, steps);
+   top->emit(std::cout);
+
+   std::cout << "\n"
+      "int main(int argc, const char** argv) {\n"
+      "   warped::Simulation simulation(\"processes\", argc, argv);\n"
+      "   top object(\"top\");\n"
+      "   const char* zero[] = { \"clk\", \"a\", \"b\", \"cnt\", \"n\" };\n"
+      "   for (unsigned i = 0; i < 5; i++)\n"
+      "      object.signals_.set(zero[i], ivl::logic_vector(object.signals_.at(zero[i]).size(), '0'));\n"
+      "   simulation.simulate(std::vector<warped::SimulationObject*>(1, &object));\n"
+      "   const char* names[] = { \"clk\", \"a\", \"b\", \"y\", \"cnt\", \"q\", \"n\" };\n"
+      "   for (unsigned i = 0; i < 7; i++)\n"
+      "      std::cout << names[i] << \"=\" << object.signals_.at(names[i]) << std::endl;\n"
+      "   return 0;\n"
+      "}\n";
+   return 0;
+}
@@ -36,6 +36,14 @@ class NetScope;
  */
 extern bool load_module(const char*type);
 
+/*
+ * Start preprocessing the library file for a module type ahead of the
+ * load_module call that will parse it. The cleanup function discards
+ * any prefetched files that turned out not to be needed.
+ */
+extern void prefetch_module(const char*type);
+extern void prefetch_module_cleanup(void);
+
 
 
 struct attrib_list_t {
@@ -84,6 +84,8 @@ static void my_mcd_rawwrite(PLI_UINT32 mcd, const char*buf, size_t count)
 
 struct timeformat_info_s timeformat_info = { 0, 0, 0, 20 };
 
+struct display_cache;
+
 struct strobe_cb_info {
       const char*name;
       char*filename;
@@ -93,8 +95,124 @@ struct strobe_cb_info {
       vpiHandle*items;
       unsigned nitems;
       unsigned fd_mcd;
+	/* The compiled call site, if any. Its items match the items
+	   above, so the argument kinds need not be looked up again. */
+      const struct display_cache*cache;
+};
+
+/*
+ * The formatted text is collected in one of these. The buffer only
+ * grows, so a call site that keeps its buffer stops allocating once
+ * it has seen its longest line. The text may hold NULL characters
+ * (%u and %z) so the size is kept separately. There is always room
+ * for a trailing '\0'.
+ */
+struct display_buf {
+      char*text;
+      unsigned size;
+      unsigned alloc;
+};
+
+static char* display_buf_reserve(struct display_buf*buf, unsigned cnt)
+{
+      if (buf->size + cnt + 1 > buf->alloc) {
+	    unsigned alloc = buf->alloc ? buf->alloc : 256;
+	    while (buf->size + cnt + 1 > alloc) alloc *= 2;
+	    buf->text = realloc(buf->text, alloc*sizeof(char));
+	    buf->alloc = alloc;
+      }
+      return buf->text + buf->size;
+}
+
+static void display_buf_append(struct display_buf*buf, const char*data,
+                               unsigned cnt)
+{
+      char*cp = display_buf_reserve(buf, cnt);
+      memcpy(cp, data, cnt);
+      buf->size += cnt;
+      buf->text[buf->size] = '\0';
+}
+
+/* Append a string padded on the left to at least width characters. */
+static void display_buf_pad(struct display_buf*buf, const char*str,
+                            unsigned width)
+{
+      unsigned len = strlen(str);
+      unsigned pad = len < width ? width - len : 0;
+      char*cp = display_buf_reserve(buf, pad + len);
+      memset(cp, ' ', pad);
+      memcpy(cp + pad, str, len);
+      buf->size += pad + len;
+      buf->text[buf->size] = '\0';
+}
+
+/*
+ * A format string is a list of literal text runs and format codes.
+ * A format that is a string constant is parsed once per call site
+ * into an array of these, other formats are parsed as they are
+ * used.
+ */
+struct format_op {
+	/* The literal text, or nil for a format code. */
+      const char*text;
+      unsigned len;
+      int ljust, plus, ld_zero, width, prec;
+      char fmt;
+};
+
+/*
+ * The way get_display handles an argument only depends on the kind
+ * of the argument, so the kind is worked out once per call site.
+ */
+enum display_kind {
+      DISPLAY_FORMAT,       /* String constant: a format string.  */
+      DISPLAY_REAL,         /* Real constant or variable.         */
+      DISPLAY_NUMERIC,      /* Vector or integer value.           */
+      DISPLAY_TIME_VAR,     /* Time variable.                     */
+      DISPLAY_STRING_VAR,   /* String variable: a format string.  */
+      DISPLAY_TIME,         /* $time or $simtime.                 */
+      DISPLAY_STIME,        /* $stime.                            */
+      DISPLAY_REALTIME,     /* $realtime.                         */
+      DISPLAY_SYSFUNC,      /* Any other system function.         */
+      DISPLAY_UNKNOWN
+};
+
+struct display_item {
+      enum display_kind kind;
+	/* The value is printed as a real by %t. */
+      int time_real;
+	/* The default decimal width of a numeric value, or -1. */
+      int dec_size;
+	/* The parsed format of a string constant. */
+      char*fmt;
+      struct format_op*ops;
+      unsigned nops;
 };
 
+/*
+ * The compiled form of a call site. It is made by the first call and
+ * kept with vpi_put_userdata, the arguments of a call site do not
+ * change from one call to the next. The items skip the leading
+ * arguments that are not displayed (file descriptor, output
+ * register and so on).
+ */
+struct display_cache {
+      char*filename;
+      int lineno;
+      vpiHandle scope;
+      vpiHandle*args;
+      struct display_item*kinds;
+      unsigned nargs;
+      unsigned skip;
+      PLI_INT32 time_units;
+      int realtime_prec;
+      struct display_buf buf;
+      int busy;
+      struct display_cache*next;
+};
+
+static struct display_cache*display_cache_list = 0;
+
 /*
  * The number of decimal digits needed to represent a
  * nr_bits binary number is floor(nr_bits*log_10(2))+1,
@@ -187,12 +305,12 @@ static int get_default_format(const char *name)
 
 /* Build the format using the variables that control how the item will
  * be printed. This is used in error messages and directly by the e/f/g
- * format codes (minus the enclosing <>). The user needs to free the
- * returned string. */
-static char * format_as_string(int ljust, int plus, int ld_zero, int width,
-                               int prec, char fmt)
+ * format codes (minus the enclosing <>). The format is written to buf,
+ * which must hold FORMAT_AS_STRING_SIZE characters. */
+#define FORMAT_AS_STRING_SIZE 64
+static void format_as_string(char *buf, int ljust, int plus, int ld_zero,
+                             int width, int prec, char fmt)
 {
-  char buf[256];
   unsigned int size = 0;
 
   /* Do not remove/change the "<" without also changing the e/f/g format
@@ -210,7 +328,6 @@ static char * format_as_string(int ljust, int plus, int ld_zero, int width,
   /* The same goes here ">"! */
   buf[size++] = '>';
   buf[size] = '\0';
-  return strdup(buf);
 }
 
 static void get_time(char *rtn, const char *value, int prec,
@@ -292,13 +409,47 @@ static void get_time_real(char *rtn, double value, int prec,
   sprintf(rtn, "%0.*f%s", prec, value, timeformat_info.suff);
 }
 
-static unsigned int get_format_char(char **rtn, int ljust, int plus,
-                                    int ld_zero, int width, int prec,
-                                    char fmt, const struct strobe_cb_info *info,
-                                    unsigned int *idx)
+/* Return the compiled form of an item, or nil if the call site is not
+ * compiled. */
+static const struct display_item *cached_item(const struct strobe_cb_info *info,
+                                              unsigned int idx)
+{
+  if (info->cache == 0) return 0;
+  return info->cache->kinds + info->cache->skip + idx;
+}
+
+static int get_item_dec_size(const struct strobe_cb_info *info,
+                             unsigned int idx)
+{
+  const struct display_item *item = cached_item(info, idx);
+  if (item && item->dec_size >= 0) return item->dec_size;
+  return vpi_get_dec_size(info->items[idx]);
+}
+
+static PLI_INT32 get_time_units(const struct strobe_cb_info *info)
+{
+  if (info->cache) return info->cache->time_units;
+  return vpi_get(vpiTimeUnit, info->scope);
+}
+
+/* Is the item printed as a real value by %t? */
+static int is_real_time(vpiHandle item)
+{
+  PLI_INT32 type = vpi_get(vpiType, item);
+  return ((type == vpiConstant || type == vpiParameter) &&
+          vpi_get(vpiConstType, item) == vpiRealConst) ||
+         type == vpiRealVar || (type == vpiSysFuncCall &&
+          vpi_get(vpiFuncType, item) == vpiRealFunc);
+}
+
+/* Append a single formatted item to the buffer. */
+static void get_format_char(struct display_buf *buf, int ljust, int plus,
+                            int ld_zero, int width, int prec,
+                            char fmt, const struct strobe_cb_info *info,
+                            unsigned int *idx)
 {
   s_vpi_value value;
-  char *result, *fmtb;
+  char *result, fmtb[FORMAT_AS_STRING_SIZE];
   unsigned int size;
   unsigned int ini_size = 512;  /* The initial size of the buffer. */
 
@@ -308,7 +459,7 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
 
   /* The default return value is the full format. */
   result = malloc(ini_size*sizeof(char));
-  fmtb = format_as_string(ljust, plus, ld_zero, width, prec, fmt);
+  format_as_string(fmtb, ljust, plus, ld_zero, width, prec, fmt);
   strcpy(result, fmtb);
   size = strlen(result) + 1; /* fallback value if errors */
   switch (fmt) {
@@ -485,7 +636,7 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
            * Icarus is 1 the string length will set the width of a real
            * displayed using %d. */
           if (width == -1) {
-            width = (ld_zero == 1) ? 0 : vpi_get_dec_size(info->items[*idx]);
+            width = (ld_zero == 1) ? 0 : get_item_dec_size(info, *idx);
           }
 
           /* If the default buffer is too small make it big enough. */
@@ -628,14 +779,13 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
         vpi_printf("WARNING: %s:%d: missing argument for %s%s.\n",
                    info->filename, info->lineno, info->name, fmtb);
       } else {
-        PLI_INT32 type;
+        const struct display_item *item = cached_item(info, *idx);
+        int time_real;
 
         /* Get the argument type and value. */
-        type = vpi_get(vpiType, info->items[*idx]);
-        if (((type == vpiConstant || type == vpiParameter) &&
-             vpi_get(vpiConstType, info->items[*idx]) == vpiRealConst) ||
-            type == vpiRealVar || (type == vpiSysFuncCall &&
-             vpi_get(vpiFuncType, info->items[*idx]) == vpiRealFunc)) {
+        if (item) time_real = item->time_real;
+        else time_real = is_real_time(info->items[*idx]);
+        if (time_real) {
           value.format = vpiRealVal;
         } else {
           value.format = vpiDecStrVal;
@@ -646,7 +796,7 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
                      info->filename, info->lineno, info->name, fmtb);
         } else {
           char *tbuf;
-          PLI_INT32 time_units = vpi_get(vpiTimeUnit, info->scope);
+          PLI_INT32 time_units = get_time_units(info);
           unsigned swidth, free_flag = 0;
           unsigned suff_len = strlen(timeformat_info.suff);
           char *cp;
@@ -840,269 +990,426 @@ static unsigned int get_format_char(char **rtn, int ljust, int plus,
       size = strlen(result) + 1;
       break;
   }
-  free(fmtb);
-  /* We can't use strdup here since %u and %z can insert NULL
-   * characters into the stream. */
-  *rtn = malloc(size*sizeof(char));
-  memcpy(*rtn, result, size);
+  /* We can't use the str functions here since %u and %z can insert
+   * NULL characters into the stream. */
+  display_buf_append(buf, result, size - 1);
   free(result);
-  return size - 1;
 }
 
-/* We can't use the normal str functions on the return value since
- * %u and %z can insert NULL characters into the stream. */
-static unsigned int get_format(char **rtn, char *fmt,
-                               const struct strobe_cb_info *info, unsigned int *idx)
+/* Parse the format code that follows a '%' and return the character
+ * after it. */
+static const char *parse_format_code(const char *cp, struct format_op *op)
 {
-  char *cp = fmt;
-  unsigned int size;
+  char *end;
+
+  op->text = 0;
+  op->len = 0;
+  op->ljust = 0;
+  op->plus = 0;
+  op->ld_zero = 0;
+  op->width = -1;
+  op->prec = -1;
+  while ((*cp == '-') || (*cp == '+')) {
+    if (*cp == '-') op->ljust = 1;
+    else op->plus = 1;
+    cp += 1;
+  }
+  if (*cp == '0') {
+    op->ld_zero = 1;
+    cp += 1;
+  }
+  if (isdigit((int)*cp)) {
+    op->width = strtoul(cp, &end, 10);
+    cp = end;
+  }
+  if (*cp == '.') {
+    cp += 1;
+    op->prec = strtoul(cp, &end, 10);
+    cp = end;
+  }
+  op->fmt = *cp;
+  if (*cp) cp += 1;
+  return cp;
+}
+
+/* Parse a format string into a list of literal text runs and format
+ * codes. The text runs point into fmt. */
+static struct format_op *compile_format(const char *fmt, unsigned int *nops)
+{
+  struct format_op *ops = 0;
+  unsigned int cnt = 0;
+  const char *cp = fmt;
+
+  while (*cp) {
+    ops = realloc(ops, (cnt+1)*sizeof(struct format_op));
+    size_t len = strcspn(cp, "%");
+    if (len > 0) {
+      ops[cnt].text = cp;
+      ops[cnt].len = len;
+      cp += len;
+    } else {
+      cp = parse_format_code(cp+1, ops+cnt);
+    }
+    cnt += 1;
+  }
+  *nops = cnt;
+  return ops;
+}
+
+static void run_format(struct display_buf *buf, const struct format_op *ops,
+                       unsigned int nops, const struct strobe_cb_info *info,
+                       unsigned int *idx)
+{
+  unsigned int op;
+
+  for (op = 0; op < nops; op += 1) {
+    const struct format_op *cur = ops + op;
+    if (cur->text) {
+      display_buf_append(buf, cur->text, cur->len);
+    } else {
+      get_format_char(buf, cur->ljust, cur->plus, cur->ld_zero, cur->width,
+                      cur->prec, cur->fmt, info, idx);
+    }
+  }
+}
+
+/* We can't use the normal str functions on the result since %u and %z
+ * can insert NULL characters into the stream. */
+static void get_format(struct display_buf *buf, const char *fmt,
+                       const struct strobe_cb_info *info, unsigned int *idx)
+{
+  const char *cp = fmt;
 
-  *rtn = strdup("");
-  size = 1;
   while (*cp) {
     size_t cnt = strcspn(cp, "%");
 
     if (cnt > 0) {
-      *rtn = realloc(*rtn, (size+cnt)*sizeof(char));
-      memcpy(*rtn+size-1, cp, cnt);
-      size += cnt;
+      display_buf_append(buf, cp, cnt);
       cp += cnt;
     } else {
-      int ljust = 0, plus = 0, ld_zero = 0, width = -1, prec = -1;
-      char *result;
-
-      cp += 1;
-      while ((*cp == '-') || (*cp == '+')) {
-        if (*cp == '-') ljust = 1;
-        else plus = 1;
-        cp += 1;
-      }
-      if (*cp == '0') {
-        ld_zero = 1;
-        cp += 1;
-      }
-      if (isdigit((int)*cp)) width = strtoul(cp, &cp, 10);
-      if (*cp == '.') {
-        cp += 1;
-        prec = strtoul(cp, &cp, 10);
-      }
-      cnt = get_format_char(&result, ljust, plus, ld_zero, width, prec, *cp,
-                            info, idx);
-      *rtn = realloc(*rtn, (size+cnt)*sizeof(char));
-      memcpy(*rtn+size-1, result, cnt);
-      free(result);
-      size += cnt;
-      if (*cp) cp += 1;
+      struct format_op op;
+      cp = parse_format_code(cp+1, &op);
+      get_format_char(buf, op.ljust, op.plus, op.ld_zero, op.width, op.prec,
+                      op.fmt, info, idx);
     }
   }
-  *(*rtn+size-1) = '\0';
-  return size - 1;
 }
 
-static unsigned int get_numeric(char **rtn, const struct strobe_cb_info *info,
-                                vpiHandle item)
+static void get_numeric(struct display_buf *buf,
+                        const struct strobe_cb_info *info, unsigned int idx)
 {
-  int size, min;
+  int size;
   s_vpi_value val;
 
   val.format = info->default_format;
-  vpi_get_value(item, &val);
+  vpi_get_value(info->items[idx], &val);
 
   switch(info->default_format){
     case vpiDecStrVal:
-      size = vpi_get_dec_size(item);
 	/* -1 can be represented as a one bit signed value. This returns
-	 * a size of 1 which is too small for the -1 string value so make
-	 * the string width the minimum display width. */
-      min = strlen(val.value.str);
-      if (size < min) size = min;
-      *rtn = malloc((size+1)*sizeof(char));
-      sprintf(*rtn, "%*s", size, val.value.str);
+	 * a size of 1 which is too small for the -1 string value, the
+	 * padding then makes the string width the minimum width. */
+      size = get_item_dec_size(info, idx);
+      display_buf_pad(buf, val.value.str, size);
       break;
     default:
-      *rtn = strdup(val.value.str);
+      display_buf_append(buf, val.value.str, strlen(val.value.str));
   }
+}
+
+static void get_real(char *rtn, double value)
+{
+#if !defined(__GNUC__)
+  if (compatible_flag)
+    sprintf(rtn, "%g", value);
+  else {
+    if (value == 0.0 || value == -0.0)
+      sprintf(rtn, "%.05f", value);
+    else
+      sprintf(rtn, "%#g", value);
+  }
+#else
+  sprintf(rtn, compatible_flag ? "%g" : "%#g", value);
+#endif
+}
+
+static enum display_kind get_display_kind(vpiHandle item)
+{
+  switch (vpi_get(vpiType, item)) {
+
+    case vpiConstant:
+    case vpiParameter:
+      switch (vpi_get(vpiConstType, item)) {
+        case vpiStringConst:
+          return DISPLAY_FORMAT;
+        case vpiRealConst:
+          return DISPLAY_REAL;
+        default:
+          return DISPLAY_NUMERIC;
+      }
+
+    case vpiNet:
+    case vpiReg:
+    case vpiBitVar:
+    case vpiByteVar:
+    case vpiShortIntVar:
+    case vpiIntVar:
+    case vpiLongIntVar:
+    case vpiIntegerVar:
+    case vpiMemoryWord:
+    case vpiPartSelect:
+      return DISPLAY_NUMERIC;
+
+    /* It appears that this is not currently used! A time variable is
+       passed as an integer and processed above. */
+    case vpiTimeVar:
+      return DISPLAY_TIME_VAR;
+
+    /* Realtime variables are also processed here. */
+    case vpiRealVar:
+      return DISPLAY_REAL;
+
+    /* Process string variables like string constants: interpret
+       the contained strings like format strings. */
+    case vpiStringVar:
+      return DISPLAY_STRING_VAR;
+
+    case vpiSysFuncCall: {
+      const char *func_name = vpi_get_str(vpiName, item);
+      if (strcmp(func_name, "$time") == 0) return DISPLAY_TIME;
+      if (strcmp(func_name, "$stime") == 0) return DISPLAY_STIME;
+      if (strcmp(func_name, "$simtime") == 0) return DISPLAY_TIME;
+      if (strcmp(func_name, "$realtime") == 0) return DISPLAY_REALTIME;
+      return DISPLAY_SYSFUNC;
+    }
 
-  return strlen(*rtn);
+    default:
+      return DISPLAY_UNKNOWN;
+  }
 }
 
-/* In many places we can't use the normal str functions since %u and %z
+/* Format all the items into the buffer, replacing its contents. In
+ * many places we can't use the normal str functions since %u and %z
  * can insert NULL characters into the stream. */
-static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
+static void format_display(struct display_buf *buf,
+                           const struct strobe_cb_info *info)
 {
-  char *result, *fmt, *rtn, *func_name;
-  const char *cresult;
+  char *fmt;
   s_vpi_value value;
-  unsigned int idx, size, width;
-  char buf[256];
+  unsigned int idx;
+  int use_prec;
+  char tbuf[256];
 
-  rtn = strdup("");
-  size = 1;
+  buf->size = 0;
+  display_buf_reserve(buf, 0);
+  buf->text[0] = '\0';
   for  (idx = 0; idx < info->nitems; idx += 1) {
     vpiHandle item = info->items[idx];
+    const struct display_item *citem = cached_item(info, idx);
 
-    switch (vpi_get(vpiType, item)) {
-
-      case vpiConstant:
-      case vpiParameter:
-        if (vpi_get(vpiConstType, item) == vpiStringConst) {
-          value.format = vpiStringVal;
-          vpi_get_value(item, &value);
-          fmt = strdup(value.value.str);
-          width = get_format(&result, fmt, info, &idx);
-          free(fmt);
-        } else if (vpi_get(vpiConstType, item) == vpiRealConst) {
-          value.format = vpiRealVal;
-          vpi_get_value(item, &value);
-#if !defined(__GNUC__)
-		  if(compatible_flag)
-			  sprintf(buf, "%g", value.value.real);
-		  else {
-			  if(value.value.real == 0.0 || value.value.real == -0.0)
-				  sprintf(buf, "%.05f", value.value.real);
-			  else
-				  sprintf(buf, "%#g", value.value.real);
-		  }
-#else
-          sprintf(buf, compatible_flag ? "%g" : "%#g", value.value.real);
-#endif
-          result = strdup(buf);
-          width = strlen(result);
-        } else {
-          width = get_numeric(&result, info, item);
+    switch (citem ? citem->kind : get_display_kind(item)) {
+
+      case DISPLAY_FORMAT:
+        if (citem) {
+          run_format(buf, citem->ops, citem->nops, info, &idx);
+          break;
         }
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
+        /* fallthrough */
+      case DISPLAY_STRING_VAR:
+        value.format = vpiStringVal;
+        vpi_get_value(item, &value);
+        fmt = strdup(value.value.str);
+        get_format(buf, fmt, info, &idx);
+        free(fmt);
         break;
 
-      case vpiNet:
-      case vpiReg:
-      case vpiBitVar:
-      case vpiByteVar:
-      case vpiShortIntVar:
-      case vpiIntVar:
-      case vpiLongIntVar:
-      case vpiIntegerVar:
-      case vpiMemoryWord:
-      case vpiPartSelect:
-        width = get_numeric(&result, info, item);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
+      case DISPLAY_REAL:
+        value.format = vpiRealVal;
+        vpi_get_value(item, &value);
+        get_real(tbuf, value.value.real);
+        display_buf_append(buf, tbuf, strlen(tbuf));
         break;
 
-      /* It appears that this is not currently used! A time variable is
-         passed as an integer and processed above. Hence this code has
-         only been visually checked. */
-      case vpiTimeVar:
+      case DISPLAY_NUMERIC:
+        get_numeric(buf, info, idx);
+        break;
+
+      /* This code has only been visually checked. */
+      case DISPLAY_TIME_VAR:
         value.format = vpiDecStrVal;
         vpi_get_value(item, &value);
-        get_time(buf, value.value.str, timeformat_info.prec,
-                 vpi_get(vpiTimeUnit, info->scope));
-        width = strlen(buf);
-        if (width  < timeformat_info.width) width = timeformat_info.width;
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        sprintf(rtn+size-1, "%*s", width, buf);
+        get_time(tbuf, value.value.str, timeformat_info.prec,
+                 get_time_units(info));
+        display_buf_pad(buf, tbuf, timeformat_info.width);
         break;
 
-      /* Realtime variables are also processed here. */
-      case vpiRealVar:
-        value.format = vpiRealVal;
+      case DISPLAY_TIME:
+        value.format = vpiDecStrVal;
         vpi_get_value(item, &value);
-#if !defined(__GNUC__)
-		if (compatible_flag)
-			sprintf(buf, "%g", value.value.real);
-		else {
-			if (value.value.real == 0.0 || value.value.real == -0.0)
-				sprintf(buf, "%.05f", value.value.real);
-			else
-				sprintf(buf, "%#g", value.value.real);
-		}
-#else
-        sprintf(buf, compatible_flag ? "%g" : "%#g", value.value.real);
-#endif
-        width = strlen(buf);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, buf, width);
+        display_buf_pad(buf, value.value.str, 20);
         break;
 
-       /* Process string variables like string constants: interpret
-	  the contained strings like format strings. */
-      case vpiStringVar:
-	value.format = vpiStringVal;
-	vpi_get_value(item, &value);
-	fmt = strdup(value.value.str);
-	width = get_format(&result, fmt, info, &idx);
-	free(fmt);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, result, width);
-        free(result);
-	break;
-
-      case vpiSysFuncCall:
-        func_name = vpi_get_str(vpiName, item);
-        if (strcmp(func_name, "$time") == 0) {
-          value.format = vpiDecStrVal;
-          vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 20) width = 20;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
-
-        } else if (strcmp(func_name, "$stime") == 0) {
-          value.format = vpiDecStrVal;
-          vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 10) width = 10;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
+      case DISPLAY_STIME:
+        value.format = vpiDecStrVal;
+        vpi_get_value(item, &value);
+        display_buf_pad(buf, value.value.str, 10);
+        break;
 
-        } else if (strcmp(func_name, "$simtime") == 0) {
-          value.format = vpiDecStrVal;
-          vpi_get_value(item, &value);
-          width = strlen(value.value.str);
-          if (width  < 20) width = 20;
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, value.value.str);
-
-        } else if (strcmp(func_name, "$realtime") == 0) {
-          /* Use the local scope precision. */
-          int use_prec = vpi_get(vpiTimeUnit, info->scope) -
-                         vpi_get(vpiTimePrecision, info->scope);
-          assert(use_prec >= 0);
-          value.format = vpiRealVal;
-          vpi_get_value(item, &value);
-          sprintf(buf, "%.*f", use_prec, value.value.real);
-          width = strlen(buf);
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          sprintf(rtn+size-1, "%*s", width, buf);
+      case DISPLAY_REALTIME:
+        /* Use the local scope precision. */
+        if (info->cache) use_prec = info->cache->realtime_prec;
+        else use_prec = vpi_get(vpiTimeUnit, info->scope) -
+                        vpi_get(vpiTimePrecision, info->scope);
+        assert(use_prec >= 0);
+        value.format = vpiRealVal;
+        vpi_get_value(item, &value);
+        sprintf(tbuf, "%.*f", use_prec, value.value.real);
+        display_buf_append(buf, tbuf, strlen(tbuf));
+        break;
 
-        } else {
-          vpi_printf("WARNING: %s:%d: %s does not support %s as an argument!\n",
-                     info->filename, info->lineno, info->name, func_name);
-          strcpy(buf, "<?>");
-          width = strlen(buf);
-          rtn = realloc(rtn, (size+width)*sizeof(char));
-          memcpy(rtn+size-1, buf, width);
-        }
+      case DISPLAY_SYSFUNC:
+        vpi_printf("WARNING: %s:%d: %s does not support %s as an argument!\n",
+                   info->filename, info->lineno, info->name,
+                   vpi_get_str(vpiName, item));
+        display_buf_append(buf, "<?>", 3);
         break;
 
       default:
         vpi_printf("WARNING: %s:%d: unknown argument type (%s) given to %s!\n",
                    info->filename, info->lineno, vpi_get_str(vpiType, item),
                    info->name);
-        cresult = "<?>";
-        width = strlen(cresult);
-        rtn = realloc(rtn, (size+width)*sizeof(char));
-        memcpy(rtn+size-1, cresult, width);
+        display_buf_append(buf, "<?>", 3);
         break;
     }
-    size += width;
   }
-  rtn[size-1] = '\0';
-  *rtnsz = size - 1;
-  return rtn;
+}
+
+/* The caller needs to free the returned string, *rtnsz is its size. */
+static char *get_display(unsigned int *rtnsz, const struct strobe_cb_info *info)
+{
+  struct display_buf buf = { 0, 0, 0 };
+
+  format_display(&buf, info);
+  *rtnsz = buf.size;
+  return buf.text;
+}
+
+/*
+ * Return the compiled form of the call site, making it on the first
+ * call. The first skip arguments are not displayed.
+ */
+static struct display_cache *get_display_cache(vpiHandle callh,
+                                               unsigned int skip)
+{
+      struct display_cache*cache;
+      vpiHandle argv, arg;
+      unsigned idx;
+
+      cache = (struct display_cache*)vpi_get_userdata(callh);
+      if (cache) return cache;
+
+      cache = calloc(1, sizeof(struct display_cache));
+      cache->filename = strdup(vpi_get_str(vpiFile, callh));
+      cache->lineno = (int)vpi_get(vpiLineNo, callh);
+      cache->scope = vpi_handle(vpiScope, callh);
+      assert(cache->scope);
+      cache->time_units = vpi_get(vpiTimeUnit, cache->scope);
+      cache->realtime_prec = cache->time_units -
+                             vpi_get(vpiTimePrecision, cache->scope);
+
+      argv = vpi_iterate(vpiArgument, callh);
+      if (argv) {
+	    for (arg = vpi_scan(argv) ;  arg ;  arg = vpi_scan(argv)) {
+		  cache->args = realloc(cache->args,
+		                        (cache->nargs+1)*sizeof(vpiHandle));
+		  cache->args[cache->nargs] = arg;
+		  cache->nargs += 1;
+	    }
+      }
+      cache->skip = skip < cache->nargs ? skip : cache->nargs;
+
+      cache->kinds = calloc(cache->nargs+1, sizeof(struct display_item));
+      for (idx = 0 ;  idx < cache->nargs ;  idx += 1) {
+	    struct display_item*item = cache->kinds + idx;
+	    arg = cache->args[idx];
+	    item->kind = get_display_kind(arg);
+	    item->time_real = is_real_time(arg);
+	    item->dec_size = -1;
+	    if (item->kind == DISPLAY_NUMERIC)
+		  item->dec_size = vpi_get_dec_size(arg);
+	    if (item->kind == DISPLAY_FORMAT) {
+		  s_vpi_value value;
+		  value.format = vpiStringVal;
+		  vpi_get_value(arg, &value);
+		  item->fmt = strdup(value.value.str);
+		  item->ops = compile_format(item->fmt, &item->nops);
+	    }
+      }
+
+      cache->next = display_cache_list;
+      display_cache_list = cache;
+      vpi_put_userdata(callh, cache);
+      return cache;
+}
+
+static void info_from_cache(struct strobe_cb_info*info,
+                            const struct display_cache*cache,
+                            const char*name)
+{
+	/* We could use vpi_get_str(vpiName, callh) to get the task name,
+	 * but name is already defined. */
+      info->name = name;
+      info->filename = cache->filename;
+      info->lineno = cache->lineno;
+      info->default_format = get_default_format(name);
+      info->scope = cache->scope;
+      info->items = cache->args + cache->skip;
+      info->nitems = cache->nargs - cache->skip;
+      info->fd_mcd = 1;
+      info->cache = cache;
+}
+
+/*
+ * Get the buffer of the call site to format into. A function called
+ * by an argument can run the same call site again before it is done,
+ * so a busy call site gets a temporary buffer instead.
+ */
+static struct display_buf*display_buf_get(struct display_cache*cache,
+                                          struct display_buf*tmp)
+{
+      if (cache->busy) {
+	    tmp->text = 0;
+	    tmp->size = 0;
+	    tmp->alloc = 0;
+	    return tmp;
+      }
+      cache->busy = 1;
+      return &cache->buf;
+}
+
+static void display_buf_release(struct display_cache*cache,
+                                struct display_buf*buf)
+{
+      if (buf == &cache->buf) cache->busy = 0;
+      else free(buf->text);
+}
+
+static void display_cache_delete(void)
+{
+      while (display_cache_list) {
+	    struct display_cache*cache = display_cache_list;
+	    unsigned idx;
+	    display_cache_list = cache->next;
+	    for (idx = 0 ;  idx < cache->nargs ;  idx += 1) {
+		  free(cache->kinds[idx].fmt);
+		  free(cache->kinds[idx].ops);
+	    }
+	    free(cache->kinds);
+	    free(cache->args);
+	    free(cache->filename);
+	    free(cache->buf.text);
+	    free(cache);
+      }
 }
 
 #ifdef BR916_STOPGAP_FIX
@@ -1241,65 +1548,49 @@ static PLI_INT32 sys_display_compiletf(ICARUS_VPI_CONST PLI_BYTE8*name)
 /* This implements the $display/$fdisplay and the $write/$fwrite based tasks. */
 static PLI_INT32 sys_display_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
-      vpiHandle callh, argv, scope;
+      vpiHandle callh;
+      struct display_cache*cache;
       struct strobe_cb_info info;
-      char* result;
-      unsigned int size;
+      struct display_buf*buf, tmp;
       PLI_UINT32 fd_mcd;
 
       callh = vpi_handle(vpiSysTfCall, 0);
-      argv = vpi_iterate(vpiArgument, callh);
+      cache = get_display_cache(callh, name[1] == 'f' ? 1 : 0);
 
 	/* Get the file/MC descriptor and verify it is valid. */
       if(name[1] == 'f') {
 	      errno = 0;
-	      vpiHandle arg = vpi_scan(argv);
 	      s_vpi_value val;
 	      val.format = vpiIntVal;
-	      vpi_get_value(arg, &val);
+	      vpi_get_value(cache->args[0], &val);
 	      fd_mcd = val.value.integer;
 
 		/* If the MCD is zero we have nothing to do so just return. */
-	      if (fd_mcd == 0)  {
-		    vpi_free_object(argv);
-		    return 0;
-	      }
+	      if (fd_mcd == 0) return 0;
 
 	      if ((! IS_MCD(fd_mcd) && vpi_get_file(fd_mcd) == NULL) ||
 	          ( IS_MCD(fd_mcd) && my_mcd_printf(fd_mcd, "") == EOF)) {
-		    vpi_printf("WARNING: %s:%d: ", vpi_get_str(vpiFile, callh),
-		               (int)vpi_get(vpiLineNo, callh));
+		    vpi_printf("WARNING: %s:%d: ", cache->filename,
+		               cache->lineno);
 		    vpi_printf("invalid file descriptor/MCD (0x%x) given "
 		               "to %s.\n", (unsigned int)fd_mcd, name);
 		    errno = EBADF;
-		    vpi_free_object(argv);
 		    return 0;
 	      }
       } else {
 	      fd_mcd = 1;
       }
 
-      scope = vpi_handle(vpiScope, callh);
-      assert(scope);
-	/* We could use vpi_get_str(vpiName, callh) to get the task name,
-	 * but name is already defined. */
-      info.name = name;
-      info.filename = strdup(vpi_get_str(vpiFile, callh));
-      info.lineno = (int)vpi_get(vpiLineNo, callh);
-      info.default_format = get_default_format(name);
-      info.scope = scope;
-      array_from_iterator(&info, argv);
+      info_from_cache(&info, cache, name);
 
 	/* Because %u and %z may put embedded NULL characters into the
 	 * returned string strlen() may not match the real size! */
-      result = get_display(&size, &info);
-      my_mcd_rawwrite(fd_mcd, result, size);
+      buf = display_buf_get(cache, &tmp);
+      format_display(buf, &info);
+      my_mcd_rawwrite(fd_mcd, buf->text, buf->size);
       if ((strncmp(name,"$display",8) == 0) ||
           (strncmp(name,"$fdisplay",9) == 0)) my_mcd_rawwrite(fd_mcd, "\n", 1);
-
-      free(info.filename);
-      free(info.items);
-      free(result);
+      display_buf_release(cache, buf);
       return 0;
 }
 
@@ -1396,6 +1687,7 @@ static PLI_INT32 sys_strobe_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       info->default_format = get_default_format(name);
       info->scope= scope;
       array_from_iterator(info, argv);
+      info->cache = get_display_cache(callh, name[1] == 'f' ? 1 : 0);
 
       timerec.type = vpiSimTime;
       timerec.low = 0;
@@ -1419,7 +1711,7 @@ static PLI_INT32 sys_strobe_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
  * though that monitor may be watching many variables).
  */
 
-static struct strobe_cb_info monitor_info = { 0, 0, 0, 0, 0, 0, 0, 0 };
+static struct strobe_cb_info monitor_info = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 static vpiHandle *monitor_callbacks = 0;
 static int monitor_scheduled = 0;
 static int monitor_enabled = 1;
@@ -1523,6 +1815,7 @@ static PLI_INT32 sys_monitor_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       monitor_info.default_format = get_default_format(name);
       monitor_info.scope = scope;
       monitor_info.fd_mcd = 1;
+      monitor_info.cache = get_display_cache(callh, 0);
 
 	/* Attach callbacks to all the parameters that might change. */
       monitor_callbacks = calloc(monitor_info.nitems, sizeof(vpiHandle));
@@ -1618,39 +1911,29 @@ static PLI_INT32 sys_swrite_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
 static PLI_INT32 sys_swrite_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
-  vpiHandle callh, argv, reg, scope;
+  vpiHandle callh;
+  struct display_cache *cache;
   struct strobe_cb_info info;
+  struct display_buf *buf, tmp;
   s_vpi_value val;
-  unsigned int size;
 
   callh = vpi_handle(vpiSysTfCall, 0);
-  argv = vpi_iterate(vpiArgument, callh);
-  reg = vpi_scan(argv);
-
-  scope = vpi_handle(vpiScope, callh);
-  assert(scope);
-  /* We could use vpi_get_str(vpiName, callh) to get the task name, but
-   * name is already defined. */
-  info.name = name;
-  info.filename = strdup(vpi_get_str(vpiFile, callh));
-  info.lineno = (int)vpi_get(vpiLineNo, callh);
-  info.default_format = get_default_format(name);
-  info.scope = scope;
-  array_from_iterator(&info, argv);
+  cache = get_display_cache(callh, 1);
+  info_from_cache(&info, cache, name);
 
   /* Because %u and %z may put embedded NULL characters into the returned
    * string strlen() may not match the real size! */
-  val.value.str = get_display(&size, &info);
+  buf = display_buf_get(cache, &tmp);
+  format_display(buf, &info);
+  val.value.str = buf->text;
   val.format = vpiStringVal;
-  vpi_put_value(reg, &val, 0, vpiNoDelay);
-  if (size != strlen(val.value.str)) {
+  vpi_put_value(cache->args[0], &val, 0, vpiNoDelay);
+  if (buf->size != strlen(val.value.str)) {
     vpi_printf("WARNING: %s:%d: %s returned a value with an embedded NULL "
                "(see %%u/%%z).\n", info.filename, info.lineno, name);
   }
 
-  free(val.value.str);
-  free(info.filename);
-  free(info.items);
+  display_buf_release(cache, buf);
   return 0;
 }
 
@@ -1707,32 +1990,34 @@ static PLI_INT32 sys_sformat_compiletf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 
 static PLI_INT32 sys_sformat_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
 {
-  vpiHandle callh, argv, reg, scope;
+  vpiHandle callh;
+  struct display_cache *cache;
+  const struct display_item *fmt_item;
   struct strobe_cb_info info;
+  struct display_buf *buf, tmp;
   s_vpi_value val;
-  char *result, *fmt;
-  unsigned int idx, size;
+  char *fmt;
+  unsigned int idx;
 
   callh = vpi_handle(vpiSysTfCall, 0);
-  argv = vpi_iterate(vpiArgument, callh);
-  reg = vpi_scan(argv);
-  val.format = vpiStringVal;
-  vpi_get_value(vpi_scan(argv), &val);
-  fmt = strdup(val.value.str);
-
-  scope = vpi_handle(vpiScope, callh);
-  assert(scope);
-  /* We could use vpi_get_str(vpiName, callh) to get the task name, but
-   * name is already defined. */
-  info.name = name;
-  info.filename = strdup(vpi_get_str(vpiFile, callh));
-  info.lineno = (int)vpi_get(vpiLineNo, callh);
-  info.default_format = get_default_format(name);
-  info.scope = scope;
-  array_from_iterator(&info, argv);
+  cache = get_display_cache(callh, 2);
+  info_from_cache(&info, cache, name);
+
+  buf = display_buf_get(cache, &tmp);
+  buf->size = 0;
+  display_buf_reserve(buf, 0);
+  buf->text[0] = '\0';
   idx = -1;
-  size = get_format(&result, fmt, &info, &idx);
-  free(fmt);
+  fmt_item = cache->kinds + 1;
+  if (fmt_item->ops) {
+    run_format(buf, fmt_item->ops, fmt_item->nops, &info, &idx);
+  } else {
+    val.format = vpiStringVal;
+    vpi_get_value(cache->args[1], &val);
+    fmt = strdup(val.value.str);
+    get_format(buf, fmt, &info, &idx);
+    free(fmt);
+  }
 
   if (idx+1< info.nitems) {
     vpi_printf("WARNING: %s:%d: %s has %d extra argument(s).\n",
@@ -1740,17 +2025,15 @@ static PLI_INT32 sys_sformat_calltf(ICARUS_VPI_CONST PLI_BYTE8 *name)
                info.nitems-idx-1);
   }
 
-  val.value.str = result;
+  val.value.str = buf->text;
   val.format = vpiStringVal;
-  vpi_put_value(reg, &val, 0, vpiNoDelay);
-  if (size != strlen(val.value.str)) {
+  vpi_put_value(cache->args[0], &val, 0, vpiNoDelay);
+  if (buf->size != strlen(val.value.str)) {
     vpi_printf("WARNING: %s:%d: %s returned a value with an embedded NULL "
                "(see %%u/%%z).\n", info.filename, info.lineno, name);
   }
 
-  free(val.value.str);
-  free(info.filename);
-  free(info.items);
+  display_buf_release(cache, buf);
   return 0;
 }
 
@@ -2052,6 +2335,7 @@ static PLI_INT32 sys_severity_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
       info.default_format = vpiDecStrVal;
       info.scope = scope;
       array_from_iterator(&info, argv);
+      info.cache = 0;
 
       vpi_printf("%s: %s:%d: ", sstr, info.filename, info.lineno);
 
@@ -2097,6 +2381,9 @@ static PLI_INT32 sys_end_of_simulation(p_cb_data cb_data)
       monitor_info.items = 0;
       monitor_info.nitems = 0;
       monitor_info.name = 0;
+      monitor_info.cache = 0;
+
+      display_cache_delete();
 
       free(timeformat_info.suff);
       timeformat_info.suff = 0;
@@ -19,6 +19,8 @@
 
 # include  "sys_priv.h"
 # include  "sdf_priv.h"
+# include  "stringheap.h"
+# include  "ivl_alloc.h"
 # include  <stdlib.h>
 # include  <string.h>
 # include  <assert.h>
@@ -34,26 +36,154 @@ int sdf_min_typ_max;
   /* Scope of the $sdf_annotate call. Annotation starts here. */
 static vpiHandle sdf_scope;
 static vpiHandle sdf_callh = 0;
+
+/*
+ * The design is indexed while the SDF file is read so that every CELL
+ * and IOPATH is a binary search instead of a walk over the VPI
+ * iterators. A scope gets the sorted table of its child modules the
+ * first time a CELL goes through it, and a cell gets the sorted table
+ * of its module paths the first time an IOPATH is annotated on it.
+ * The names are kept in sdf_name_heap and everything is released when
+ * the annotation is done.
+ */
+struct sdf_path_s {
+      const char*src;
+      const char*dst;
+      int edge;
+      vpiHandle path;
+};
+
+struct sdf_scope_s {
+      vpiHandle scope;
+      const char*name;
+	/* The child modules, sorted by name. */
+      struct sdf_scope_s*child;
+      unsigned nchild;
+	/* The module paths, sorted by source then destination name. */
+      struct sdf_path_s*path;
+      unsigned npath;
+      unsigned child_done : 1;
+      unsigned path_done : 1;
+};
+
+static struct stringheap_s sdf_name_heap = {0, 0};
+static struct sdf_scope_s sdf_root;
+
   /* The cell in process. */
-static vpiHandle sdf_cur_cell;
+static struct sdf_scope_s*sdf_cur_cell;
 
-static vpiHandle find_scope(vpiHandle scope, const char*name)
+static void init_scope(struct sdf_scope_s*node, vpiHandle scope,
+                       const char*name)
 {
-      vpiHandle idx = vpi_iterate(vpiModule, scope);
-	/* If this scope has no modules then it can't have the one we
-	 * are looking for so just return 0. */
-      if (idx == 0) return 0;
+      memset(node, 0, sizeof(*node));
+      node->scope = scope;
+      node->name = name;
+}
+
+static void delete_scope(struct sdf_scope_s*node)
+{
+      unsigned idx;
+      for (idx = 0 ; idx < node->nchild ; idx += 1)
+	    delete_scope(node->child + idx);
+      free(node->child);
+      free(node->path);
+}
+
+static int scope_compare(const void*a, const void*b)
+{
+      const struct sdf_scope_s*sa = (const struct sdf_scope_s*)a;
+      const struct sdf_scope_s*sb = (const struct sdf_scope_s*)b;
+      return strcmp(sa->name, sb->name);
+}
+
+static int path_compare(const void*a, const void*b)
+{
+      const struct sdf_path_s*pa = (const struct sdf_path_s*)a;
+      const struct sdf_path_s*pb = (const struct sdf_path_s*)b;
+      int rc = strcmp(pa->src, pb->src);
+      if (rc != 0) return rc;
+      return strcmp(pa->dst, pb->dst);
+}
+
+static void index_children(struct sdf_scope_s*node)
+{
+      vpiHandle idx, cur;
+      unsigned alloc = 0;
+
+      node->child_done = 1;
+      idx = vpi_iterate(vpiModule, node->scope);
+	/* If this scope has no modules then it has nothing to index. */
+      if (idx == 0) return;
 
-      vpiHandle cur;
       while ( (cur = vpi_scan(idx)) ) {
+	    if (node->nchild == alloc) {
+		  alloc = alloc ? 2*alloc : 8;
+		  node->child = (struct sdf_scope_s*)
+			realloc(node->child, alloc*sizeof(struct sdf_scope_s));
+	    }
+	    init_scope(node->child + node->nchild, cur,
+	               strdup_sh(&sdf_name_heap, vpi_get_str(vpiName, cur)));
+	    node->nchild += 1;
+      }
+
+      qsort(node->child, node->nchild, sizeof(struct sdf_scope_s),
+            scope_compare);
+}
+
+static void index_paths(struct sdf_scope_s*node)
+{
+      vpiHandle iter, path;
+      unsigned alloc = 0;
+
+      node->path_done = 1;
+      iter = vpi_iterate(vpiModPath, node->scope);
+      if (iter == 0) return;
+
+      while ( (path = vpi_scan(iter)) ) {
+	    struct sdf_path_s*cur;
 
-	    if ( strcmp(name, vpi_get_str(vpiName,cur)) == 0) {
-		  vpi_free_object(idx);
-		  return cur;
+	    vpiHandle path_t_in = vpi_handle(vpiModPathIn,path);
+	    vpiHandle path_t_out = vpi_handle(vpiModPathOut,path);
+
+	    vpiHandle path_in = vpi_handle(vpiExpr,path_t_in);
+	    vpiHandle path_out = vpi_handle(vpiExpr,path_t_out);
+
+	      /* The expressions for the path terms must be signals,
+	         vpiNet or vpiReg. */
+	    assert(vpi_get(vpiType,path_in) == vpiNet);
+	    assert(vpi_get(vpiType,path_out) == vpiNet
+		   || vpi_get(vpiType,path_out) == vpiReg);
+
+	    if (node->npath == alloc) {
+		  alloc = alloc ? 2*alloc : 8;
+		  node->path = (struct sdf_path_s*)
+			realloc(node->path, alloc*sizeof(struct sdf_path_s));
 	    }
+	    cur = node->path + node->npath;
+	    cur->src = strdup_sh(&sdf_name_heap, vpi_get_str(vpiName,path_in));
+	    cur->dst = strdup_sh(&sdf_name_heap, vpi_get_str(vpiName,path_out));
+	    cur->edge = vpi_get(vpiEdge,path_t_in);
+	    cur->path = path;
+	    node->npath += 1;
       }
 
-      return 0;
+	/* Paths with the same ports (they differ by their edge) end up
+	   next to each other and are all visited by an IOPATH. */
+      qsort(node->path, node->npath, sizeof(struct sdf_path_s),
+            path_compare);
+}
+
+static struct sdf_scope_s*find_scope(struct sdf_scope_s*node,
+                                     const char*name)
+{
+      struct sdf_scope_s key;
+
+      if (! node->child_done) index_children(node);
+
+      key.name = name;
+      return (struct sdf_scope_s*)
+	    bsearch(&key, node->child, node->nchild,
+	            sizeof(struct sdf_scope_s), scope_compare);
 }
 
 /*
@@ -65,9 +195,20 @@ void sdf_select_instance(const char*celltype, const char*cellinst)
 {
       char buffer[128];
 
+	/* A wildcard instance would apply to every cell of the type,
+	   and that is not supported. */
+      if (cellinst == 0) {
+	    vpi_printf("SDF WARNING: %s:%d: ", vpi_get_str(vpiFile, sdf_callh),
+	               (int)vpi_get(vpiLineNo, sdf_callh));
+	    vpi_printf("Wildcard cell instances (%s) are not supported.\n",
+	               celltype);
+	    sdf_cur_cell = 0;
+	    return;
+      }
+
 	/* First follow the hierarchical parts of the cellinst name to
 	   get to the cell that I'm looking for. */
-      vpiHandle scope = sdf_scope;
+      struct sdf_scope_s*scope = &sdf_root;
       const char*src = cellinst;
       const char*dp;
       while ( (dp=strchr(src, '.')) ) {
@@ -77,13 +218,13 @@ void sdf_select_instance(const char*celltype, const char*cellinst)
 	    strncpy(buffer, src, len);
 	    buffer[len] = 0;
 
-	    vpiHandle tmp_scope = find_scope(scope, buffer);
+	    struct sdf_scope_s*tmp_scope = find_scope(scope, buffer);
 	    if (tmp_scope == 0) {
 		  vpi_printf("SDF WARNING: %s:%d: ",
 		             vpi_get_str(vpiFile, sdf_callh),
 		             (int)vpi_get(vpiLineNo, sdf_callh));
 		  vpi_printf("Cannot find %s in scope %s.\n",
-			     buffer, vpi_get_str(vpiFullName, scope));
+			     buffer, vpi_get_str(vpiFullName, scope->scope));
 		  break;
 	    }
 	    assert(tmp_scope);
@@ -94,32 +235,32 @@ void sdf_select_instance(const char*celltype, const char*cellinst)
 
 	/* Now find the cell. */
       if (src[0] == 0)
-	    sdf_cur_cell = sdf_scope;
+	    sdf_cur_cell = &sdf_root;
       else
 	    sdf_cur_cell = find_scope(scope, src);
       if (sdf_cur_cell == 0) {
 	    vpi_printf("SDF WARNING: %s:%d: ", vpi_get_str(vpiFile, sdf_callh),
 	               (int)vpi_get(vpiLineNo, sdf_callh));
 	    vpi_printf("Unable to find %s in scope %s.\n",
-		       src, vpi_get_str(vpiFullName, scope));
+		       src, vpi_get_str(vpiFullName, scope->scope));
 	    return;
       }
 
 	/* The scope that matches should be a module. */
-      if (vpi_get(vpiType,sdf_cur_cell) != vpiModule) {
+      if (vpi_get(vpiType,sdf_cur_cell->scope) != vpiModule) {
 	    vpi_printf("SDF WARNING: %s:%d: ", vpi_get_str(vpiFile, sdf_callh),
 	               (int)vpi_get(vpiLineNo, sdf_callh));
 	    vpi_printf("Scope %s in %s is not a module.\n",
-		       src, vpi_get_str(vpiFullName, scope));
+		       src, vpi_get_str(vpiFullName, scope->scope));
       }
 
 	/* The matching scope (a module) should have the expected type. */
-      if (strcmp(celltype,vpi_get_str(vpiDefName,sdf_cur_cell)) != 0) {
+      if (strcmp(celltype,vpi_get_str(vpiDefName,sdf_cur_cell->scope)) != 0) {
 	    vpi_printf("SDF WARNING: %s:%d: ", vpi_get_str(vpiFile, sdf_callh),
 	               (int)vpi_get(vpiLineNo, sdf_callh));
 	    vpi_printf("Module %s in %s is not a %s; it is a ", src,
-		       vpi_get_str(vpiFullName, scope), celltype);
-	    vpi_printf("%s\n", vpi_get_str(vpiDefName, sdf_cur_cell));
+		       vpi_get_str(vpiFullName, scope->scope), celltype);
+	    vpi_printf("%s\n", vpi_get_str(vpiDefName, sdf_cur_cell->scope));
       }
 
 }
@@ -138,46 +279,44 @@ static const char*edge_str(int vpi_edge)
 void sdf_iopath_delays(int vpi_edge, const char*src, const char*dst,
 		       const struct sdf_delval_list_s*delval_list)
 {
-      vpiHandle iter, path;
+      struct sdf_path_s key;
+      unsigned lo, hi;
       int match_count = 0;
 
       if (sdf_cur_cell == 0)
 	    return;
 
-      iter = vpi_iterate(vpiModPath, sdf_cur_cell);
+      if (! sdf_cur_cell->path_done) index_paths(sdf_cur_cell);
+
+	/* Search for the modpaths that match the IOPATH by looking
+	   for the first modpath that uses the same ports as the ports
+	   that the parser has found. The rest follow it in the table. */
+      key.src = src;
+      key.dst = dst;
+      lo = 0;
+      hi = sdf_cur_cell->npath;
+      while (lo < hi) {
+	    unsigned mid = lo + (hi - lo) / 2;
+	    if (path_compare(sdf_cur_cell->path + mid, &key) < 0)
+		  lo = mid + 1;
+	    else
+		  hi = mid;
+      }
 
-	/* Search for the modpath that matches the IOPATH by looking
-	   for the modpath that uses the same ports as the ports that
-	   the parser has found. */
-      if (iter) while ( (path = vpi_scan(iter)) ) {
+      for ( ; lo < sdf_cur_cell->npath ; lo += 1) {
+	    const struct sdf_path_s*cur = sdf_cur_cell->path + lo;
 	    s_vpi_delay delays;
 	    struct t_vpi_time delay_vals[12];
 	    int idx;
 
-	    vpiHandle path_t_in = vpi_handle(vpiModPathIn,path);
-	    vpiHandle path_t_out = vpi_handle(vpiModPathOut,path);
-
-	    vpiHandle path_in = vpi_handle(vpiExpr,path_t_in);
-	    vpiHandle path_out = vpi_handle(vpiExpr,path_t_out);
-
-	      /* The expressions for the path terms must be signals,
-	         vpiNet or vpiReg. */
-	    assert(vpi_get(vpiType,path_in) == vpiNet);
-	    assert(vpi_get(vpiType,path_out) == vpiNet
-		   || vpi_get(vpiType,path_out) == vpiReg);
+	    if (path_compare(cur, &key) != 0)
+		  break;
 
-	      /* If the src name doesn't match, go on. */
-	    if (strcmp(src,vpi_get_str(vpiName,path_in)) != 0)
-		  continue;
 	      /* The edge type must match too. But note that if this
 	         IOPATH has no edge, then it matches with all edges of
 	         the modpath object. */
 /* --> Is this correct in the context of the 10, 01, etc. edges? */
-	    if (vpi_edge != vpiNoEdge && vpi_get(vpiEdge,path_t_in) != vpi_edge)
-		  continue;
-
-	      /* If the dst name doesn't match, go on. */
-	    if (strcmp(dst,vpi_get_str(vpiName,path_out)) != 0)
+	    if (vpi_edge != vpiNoEdge && cur->edge != vpi_edge)
 		  continue;
 
 	      /* Ah, this must be a match! */
@@ -187,7 +326,7 @@ void sdf_iopath_delays(int vpi_edge, const char*src, const char*dst,
 	    delays.mtm_flag = 0;
 	    delays.append_flag = 0;
 	    delays.plusere_flag = 0;
-	    vpi_get_delays(path, &delays);
+	    vpi_get_delays(cur->path, &delays);
 
 	    for (idx = 0 ; idx < delval_list->count ; idx += 1) {
 		  delay_vals[idx].type = vpiScaledRealTime;
@@ -196,7 +335,7 @@ void sdf_iopath_delays(int vpi_edge, const char*src, const char*dst,
 		  }
 	    }
 
-	    vpi_put_delays(path, &delays);
+	    vpi_put_delays(cur->path, &delays);
 	    match_count += 1;
       }
 
@@ -205,7 +344,7 @@ void sdf_iopath_delays(int vpi_edge, const char*src, const char*dst,
 	               (int)vpi_get(vpiLineNo, sdf_callh));
 	    vpi_printf("Unable to match ModPath %s%s -> %s in %s\n",
 		       edge_str(vpi_edge), src, dst,
-		       vpi_get_str(vpiFullName, sdf_cur_cell));
+		       vpi_get_str(vpiFullName, sdf_cur_cell->scope));
       }
 }
 
@@ -308,10 +447,14 @@ static PLI_INT32 sys_sdf_annotate_calltf(ICARUS_VPI_CONST PLI_BYTE8*name)
 	/* Select which delay to use. */
       sdf_min_typ_max = vpi_get(_vpiDelaySelection, 0);
 
+      init_scope(&sdf_root, sdf_scope, "");
       sdf_cur_cell = 0;
       sdf_callh = callh;
       sdf_process_file(sdf_fd, fname);
       sdf_callh = 0;
+      sdf_cur_cell = 0;
+      delete_scope(&sdf_root);
+      string_heap_delete(&sdf_name_heap);
 
       fclose(sdf_fd);
       free(fname);
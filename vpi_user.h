@@ -647,6 +647,26 @@ extern void vpip_mcd_rawwrite(PLI_UINT32 mcd, const char*buf, size_t count);
 extern void vpip_count_drivers(vpiHandle ref, unsigned idx,
                                unsigned counts[4]);
 
+  /* Register a callback with the reason _cbValueChangeBatch on a net
+     or a variable to collect its value changes instead of getting a
+     cbValueChange call for each of them. At the read-only synch point
+     of a time step where some of them changed, the cb_rtn is called
+     once for all the handles registered with the same cb_rtn and
+     user_data. In that call the index field holds the number of
+     handles that changed, and vpip_value_changes() returns them with
+     their value at the end of the time step, packed like a
+     vpiVectorVal (least significant word first). The array belongs
+     to the simulator and is only valid during the call. Use
+     vpi_remove_cb on the handle returned by vpi_register_cb to stop
+     collecting the changes of an object. */
+#define _cbValueChangeBatch 0x1000000
+typedef struct t_vpip_value_change {
+      vpiHandle obj;
+      PLI_INT32 size;
+      p_vpi_vecval value;
+} s_vpip_value_change, *p_vpip_value_change;
+extern p_vpip_value_change vpip_value_changes(void);
+
 /*
  * Stopgap fix for br916. We need to reject any attempt to pass a thread
  * variable to $strobe or $monitor. To do this, we use some private VPI
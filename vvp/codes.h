@@ -26,6 +26,8 @@
 
 typedef bool (*vvp_code_fun)(vthread_t thr, vvp_code_t code);
 
+struct waitable_hooks_s;
+
 /*
  * These functions are implementations of executable op-codes. The
  * implementation lives in the vthread.cc file so that they have
@@ -268,6 +270,8 @@ struct vvp_code_s {
 	    vvp_net_t   *net2;
 	    vvp_code_t   cptr2;
 	    class ufunc_core*ufunc_core_ptr;
+	      /* %wait keeps the event it found the first time. */
+	    struct waitable_hooks_s*waitable;
       };
 };
 
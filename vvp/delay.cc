@@ -112,6 +112,44 @@ vvp_time64_t vvp_delay_t::get_delay(vvp_bit4_t from, vvp_bit4_t to)
       return 0;
 }
 
+/*
+ * Scan the vectors a word at a time. Only the kinds of change matter
+ * (to 1, to 0, to z or to x), so collect which kinds are present and
+ * return the largest of their delays.
+ */
+vvp_time64_t vvp_delay_t::get_delay(const vvp_vector4_t&from,
+                                    const vvp_vector4_t&to, unsigned wid)
+{
+      const unsigned WORD_BITS = 8*sizeof(unsigned long);
+
+      if (wid == 0) return get_delay(from.value(0), to.value(0));
+
+      unsigned long rise = 0, fall = 0, decay = 0, unknown = 0;
+      for (unsigned idx = 0 ;  idx < wid ;  idx += WORD_BITS) {
+	    unsigned long fa, fb, ta, tb;
+	    from.get_word(idx, fa, fb);
+	    to.get_word(idx, ta, tb);
+
+	    unsigned long mask = ~0UL;
+	    if (wid-idx < WORD_BITS) mask = (1UL << (wid-idx)) - 1;
+
+	      /* 0 is a=0/b=0, 1 is a=1/b=0, x is a=1/b=1 and z is
+		 a=0/b=1. A bit changes to a value if it is that value
+		 in the new vector and was not in the old one. */
+	    rise    |= mask &  ta & ~tb & ~( fa & ~fb);
+	    fall    |= mask & ~ta & ~tb & ~(~fa & ~fb);
+	    unknown |= mask &  ta &  tb & ~( fa &  fb);
+	    decay   |= mask & ~ta &  tb & ~(~fa &  fb);
+      }
+
+      vvp_time64_t res = 0;
+      if (rise && rise_ > res) res = rise_;
+      if (fall && fall_ > res) res = fall_;
+      if (decay && decay_ > res) res = decay_;
+      if (unknown && min_delay_ > res) res = min_delay_;
+      return res;
+}
+
 vvp_time64_t vvp_delay_t::get_min_delay() const
 {
       return min_delay_;
@@ -178,7 +216,97 @@ vvp_fun_delay::vvp_fun_delay(vvp_net_t*n, unsigned width, const vvp_delay_t&d)
 vvp_fun_delay::~vvp_fun_delay()
 {
       while (struct event_*cur = dequeue_())
-	    delete cur;
+	    delete_event_(cur);
+}
+
+slab_t<sizeof(vvp_fun_delay::event_vec4_),
+       vvp_fun_delay::EVENT_CHUNK_BYTES/sizeof(vvp_fun_delay::event_vec4_)>
+      vvp_fun_delay::vec4_heap_;
+slab_t<sizeof(vvp_fun_delay::event_vec8_),
+       vvp_fun_delay::EVENT_CHUNK_BYTES/sizeof(vvp_fun_delay::event_vec8_)>
+      vvp_fun_delay::vec8_heap_;
+slab_t<sizeof(vvp_fun_delay::event_real_),
+       vvp_fun_delay::EVENT_CHUNK_BYTES/sizeof(vvp_fun_delay::event_real_)>
+      vvp_fun_delay::real_heap_;
+
+/*
+ * The pending events are taken from slabs, a busy delay allocates
+ * and frees one for every transition. Valgrind builds use the normal
+ * heap so that the events left in the queues at the end are found.
+ */
+void* vvp_fun_delay::event_vec4_::operator new(size_t size)
+{
+      assert(size == sizeof(event_vec4_));
+#ifdef CHECK_WITH_VALGRIND
+      return ::operator new(size);
+#else
+      return vec4_heap_.alloc_slab();
+#endif
+}
+
+void vvp_fun_delay::event_vec4_::operator delete(void*ptr)
+{
+#ifdef CHECK_WITH_VALGRIND
+      ::operator delete(ptr);
+#else
+      vec4_heap_.free_slab(ptr);
+#endif
+}
+
+void* vvp_fun_delay::event_vec8_::operator new(size_t size)
+{
+      assert(size == sizeof(event_vec8_));
+#ifdef CHECK_WITH_VALGRIND
+      return ::operator new(size);
+#else
+      return vec8_heap_.alloc_slab();
+#endif
+}
+
+void vvp_fun_delay::event_vec8_::operator delete(void*ptr)
+{
+#ifdef CHECK_WITH_VALGRIND
+      ::operator delete(ptr);
+#else
+      vec8_heap_.free_slab(ptr);
+#endif
+}
+
+void* vvp_fun_delay::event_real_::operator new(size_t size)
+{
+      assert(size == sizeof(event_real_));
+#ifdef CHECK_WITH_VALGRIND
+      return ::operator new(size);
+#else
+      return real_heap_.alloc_slab();
+#endif
+}
+
+void vvp_fun_delay::event_real_::operator delete(void*ptr)
+{
+#ifdef CHECK_WITH_VALGRIND
+      ::operator delete(ptr);
+#else
+      real_heap_.free_slab(ptr);
+#endif
+}
+
+void vvp_fun_delay::delete_event_(struct event_*cur)
+{
+      switch (type_) {
+	  case VEC4_DELAY:
+	    delete static_cast<event_vec4_*>(cur);
+	    break;
+	  case VEC8_DELAY:
+	    delete static_cast<event_vec8_*>(cur);
+	    break;
+	  case REAL_DELAY:
+	    delete static_cast<event_real_*>(cur);
+	    break;
+	  default:
+	    assert(0);
+	    break;
+      }
 }
 
 bool vvp_fun_delay::clean_pulse_events_(vvp_time64_t use_delay,
@@ -188,7 +316,7 @@ bool vvp_fun_delay::clean_pulse_events_(vvp_time64_t use_delay,
 
 	/* If the most recent event and the new event have the same
 	 * value then we need to skip the new event. */
-      if (list_->next->ptr_vec4.eeq(bit)) return true;
+      if (event_vec4_val_(list_->next).eeq(bit)) return true;
 
       clean_pulse_events_(use_delay);
       return false;
@@ -201,7 +329,7 @@ bool vvp_fun_delay::clean_pulse_events_(vvp_time64_t use_delay,
 
 	/* If the most recent event and the new event have the same
 	 * value then we need to skip the new event. */
-      if (list_->next->ptr_vec8.eeq(bit)) return true;
+      if (event_vec8_val_(list_->next).eeq(bit)) return true;
 
       clean_pulse_events_(use_delay);
       return false;
@@ -214,7 +342,7 @@ bool vvp_fun_delay::clean_pulse_events_(vvp_time64_t use_delay,
 
 	/* If the most recent event and the new event have the same
 	 * value then we need to skip the new event. */
-      if (list_->next->ptr_real == bit) return true;
+      if (event_real_val_(list_->next) == bit) return true;
 
       clean_pulse_events_(use_delay);
       return false;
@@ -236,7 +364,7 @@ void vvp_fun_delay::clean_pulse_events_(vvp_time64_t use_delay)
 		  list_ = 0;
 	    else
 		  list_->next = cur->next;
-	    delete cur;
+	    delete_event_(cur);
       } while (list_);
 }
 
@@ -294,7 +422,7 @@ void vvp_fun_delay::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 	      // current value of the output. Detect and handle the
 	      // special case that the event list contains the current
 	      // value as a zero-delay-remaining event.
-	    const vvp_vector4_t&use_vec4 = (list_ && list_->next->sim_time == schedule_simtime())? list_->next->ptr_vec4 : cur_vec4_;
+	    const vvp_vector4_t&use_vec4 = (list_ && list_->next->sim_time == schedule_simtime())? event_vec4_val_(list_->next) : cur_vec4_;
 
 	      /* How many bits to compare? */
 	    unsigned use_wid = use_vec4.size();
@@ -302,13 +430,7 @@ void vvp_fun_delay::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 
 	      /* Scan the vectors looking for delays. Select the maximum
 	         delay encountered. */
-	    use_delay = delay_.get_delay(use_vec4.value(0), bit.value(0));
-
-	    for (unsigned idx = 1 ;  idx < use_wid ;  idx += 1) {
-		  vvp_time64_t tmp;
-		  tmp = delay_.get_delay(use_vec4.value(idx), bit.value(idx));
-		  if (tmp > use_delay) use_delay = tmp;
-	    }
+	    use_delay = delay_.get_delay(use_vec4, bit, use_wid);
       }
 
       /* what *should* happen here is we check to see if there is a
@@ -324,10 +446,7 @@ void vvp_fun_delay::recv_vec4(vvp_net_ptr_t port, const vvp_vector4_t&bit,
 	    initial_ = false;
 	    net_->send_vec4(cur_vec4_, 0);
       } else {
-	    struct event_*cur = new struct event_(use_simtime);
-	    cur->run_run_ptr = &vvp_fun_delay::run_run_vec4_;
-	    cur->ptr_vec4 = bit;
-	    enqueue_(cur);
+	    enqueue_(new event_vec4_(use_simtime, bit));
 	    schedule_generic(this, use_delay, false);
       }
 }
@@ -357,7 +476,7 @@ void vvp_fun_delay::recv_vec8(vvp_net_ptr_t port, const vvp_vector8_t&bit)
 	      // current value of the output. Detect and handle the
 	      // special case that the event list contains the current
 	      // value as a zero-delay-remaining event.
-	    const vvp_vector8_t&use_vec8 = (list_ && list_->next->sim_time == schedule_simtime())? list_->next->ptr_vec8 : cur_vec8_;
+	    const vvp_vector8_t&use_vec8 = (list_ && list_->next->sim_time == schedule_simtime())? event_vec8_val_(list_->next) : cur_vec8_;
 
 	      /* How many bits to compare? */
 	    unsigned use_wid = use_vec8.size();
@@ -389,10 +508,7 @@ void vvp_fun_delay::recv_vec8(vvp_net_ptr_t port, const vvp_vector8_t&bit)
 	    initial_ = false;
 	    net_->send_vec8(cur_vec8_);
       } else {
-	    struct event_*cur = new struct event_(use_simtime);
-	    cur->ptr_vec8 = bit;
-	    cur->run_run_ptr = &vvp_fun_delay::run_run_vec8_;
-	    enqueue_(cur);
+	    enqueue_(new event_vec8_(use_simtime, bit));
 	    schedule_generic(this, use_delay, false);
       }
 }
@@ -451,10 +567,7 @@ void vvp_fun_delay::recv_real(vvp_net_ptr_t port, double bit,
 	    initial_ = false;
 	    net_->send_real(cur_real_, 0);
       } else {
-	    struct event_*cur = new struct event_(use_simtime);
-	    cur->run_run_ptr = &vvp_fun_delay::run_run_real_;
-	    cur->ptr_real = bit;
-	    enqueue_(cur);
+	    enqueue_(new event_real_(use_simtime, bit));
 
 	    schedule_generic(this, use_delay, false);
       }
@@ -470,27 +583,25 @@ void vvp_fun_delay::run_run()
       if (cur == 0)
 	    return;
 
-      (this->*(cur->run_run_ptr))(cur);
+      switch (type_) {
+	  case VEC4_DELAY:
+	    cur_vec4_ = event_vec4_val_(cur);
+	    net_->send_vec4(cur_vec4_, 0);
+	    break;
+	  case VEC8_DELAY:
+	    cur_vec8_ = event_vec8_val_(cur);
+	    net_->send_vec8(cur_vec8_);
+	    break;
+	  case REAL_DELAY:
+	    cur_real_ = event_real_val_(cur);
+	    net_->send_real(cur_real_, 0);
+	    break;
+	  default:
+	    assert(0);
+	    break;
+      }
       initial_ = false;
-      delete cur;
-}
-
-void vvp_fun_delay::run_run_vec4_(struct event_*cur)
-{
-      cur_vec4_ = cur->ptr_vec4;
-      net_->send_vec4(cur_vec4_, 0);
-}
-
-void vvp_fun_delay::run_run_vec8_(struct vvp_fun_delay::event_*cur)
-{
-      cur_vec8_ = cur->ptr_vec8;
-      net_->send_vec8(cur_vec8_);
-}
-
-void vvp_fun_delay::run_run_real_(struct vvp_fun_delay::event_*cur)
-{
-      cur_real_ = cur->ptr_real;
-      net_->send_real(cur_real_, 0);
+      delete_event_(cur);
 }
 
 vvp_fun_modpath::vvp_fun_modpath(vvp_net_t*net, unsigned width)
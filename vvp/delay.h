@@ -22,6 +22,7 @@
 # include  <stddef.h>
 # include  "vvp_net.h"
 # include  "schedule.h"
+# include  "slab.h"
 
 enum delay_edge_t {
       DELAY_EDGE_01 = 0, DELAY_EDGE_10, DELAY_EDGE_0z,
@@ -44,6 +45,9 @@ class vvp_delay_t {
       ~vvp_delay_t();
 
       vvp_time64_t get_delay(vvp_bit4_t from, vvp_bit4_t to);
+	// The largest delay of the changes of the first wid bits.
+      vvp_time64_t get_delay(const vvp_vector4_t&from,
+                             const vvp_vector4_t&to, unsigned wid);
       vvp_time64_t get_min_delay() const;
 
       void set_rise(vvp_time64_t val);
@@ -75,18 +79,38 @@ class vvp_delay_t {
 class vvp_fun_delay  : public vvp_net_fun_t, private vvp_gen_event_s {
 
       enum delay_type_t {UNKNOWN_DELAY, VEC4_DELAY, VEC8_DELAY, REAL_DELAY};
+	// The pending output changes. The type of the functor is set by
+	// the first value it receives, so all the events of a functor
+	// carry the same type of value and only the base is linked.
       struct event_ {
-	    explicit event_(vvp_time64_t s) : sim_time(s) {
-		  ptr_real = 0.0;
-		  next = NULL;
-	    }
-	    void (vvp_fun_delay::*run_run_ptr)(struct vvp_fun_delay::event_*cur);
+	    explicit event_(vvp_time64_t s) : sim_time(s), next(0) { }
 	    const vvp_time64_t sim_time;
-	    vvp_vector4_t ptr_vec4;
-	    vvp_vector8_t ptr_vec8;
-	    double ptr_real;
 	    struct event_*next;
       };
+      struct event_vec4_ : public event_ {
+	    event_vec4_(vvp_time64_t s, const vvp_vector4_t&v)
+	    : event_(s), val(v) { }
+	    vvp_vector4_t val;
+	    static void* operator new(size_t);
+	    static void operator delete(void*);
+      };
+      struct event_vec8_ : public event_ {
+	    event_vec8_(vvp_time64_t s, const vvp_vector8_t&v)
+	    : event_(s), val(v) { }
+	    vvp_vector8_t val;
+	    static void* operator new(size_t);
+	    static void operator delete(void*);
+      };
+      struct event_real_ : public event_ {
+	    event_real_(vvp_time64_t s, double v) : event_(s), val(v) { }
+	    double val;
+	    static void* operator new(size_t);
+	    static void operator delete(void*);
+      };
+      enum { EVENT_CHUNK_BYTES = 8192 };
+      static slab_t<sizeof(event_vec4_),EVENT_CHUNK_BYTES/sizeof(event_vec4_)> vec4_heap_;
+      static slab_t<sizeof(event_vec8_),EVENT_CHUNK_BYTES/sizeof(event_vec8_)> vec8_heap_;
+      static slab_t<sizeof(event_real_),EVENT_CHUNK_BYTES/sizeof(event_real_)> real_heap_;
 
     public:
       vvp_fun_delay(vvp_net_t*net, unsigned width, const vvp_delay_t&d);
@@ -102,10 +126,13 @@ class vvp_fun_delay  : public vvp_net_fun_t, private vvp_gen_event_s {
     private:
       virtual void run_run();
 
-
-      void run_run_vec4_(struct vvp_fun_delay::event_*cur);
-      void run_run_vec8_(struct vvp_fun_delay::event_*cur);
-      void run_run_real_(struct vvp_fun_delay::event_*cur);
+      void delete_event_(struct event_*cur);
+      const vvp_vector4_t& event_vec4_val_(struct event_*cur) const
+      { return static_cast<event_vec4_*>(cur)->val; }
+      const vvp_vector8_t& event_vec8_val_(struct event_*cur) const
+      { return static_cast<event_vec8_*>(cur)->val; }
+      double event_real_val_(struct event_*cur) const
+      { return static_cast<event_real_*>(cur)->val; }
 
     private:
       vvp_net_t*net_;
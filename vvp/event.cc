@@ -386,12 +386,7 @@ bool vvp_fun_anyedge::recv_vec4_(const vvp_vector4_t&bit,
 	    }
 
       } else {
-	    for (unsigned idx = 0 ;  idx < bit.size() ;  idx += 1) {
-		  if (old_bits.value(idx) != bit.value(idx)) {
-			flag = true;
-			break;
-		  }
-	    }
+	    flag = ! old_bits.eeq(bit);
       }
 
       if (flag) {
@@ -22,17 +22,65 @@
 # include  "symbols.h"
 # include  "schedule.h"
 # include  <list>
+# include  <vector>
+# include  <algorithm>
 
 # include  <iostream>
 
 using namespace std;
 
+struct vvp_island_branch_tran;
+
+/*
+ * The branches of a tran island are split into subnets, the sets of
+ * branches that are connected through their ports whatever the state
+ * of the tranif enables. Values cannot cross from one subnet to the
+ * other, so a change at a port only needs the subnet of that port to
+ * be resolved again, and the subnets controlled by the port if it is
+ * an enable. The subnets are made when the island first runs; all of
+ * them are resolved by that first run.
+ */
 class vvp_island_tran : public vvp_island {
 
     public:
+      vvp_island_tran();
+
       void run_island();
+      void port_flagged(vvp_island_port*port);
       void count_drivers(vvp_island_port*port, unsigned bit_idx,
                          unsigned counts[3]);
+
+    private:
+      struct subnet_s {
+	      // The branches of the subnet, in the island order.
+	    vector<vvp_island_branch_tran*> branches;
+	      // The ports of the subnet that are also enables.
+	    vector<unsigned> enables;
+	    bool dirty;
+      };
+
+      struct port_info_s {
+	    vvp_island_port*port;
+	      // A branch end attached to the port, if any.
+	    vvp_island_branch*branch;
+	    unsigned side;
+	      // The subnet of the port, or NO_SUBNET.
+	    unsigned subnet;
+	      // The subnets with a branch enabled by this port.
+	    vector<unsigned> controls;
+      };
+
+      static const unsigned NO_SUBNET = (unsigned)-1;
+
+      unsigned port_index_(vvp_net_t*net);
+      void make_subnets_();
+      void mark_dirty_(unsigned subnet);
+
+      bool subnets_made_;
+      vector<subnet_s> subnets_;
+	// Index 0 is not used, it is the index of the unknown ports.
+      vector<port_info_s> ports_info_;
+      vector<unsigned> dirty_;
 };
 
 enum tran_state_t {
@@ -54,6 +102,8 @@ struct vvp_island_branch_tran : public vvp_island_branch {
       unsigned width, part, offset;
       bool active_high;
       tran_state_t state;
+	// The position of the branch in the island list.
+      unsigned index;
 };
 
 vvp_island_branch_tran::vvp_island_branch_tran(vvp_net_t*en__,
@@ -62,7 +112,7 @@ vvp_island_branch_tran::vvp_island_branch_tran(vvp_net_t*en__,
                                                unsigned part__,
                                                unsigned offset__)
 : en(en__), width(width__), part(part__), offset(offset__),
-  active_high(active_high__)
+  active_high(active_high__), index(0)
 {
       state = en__ ? tran_disabled : tran_enabled;
 }
@@ -74,35 +124,226 @@ static inline vvp_island_branch_tran* BRANCH_TRAN(vvp_island_branch*tmp)
       return res;
 }
 
+static inline bool branch_order(const vvp_island_branch_tran*a,
+                                const vvp_island_branch_tran*b)
+{
+      return a->index < b->index;
+}
+
+vvp_island_tran::vvp_island_tran()
+: subnets_made_(false)
+{
+}
+
+unsigned vvp_island_tran::port_index_(vvp_net_t*net)
+{
+      vvp_island_port*port = dynamic_cast<vvp_island_port*>(net->fun);
+      assert(port);
+
+      if (port->island_index == 0) {
+	    port_info_s info;
+	    info.port = port;
+	    info.branch = 0;
+	    info.side = 0;
+	    info.subnet = NO_SUBNET;
+	    port->island_index = ports_info_.size();
+	    ports_info_.push_back(info);
+      }
+      return port->island_index;
+}
+
+/*
+ * Split the branches into their subnets. The ports are numbered and
+ * joined by the branches with a union-find, then every branch goes to
+ * the subnet of its root port.
+ */
+void vvp_island_tran::make_subnets_()
+{
+      subnets_made_ = true;
+
+      ports_info_.resize(1);
+      ports_info_[0].port = 0;
+      ports_info_[0].branch = 0;
+      ports_info_[0].side = 0;
+      ports_info_[0].subnet = NO_SUBNET;
+
+      vector<vvp_island_branch_tran*> branch_list;
+      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
+	    vvp_island_branch_tran*tmp = BRANCH_TRAN(cur);
+	    tmp->index = branch_list.size();
+	    branch_list.push_back(tmp);
+
+	    unsigned pa = port_index_(tmp->a);
+	    unsigned pb = port_index_(tmp->b);
+	    if (ports_info_[pa].branch == 0) {
+		  ports_info_[pa].branch = tmp;
+		  ports_info_[pa].side = 0;
+	    }
+	    if (ports_info_[pb].branch == 0) {
+		  ports_info_[pb].branch = tmp;
+		  ports_info_[pb].side = 1;
+	    }
+	    if (tmp->en && dynamic_cast<vvp_island_port*>(tmp->en->fun))
+		  port_index_(tmp->en);
+      }
+
+      vector<unsigned> parent (ports_info_.size());
+      for (unsigned idx = 0 ; idx < parent.size() ; idx += 1)
+	    parent[idx] = idx;
+
+      for (unsigned idx = 0 ; idx < branch_list.size() ; idx += 1) {
+	    vvp_island_branch_tran*tmp = branch_list[idx];
+	    unsigned ra = dynamic_cast<vvp_island_port*>(tmp->a->fun)->island_index;
+	    unsigned rb = dynamic_cast<vvp_island_port*>(tmp->b->fun)->island_index;
+	    while (parent[ra] != ra) ra = parent[ra] = parent[parent[ra]];
+	    while (parent[rb] != rb) rb = parent[rb] = parent[parent[rb]];
+	    if (ra < rb) parent[rb] = ra;
+	    else parent[ra] = rb;
+      }
+
+      for (unsigned idx = 0 ; idx < branch_list.size() ; idx += 1) {
+	    vvp_island_branch_tran*tmp = branch_list[idx];
+	    vvp_island_port*pa = dynamic_cast<vvp_island_port*>(tmp->a->fun);
+	    vvp_island_port*pb = dynamic_cast<vvp_island_port*>(tmp->b->fun);
+	    unsigned root = pa->island_index;
+	    while (parent[root] != root) root = parent[root];
+
+	    if (ports_info_[root].subnet == NO_SUBNET) {
+		  ports_info_[root].subnet = subnets_.size();
+		  subnets_.push_back(subnet_s());
+		  subnets_.back().dirty = false;
+	    }
+	    unsigned subnet = ports_info_[root].subnet;
+	    subnets_[subnet].branches.push_back(tmp);
+	    ports_info_[pa->island_index].subnet = subnet;
+	    ports_info_[pb->island_index].subnet = subnet;
+
+	    if (tmp->en == 0) continue;
+	    vvp_island_port*ep = dynamic_cast<vvp_island_port*>(tmp->en->fun);
+	    if (ep == 0) continue;
+	    vector<unsigned>&controls = ports_info_[ep->island_index].controls;
+	    if (controls.empty() || controls.back() != subnet)
+		  controls.push_back(subnet);
+      }
+
+	// A port may control a subnet through several branches that
+	// are not next to each other in the island.
+      for (unsigned idx = 1 ; idx < ports_info_.size() ; idx += 1) {
+	    port_info_s&info = ports_info_[idx];
+	    if (info.controls.empty()) continue;
+
+	    sort(info.controls.begin(), info.controls.end());
+	    info.controls.erase(unique(info.controls.begin(), info.controls.end()),
+	                        info.controls.end());
+	    if (info.subnet != NO_SUBNET)
+		  subnets_[info.subnet].enables.push_back(idx);
+      }
+
+	// The first run resolves all the subnets.
+      for (unsigned idx = 0 ; idx < subnets_.size() ; idx += 1)
+	    mark_dirty_(idx);
+}
+
+void vvp_island_tran::mark_dirty_(unsigned subnet)
+{
+      if (subnets_[subnet].dirty)
+	    return;
+
+      subnets_[subnet].dirty = true;
+      dirty_.push_back(subnet);
+}
+
+/*
+ * Note the subnets that a changed port reaches. Until the island has
+ * run for the first time there are no subnets, and all of them will
+ * be resolved anyhow.
+ */
+void vvp_island_tran::port_flagged(vvp_island_port*port)
+{
+      if (! subnets_made_ || port->island_index == 0)
+	    return;
+
+      const port_info_s&info = ports_info_[port->island_index];
+      if (info.subnet != NO_SUBNET)
+	    mark_dirty_(info.subnet);
+      for (unsigned idx = 0 ; idx < info.controls.size() ; idx += 1)
+	    mark_dirty_(info.controls[idx]);
+}
+
 /*
  * The run_island() method is called by the scheduler to run the
- * entire island. We run the island by calling run_resolution() for
- * all the branches in the island.
+ * island. We run the island by calling run_resolution() for all the
+ * branches of the subnets that were flagged since the last run. The
+ * other subnets keep the values they already sent out.
 */
 void vvp_island_tran::run_island()
 {
+      if (! subnets_made_)
+	    make_subnets_();
+
+      if (dirty_.empty())
+	    return;
+
+	// Take the subnets to run. A port flagged while the values
+	// are sent out marks its subnet for the next run.
+      vector<unsigned> run_list;
+      run_list.swap(dirty_);
+      for (unsigned idx = 0 ; idx < run_list.size() ; idx += 1)
+	    subnets_[run_list[idx]].dirty = false;
+
 	// Test to see if any of the branches are enabled. This loop
 	// tests the enabled inputs for all the branches and caches
 	// the results in the state for each branch.
-      bool runnable = false;
-      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    runnable |= tmp->run_test_enabled();
+      for (unsigned idx = 0 ; idx < run_list.size() ; idx += 1) {
+	    const vector<vvp_island_branch_tran*>&list = subnets_[run_list[idx]].branches;
+	    for (unsigned bdx = 0 ; bdx < list.size() ; bdx += 1)
+		  list[bdx]->run_test_enabled();
       }
 
-	// Now resolve all the branches in the island.
-      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    tmp->run_resolution();
+	// Now resolve all the branches of these subnets.
+      for (unsigned idx = 0 ; idx < run_list.size() ; idx += 1) {
+	    const vector<vvp_island_branch_tran*>&list = subnets_[run_list[idx]].branches;
+	    for (unsigned bdx = 0 ; bdx < list.size() ; bdx += 1)
+		  list[bdx]->run_resolution();
       }
 
-	// Now output the resolved values.
-      for (vvp_island_branch*cur = branches_ ; cur ; cur = cur->next_branch) {
-	    vvp_island_branch_tran*tmp = dynamic_cast<vvp_island_branch_tran*>(cur);
-	    assert(tmp);
-	    tmp->run_output();
+	// Keep the values sent by the enables of these subnets, so
+	// that the subnets they control are resolved again when they
+	// change. As when the whole island was resolved, the new
+	// enable value is used by the next run.
+      vector<unsigned> enables;
+      vector<vvp_vector8_t> enable_vals;
+      for (unsigned idx = 0 ; idx < run_list.size() ; idx += 1) {
+	    const vector<unsigned>&list = subnets_[run_list[idx]].enables;
+	    for (unsigned edx = 0 ; edx < list.size() ; edx += 1) {
+		  enables.push_back(list[edx]);
+		  enable_vals.push_back(ports_info_[list[edx]].port->outvalue);
+	    }
+      }
+
+	// Now output the resolved values. They go out in the island
+	// order of the branches, whatever the subnets.
+      if (run_list.size() == 1) {
+	    const vector<vvp_island_branch_tran*>&list = subnets_[run_list[0]].branches;
+	    for (unsigned bdx = 0 ; bdx < list.size() ; bdx += 1)
+		  list[bdx]->run_output();
+      } else {
+	    vector<vvp_island_branch_tran*> list;
+	    for (unsigned idx = 0 ; idx < run_list.size() ; idx += 1) {
+		  const vector<vvp_island_branch_tran*>&tmp = subnets_[run_list[idx]].branches;
+		  list.insert(list.end(), tmp.begin(), tmp.end());
+	    }
+	    sort(list.begin(), list.end(), branch_order);
+	    for (unsigned bdx = 0 ; bdx < list.size() ; bdx += 1)
+		  list[bdx]->run_output();
+      }
+
+      for (unsigned idx = 0 ; idx < enables.size() ; idx += 1) {
+	    const port_info_s&info = ports_info_[enables[idx]];
+	    if (info.port->outvalue.eeq(enable_vals[idx]))
+		  continue;
+	    for (unsigned cdx = 0 ; cdx < info.controls.size() ; cdx += 1)
+		  mark_dirty_(info.controls[cdx]);
       }
 }
 
@@ -162,20 +403,13 @@ void vvp_island_tran::count_drivers(vvp_island_port*port, unsigned bit_idx,
                                     unsigned counts[3])
 {
         // First we need to find a branch that is attached to the specified
-        // port. Unfortunately there's no quick way to do this.
-      vvp_island_branch*branch = branches_;
-      unsigned side = 0;
-      while (branch) {
-            if (branch->a->fun == port) {
-                  side = 0;
-                  break;
-            }
-            if (branch->b->fun == port) {
-                  side = 1;
-                  break;
-            }
-            branch = branch->next_branch;
-      }
+        // port. The subnets keep one for every port.
+      if (! subnets_made_)
+            make_subnets_();
+
+      assert(port->island_index != 0);
+      vvp_island_branch*branch = ports_info_[port->island_index].branch;
+      unsigned side = ports_info_[port->island_index].side;
       assert(branch);
 
         // Now count the drivers, pushing through the network as necessary.
@@ -247,7 +247,7 @@ static void final_cleanup()
 unsigned module_cnt = 0;
 const char*module_tab[64];
 
-extern void vpip_mcd_init(FILE *log);
+extern void vpip_mcd_init(FILE *log, size_t buffer_size);
 extern void vvp_vpi_init(void);
 
 int main(int argc, char*argv[])
@@ -258,6 +258,8 @@ int main(int argc, char*argv[])
       struct rusage cycles[3];
       const char *logfile_name = 0x0;
       FILE *logfile = 0x0;
+      bool interactive_flag = false;
+      unsigned long output_buffer_kb = 256;
       extern void vpi_set_vlog_info(int, char**);
       extern bool stop_is_finish;
       extern int  stop_is_finish_exit_code;
@@ -315,11 +317,12 @@ int main(int argc, char*argv[])
         /* For non-interactive runs we do not want to run the interactive
          * debugger, so make $stop just execute a $finish. */
       stop_is_finish = false;
-      while ((opt = getopt(argc, argv, "+hil:M:m:nNsvV")) != EOF) switch (opt) {
+      while ((opt = getopt(argc, argv, "+b:hil:M:m:nNsvV")) != EOF) switch (opt) {
          case 'h':
            fprintf(stderr,
                    "Usage: vvp [options] input-file [+plusargs...]\n"
                    "Options:\n"
+                   " -b kbytes      Size of the output buffers (default 256).\n"
                    " -h             Print this help message.\n"
                    " -i             Interactive mode (unbuffered stdio).\n"
                    " -l file        Logfile, '-' for <stderr>\n"
@@ -332,8 +335,12 @@ int main(int argc, char*argv[])
                    " -v             Verbose progress messages.\n"
                    " -V             Print the version information.\n" );
            exit(0);
+	  case 'b':
+	    output_buffer_kb = strtoul(optarg, 0, 10);
+	    break;
 	  case 'i':
 	    setvbuf(stdout, 0, _IONBF, 0);
+	    interactive_flag = true;
 	    break;
 	  case 'l':
 	    logfile_name = optarg;
@@ -412,6 +419,11 @@ int main(int argc, char*argv[])
 	   anything. It is done early because it is plausible that the
 	   compile might affect it, and it is cheap to do. */
 
+	/* The output to files (and to stdout when it is redirected to
+	   one) goes through large buffers, unless the run is
+	   interactive. */
+      size_t output_buffer = interactive_flag? 0 : output_buffer_kb * 1024;
+
       if (logfile_name) {
 	    if (!strcmp(logfile_name, "-"))
 		  logfile = stderr;
@@ -421,11 +433,17 @@ int main(int argc, char*argv[])
 		        perror(logfile_name);
 		        exit(1);
 		  }
-		  setvbuf(logfile, log_buffer, _IOLBF, sizeof(log_buffer));
+		  if (output_buffer > 0)
+			setvbuf(logfile, 0, _IOFBF, output_buffer);
+		  else
+			setvbuf(logfile, log_buffer, _IOLBF, sizeof(log_buffer));
 	    }
       }
 
-      vpip_mcd_init(logfile);
+      if (output_buffer > 0 && !isatty(fileno(stdout)))
+	    setvbuf(stdout, 0, _IOFBF, output_buffer);
+
+      vpip_mcd_init(logfile, output_buffer);
 
       if (verbose_flag) {
 	    my_getrusage(cycles+0);
@@ -35,6 +35,13 @@
 extern void schedule_vthread(vthread_t thr, vvp_time64_t delay,
 			     bool push_flag =false);
 
+/*
+ * Schedule a list of threads, linked by the event that woke them up,
+ * to run together in the active queue of the current time. The
+ * threads must already be marked as scheduled.
+ */
+extern void schedule_vthread_list(vthread_t thr);
+
 extern void schedule_final_vthread(vthread_t thr);
 
 /*
@@ -37,6 +37,7 @@
 # include  <cstdio>
 # include  <cassert>
 # include  <cstdlib>
+# include  <vector>
 /*
  * Callback handles are created when the VPI function registers a
  * callback. The handle is stored by the run time, and it triggered
@@ -272,6 +273,209 @@ static value_callback* make_value_change(p_cb_data data)
       return obj;
 }
 
+/*
+ * A batched value change callback is attached to the signal like a
+ * value change callback, but instead of calling the user function it
+ * puts itself, once per time step, in the list of changes of its
+ * value_change_batch. The batch is a generic event scheduled in the
+ * read-only synch region: it reads the final values of the signals
+ * that changed, packs them in vecvals and passes them all to the user
+ * function in a single call. The vectors of the batch keep their
+ * room, so after the first time steps no memory is allocated.
+ */
+class value_change_batch;
+
+class batch_callback : public value_callback {
+    public:
+      batch_callback(p_cb_data data, value_change_batch*batch,
+                     vvp_signal_value*sig);
+      ~batch_callback();
+
+      bool test_value_callback_ready(void);
+
+    public:
+      value_change_batch*batch;
+      vvp_signal_value*signal;
+	// Set when the callback is in the changes of this time step.
+      bool pending;
+};
+
+class value_change_batch : public vvp_gen_event_s {
+    public:
+      value_change_batch(PLI_INT32 (*rtn)(struct t_cb_data*), char*data);
+
+      void add_change(batch_callback*cb);
+      void forget_change(batch_callback*cb);
+
+      void run_run();
+
+    public:
+      PLI_INT32 (*cb_rtn)(struct t_cb_data*);
+      char*user_data;
+      value_change_batch*next;
+
+    private:
+      bool scheduled_;
+      std::vector<batch_callback*> pending_;
+      std::vector<s_vpip_value_change> changes_;
+      std::vector<unsigned> offsets_;
+      std::vector<s_vpi_vecval> words_;
+      vvp_vector4_t value_;
+      struct t_vpi_time time_;
+};
+
+static value_change_batch*value_change_batches = 0;
+  /* The changes of the batch being delivered, for vpip_value_changes. */
+static p_vpip_value_change value_changes = 0;
+
+inline batch_callback::batch_callback(p_cb_data data,
+                                      value_change_batch*bat,
+                                      vvp_signal_value*sig)
+: value_callback(data), batch(bat), signal(sig), pending(false)
+{
+}
+
+batch_callback::~batch_callback()
+{
+      if (pending) batch->forget_change(this);
+}
+
+/*
+ * The signal calls this when its value changes. Note the change in
+ * the batch and tell the signal that there is nothing to call now.
+ */
+bool batch_callback::test_value_callback_ready(void)
+{
+      if (! pending) {
+	    pending = true;
+	    batch->add_change(this);
+      }
+      return false;
+}
+
+value_change_batch::value_change_batch(PLI_INT32 (*rtn)(struct t_cb_data*),
+                                       char*data)
+: cb_rtn(rtn), user_data(data), next(0), scheduled_(false)
+{
+      time_.type = vpiSimTime;
+}
+
+void value_change_batch::add_change(batch_callback*cb)
+{
+      pending_.push_back(cb);
+      if (! scheduled_) {
+	    scheduled_ = true;
+	    schedule_generic(this, 0, true, true, false);
+      }
+}
+
+void value_change_batch::forget_change(batch_callback*cb)
+{
+      for (size_t idx = 0 ; idx < pending_.size() ; idx += 1) {
+	    if (pending_[idx] == cb) pending_[idx] = 0;
+      }
+}
+
+void value_change_batch::run_run()
+{
+      scheduled_ = false;
+      changes_.clear();
+      offsets_.clear();
+      words_.clear();
+
+      for (size_t idx = 0 ; idx < pending_.size() ; idx += 1) {
+	    batch_callback*cur = pending_[idx];
+	    if (cur == 0) continue;
+	    cur->pending = false;
+	      /* Removed by vpi_remove_cb. */
+	    if (cur->cb_data.cb_rtn == 0) continue;
+
+	    cur->signal->vec4_value(value_);
+	    unsigned wid = value_.size();
+	    unsigned base = words_.size();
+	    words_.resize(base + (wid+31)/32);
+	    for (unsigned bit = 0 ; bit < wid ; bit += 1) {
+		  vvp_bit4_t val = value_.value(bit);
+		  if (val == BIT4_0) continue;
+		  s_vpi_vecval&word = words_[base + bit/32];
+		  PLI_INT32 mask = 1 << (bit%32);
+		  if (val != BIT4_Z) word.aval |= mask;
+		  if (val != BIT4_1) word.bval |= mask;
+	    }
+
+	    s_vpip_value_change change;
+	    change.obj = cur->cb_data.obj;
+	    change.size = wid;
+	    change.value = 0;
+	    changes_.push_back(change);
+	    offsets_.push_back(base);
+      }
+      pending_.clear();
+
+      if (changes_.empty())
+	    return;
+
+	/* The words are all in place, so they do not move anymore. */
+      for (size_t idx = 0 ; idx < changes_.size() ; idx += 1)
+	    changes_[idx].value = &words_[offsets_[idx]];
+
+      vpip_time_to_timestruct(&time_, schedule_simtime());
+
+      struct t_cb_data data;
+      data.reason = _cbValueChangeBatch;
+      data.cb_rtn = cb_rtn;
+      data.obj = 0;
+      data.time = &time_;
+      data.value = 0;
+      data.index = changes_.size();
+      data.user_data = user_data;
+
+      assert(vpi_mode_flag == VPI_MODE_NONE);
+      vpi_mode_flag = VPI_MODE_ROSYNC;
+      value_changes = &changes_[0];
+      (cb_rtn)(&data);
+      value_changes = 0;
+      vpi_mode_flag = VPI_MODE_NONE;
+}
+
+extern "C" p_vpip_value_change vpip_value_changes(void)
+{
+      return value_changes;
+}
+
+/*
+ * Batched value change callbacks can be placed on the signals. The
+ * callbacks with the same function and user data share a batch.
+ */
+static value_callback* make_value_change_batch(p_cb_data data)
+{
+      struct __vpiSignal*sig = dynamic_cast<__vpiSignal*>(data->obj);
+      if (sig == 0 || vpi_get(vpiAutomatic, data->obj)) {
+	    fprintf(stderr, "vpi error: batched value change callbacks "
+		    "can only be placed on static nets and variables.\n");
+	    return 0;
+      }
+
+      vvp_net_fil_t*sig_fil = dynamic_cast<vvp_net_fil_t*>(sig->node->fil);
+      vvp_signal_value*sig_val = dynamic_cast<vvp_signal_value*>(sig->node->fil);
+      assert(sig_fil && sig_val);
+
+      value_change_batch*batch = value_change_batches;
+      while (batch && (batch->cb_rtn != data->cb_rtn
+		       || batch->user_data != data->user_data))
+	    batch = batch->next;
+
+      if (batch == 0) {
+	    batch = new value_change_batch(data->cb_rtn, data->user_data);
+	    batch->next = value_change_batches;
+	    value_change_batches = batch;
+      }
+
+      batch_callback*obj = new batch_callback(data, batch, sig_val);
+      sig_fil->add_vpi_callback(obj);
+      return obj;
+}
+
 class sync_callback : public __vpiCallback {
     public:
       explicit sync_callback(p_cb_data data);
@@ -442,6 +646,13 @@ void simulator_cb_delete(void)
 	    EndOfSimulation = dynamic_cast<simulator_callback*>(cur->next);
 	    delete cur;
       }
+
+	/* Delete the value change batches. */
+      while (value_change_batches) {
+	    value_change_batch*tmp = value_change_batches;
+	    value_change_batches = tmp->next;
+	    delete tmp;
+      }
 }
 #endif
 
@@ -565,6 +776,10 @@ vpiHandle vpi_register_cb(p_cb_data data)
 	    obj = make_value_change(data);
 	    break;
 
+	  case _cbValueChangeBatch:
+	    obj = make_value_change_batch(data);
+	    break;
+
 	  case cbReadOnlySynch:
 	    obj = make_sync(data, true);
 	    break;
@@ -672,7 +887,7 @@ void vvp_vpi_callback::add_vpi_callback(value_callback*cb)
 void vvp_vpi_callback::clear_all_callbacks()
 {
       while (vpi_callbacks_) {
-	    value_callback *tmp = dynamic_cast<value_callback*>
+	    value_callback *tmp = static_cast<value_callback*>
 	                            (vpi_callbacks_->next);
 	    delete vpi_callbacks_;
 	    vpi_callbacks_ = tmp;
@@ -684,7 +899,8 @@ void vvp_vpi_callback::clear_all_callbacks()
  * A vvp_fun_signal uses this method to run its callbacks whenever it
  * has a value change. If the cb_rtn is non-nil, then call the
  * callback function. If the cb_rtn pointer is nil, then the object
- * has been marked for deletion. Free it.
+ * has been marked for deletion. Free it. Only add_vpi_callback puts
+ * callbacks in the list, so they are all value_callback objects.
  */
 void vvp_vpi_callback::run_vpi_callbacks()
 {
@@ -695,7 +911,7 @@ void vvp_vpi_callback::run_vpi_callbacks()
 
       while (next) {
 	    value_callback*cur = next;
-	    next = dynamic_cast<value_callback*>(cur->next);
+	    next = static_cast<value_callback*>(cur->next);
 
 	    if (cur->cb_data.cb_rtn != 0) {
 		  if (cur->test_value_callback_ready()) {
@@ -27,10 +27,22 @@
 # include  <cstdio>
 # include  <cstdlib>
 # include  <cstring>
+# include  <ctime>
 # include  "ivl_alloc.h"
 
 extern FILE* vpi_trace;
 
+/*
+ * The simulation runs in a single thread, so the output does not need
+ * the locking of the stdio functions where the C library has unlocked
+ * variants.
+ */
+#if defined(__GLIBC__)
+# define MCD_FWRITE fwrite_unlocked
+#else
+# define MCD_FWRITE fwrite
+#endif
+
 /*
  * This table keeps track of the MCD files. Note that there may be
  * only 31 such files, and mcd bit0 (32'h00_00_00_01) is the special
@@ -48,6 +60,8 @@ extern FILE* vpi_trace;
 typedef struct mcd_entry {
 	FILE *fp;
 	char *filename;
+	  /* Set for the fd files that can be written, and so flushed. */
+	bool output;
 } mcd_entry_s;
 static mcd_entry_s mcd_table[31];
 static mcd_entry_s *fd_table = NULL;
@@ -55,16 +69,70 @@ static unsigned fd_table_len = 0;
 
 static FILE* logfile;
 
+/*
+ * The size of the stdio buffer of the files the simulation opens, or
+ * 0 to keep the default buffering and write the output out as soon as
+ * the C library would. With a buffer, the output of the MCD channels
+ * waits in the buffers until they are full, until a $fflush or the
+ * end of the simulation, but no more than MCD_FLUSH_SECONDS.
+ */
+static size_t mcd_buffer_size = 0;
+static time_t mcd_last_flush = 0;
+#define MCD_FLUSH_SECONDS 1
+
+/*
+ * The formatted text of vpi_mcd_vprintf. It is kept from one call to
+ * the next and only grows.
+ */
+static char*mcd_text = 0;
+static size_t mcd_text_size = 0;
+
+static void mcd_set_buffer(FILE*fp)
+{
+      if (mcd_buffer_size > 0)
+	    setvbuf(fp, 0, _IOFBF, mcd_buffer_size);
+}
+
+/*
+ * Flush the MCD channels and the files opened for output with
+ * $fopen if their output waited long enough in the buffers.
+ */
+static void mcd_flush_stale(void)
+{
+      if (mcd_buffer_size == 0)
+	    return;
+
+      time_t now = time(0);
+      if (now - mcd_last_flush < MCD_FLUSH_SECONDS)
+	    return;
+
+      mcd_last_flush = now;
+      for (int idx = 0; idx < 31; idx += 1) {
+	    if (mcd_table[idx].fp) fflush(mcd_table[idx].fp);
+      }
+      for (unsigned idx = 0; idx < fd_table_len; idx += 1) {
+	    if (fd_table[idx].fp && fd_table[idx].output)
+		  fflush(fd_table[idx].fp);
+      }
+      if (logfile) fflush(logfile);
+}
+
 /* Initialize mcd portion of vpi.  Must be called before
- * any vpi_mcd routines can be used.
+ * any vpi_mcd routines can be used. The buffer_size is the size of
+ * the stdio buffer given to the files opened by the simulation, 0 to
+ * keep the default. The caller sets up stdout and the logfile.
  */
-void vpip_mcd_init(FILE *log)
+void vpip_mcd_init(FILE *log, size_t buffer_size)
 {
+      mcd_buffer_size = buffer_size;
+      mcd_last_flush = time(0);
+
       fd_table_len = FD_INCR;
       fd_table = (mcd_entry_s *) malloc(fd_table_len*sizeof(mcd_entry_s));
       for (unsigned idx = 0; idx < fd_table_len; idx += 1) {
 	    fd_table[idx].fp = NULL;
 	    fd_table[idx].filename = NULL;
+	    fd_table[idx].output = false;
       }
 
       mcd_table[0].fp = stdout;
@@ -74,8 +142,10 @@ void vpip_mcd_init(FILE *log)
       fd_table[0].filename = strdup("stdin");
       fd_table[1].fp = stdout;
       fd_table[1].filename = strdup("stdout");
+      fd_table[1].output = true;
       fd_table[2].fp = stderr;
       fd_table[2].filename = strdup("stderr");
+      fd_table[2].output = true;
 
       logfile = log;
 }
@@ -102,6 +172,10 @@ void vpi_mcd_delete(void)
       free(fd_table);
       fd_table = NULL;
       fd_table_len = 0;
+
+      free(mcd_text);
+      mcd_text = NULL;
+      mcd_text_size = 0;
 }
 #endif
 
@@ -171,6 +245,7 @@ got_entry:
 #endif
 	if(mcd_table[i].fp == NULL)
 		return 0;
+	mcd_set_buffer(mcd_table[i].fp);
 	mcd_table[i].filename = strdup(name);
 
 	if (vpi_trace) {
@@ -181,13 +256,14 @@ got_entry:
 	return 1<<i;
 }
 
+/*
+ * The text is formatted once, and then written to all the selected
+ * channels.
+ */
 extern "C" PLI_INT32
 vpi_mcd_vprintf(PLI_UINT32 mcd, const char*fmt, va_list ap)
 {
-      char buffer[4096];
-      char *buf_ptr = buffer;
       int rc = 0;
-      bool need_free = false;
       va_list saved_ap;
 
       if (!IS_MCD(mcd)) return 0;
@@ -197,34 +273,41 @@ vpi_mcd_vprintf(PLI_UINT32 mcd, const char*fmt, va_list ap)
 		    (unsigned int)mcd, fmt);
       }
 
+      if (mcd_text == 0) {
+	    mcd_text_size = 4096;
+	    mcd_text = (char *)malloc(mcd_text_size);
+      }
+
       va_copy(saved_ap, ap);
-      rc = vsnprintf(buffer, sizeof buffer, fmt, ap);
+      rc = vsnprintf(mcd_text, mcd_text_size, fmt, ap);
       assert(rc >= 0);
 	/*
-	 * If rc is greater than sizeof buffer then the result was truncated
-	 * so the print needs to be redone with a larger buffer (very rare).
+	 * If rc is greater than the buffer size then the result was
+	 * truncated so the print needs to be redone with a larger
+	 * buffer, which is kept for the next calls.
 	 */
-      if ((unsigned) rc >= sizeof buffer) {
-	    buf_ptr = (char *)malloc(rc + 1);
-	    need_free = true;
-	    rc = vsnprintf(buf_ptr, rc+1, fmt, saved_ap);
+      if ((size_t) rc >= mcd_text_size) {
+	    mcd_text_size = rc + 1;
+	    mcd_text = (char *)realloc(mcd_text, mcd_text_size);
+	    rc = vsnprintf(mcd_text, mcd_text_size, fmt, saved_ap);
       }
       va_end(saved_ap);
 
+      size_t cnt = rc;
       for(int i = 0; i < 31; i++) {
 	    if((mcd>>i) & 1) {
 		  if(mcd_table[i].fp) {
 			  // echo to logfile
 			if (i == 0 && logfile)
-			      fputs(buf_ptr, logfile);
-			fputs(buf_ptr, mcd_table[i].fp);
+			      MCD_FWRITE(mcd_text, 1, cnt, logfile);
+			MCD_FWRITE(mcd_text, 1, cnt, mcd_table[i].fp);
 		  } else {
 			rc = EOF;
 		  }
 	    }
       }
-      if (need_free) free(buf_ptr);
 
+      mcd_flush_stale();
       return rc;
 }
 
@@ -248,11 +331,13 @@ extern "C" void vpip_mcd_rawwrite(PLI_UINT32 mcd, const char*buf, size_t cnt)
 	    if (mcd_table[idx].fp == 0)
 		  continue;
 
-	    fwrite(buf, 1, cnt, mcd_table[idx].fp);
+	    MCD_FWRITE(buf, 1, cnt, mcd_table[idx].fp);
 	    if (idx == 0 && logfile)
-		  fwrite(buf, 1, cnt, logfile);
+		  MCD_FWRITE(buf, 1, cnt, logfile);
 
       }
+
+      mcd_flush_stale();
 }
 
 extern "C" PLI_INT32 vpi_mcd_flush(PLI_UINT32 mcd)
@@ -302,6 +387,7 @@ extern "C" PLI_INT32 vpi_fopen(const char*name, const char*mode)
       for (unsigned idx = i; idx < fd_table_len; idx += 1) {
 	    fd_table[idx].fp = NULL;
 	    fd_table[idx].filename = NULL;
+	    fd_table[idx].output = false;
       }
 
 got_entry:
@@ -314,6 +400,8 @@ got_entry:
 		fd_table[i].fp = fopen("nul", mode);
 #endif
       if (fd_table[i].fp == NULL) return 0;
+      mcd_set_buffer(fd_table[i].fp);
+      fd_table[i].output = mode[0] != 'r' || strchr(mode, '+') != 0;
       fd_table[i].filename = strdup(name);
       return ((1U<<31)|i);
 }
@@ -326,5 +414,9 @@ extern "C" FILE *vpi_get_file(PLI_INT32 fd)
 	// Only know about fd_table_len indices
       if (FD_IDX(fd) >= fd_table_len) return NULL;
 
+	// The fd output is written through the returned file, so this
+	// is where it gets its periodic flush.
+      mcd_flush_stale();
+
       return fd_table[FD_IDX(fd)].fp;
 }
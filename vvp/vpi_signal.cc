@@ -141,19 +141,81 @@ static vpiHandle fill_in_net4(struct __vpiSignal*obj,
  * They work with full or partial signals.
  */
 
+/*
+ * The string formats read the value of the signal once, into a vector
+ * that keeps its storage from one call to the next, and then convert
+ * the bits a word at a time.
+ */
+static vvp_vector4_t format_value;
+static const unsigned FORMAT_WORD_BITS = 8*sizeof(unsigned long);
+
+/*
+ * Get the a and b bits of the FORMAT_WORD_BITS bits of the value that
+ * start at idx. The bits outside of the value are X.
+ */
+static inline void get_value_word(long idx, unsigned long&abits,
+                                  unsigned long&bbits)
+{
+      if (idx >= 0) {
+	    format_value.get_word(idx, abits, bbits);
+	    return;
+      }
+
+      if (-idx >= (long)FORMAT_WORD_BITS) {
+	    abits = ~0UL;
+	    bbits = ~0UL;
+	    return;
+      }
+
+      unsigned shift = -idx;
+      unsigned long mask = (1UL << shift) - 1;
+      format_value.get_word(0, abits, bbits);
+      abits = (abits << shift) | mask;
+      bbits = (bbits << shift) | mask;
+}
+
+/*
+ * The characters of the 8 bits in the byte, the most significant
+ * first, for the bytes that have no x or z bits.
+ */
+static char bin_digits[256][8];
+
 static void format_vpiBinStrVal(vvp_signal_value*sig, int base, unsigned wid,
                                 s_vpi_value*vp)
 {
       char *rbuf = (char *) need_result_buf(wid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long offset = end - 1;
-      long ssize = (signed)sig->value_size();
 
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    if (idx < 0 || idx >= ssize) {
-                  rbuf[offset-idx] = 'x';
-	    } else {
-                  rbuf[offset-idx] = vvp_bit4_to_ascii(sig->value(idx));
+      if (bin_digits[0][0] == 0) {
+	    for (unsigned val = 0 ;  val < 256 ;  val += 1) {
+		  for (unsigned bit = 0 ;  bit < 8 ;  bit += 1)
+			bin_digits[val][7-bit] = (val >> bit) & 1? '1' : '0';
+	    }
+      }
+
+      sig->vec4_value(format_value);
+
+	/* cp points past the character of the next bit. */
+      char*cp = rbuf + wid;
+      for (unsigned pos = 0 ;  pos < wid ;  pos += FORMAT_WORD_BITS) {
+	    unsigned long abits, bbits;
+	    get_value_word(base + (long)pos, abits, bbits);
+	    unsigned cnt = wid - pos;
+	    if (cnt > FORMAT_WORD_BITS) cnt = FORMAT_WORD_BITS;
+
+	    for (unsigned idx = 0 ;  idx < cnt ;  idx += 8) {
+		  unsigned aval = (abits >> idx) & 0xff;
+		  unsigned bval = (bbits >> idx) & 0xff;
+		  if (bval == 0 && cnt - idx >= 8) {
+			cp -= 8;
+			memcpy(cp, bin_digits[aval], 8);
+			continue;
+		  }
+		  for (unsigned bit = idx ;  bit < idx+8 && bit < cnt ;  bit += 1) {
+			unsigned code = (((bbits >> bit) & 1) << 1)
+			              | ((abits >> bit) & 1);
+			cp -= 1;
+			*cp = "01zx"[code];
+		  }
 	    }
       }
       rbuf[wid] = 0;
@@ -161,58 +223,76 @@ static void format_vpiBinStrVal(vvp_signal_value*sig, int base, unsigned wid,
       vp->value.str = rbuf;
 }
 
-static void format_vpiOctStrVal(vvp_signal_value*sig, int base, unsigned wid,
-                                s_vpi_value*vp)
+/*
+ * Format the value in digits of dbits bits (3 for octal, 4 for hex).
+ * The digits without x or z bits come from the plain digits string,
+ * the others from the table (oct_digits or hex_digits) that is
+ * indexed by the 2 bit codes of the bits: 0, 1, 2 for x and 3 for z.
+ */
+static void format_digits(int base, unsigned wid, unsigned dbits,
+                          const char*digits, const char*table, char*rbuf)
 {
-      unsigned dwid = (wid + 2) / 3;
-      char *rbuf = (char *) need_result_buf(dwid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long ssize = (signed)sig->value_size();
-      unsigned val = 0;
+      unsigned dwid = (wid + dbits - 1) / dbits;
+      unsigned long dmask = (1UL << dbits) - 1;
+      unsigned long abits = 0, bbits = 0;
+      unsigned avail = 0;
 
       rbuf[dwid] = 0;
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    unsigned bit = 0;
-	    if (idx < 0 || idx >= ssize) {
-                  bit = 2; // BIT4_X
-	    } else {
-                  switch (sig->value(idx)) {
-		      case BIT4_0:
-			bit = 0;
-			break;
-		      case BIT4_1:
-			bit = 1;
-			break;
-		      case BIT4_X:
-			bit = 2;
-			break;
-		      case BIT4_Z:
-			bit = 3;
-			break;
-                  }
+      for (unsigned pos = 0 ;  pos < wid ;  pos += dbits) {
+	    if (avail < dbits) {
+		  get_value_word(base + (long)pos, abits, bbits);
+		  avail = FORMAT_WORD_BITS;
+	    }
+	    unsigned long aval = abits & dmask;
+	    unsigned long bval = bbits & dmask;
+	    abits >>= dbits;
+	    bbits >>= dbits;
+	    avail -= dbits;
+	    dwid -= 1;
+
+	    unsigned cnt = wid - pos;
+	    if (bval == 0 && cnt >= dbits) {
+		  rbuf[dwid] = digits[aval];
+		  continue;
 	    }
-	    val |= bit << 2*((idx-base) % 3);
 
-	    if ((idx-base) % 3 == 2) {
-		dwid -= 1;
-		rbuf[dwid] = oct_digits[val];
-		val = 0;
+	    unsigned long cmask = dmask;
+	    if (cnt < dbits) {
+		  cmask = (1UL << cnt) - 1;
+		  aval &= cmask;
+		  bval &= cmask;
 	    }
-      }
 
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (wid % 3) {
-	  case 1:
-	    if (val == 2) val = 42;
-	    else if (val == 3) val = 63;
-	    break;
-	  case 2:
-	    if (val == 10) val = 42;
-	    else if (val == 15) val = 63;
-	    break;
+	    unsigned code = 0;
+	    for (unsigned bit = 0 ;  bit < dbits ;  bit += 1) {
+		  unsigned tmp = (bval >> bit) & 1? 2 | !((aval >> bit) & 1)
+		                                   : (aval >> bit) & 1;
+		  code |= tmp << 2*bit;
+	    }
+
+	      /* Fill in X or Z if they are the only thing in the
+		 last, partial, digit. */
+	    if (cnt < dbits && bval == cmask) {
+		  unsigned fill = aval == cmask? 2 : aval == 0? 3 : 0;
+		  if (fill) {
+			code = 0;
+			for (unsigned bit = 0 ;  bit < dbits ;  bit += 1)
+			      code |= fill << 2*bit;
+		  }
+	    }
+
+	    rbuf[dwid] = table[code];
       }
+}
+
+static void format_vpiOctStrVal(vvp_signal_value*sig, int base, unsigned wid,
+                                s_vpi_value*vp)
+{
+      unsigned dwid = (wid + 2) / 3;
+      char *rbuf = (char *) need_result_buf(dwid+1, RBUF_VAL);
 
-      if (dwid > 0) rbuf[0] = oct_digits[val];
+      sig->vec4_value(format_value);
+      format_digits(base, wid, 3, "01234567", oct_digits, rbuf);
 
       vp->value.str = rbuf;
 }
@@ -222,57 +302,9 @@ static void format_vpiHexStrVal(vvp_signal_value*sig, int base, unsigned wid,
 {
       unsigned dwid = (wid + 3) / 4;
       char *rbuf = (char *) need_result_buf(dwid+1, RBUF_VAL);
-      long end = base + (signed)wid;
-      long ssize = (signed)sig->value_size();
-      unsigned val = 0;
-
-      rbuf[dwid] = 0;
-      for (long idx = base ;  idx < end ;  idx += 1) {
-	    unsigned bit = 0;
-	    if (idx < 0 || idx >= ssize) {
-                  bit = 2; // BIT4_X
-	    } else {
-                  switch (sig->value(idx)) {
-		      case BIT4_0:
-			bit = 0;
-			break;
-		      case BIT4_1:
-			bit = 1;
-			break;
-		      case BIT4_X:
-			bit = 2;
-			break;
-		      case BIT4_Z:
-			bit = 3;
-			break;
-                  }
-	    }
-	    val |= bit << 2*((idx-base) % 4);
-
-	    if ((idx-base) % 4 == 3) {
-		dwid -= 1;
-		rbuf[dwid] = hex_digits[val];
-		val = 0;
-	    }
-      }
-
-	/* Fill in X or Z if they are the only thing in the value. */
-      switch (wid % 4) {
-	  case 1:
-	    if (val == 2) val = 170;
-	    else if (val == 3) val = 255;
-	    break;
-	  case 2:
-	    if (val == 10) val = 170;
-	    else if (val == 15) val = 255;
-	    break;
-	  case 3:
-	    if (val == 42) val = 170;
-	    else if (val == 63) val = 255;
-	    break;
-      }
 
-      if (dwid > 0) rbuf[0] = hex_digits[val];
+      sig->vec4_value(format_value);
+      format_digits(base, wid, 4, "0123456789abcdef", hex_digits, rbuf);
 
       vp->value.str = rbuf;
 }
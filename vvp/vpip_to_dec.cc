@@ -29,73 +29,352 @@
 # include  <cstdlib>
 # include  <cctype>
 # include  <cassert>
-# include  "ivl_alloc.h"
+# include  <vector>
 
-/* If you are allergic to malloc, you can set a stack memory allocation
- * here.  Otherwise, malloc() is used for the temporary array, so the
- * conversion length is unlimited. */
-/* #define MAX_DIGITS 20 */
+/*
+ * The magnitude of a value is kept as a vector of 32 bit limbs, the
+ * least significant first. The decimal digits are handled in groups
+ * of DEC_DIGITS digits, each a number less than DEC_BASE that also
+ * fits in a limb.
+ */
+typedef uint32_t limb_t;
+typedef std::vector<limb_t> limbs_t;
 
+#define LIMB_BITS 32
+#define DEC_DIGITS 9
+#define DEC_BASE 1000000000
 
-#if SIZEOF_UNSIGNED_LONG * CHAR_BIT >= 64
-#define BDIGITS 9
-#define BASE 1000000000
-#define BBITS 32
-#define BMASK 0xffffffff
-#else
-#if SIZEOF_UNSIGNED_LONG * CHAR_BIT >= 32
-#define BDIGITS 4
-#define BASE 10000
-#define BBITS 16
-#define BMASK 0xffff
+/*
+ * Values that fit in a dec_word_t are converted with the native
+ * division of the host, up to 128 bits where the compiler has them.
+ */
+#ifdef __SIZEOF_INT128__
+typedef unsigned __int128 dec_word_t;
 #else
-#error apparent non-conforming word length
-#endif
+typedef uint64_t dec_word_t;
 #endif
 
-#define B_IS0(x)  ((x) == 0)
-#define B_IS1(x)  ((x) == 1)
-#define B_ISX(x)  ((x) == 2)
-#define B_ISZ(x)  ((x) == 3)
-
-/* The program works by building a base BASE representation of the number
- * in the valv array.  BBITS bits of the number can be put in at a time.
- * Previous values of each valv element are always less than BASE, the
- * input val is less than or equal to 2^BBITS, so (valv[i]<<BBITS)+val
- * is guaranteed less than or equal to BASE<<BBITS, which is configured
- * less than ULONG_MAX.  When this number divided by BASE, to get the amount
- * propagated as a "carry" to the next array element, the result is again
- * less than or equal to 2^BBITS.  BBITS and BASE are configured above
- * to depend on the "unsigned long" length of the host, for efficiency.
+/*
+ * Below these sizes the simple quadratic algorithms are faster than
+ * the divide and conquer ones.
  */
-static inline void shift_in(unsigned long *valv, unsigned int vlen, unsigned long val)
+#define KARATSUBA_LIMBS 32
+#define DIVIDE_LIMBS 32
+#define COMBINE_GROUPS 16
+
+static inline void trim(limbs_t&val)
 {
-	unsigned int i;
-	/* printf("shift in %u\n",val); */
-	for (i=0; i<vlen; i++) {
-		val=(valv[i]<<BBITS)+val;
-		valv[i]=val%BASE;
-		val=val/BASE;
-	}
-	if (val!=0)
-	      fprintf(stderr,"internal error: carry out %lu in " __FILE__ "\n",val);
+      while (!val.empty() && val.back() == 0)
+	    val.pop_back();
+}
+
+static int compare(const limbs_t&a, const limbs_t&b)
+{
+      if (a.size() != b.size())
+	    return a.size() < b.size()? -1 : 1;
+      for (size_t idx = a.size() ; idx > 0 ; idx -= 1) {
+	    if (a[idx-1] != b[idx-1])
+		  return a[idx-1] < b[idx-1]? -1 : 1;
+      }
+      return 0;
+}
+
+/* res += val << (shift limbs) */
+static void add_shifted(limbs_t&res, const limbs_t&val, size_t shift)
+{
+      if (res.size() < val.size()+shift)
+	    res.resize(val.size()+shift, 0);
+
+      uint64_t carry = 0;
+      size_t idx;
+      for (idx = 0 ; idx < val.size() ; idx += 1) {
+	    carry += (uint64_t)res[idx+shift] + val[idx];
+	    res[idx+shift] = (limb_t)carry;
+	    carry >>= LIMB_BITS;
+      }
+      for (idx += shift ; carry && idx < res.size() ; idx += 1) {
+	    carry += res[idx];
+	    res[idx] = (limb_t)carry;
+	    carry >>= LIMB_BITS;
+      }
+      if (carry)
+	    res.push_back((limb_t)carry);
 }
 
-/* Since BASE is a power of ten, conversion of each element of the
- * valv array to decimal is easy.  sprintf(buf,"%d",v) could be made
- * to work, I suppose, but for speed and control I prefer to write
- * the steps out longhand.
+/* res -= val, with res >= val. */
+static void subtract(limbs_t&res, const limbs_t&val)
+{
+      int64_t borrow = 0;
+      for (size_t idx = 0 ; idx < res.size() ; idx += 1) {
+	    if (idx >= val.size() && borrow == 0)
+		  break;
+	    borrow += (int64_t)res[idx] - (idx < val.size()? val[idx] : 0);
+	    res[idx] = (limb_t)borrow;
+	    borrow = borrow < 0? -1 : 0;
+      }
+      assert(borrow == 0);
+      trim(res);
+}
+
+/* res = res * mul + add, for single limbs. */
+static void mul_add_limb(limbs_t&res, limb_t mul, limb_t add)
+{
+      uint64_t carry = add;
+      for (size_t idx = 0 ; idx < res.size() ; idx += 1) {
+	    carry += (uint64_t)res[idx] * mul;
+	    res[idx] = (limb_t)carry;
+	    carry >>= LIMB_BITS;
+      }
+      if (carry)
+	    res.push_back((limb_t)carry);
+}
+
+/*
+ * Multiply two magnitudes. Large operands are split in two halves and
+ * multiplied with three smaller products (Karatsuba), which makes the
+ * conversions below subquadratic.
+ */
+static limbs_t multiply(const limbs_t&a, const limbs_t&b)
+{
+      limbs_t res;
+      if (a.empty() || b.empty())
+	    return res;
+
+      if (a.size() < KARATSUBA_LIMBS || b.size() < KARATSUBA_LIMBS) {
+	    res.assign(a.size()+b.size(), 0);
+	    for (size_t adx = 0 ; adx < a.size() ; adx += 1) {
+		  uint64_t carry = 0;
+		  for (size_t bdx = 0 ; bdx < b.size() ; bdx += 1) {
+			carry += (uint64_t)a[adx] * b[bdx] + res[adx+bdx];
+			res[adx+bdx] = (limb_t)carry;
+			carry >>= LIMB_BITS;
+		  }
+		  res[adx+b.size()] = (limb_t)carry;
+	    }
+	    trim(res);
+	    return res;
+      }
+
+      size_t half = (a.size() > b.size()? a.size() : b.size()) / 2;
+      limbs_t a0 (a.begin(), a.begin() + (a.size() < half? a.size() : half));
+      limbs_t a1 (a.begin() + a0.size(), a.end());
+      limbs_t b0 (b.begin(), b.begin() + (b.size() < half? b.size() : half));
+      limbs_t b1 (b.begin() + b0.size(), b.end());
+      trim(a0);
+      trim(b0);
+
+      limbs_t z0 = multiply(a0, b0);
+      limbs_t z2 = multiply(a1, b1);
+      add_shifted(a0, a1, 0);
+      add_shifted(b0, b1, 0);
+      limbs_t z1 = multiply(a0, b0);
+      subtract(z1, z0);
+      subtract(z1, z2);
+
+      res = z0;
+      add_shifted(res, z1, half);
+      add_shifted(res, z2, 2*half);
+      trim(res);
+      return res;
+}
+
+/*
+ * Long division (Knuth, algorithm D). This is only used to compute
+ * the reciprocals of the cached powers, once for every power.
+ */
+static limbs_t long_divide(const limbs_t&num, const limbs_t&den)
+{
+      assert(!den.empty() && den.back() != 0);
+      limbs_t quo;
+      if (compare(num, den) < 0)
+	    return quo;
+
+      size_t nd = den.size();
+      size_t nn = num.size();
+      unsigned shift = 0;
+      while ((den.back() << shift & 0x80000000) == 0)
+	    shift += 1;
+
+	/* Normalize so that the top bit of the divisor is set. */
+      limbs_t v (nd), u (nn+1);
+      for (size_t idx = nd ; idx > 0 ; idx -= 1) {
+	    uint64_t tmp = (uint64_t)den[idx-1] << shift;
+	    if (idx > 1) tmp |= (uint64_t)den[idx-2] << shift >> LIMB_BITS;
+	    v[idx-1] = (limb_t)tmp;
+      }
+      u[nn] = shift? num[nn-1] >> (LIMB_BITS-shift) : 0;
+      for (size_t idx = nn ; idx > 0 ; idx -= 1) {
+	    uint64_t tmp = (uint64_t)num[idx-1] << shift;
+	    if (idx > 1) tmp |= (uint64_t)num[idx-2] << shift >> LIMB_BITS;
+	    u[idx-1] = (limb_t)tmp;
+      }
+
+      quo.assign(nn-nd+1, 0);
+      for (size_t jdx = nn-nd+1 ; jdx > 0 ; jdx -= 1) {
+	    size_t j = jdx-1;
+	    uint64_t top = ((uint64_t)u[j+nd] << LIMB_BITS) | u[j+nd-1];
+	    uint64_t qhat = top / v[nd-1];
+	    uint64_t rhat = top % v[nd-1];
+	    while (qhat > 0xffffffffULL
+		   || (nd > 1 && qhat * v[nd-2] > ((rhat << LIMB_BITS) | u[j+nd-2]))) {
+		  qhat -= 1;
+		  rhat += v[nd-1];
+		  if (rhat > 0xffffffffULL)
+			break;
+	    }
+
+	      /* u[j..j+nd] -= qhat * v */
+	    int64_t borrow = 0;
+	    uint64_t carry = 0;
+	    for (size_t idx = 0 ; idx < nd ; idx += 1) {
+		  carry += qhat * v[idx];
+		  borrow += (int64_t)u[j+idx] - (int64_t)(carry & 0xffffffffULL);
+		  u[j+idx] = (limb_t)borrow;
+		  borrow >>= LIMB_BITS;
+		  carry >>= LIMB_BITS;
+	    }
+	    borrow += (int64_t)u[j+nd] - (int64_t)carry;
+	    u[j+nd] = (limb_t)borrow;
+
+	      /* The estimate was one too large, add the divisor back. */
+	    if (borrow < 0) {
+		  qhat -= 1;
+		  uint64_t sum = 0;
+		  for (size_t idx = 0 ; idx < nd ; idx += 1) {
+			sum += (uint64_t)u[j+idx] + v[idx];
+			u[j+idx] = (limb_t)sum;
+			sum >>= LIMB_BITS;
+		  }
+		  u[j+nd] += (limb_t)sum;
+	    }
+	    quo[j] = (limb_t)qhat;
+      }
+
+      trim(quo);
+      return quo;
+}
+
+/*
+ * The powers DEC_BASE^(2^k) used to split the values in halves, with
+ * their reciprocals floor(2^(64*n)/power) where n is the number of
+ * limbs of the power. They are computed the first time a value needs
+ * them and kept for the next conversions.
  */
-static inline int write_digits(unsigned long v, char **buf,
+static std::vector<limbs_t> dec_powers;
+static std::vector<limbs_t> dec_reciprocals;
+
+static const limbs_t& dec_power(unsigned k)
+{
+      while (dec_powers.size() <= k) {
+	    if (dec_powers.empty()) {
+		  dec_powers.push_back(limbs_t(1, DEC_BASE));
+	    } else {
+		  const limbs_t&prev = dec_powers.back();
+		  dec_powers.push_back(multiply(prev, prev));
+	    }
+	    const limbs_t&pow = dec_powers.back();
+	    limbs_t one (2*pow.size()+1, 0);
+	    one.back() = 1;
+	    dec_reciprocals.push_back(long_divide(one, pow));
+      }
+      return dec_powers[k];
+}
+
+/*
+ * Divide num by dec_power(k), with num < dec_power(k)^2, using the
+ * reciprocal of the power: the estimated quotient is at most a few
+ * units short, and the remainder corrects it.
+ */
+static void divide_by_power(const limbs_t&num, unsigned k,
+			    limbs_t&quo, limbs_t&rem)
+{
+      const limbs_t&pow = dec_power(k);
+      const limbs_t&rec = dec_reciprocals[k];
+      size_t shift = 2*pow.size();
+
+      limbs_t tmp = multiply(num, rec);
+      if (tmp.size() > shift)
+	    quo.assign(tmp.begin()+shift, tmp.end());
+      else
+	    quo.clear();
+
+      rem = num;
+      subtract(rem, multiply(quo, pow));
+      while (compare(rem, pow) >= 0) {
+	    subtract(rem, pow);
+	    mul_add_limb(quo, 1, 1);
+      }
+}
+
+/*
+ * Write the value, less than dec_power(k), as 2^k groups of decimal
+ * digits, the least significant first.
+ */
+static void to_dec_groups(const limbs_t&val, unsigned k, limb_t*out)
+{
+      size_t count = (size_t)1 << k;
+
+      if (val.size() <= DIVIDE_LIMBS) {
+	    limbs_t tmp = val;
+	    for (size_t idx = 0 ; idx < count ; idx += 1) {
+		  uint64_t rem = 0;
+		  for (size_t wdx = tmp.size() ; wdx > 0 ; wdx -= 1) {
+			rem = (rem << LIMB_BITS) | tmp[wdx-1];
+			tmp[wdx-1] = (limb_t)(rem / DEC_BASE);
+			rem %= DEC_BASE;
+		  }
+		  trim(tmp);
+		  out[idx] = (limb_t)rem;
+	    }
+	    return;
+      }
+
+      assert(k > 0);
+      limbs_t quo, rem;
+      divide_by_power(val, k-1, quo, rem);
+      to_dec_groups(rem, k-1, out);
+      to_dec_groups(quo, k-1, out + count/2);
+}
+
+/*
+ * Build the value of count groups of decimal digits, the least
+ * significant first: the high groups times a power plus the low ones.
+ */
+static limbs_t from_dec_groups(const limb_t*groups, size_t count)
+{
+      limbs_t res;
+      if (count <= COMBINE_GROUPS) {
+	    for (size_t idx = count ; idx > 0 ; idx -= 1)
+		  mul_add_limb(res, DEC_BASE, groups[idx-1]);
+	    trim(res);
+	    return res;
+      }
+
+      unsigned k = 0;
+      while (((size_t)2 << k) < count)
+	    k += 1;
+      size_t low = (size_t)1 << k;
+
+      res = multiply(from_dec_groups(groups+low, count-low), dec_power(k));
+      add_shifted(res, from_dec_groups(groups, low), 0);
+      trim(res);
+      return res;
+}
+
+/*
+ * Write the digits of a group. Leading zeros are suppressed as long
+ * as zero_suppress is set.
+ */
+static inline int write_digits(limb_t v, char **buf,
                                unsigned int *nbuf, int zero_suppress)
 {
-	char segment[BDIGITS];
+	char segment[DEC_DIGITS];
 	int i;
-	for (i=BDIGITS-1; i>=0; --i) {
+	for (i=DEC_DIGITS-1; i>=0; --i) {
 		segment[i] = '0' + v%10;
 		v=v/10;
 	}
-	for (i=0; i<BDIGITS; ++i) {
+	for (i=0; i<DEC_DIGITS; ++i) {
 		if (!(zero_suppress&=(segment[i]=='0'))) {
 			*(*buf)++=segment[i]; --(*nbuf);
 		}
@@ -103,17 +382,15 @@ static inline int write_digits(unsigned long v, char **buf,
 	return zero_suppress;
 }
 
-/* Jump through some hoops so we don't have to malloc/free valv
- * on every call, and implement an optional malloc-less version. */
-static unsigned long *valv=NULL;
-static unsigned int vlen_alloc=0;
+/* The groups of decimal digits, kept for the next conversions. */
+static std::vector<limb_t> dec_groups;
 
 #ifdef CHECK_WITH_VALGRIND
 void dec_str_delete(void)
 {
-      free(valv);
-      valv = 0;
-      vlen_alloc = 0;
+      std::vector<limbs_t>().swap(dec_powers);
+      std::vector<limbs_t>().swap(dec_reciprocals);
+      std::vector<limb_t>().swap(dec_groups);
 }
 #endif
 
@@ -121,11 +398,10 @@ unsigned vpip_vec4_to_dec_str(const vvp_vector4_t&vec4,
 			      char *buf, unsigned int nbuf,
 			      int signed_flag)
 {
-      unsigned int idx, vlen;
+      unsigned int idx;
       unsigned int mbits=vec4.size();   /* number of non-sign bits */
       unsigned count_x = 0, count_z = 0;
 
-      unsigned long val=0;
       int comp=0;
       if (signed_flag) {
 	    switch (vec4.value(vec4.size()-1)) {
@@ -143,22 +419,13 @@ unsigned vpip_vec4_to_dec_str(const vvp_vector4_t&vec4,
 	    }
 	    mbits -= 1;
       }
-      assert(mbits<(UINT_MAX-92)/28);
-      vlen = ((mbits*28+92)/93+BDIGITS-1)/BDIGITS;
-	/* printf("vlen=%d\n",vlen); */
-
-#define ALLOC_MARGIN 4
-      if (!valv || vlen > vlen_alloc) {
-	    if (valv) free(valv);
-	    valv = (unsigned long*) calloc(vlen+ALLOC_MARGIN, sizeof (*valv));
-	    vlen_alloc=vlen+ALLOC_MARGIN;
-      } else {
-	    memset(valv,0,vlen*sizeof(valv[0]));
-      }
 
+	/* Collect the magnitude. A negative value is complemented
+	   and incremented, which can carry into bit mbits. */
+      limbs_t val (mbits/LIMB_BITS + 1, 0);
       for (idx = 0; idx < mbits; idx += 1) {
-	      /* printf("%c ",bits[mbits-idx-1]); */
-	    switch (vec4.value(mbits-idx-1)) {
+	    vvp_bit4_t bit = vec4.value(idx);
+	    switch (bit) {
 		case BIT4_Z:
 		  count_z += 1;
 		  break;
@@ -166,60 +433,68 @@ unsigned vpip_vec4_to_dec_str(const vvp_vector4_t&vec4,
 		  count_x += 1;
 		  break;
 		case BIT4_1:
-		  if (! comp)
-			val += 1;
-		  break;
 		case BIT4_0:
-		  if (comp)
-			val += 1;
+		  if ((bit == BIT4_1) != (comp != 0))
+			val[idx/LIMB_BITS] |= (limb_t)1 << (idx%LIMB_BITS);
 		  break;
 	    }
-
-	    if ((mbits-idx-1)%BBITS==0) {
-		    /* make negative 2's complement, not 1's complement */
-		  if (comp && idx==mbits-1) ++val;
-		  shift_in(valv,vlen,val);
-		  val=0;
-	    } else {
-		  val=val+val;
-	    }
       }
+      if (comp)
+	    mul_add_limb(val, 1, 1);
+      trim(val);
 
 	if (count_x == vec4.size()) {
 	      buf[0] = 'x';
 	      buf[1] = 0;
+	      return 0;
 	} else if (count_x > 0) {
 	      buf[0] = 'X';
 	      buf[1] = 0;
+	      return 0;
 	} else if (count_z == vec4.size()) {
 	      buf[0] = 'z';
 	      buf[1] = 0;
+	      return 0;
 	} else if (count_z > 0) {
 	      buf[0] = 'Z';
 	      buf[1] = 0;
-	} else {
-	      int i;
-	      int zero_suppress=1;
-	      if (comp) {
-		    *buf++='-';
-		    nbuf--;
-		      /* printf("-"); */
-	      }
-	      for (i=vlen-1; i>=0; i--) {
-		    zero_suppress = write_digits(valv[i],
-						 &buf,&nbuf,zero_suppress);
-		      /* printf(",%.4u",valv[i]); */
-	      }
-		/* Awkward special case, since we don't want to
-		 * zero suppress down to nothing at all.  The only
-		 * way we can still have zero_suppress on in the
-		 * comp=1 case is if mbits==0, and therefore vlen==0.
-		 * We represent 1'sb1 as "-1". */
-	      if (zero_suppress) *buf++='0'+comp;
-		/* printf("\n"); */
-	      *buf='\0';
+	      return 0;
 	}
-	return 0;
+
+	/* Split the magnitude in groups of decimal digits, with the
+	   native division when it fits in a dec_word_t. */
+      dec_groups.clear();
+      if (val.size()*LIMB_BITS <= sizeof(dec_word_t)*CHAR_BIT) {
+	    dec_word_t tmp = 0;
+	    for (idx = val.size() ; idx > 0 ; idx -= 1)
+		  tmp = (tmp << LIMB_BITS) | val[idx-1];
+	    while (tmp != 0) {
+		  dec_groups.push_back((limb_t)(tmp % DEC_BASE));
+		  tmp /= DEC_BASE;
+	    }
+      } else {
+	    unsigned k = 0;
+	    while (compare(val, dec_power(k)) >= 0)
+		  k += 1;
+	    dec_groups.resize((size_t)1 << k);
+	    to_dec_groups(val, k, &dec_groups[0]);
+      }
+
+      int zero_suppress=1;
+      if (comp) {
+	    *buf++='-';
+	    nbuf--;
+      }
+      for (idx = dec_groups.size(); idx > 0; idx -= 1) {
+	    zero_suppress = write_digits(dec_groups[idx-1],
+					 &buf,&nbuf,zero_suppress);
+      }
+	/* Awkward special case, since we don't want to
+	 * zero suppress down to nothing at all. A negative
+	 * magnitude is never zero, so this is a plain 0. */
+      if (zero_suppress) *buf++='0';
+      *buf='\0';
+      return 0;
 }
 
 void vpip_dec_str_to_vec4(vvp_vector4_t&vec, const char*buf)
@@ -288,38 +563,27 @@ void vpip_dec_str_to_vec4(vvp_vector4_t&vec, const char*buf)
 		  for (unsigned jdx = 0 ;  jdx < vec.size() ;  jdx += 1) {
 			vec.set_bit(jdx, BIT4_X);
 		  }
+		  delete[]str;
 		  return;
             }
       }
 
       str[slen] = 0;
 
-      for (unsigned idx = 0 ;  idx < vec.size() ;  idx += 1) {
-	    vvp_bit4_t val4 = BIT4_0;
-
-	    switch (str[0]) {
-		case '1':
-		case '3':
-		case '5':
-		case '7':
-		case '9':
-		  val4 = BIT4_1;
-		  break;
-	    }
-
-	    vec.set_bit(idx, val4);
-
-	      /* Divide the str string by 2 in decimal. */
-	    char*cp = str;
-	    while (*cp) {
-		  unsigned val = cp[0] - '0';
-		  if ((val&1) && (cp > str))
-			cp[-1] += 5;
-
-		  cp[0] = '0' + val/2;
-		  cp += 1;
-	    }
+	/* Collect the digits in groups, the least significant first,
+	   and build the magnitude from them. */
+      size_t ngroups = (slen + DEC_DIGITS - 1) / DEC_DIGITS;
+      std::vector<limb_t> groups (ngroups, 0);
+      for (unsigned idx = slen ;  idx > 0 ;  idx -= 1) {
+	    limb_t&group = groups[(idx-1) / DEC_DIGITS];
+	    group = group*10 + (str[idx-1] - '0');
+      }
+      limbs_t val = from_dec_groups(groups.empty()? 0 : &groups[0], ngroups);
 
+      for (unsigned idx = 0 ;  idx < vec.size() ;  idx += 1) {
+	    unsigned wdx = idx / LIMB_BITS;
+	    bool bit = wdx < val.size() && (val[wdx] >> (idx%LIMB_BITS) & 1);
+	    vec.set_bit(idx, bit? BIT4_1 : BIT4_0);
       }
 
       if (is_negative) {
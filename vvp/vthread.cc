@@ -31,7 +31,6 @@
 #ifdef CHECK_WITH_VALGRIND
 # include  "vvp_cleanup.h"
 #endif
-# include  <set>
 # include  <typeinfo>
 # include  <vector>
 # include  <cstdlib>
@@ -66,14 +65,20 @@ using namespace std;
  * Children that are detached with %join/detach need to have a different
  * parent/child relationship since the parent can still effect them if
  * it uses the %disable/fork or %wait/fork opcodes. The i_am_detached
- * flag and detached_children set are used for this relationship.
+ * flag and detached_children list are used for this relationship.
  *
  * Children placed into a task or function scope are given special
  * treatment, which is required to make task/function calls that they
- * represent work correctly. These task/function children are copied
- * into a task_func_children set to mark them for this handling. %join
- * operations will guarantee that task/function threads are joined first,
- * before any non-task/function threads.
+ * represent work correctly. These task/function children have their
+ * i_am_task_func flag set and are counted in the task_func_count of
+ * the parent to mark them for this handling. %join operations will
+ * guarantee that task/function threads are joined first, before any
+ * non-task/function threads.
+ *
+ * The children lists and the list of the threads of a scope keep
+ * their links in the threads, and the threads that end are recycled
+ * by vthread_new, so a %fork allocates no memory once some threads
+ * have ended.
  *
  * It is a programming error for a thread that created threads to not
  * %join (or %join/detach) as many as it created before it %ends. The
@@ -253,12 +258,19 @@ struct vthread_s {
       unsigned waiting_for_event :1;
       unsigned is_scheduled      :1;
       unsigned delay_delete      :1;
-	/* This points to the children of the thread. */
-      set<struct vthread_s*>children;
-	/* This points to the detached children of the thread. */
-      set<struct vthread_s*>detached_children;
+      unsigned i_am_task_func    :1;
+	/* These are the children of the thread. */
+      vthread_list_t<VTHREAD_FAMILY_LINK> children;
+	/* These are the detached children of the thread. */
+      vthread_list_t<VTHREAD_FAMILY_LINK> detached_children;
 	/* No more than 1 of the children are tasks or functions. */
-      set<vthread_s*>task_func_children;
+      unsigned task_func_count;
+	/* The links of the lists the thread is in. */
+      struct {
+	    struct vthread_s*prev;
+	    struct vthread_s*next;
+	    const void*list;
+      } link[VTHREAD_LINK_COUNT];
 	/* This points to my parent, if I have one. */
       struct vthread_s*parent;
 	/* This points to the containing scope. */
@@ -289,6 +301,53 @@ struct vthread_s {
 inline vthread_s::vthread_s()
 {
       stack_obj_size_ = 0;
+      for (unsigned idx = 0 ; idx < VTHREAD_LINK_COUNT ; idx += 1) {
+	    link[idx].prev = 0;
+	    link[idx].next = 0;
+	    link[idx].list = 0;
+      }
+}
+
+template <unsigned LINK> vthread_t vthread_list_t<LINK>::next(vthread_t thr)
+{
+      return thr->link[LINK].next;
+}
+
+template <unsigned LINK> void vthread_list_t<LINK>::push_back(vthread_t thr)
+{
+      assert(thr->link[LINK].list == 0);
+      thr->link[LINK].list = this;
+      thr->link[LINK].prev = tail_;
+      thr->link[LINK].next = 0;
+      if (tail_)
+	    tail_->link[LINK].next = thr;
+      else
+	    head_ = thr;
+      tail_ = thr;
+      count_ += 1;
+}
+
+template <unsigned LINK> size_t vthread_list_t<LINK>::erase(vthread_t thr)
+{
+      if (thr->link[LINK].list != this)
+	    return 0;
+
+      vthread_t prev = thr->link[LINK].prev;
+      vthread_t next = thr->link[LINK].next;
+      if (prev)
+	    prev->link[LINK].next = next;
+      else
+	    head_ = next;
+      if (next)
+	    next->link[LINK].prev = prev;
+      else
+	    tail_ = prev;
+
+      thr->link[LINK].prev = 0;
+      thr->link[LINK].next = 0;
+      thr->link[LINK].list = 0;
+      count_ -= 1;
+      return 1;
 }
 
 void vthread_s::debug_dump(ostream&fd, const char*label)
@@ -488,12 +547,29 @@ void contexts_delete(struct __vpiScope*scope)
 }
 #endif
 
+/*
+ * The threads that ended, ready to be used again. A recycled thread
+ * keeps the room its stacks grew to, and taking it from here costs
+ * much less than allocating and building a new one. No more than
+ * VTHREAD_POOL_MAX threads are kept, the others are deleted.
+ */
+static const unsigned VTHREAD_POOL_MAX = 1024;
+static vthread_t vthread_pool = 0;
+static unsigned vthread_pool_count = 0;
+
 /*
  * Create a new thread with the given start address.
  */
 vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
 {
-      vthread_t thr = new struct vthread_s;
+      vthread_t thr;
+      if (vthread_pool) {
+	    thr = vthread_pool;
+	    vthread_pool = thr->wait_next;
+	    vthread_pool_count -= 1;
+      } else {
+	    thr = new struct vthread_s;
+      }
       thr->pc     = pc;
 	//thr->bits4  = vvp_vector4_t(32);
       thr->parent = 0;
@@ -509,9 +585,11 @@ vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
       thr->i_have_ended  = 0;
       thr->i_was_disabled = 0;
       thr->delay_delete  = 0;
+      thr->i_am_task_func = 0;
       thr->waiting_for_event = 0;
       thr->event  = 0;
       thr->ecount = 0;
+      thr->task_func_count = 0;
 
       thr->flags[0] = BIT4_0;
       thr->flags[1] = BIT4_1;
@@ -520,7 +598,7 @@ vthread_t vthread_new(vvp_code_t pc, struct __vpiScope*scope)
       for (int idx = 4 ; idx < 8 ; idx += 1)
 	    thr->flags[idx] = BIT4_X;
 
-      scope->threads .insert(thr);
+      scope->threads.push_back(thr);
       return thr;
 }
 
@@ -554,11 +632,11 @@ static void child_delete(vthread_t base)
 
 void vthreads_delete(struct __vpiScope*scope)
 {
-      for (std::set<vthread_t>::iterator cur = scope->threads.begin()
-		 ; cur != scope->threads.end() ; ++ cur ) {
-	    delete *cur;
+      while (! scope->threads.empty()) {
+	    vthread_t cur = scope->threads.front();
+	    scope->threads.erase(cur);
+	    delete cur;
       }
-      scope->threads.clear();
 }
 #endif
 
@@ -568,27 +646,30 @@ void vthreads_delete(struct __vpiScope*scope)
  */
 static void vthread_reap(vthread_t thr)
 {
-      if (! thr->children.empty()) {
-	    for (set<vthread_t>::iterator cur = thr->children.begin()
-		       ; cur != thr->children.end() ; ++cur) {
-		  vthread_t child = *cur;
-		  assert(child);
-		  assert(child->parent == thr);
-		  child->parent = thr->parent;
-	    }
+      while (! thr->children.empty()) {
+	    vthread_t child = thr->children.front();
+	    assert(child->parent == thr);
+	    thr->children.erase(child);
+	    child->parent = thr->parent;
+	    child->i_am_task_func = 0;
+	    if (thr->parent)
+		  thr->parent->children.push_back(child);
       }
-      if (! thr->detached_children.empty()) {
-	    for (set<vthread_t>::iterator cur = thr->detached_children.begin()
-		       ; cur != thr->detached_children.end() ; ++cur) {
-		  vthread_t child = *cur;
-		  assert(child);
-		  assert(child->parent == thr);
-		  assert(child->i_am_detached);
-		  child->parent = 0;
-		  child->i_am_detached = 0;
-	    }
+      while (! thr->detached_children.empty()) {
+	    vthread_t child = thr->detached_children.front();
+	    assert(child->parent == thr);
+	    assert(child->i_am_detached);
+	    child->parent = 0;
+	    child->i_am_detached = 0;
+	    thr->detached_children.erase(child);
       }
       if (thr->parent) {
+	      /* A task or function child that did not get joined. */
+	    if (thr->i_am_task_func) {
+		  assert(thr->parent->task_func_count > 0);
+		  thr->parent->task_func_count -= 1;
+		  thr->i_am_task_func = 0;
+	    }
 	      /* assert that the given element was removed. */
 	    if (thr->i_am_detached) {
 		  size_t res = thr->parent->detached_children.erase(thr);
@@ -622,7 +703,18 @@ static void vthread_reap(vthread_t thr)
 void vthread_delete(vthread_t thr)
 {
       thr->cleanup();
+      thr->parent_scope->threads.erase(thr);
+#ifdef CHECK_WITH_VALGRIND
       delete thr;
+#else
+      if (vthread_pool_count >= VTHREAD_POOL_MAX) {
+	    delete thr;
+	    return;
+      }
+      thr->wait_next = vthread_pool;
+      vthread_pool = thr;
+      vthread_pool_count += 1;
+#endif
 }
 
 void vthread_mark_scheduled(vthread_t thr)
@@ -687,16 +779,20 @@ bool of_CHUNK_LINK(vthread_t thr, vvp_code_t code)
 /*
  * This is called by an event functor to wake up all the threads on
  * its list. I in fact created that list in the %wait instruction, and
- * I also am certain that the waiting_for_event flag is set.
+ * I also am certain that the waiting_for_event flag is set. The
+ * threads are marked as scheduled in the same pass, and the whole
+ * list is then run by a single event.
  */
 void vthread_schedule_list(vthread_t thr)
 {
       for (vthread_t cur = thr ;  cur ;  cur = cur->wait_next) {
 	    assert(cur->waiting_for_event);
+	    assert(cur->is_scheduled == 0);
 	    cur->waiting_for_event = 0;
+	    cur->is_scheduled = 1;
       }
 
-      schedule_vthread(thr, 0);
+      schedule_vthread_list(thr);
 }
 
 vvp_context_t vthread_get_wt_context()
@@ -2183,7 +2279,7 @@ static bool do_disable(vthread_t thr, vthread_t match)
 	   %forks that this thread has done. */
       while (! thr->children.empty()) {
 
-	    vthread_t tmp = *(thr->children.begin());
+	    vthread_t tmp = thr->children.front();
 	    assert(tmp);
 	    assert(tmp->parent == thr);
 	    thr->i_am_joining = 0;
@@ -2232,9 +2328,9 @@ bool of_DISABLE(vthread_t thr, vvp_code_t cp)
       bool disabled_myself_flag = false;
 
       while (! scope->threads.empty()) {
-	    set<vthread_t>::iterator cur = scope->threads.begin();
+	    vthread_t cur = scope->threads.front();
 
-	    if (do_disable(*cur, thr))
+	    if (do_disable(cur, thr))
 		  disabled_myself_flag = true;
       }
 
@@ -2256,7 +2352,7 @@ bool of_DISABLE_FORK(vthread_t thr, vvp_code_t)
 
 	/* Disable any detached children. */
       while (! thr->detached_children.empty()) {
-	    vthread_t child = *(thr->detached_children.begin());
+	    vthread_t child = thr->detached_children.front();
 	    assert(child);
 	    assert(child->parent == thr);
 	      /* Disabling the children can never match the parent thread. */
@@ -2592,13 +2688,13 @@ bool of_END(vthread_t thr, vvp_code_t)
 
 	/* Fully detach any detached children. */
       while (! thr->detached_children.empty()) {
-	    vthread_t child = *(thr->detached_children.begin());
+	    vthread_t child = thr->detached_children.front();
 	    assert(child);
 	    assert(child->parent == thr);
 	    assert(child->i_am_detached);
 	    child->parent = 0;
 	    child->i_am_detached = 0;
-	    thr->detached_children.erase(thr->detached_children.begin());
+	    thr->detached_children.erase(child);
       }
 
 	/* It is an error to still have active children running at this
@@ -2626,7 +2722,7 @@ bool of_END(vthread_t thr, vvp_code_t)
       }
 
 	/* If this thread is not fully detached then remove it from the
-	 * parents detached_children set and reap it. */
+	 * parents detached_children list and reap it. */
       if (thr->i_am_detached) {
 	    vthread_t tmp = thr->parent;
 	    assert(tmp);
@@ -2895,19 +2991,21 @@ bool of_FORK(vthread_t thr, vvp_code_t cp)
       }
 
       child->parent = thr;
-      thr->children.insert(child);
+      thr->children.push_back(child);
 
 	/* If the child scope is not the same as the current scope,
 	   infer that this is a task or function call. */
       switch (cp->scope->get_type_code()) {
 	  case vpiFunction:
-	    thr->task_func_children.insert(child);
+	    child->i_am_task_func = 1;
+	    thr->task_func_count += 1;
 	    child->is_scheduled = 1;
 	    vthread_run(child);
 	    running_thread = thr;
 	    break;
 	  case vpiTask:
-	    thr->task_func_children.insert(child);
+	    child->i_am_task_func = 1;
+	    thr->task_func_count += 1;
 	    schedule_vthread(child, 0, true);
 	    break;
 	  default:
@@ -3229,8 +3327,7 @@ bool of_JMP1XZ(vthread_t thr, vvp_code_t cp)
 
 static bool test_joinable(vthread_t thr, vthread_t child)
 {
-      set<vthread_t>::iterator cur = thr->task_func_children.find(child);
-      if (! thr->task_func_children.empty() && cur == thr->task_func_children.end())
+      if (thr->task_func_count > 0 && ! child->i_am_task_func)
 	    return false;
 
       return true;
@@ -3240,8 +3337,12 @@ static void do_join(vthread_t thr, vthread_t child)
 {
       assert(child->parent == thr);
 
-	/* Remove the thread from the task/function set if needed. */
-      thr->task_func_children.erase(child);
+	/* Remove the thread from the task/function count if needed. */
+      if (child->i_am_task_func) {
+	    assert(thr->task_func_count > 0);
+	    thr->task_func_count -= 1;
+	    child->i_am_task_func = 0;
+      }
 
         /* If the immediate child thread is in an automatic scope... */
       if (child->wt_context) {
@@ -3267,9 +3368,8 @@ bool of_JOIN(vthread_t thr, vvp_code_t)
 
 	// Are there any children that have already ended? If so, then
 	// join with that one.
-      for (set<vthread_t>::iterator cur = thr->children.begin()
-		 ; cur != thr->children.end() ; ++cur) {
-	    vthread_t curp = *cur;
+      for (vthread_t curp = thr->children.front()
+		 ; curp ; curp = thr->children.next(curp)) {
 	    if (! curp->i_have_ended)
 		  continue;
 
@@ -3295,11 +3395,11 @@ bool of_JOIN_DETACH(vthread_t thr, vvp_code_t cp)
 {
       unsigned long count = cp->number;
 
-      assert(thr->task_func_children.empty());
+      assert(thr->task_func_count == 0);
       assert(count == thr->children.size());
 
       while (! thr->children.empty()) {
-	    vthread_t child = *thr->children.begin();
+	    vthread_t child = thr->children.front();
 	    assert(child->parent == thr);
 
 	      // We cannot detach automatic tasks/functions within an
@@ -3315,7 +3415,7 @@ bool of_JOIN_DETACH(vthread_t thr, vvp_code_t cp)
 		  size_t res = child->parent->children.erase(child);
 		  assert(res == 1);
 		  child->i_am_detached = 1;
-		  thr->detached_children.insert(child);
+		  thr->detached_children.push_back(child);
 	    }
       }
 
@@ -5695,9 +5795,15 @@ bool of_WAIT(vthread_t thr, vvp_code_t cp)
       assert(! thr->waiting_for_event);
       thr->waiting_for_event = 1;
 
-	/* Add this thread to the list in the event. */
-      waitable_hooks_s*ep = dynamic_cast<waitable_hooks_s*> (cp->net->fun);
-      assert(ep);
+	/* Add this thread to the list in the event. The event functor
+	   of the instruction never changes, so only look for it the
+	   first time through. */
+      waitable_hooks_s*ep = cp->waitable;
+      if (ep == 0) {
+	    ep = dynamic_cast<waitable_hooks_s*> (cp->net->fun);
+	    assert(ep);
+	    cp->waitable = ep;
+      }
       thr->wait_next = ep->add_waiting_thread(thr);
 
 	/* Return false to suspend this thread. */
@@ -5826,7 +5932,7 @@ bool of_EXEC_UFUNC(vthread_t thr, vvp_code_t cp)
             return true;
 
       child->parent = thr;
-      thr->children.insert(child);
+      thr->children.push_back(child);
       thr->i_am_joining = 1;
       return false;
 }
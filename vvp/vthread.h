@@ -37,6 +37,43 @@
 typedef struct vthread_s* vthread_t;
 typedef struct vvp_code_s*vvp_code_t;
 
+/*
+ * A list of threads that never allocates: the links are kept in the
+ * threads themselves. LINK selects the links a list uses, so that a
+ * thread can be at the same time in the list of the threads of its
+ * scope (VTHREAD_SCOPE_LINK) and in the list of the children of its
+ * parent (VTHREAD_FAMILY_LINK). The threads stay in the order they
+ * were added.
+ */
+enum { VTHREAD_SCOPE_LINK = 0, VTHREAD_FAMILY_LINK = 1, VTHREAD_LINK_COUNT = 2 };
+
+template <unsigned LINK> class vthread_list_t {
+
+    public:
+      vthread_list_t() : head_(0), tail_(0), count_(0) { }
+
+      bool empty() const { return head_ == 0; }
+      size_t size() const { return count_; }
+      vthread_t front() const { return head_; }
+	// The thread after thr in its list, or nil.
+      static vthread_t next(vthread_t thr);
+
+      void push_back(vthread_t thr);
+	// Remove thr if it is in this list. Like std::set::erase,
+	// return the number of threads removed.
+      size_t erase(vthread_t thr);
+
+    private:
+      vthread_t head_, tail_;
+      size_t count_;
+
+    private: // Not implemented
+      vthread_list_t(const vthread_list_t&);
+      vthread_list_t& operator= (const vthread_list_t&);
+};
+
+typedef vthread_list_t<VTHREAD_SCOPE_LINK> vthread_scope_list_t;
+
 /*
  * This creates a new simulation thread, with the given start
  * address. The generated thread is ready to run, but is not yet
@@ -68,8 +68,10 @@ vvp_island::~vvp_island()
       }
 }
 
-void vvp_island::flag_island()
+void vvp_island::flag_island(vvp_island_port*port)
 {
+      port_flagged(port);
+
       if (flagged_ == true)
 	    return;
 
@@ -88,6 +90,9 @@ void vvp_island::run_run()
       run_island();
 }
 
+void vvp_island::port_flagged(vvp_island_port*)
+{
+}
 
 void vvp_island::add_port(const char*key, vvp_net_t*net)
 {
@@ -162,7 +167,7 @@ void vvp_island::compile_cleanup()
 }
 
 vvp_island_port::vvp_island_port(vvp_island*ip)
-: island_(ip)
+: island_index(0), island_(ip)
 {
 }
 
@@ -178,7 +183,7 @@ void vvp_island_port::recv_vec4(vvp_net_ptr_t, const vvp_vector4_t&bit,
 	    return;
 
       invalue = tmp;
-      island_->flag_island();
+      island_->flag_island(this);
 }
 
 void vvp_island_port::recv_vec4_pv(vvp_net_ptr_t port, const vvp_vector4_t&bit,
@@ -196,7 +201,7 @@ void vvp_island_port::recv_vec8(vvp_net_ptr_t, const vvp_vector8_t&bit)
 	    return;
 
       invalue = bit;
-      island_->flag_island();
+      island_->flag_island(this);
 }
 
 void vvp_island_port::recv_vec8_pv(vvp_net_ptr_t, const vvp_vector8_t&bit,
@@ -214,15 +219,17 @@ void vvp_island_port::recv_vec8_pv(vvp_net_ptr_t, const vvp_vector8_t&bit,
 	    }
       }
 
-      island_->flag_island();
+      island_->flag_island(this);
 }
 
 void vvp_island_port::force_flag(bool run_now)
 {
-      if (run_now)
+      if (run_now) {
+	    island_->port_flagged(this);
 	    island_->run_island();
-      else
-	    island_->flag_island();
+      } else {
+	    island_->flag_island(this);
+      }
 }
 
 vvp_island_branch::~vvp_island_branch()
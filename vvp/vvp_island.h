@@ -67,7 +67,12 @@ class vvp_island  : private vvp_gen_event_s {
 	// the input. The island will use this to create an active
 	// event. The run_run() method will then be called by the
 	// scheduler to process whatever happened.
-      void flag_island();
+      void flag_island(vvp_island_port*port);
+
+	// This is called for every port that flags the island, before
+	// the island runs. The derived island class can use it to only
+	// process the part of the island the port reaches.
+      virtual void port_flagged(vvp_island_port*port);
 
 	// This is the method that is called, eventually, to process
 	// whatever happened. The derived island class implements this
@@ -147,6 +152,10 @@ class vvp_island_port  : public vvp_net_fun_t {
       vvp_vector8_t outvalue;
       vvp_vector8_t value;
 
+	// The island may use this to find what the port is connected
+	// to within the island.
+      unsigned island_index;
+
     private:
       vvp_island*island_;
 
@@ -1053,6 +1053,38 @@ void vvp_vector4_t::resize(unsigned newsize, vvp_bit4_t pad_bit)
       }
 }
 
+void vvp_vector4_t::get_word(unsigned adr, unsigned long&abits,
+			     unsigned long&bbits) const
+{
+      if (adr >= size_) {
+	    abits = ~0UL;
+	    bbits = ~0UL;
+	    return;
+      }
+
+      if (size_ <= BITS_PER_WORD) {
+	    abits = abits_val_ >> adr;
+	    bbits = bbits_val_ >> adr;
+      } else {
+	    unsigned wdx = adr / BITS_PER_WORD;
+	    unsigned off = adr % BITS_PER_WORD;
+	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+	    abits = abits_ptr_[wdx] >> off;
+	    bbits = bbits_ptr_[wdx] >> off;
+	    if (off && wdx+1 < words) {
+		  abits |= abits_ptr_[wdx+1] << (BITS_PER_WORD-off);
+		  bbits |= bbits_ptr_[wdx+1] << (BITS_PER_WORD-off);
+	    }
+      }
+
+	/* The bits past the end are X. */
+      unsigned remain = size_ - adr;
+      if (remain < BITS_PER_WORD) {
+	    unsigned long mask = (1UL << remain) - 1;
+	    abits |= ~mask;
+	    bbits |= ~mask;
+      }
+}
 
 unsigned long* vvp_vector4_t::subarray(unsigned adr, unsigned wid, bool xz_to_0) const
 {
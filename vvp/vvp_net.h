@@ -281,6 +281,9 @@ class vvp_vector4_t {
 	// array of longs, or a nil pointer if an XZ bit was detected
 	// in the array.
       unsigned long*subarray(unsigned idx, unsigned size, bool xz_to_0 =false) const;
+	// Get the a and b bits of the unsigned long worth of bits
+	// starting at the address. The bits past the end are X.
+      void get_word(unsigned idx, unsigned long&abits, unsigned long&bbits) const;
       void setarray(unsigned idx, unsigned size, const unsigned long*val);
 
 	// Set a 4-value bit or subvector into the vector. Return true
@@ -424,6 +427,16 @@ inline vvp_vector4_t& vvp_vector4_t::operator= (const vvp_vector4_t&that)
       if (this == &that)
 	    return *this;
 
+	// A vector of the same size keeps its storage.
+      if (size_ > BITS_PER_WORD && size_ == that.size_) {
+	    unsigned words = (size_+BITS_PER_WORD-1) / BITS_PER_WORD;
+	    for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+		  abits_ptr_[idx] = that.abits_ptr_[idx];
+	    for (unsigned idx = 0 ;  idx < words ;  idx += 1)
+		  bbits_ptr_[idx] = that.bbits_ptr_[idx];
+	    return *this;
+      }
+
       if (size_ > BITS_PER_WORD)
 	    delete[] abits_ptr_;
 